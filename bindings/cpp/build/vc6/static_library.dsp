@@ -376,6 +376,10 @@ SOURCE=..\..\include\portaudiocpp\Stream.hxx
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\include\portaudiocpp\StreamGuard.hxx
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\include\portaudiocpp\StreamParameters.hxx
 # End Source File
 # Begin Source File
@@ -390,6 +394,10 @@ SOURCE=..\..\include\portaudiocpp\SystemDeviceIterator.hxx
 
 SOURCE=..\..\include\portaudiocpp\SystemHostApiIterator.hxx
 # End Source File
+# Begin Source File
+
+SOURCE=..\..\include\portaudiocpp\TypedCallbackStream.hxx
+# End Source File
 # End Group
 # End Target
 # End Project
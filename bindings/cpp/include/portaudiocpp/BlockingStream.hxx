@@ -3,7 +3,11 @@
 
 // ---------------------------------------------------------------------------------------
 
+#include <cstddef>
+#include <vector>
+
 #include "portaudiocpp/Stream.hxx"
+#include "portaudiocpp/SampleDataFormat.hxx"
 
 // ---------------------------------------------------------------------------------------
 
@@ -12,8 +16,55 @@ namespace portaudio
 
 
 
+	//////
+	/// @brief A (non-owning) range of interleaved samples, used by the typed read and 
+	/// write functions of BlockingStream. For input buffers SampleT is non-const, for 
+	/// output buffers it may be const qualified.
+	//////
+	template<typename SampleT>
+	class SampleSpan
+	{
+	public:
+		SampleSpan() : data_(NULL), size_(0) {}
+		SampleSpan(SampleT *data, std::size_t size) : data_(data), size_(size) {}
+
+		template<std::size_t N>
+		SampleSpan(SampleT (&array)[N]) : data_(array), size_(N) {}
+
+		template<typename U, typename A>
+		SampleSpan(std::vector<U, A> &v) : data_(v.empty() ? NULL : &v[0]), size_(v.size()) {}
+
+		template<typename U, typename A>
+		SampleSpan(const std::vector<U, A> &v) : data_(v.empty() ? NULL : &v[0]), size_(v.size()) {}
+
+		SampleT *data() const { return data_; }
+		std::size_t size() const { return size_; }
+
+	private:
+		SampleT *data_;
+		std::size_t size_;
+	};
+
+	// ---------------------------------------------------------------------------------------
+
 	//////
 	/// @brief Stream class for blocking read/write-style input and output.
+	///
+	/// read(void *, unsigned long) and write(const void *, unsigned long) throw a 
+	/// PaException on any error, including input overflow and output underflow. The 
+	/// typed read and write functions, and tryRead() and tryWrite(), never throw but 
+	/// return a PaError instead: paNoError, paInputOverflowed or paOutputUnderflowed when 
+	/// the data was transferred (with an overflow/underflow having occured), or an 
+	/// error code when it wasn't.
+	///
+	/// The typed functions take interleaved samples, their SampleT must match the 
+	/// stream's sample format (otherwise paSampleFormatNotSupported is returned). The 
+	/// number of frames transferred is the span's size divided by the channel count. 
+	/// For non-interleaved streams use the untyped functions.
+	///
+	/// tryRead() and tryWrite() don't block, they transfer only as many frames as are 
+	/// available. Their multi-buffer variants query the availability once for all 
+	/// the buffers, and fill or drain the buffers in order.
 	//////
 	class BlockingStream : public Stream
 	{
@@ -22,17 +73,197 @@ namespace portaudio
 		BlockingStream(const StreamParameters &parameters);
 		~BlockingStream();
 
+#if PORTAUDIOCPP_HAS_MOVE_SEMANTICS
+		BlockingStream(BlockingStream &&other) noexcept : Stream(std::move(other)), 
+			inputSampleFormat_(other.inputSampleFormat_), outputSampleFormat_(other.outputSampleFormat_), 
+			numInputChannels_(other.numInputChannels_), numOutputChannels_(other.numOutputChannels_)
+		{
+		}
+
+		BlockingStream &operator=(BlockingStream &&other)
+		{
+			if (this != &other)
+			{
+				Stream::operator=(std::move(other));
+				inputSampleFormat_ = other.inputSampleFormat_;
+				outputSampleFormat_ = other.outputSampleFormat_;
+				numInputChannels_ = other.numInputChannels_;
+				numOutputChannels_ = other.numOutputChannels_;
+			}
+			return *this;
+		}
+#endif
+
 		void open(const StreamParameters &parameters);
 
 		void read(void *buffer, unsigned long numFrames);
 		void write(const void *buffer, unsigned long numFrames);
 
+		PaError tryRead(void *buffer, unsigned long maxFrames, unsigned long &numFramesRead);
+		PaError tryWrite(const void *buffer, unsigned long maxFrames, unsigned long &numFramesWritten);
+
 		signed long availableReadSize() const;
 		signed long availableWriteSize() const;
 
+		// -----------------------------------------------------------------------------------
+
+		template<typename SampleT>
+		PaError read(SampleSpan<SampleT> buffer)
+		{
+			unsigned long numFrames;
+			PaError err = inputFrameCount(SampleFormatTraits<SampleT>::format, buffer.size(), numFrames);
+
+			if (err != paNoError)
+				return err;
+
+			return Pa_ReadStream(stream_, buffer.data(), numFrames);
+		}
+
+		template<typename SampleT>
+		PaError write(SampleSpan<SampleT> buffer)
+		{
+			unsigned long numFrames;
+			PaError err = outputFrameCount(SampleFormatTraits<SampleT>::format, buffer.size(), numFrames);
+
+			if (err != paNoError)
+				return err;
+
+			return Pa_WriteStream(stream_, buffer.data(), numFrames);
+		}
+
+		template<typename SampleT>
+		PaError read(const SampleSpan<SampleT> *buffers, std::size_t numBuffers)
+		{
+			PaError result = paNoError;
+
+			for (std::size_t i = 0; i < numBuffers; ++i)
+			{
+				PaError err = read(buffers[i]);
+
+				if (err == paInputOverflowed)
+					result = err;
+				else if (err != paNoError)
+					return err;
+			}
+
+			return result;
+		}
+
+		template<typename SampleT>
+		PaError write(const SampleSpan<SampleT> *buffers, std::size_t numBuffers)
+		{
+			PaError result = paNoError;
+
+			for (std::size_t i = 0; i < numBuffers; ++i)
+			{
+				PaError err = write(buffers[i]);
+
+				if (err == paOutputUnderflowed)
+					result = err;
+				else if (err != paNoError)
+					return err;
+			}
+
+			return result;
+		}
+
+		template<typename SampleT>
+		PaError tryRead(SampleSpan<SampleT> buffer, unsigned long &numFramesRead)
+		{
+			return tryRead(&buffer, 1, numFramesRead);
+		}
+
+		template<typename SampleT>
+		PaError tryWrite(SampleSpan<SampleT> buffer, unsigned long &numFramesWritten)
+		{
+			return tryWrite(&buffer, 1, numFramesWritten);
+		}
+
+		template<typename SampleT>
+		PaError tryRead(const SampleSpan<SampleT> *buffers, std::size_t numBuffers, unsigned long &numFramesRead)
+		{
+			numFramesRead = 0;
+
+			signed long available = Pa_GetStreamReadAvailable(stream_);
+
+			if (available < 0)
+				return static_cast<PaError>(available);
+
+			PaError result = paNoError;
+
+			for (std::size_t i = 0; i < numBuffers && available > 0; ++i)
+			{
+				unsigned long numFrames;
+				PaError err = inputFrameCount(SampleFormatTraits<SampleT>::format, buffers[i].size(), numFrames);
+
+				if (err != paNoError)
+					return err;
+
+				if (numFrames > static_cast<unsigned long>(available))
+					numFrames = static_cast<unsigned long>(available);
+
+				err = Pa_ReadStream(stream_, buffers[i].data(), numFrames);
+
+				if (err == paInputOverflowed)
+					result = err;
+				else if (err != paNoError)
+					return err;
+
+				numFramesRead += numFrames;
+				available -= numFrames;
+			}
+
+			return result;
+		}
+
+		template<typename SampleT>
+		PaError tryWrite(const SampleSpan<SampleT> *buffers, std::size_t numBuffers, unsigned long &numFramesWritten)
+		{
+			numFramesWritten = 0;
+
+			signed long available = Pa_GetStreamWriteAvailable(stream_);
+
+			if (available < 0)
+				return static_cast<PaError>(available);
+
+			PaError result = paNoError;
+
+			for (std::size_t i = 0; i < numBuffers && available > 0; ++i)
+			{
+				unsigned long numFrames;
+				PaError err = outputFrameCount(SampleFormatTraits<SampleT>::format, buffers[i].size(), numFrames);
+
+				if (err != paNoError)
+					return err;
+
+				if (numFrames > static_cast<unsigned long>(available))
+					numFrames = static_cast<unsigned long>(available);
+
+				err = Pa_WriteStream(stream_, buffers[i].data(), numFrames);
+
+				if (err == paOutputUnderflowed)
+					result = err;
+				else if (err != paNoError)
+					return err;
+
+				numFramesWritten += numFrames;
+				available -= numFrames;
+			}
+
+			return result;
+		}
+
 	private:
 		BlockingStream(const BlockingStream &); // non-copyable
 		BlockingStream &operator=(const BlockingStream &); // non-copyable
+
+		PaSampleFormat inputSampleFormat_;
+		PaSampleFormat outputSampleFormat_;
+		int numInputChannels_;
+		int numOutputChannels_;
+
+		PaError inputFrameCount(PaSampleFormat format, std::size_t numSamples, unsigned long &numFrames) const;
+		PaError outputFrameCount(PaSampleFormat format, std::size_t numSamples, unsigned long &numFrames) const;
 	};
 
 
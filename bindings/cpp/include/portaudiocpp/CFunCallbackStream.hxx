@@ -32,6 +32,11 @@ namespace portaudio
 		CFunCallbackStream();
 		CFunCallbackStream(const StreamParameters &parameters, PaStreamCallback *funPtr, void *userData);
 		~CFunCallbackStream();
+
+#if PORTAUDIOCPP_HAS_MOVE_SEMANTICS
+		CFunCallbackStream(CFunCallbackStream &&other) noexcept : CallbackStream(std::move(other)) {}
+		CFunCallbackStream &operator=(CFunCallbackStream &&other) { CallbackStream::operator=(std::move(other)); return *this; }
+#endif
 		
 		void open(const StreamParameters &parameters, PaStreamCallback *funPtr, void *userData);
 
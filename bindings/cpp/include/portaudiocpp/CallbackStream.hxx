@@ -23,6 +23,11 @@ namespace portaudio
 		CallbackStream();
 		virtual ~CallbackStream();
 
+#if PORTAUDIOCPP_HAS_MOVE_SEMANTICS
+		CallbackStream(CallbackStream &&other) noexcept : Stream(std::move(other)) {}
+		CallbackStream &operator=(CallbackStream &&other) { Stream::operator=(std::move(other)); return *this; }
+#endif
+
 	public:
 		// stream info (time-varying)
 		double cpuLoad() const;
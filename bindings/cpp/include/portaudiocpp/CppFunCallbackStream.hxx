@@ -37,6 +37,9 @@ namespace portaudio
 	//////
 	/// @brief Callback stream using a C++ function (either a free function or a static function) 
 	/// callback.
+	///
+	/// The adapter data passed to PortAudio is allocated once, by the first open(), so that 
+	/// its address stays valid when the stream is moved.
 	//////
 	class FunCallbackStream : public CallbackStream
 	{
@@ -67,13 +70,32 @@ namespace portaudio
 		FunCallbackStream(const StreamParameters &parameters, CallbackFunPtr funPtr, void *userData);
 		~FunCallbackStream();
 
+#if PORTAUDIOCPP_HAS_MOVE_SEMANTICS
+		FunCallbackStream(FunCallbackStream &&other) noexcept : CallbackStream(std::move(other)), adapterData_(other.adapterData_)
+		{
+			other.adapterData_ = NULL;
+		}
+
+		FunCallbackStream &operator=(FunCallbackStream &&other)
+		{
+			if (this != &other)
+			{
+				CallbackStream::operator=(std::move(other));
+				delete adapterData_;
+				adapterData_ = other.adapterData_;
+				other.adapterData_ = NULL;
+			}
+			return *this;
+		}
+#endif
+
 		void open(const StreamParameters &parameters, CallbackFunPtr funPtr, void *userData);
 
 	private:
 		FunCallbackStream(const FunCallbackStream &); // non-copyable
 		FunCallbackStream &operator=(const FunCallbackStream &); // non-copyable
 
-		CppToCCallbackData adapterData_;
+		CppToCCallbackData *adapterData_;
 
 		void open(const StreamParameters &parameters);
 	};
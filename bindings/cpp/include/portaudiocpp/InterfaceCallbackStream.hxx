@@ -33,6 +33,11 @@ namespace portaudio
 		InterfaceCallbackStream();
 		InterfaceCallbackStream(const StreamParameters &parameters, CallbackInterface &instance);
 		~InterfaceCallbackStream();
+
+#if PORTAUDIOCPP_HAS_MOVE_SEMANTICS
+		InterfaceCallbackStream(InterfaceCallbackStream &&other) noexcept : CallbackStream(std::move(other)) {}
+		InterfaceCallbackStream &operator=(InterfaceCallbackStream &&other) { CallbackStream::operator=(std::move(other)); return *this; }
+#endif
 		
 		void open(const StreamParameters &parameters, CallbackInterface &instance);
 
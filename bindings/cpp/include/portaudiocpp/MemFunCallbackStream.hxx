@@ -23,6 +23,9 @@ namespace portaudio
 	///
 	/// Example usage:
 	/// @verbatim MemFunCallback<MyClass> stream = MemFunCallbackStream(parameters, *this, &MyClass::myCallbackFunction); @endverbatim
+	///
+	/// The adapter passed to PortAudio is allocated once, by the first open(), so that its 
+	/// address stays valid when the stream is moved.
 	//////
 	template<typename T>
 	class MemFunCallbackStream : public CallbackStream
@@ -33,25 +36,57 @@ namespace portaudio
 
 		// -------------------------------------------------------------------------------
 
-		MemFunCallbackStream()
+		MemFunCallbackStream() : adapter_(NULL)
 		{
 		}
 
-		MemFunCallbackStream(const StreamParameters &parameters, T &instance, CallbackFunPtr memFun) : adapter_(instance, memFun)
+		MemFunCallbackStream(const StreamParameters &parameters, T &instance, CallbackFunPtr memFun) : adapter_(NULL)
 		{
-			open(parameters);
+			try
+			{
+				open(parameters, instance, memFun);
+			}
+			catch (...)
+			{
+				delete adapter_; // the destructor isn't run
+				throw;
+			}
 		}
 
 		~MemFunCallbackStream()
 		{
 			close();
+			delete adapter_;
 		}
 
+#if PORTAUDIOCPP_HAS_MOVE_SEMANTICS
+		MemFunCallbackStream(MemFunCallbackStream &&other) noexcept : CallbackStream(std::move(other)), adapter_(other.adapter_)
+		{
+			other.adapter_ = NULL;
+		}
+
+		MemFunCallbackStream &operator=(MemFunCallbackStream &&other)
+		{
+			if (this != &other)
+			{
+				CallbackStream::operator=(std::move(other));
+				delete adapter_;
+				adapter_ = other.adapter_;
+				other.adapter_ = NULL;
+			}
+			return *this;
+		}
+#endif
+
 		void open(const StreamParameters &parameters, T &instance, CallbackFunPtr memFun)
 		{
 			// XXX:	need to check if already open?
 
-			adapter_.init(instance, memFun);
+			if (adapter_ == NULL)
+				adapter_ = new MemFunToCallbackInterfaceAdapter(instance, memFun);
+			else
+				adapter_->init(instance, memFun);
+
 			open(parameters);
 		}
 
@@ -86,13 +121,13 @@ namespace portaudio
 			CallbackFunPtr memFun_;
 		};
 
-		MemFunToCallbackInterfaceAdapter adapter_;
+		MemFunToCallbackInterfaceAdapter *adapter_;
 
 		void open(const StreamParameters &parameters)
 		{
 			PaError err = Pa_OpenStream(&stream_, parameters.inputParameters().paStreamParameters(), parameters.outputParameters().paStreamParameters(), 
 				parameters.sampleRate(), parameters.framesPerBuffer(), parameters.flags(), &impl::callbackInterfaceToPaCallbackAdapter, 
-				static_cast<void *>(&adapter_));
+				static_cast<void *>(adapter_));
 
 			if (err != paNoError)
 				throw PaException(err);
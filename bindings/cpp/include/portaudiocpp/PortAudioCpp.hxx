@@ -32,6 +32,9 @@
 ///     <li>C++ exception handling instead of C-style error return codes.</li>
 ///     <li>Handling of callbacks using free functions (C and C++), static functions, member functions or instances of classes 
 ///     derived from a given interface.</li>
+///     <li>Typed callback streams which call any function object with typed views of the sample buffers, 
+///     without virtual dispatch.</li>
+///     <li>Movable streams (with a C++11 compiler) and scoped start/stop guards.</li>
 ///     <li>STL compliant iterators to host APIs and devices.</li>
 ///     <li>Some additional convenience functions to more easily set up and use PortAudio.</li>
 ///   </ul>
@@ -99,10 +102,12 @@
 #include "portaudiocpp/SampleDataFormat.hxx"
 #include "portaudiocpp/DirectionSpecificStreamParameters.hxx"
 #include "portaudiocpp/Stream.hxx"
+#include "portaudiocpp/StreamGuard.hxx"
 #include "portaudiocpp/StreamParameters.hxx"
 #include "portaudiocpp/System.hxx"
 #include "portaudiocpp/SystemDeviceIterator.hxx"
 #include "portaudiocpp/SystemHostApiIterator.hxx"
+#include "portaudiocpp/TypedCallbackStream.hxx"
 
 // ---------------------------------------------------------------------------------------
 
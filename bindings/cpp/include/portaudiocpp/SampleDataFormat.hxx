@@ -27,6 +27,24 @@ namespace portaudio
 		UINT8			= paUInt8
 	};
 
+	// ---------------------------------------------------------------------------------------
+
+	//////
+	/// @brief Maps a C++ sample type to its PortAudio sample format. Only specialized for
+	/// the types which have a native PortAudio format.
+	//////
+	template<typename SampleT>
+	struct SampleFormatTraits;
+
+	template<> struct SampleFormatTraits<float> { static const PaSampleFormat format = paFloat32; };
+	template<> struct SampleFormatTraits<int> { static const PaSampleFormat format = paInt32; };
+	template<> struct SampleFormatTraits<short> { static const PaSampleFormat format = paInt16; };
+	template<> struct SampleFormatTraits<signed char> { static const PaSampleFormat format = paInt8; };
+	template<> struct SampleFormatTraits<unsigned char> { static const PaSampleFormat format = paUInt8; };
+
+	template<typename SampleT>
+	struct SampleFormatTraits<const SampleT> : public SampleFormatTraits<SampleT> {};
+
 
 } // namespace portaudio
 
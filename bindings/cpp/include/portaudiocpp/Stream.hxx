@@ -1,10 +1,31 @@
 #ifndef INCLUDED_PORTAUDIO_STREAM_HXX
 #define INCLUDED_PORTAUDIO_STREAM_HXX
 
+#include <cstddef>
+
 #include "portaudio.h"
 
 // ---------------------------------------------------------------------------------------
 
+//////
+/// @brief Defined to 1 when the compiler supports rvalue references and noexcept, in which 
+/// case the Stream classes are movable. May be defined by the client to override detection.
+//////
+#ifndef PORTAUDIOCPP_HAS_MOVE_SEMANTICS
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+#define PORTAUDIOCPP_HAS_MOVE_SEMANTICS 1
+#else
+#define PORTAUDIOCPP_HAS_MOVE_SEMANTICS 0
+#endif
+#endif
+
+#if PORTAUDIOCPP_HAS_MOVE_SEMANTICS
+#include <memory>
+#include <utility>
+#endif
+
+// ---------------------------------------------------------------------------------------
+
 // Forward declaration(s):
 namespace portaudio
 {
@@ -30,6 +51,12 @@ namespace portaudio
 	///
 	/// The Stream object can be used to manipulate the Stream's state. Also, time-constant 
 	/// and time-varying information about the Stream can be retreived.
+	///
+	/// Streams are non-copyable. When PORTAUDIOCPP_HAS_MOVE_SEMANTICS is set the concrete 
+	/// Stream classes are movable though: moving transfers ownership of the underlying 
+	/// PaStream (which may be open, or even running) and leaves the source closed. Move 
+	/// assigning to an open Stream closes it first. This allows Streams to be stored by 
+	/// value in containers, returned from functions and handed between threads.
 	//////
 	class Stream
 	{
@@ -67,6 +94,24 @@ namespace portaudio
 	protected:
 		Stream(); // abstract class
 
+#if PORTAUDIOCPP_HAS_MOVE_SEMANTICS
+		Stream(Stream &&other) noexcept : stream_(other.stream_)
+		{
+			other.stream_ = NULL;
+		}
+
+		Stream &operator=(Stream &&other)
+		{
+			if (this != &other)
+			{
+				close();
+				stream_ = other.stream_;
+				other.stream_ = NULL;
+			}
+			return *this;
+		}
+#endif
+
 		PaStream *stream_;
 
 	private:
@@ -74,6 +119,23 @@ namespace portaudio
 		Stream &operator=(const Stream &); // non-copyable
 	};
 
+	// -----------------------------------------------------------------------------------
+
+#if PORTAUDIOCPP_HAS_MOVE_SEMANTICS
+	//////
+	/// @brief Constructs (and thus opens) a Stream of type StreamT on the heap, forwarding 
+	/// the arguments to its constructor. Throws what the constructor throws.
+	///
+	/// Example usage:
+	/// @verbatim std::unique_ptr<Stream> stream = makeStream<BlockingStream>(parameters); @endverbatim
+	//////
+	template<typename StreamT, typename... Args>
+	std::unique_ptr<StreamT> makeStream(Args &&... args)
+	{
+		return std::unique_ptr<StreamT>(new StreamT(std::forward<Args>(args)...));
+	}
+#endif
+
 
 } // namespace portaudio
 
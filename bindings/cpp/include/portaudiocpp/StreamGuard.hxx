@@ -0,0 +1,150 @@
+#ifndef INCLUDED_PORTAUDIO_STREAMGUARD_HXX
+#define INCLUDED_PORTAUDIO_STREAMGUARD_HXX
+
+// ---------------------------------------------------------------------------------------
+
+#include "portaudiocpp/Stream.hxx"
+
+// ---------------------------------------------------------------------------------------
+
+namespace portaudio
+{
+
+
+	//////
+	/// @brief A RAII idiom class which starts a Stream and ensures it's stopped again
+	/// when leaving the scope, also when an exception is raised.
+	///
+	/// The constructor throws a PaException when the Stream couldn't be started. The
+	/// destructor stops (or aborts) the Stream, ignoring errors; call end() instead to
+	/// have them reported. release() leaves the Stream running.
+	///
+	/// @verbatim
+	/// portaudio::StreamStartGuard running(stream);
+	/// stream.write(buffer, numFrames);
+	/// @endverbatim
+	//////
+	class StreamStartGuard
+	{
+	public:
+		enum EndMode
+		{
+			STOP,	///< Stop the stream, playing the buffered output.
+			ABORT	///< Abort the stream, discarding the buffered output.
+		};
+
+		explicit StreamStartGuard(Stream &stream, EndMode mode = STOP) : stream_(&stream), mode_(mode)
+		{
+			stream.start();
+		}
+
+		~StreamStartGuard()
+		{
+			try
+			{
+				end();
+			}
+			catch (...)
+			{
+				// ignore all errors
+			}
+		}
+
+		void end()
+		{
+			Stream *stream = stream_;
+			stream_ = NULL;
+
+			if (stream != NULL && !stream->isStopped())
+			{
+				if (mode_ == ABORT)
+					stream->abort();
+				else
+					stream->stop();
+			}
+		}
+
+		void release()
+		{
+			stream_ = NULL;
+		}
+
+	private:
+		StreamStartGuard(const StreamStartGuard &); // non-copyable
+		StreamStartGuard &operator=(const StreamStartGuard &); // non-copyable
+
+		Stream *stream_;
+		EndMode mode_;
+	};
+
+	// -----------------------------------------------------------------------------------
+
+	//////
+	/// @brief A RAII idiom class which stops a Stream if it's running, and restarts it
+	/// when leaving the scope. Useful to reconfigure whatever the callback uses.
+	///
+	/// The constructor throws a PaException when the Stream couldn't be stopped. The
+	/// destructor ignores errors restarting the Stream; call end() instead to have them
+	/// reported.
+	//////
+	class StreamStopGuard
+	{
+	public:
+		enum StopMode
+		{
+			STOP,	///< Stop the stream, playing the buffered output.
+			ABORT	///< Abort the stream, discarding the buffered output.
+		};
+
+		explicit StreamStopGuard(Stream &stream, StopMode mode = STOP) : stream_(NULL)
+		{
+			if (!stream.isStopped())
+			{
+				if (mode == ABORT)
+					stream.abort();
+				else
+					stream.stop();
+
+				stream_ = &stream;
+			}
+		}
+
+		~StreamStopGuard()
+		{
+			try
+			{
+				end();
+			}
+			catch (...)
+			{
+				// ignore all errors
+			}
+		}
+
+		void end()
+		{
+			Stream *stream = stream_;
+			stream_ = NULL;
+
+			if (stream != NULL)
+				stream->start();
+		}
+
+		void release()
+		{
+			stream_ = NULL;
+		}
+
+	private:
+		StreamStopGuard(const StreamStopGuard &); // non-copyable
+		StreamStopGuard &operator=(const StreamStopGuard &); // non-copyable
+
+		Stream *stream_;
+	};
+
+
+} // namespace portaudio
+
+// ---------------------------------------------------------------------------------------
+
+#endif // INCLUDED_PORTAUDIO_STREAMGUARD_HXX
@@ -0,0 +1,287 @@
+#ifndef INCLUDED_PORTAUDIO_TYPEDCALLBACKSTREAM_HXX
+#define INCLUDED_PORTAUDIO_TYPEDCALLBACKSTREAM_HXX
+
+// ---------------------------------------------------------------------------------------
+
+#include <cstddef>
+
+#include "portaudio.h"
+
+#include "portaudiocpp/CallbackStream.hxx"
+#include "portaudiocpp/SampleDataFormat.hxx"
+#include "portaudiocpp/StreamParameters.hxx"
+#include "portaudiocpp/Exception.hxx"
+
+// ---------------------------------------------------------------------------------------
+
+namespace portaudio
+{
+
+
+	//////
+	/// @brief View of the samples of one channel in a buffer. Interleaved channels are
+	/// strided, non-interleaved channels are contiguous.
+	//////
+	template<typename SampleT, bool Interleaved>
+	class ChannelView;
+
+	template<typename SampleT>
+	class ChannelView<SampleT, true>
+	{
+	public:
+		ChannelView(SampleT *data, unsigned long numFrames, int stride) : data_(data), numFrames_(numFrames), stride_(stride) {}
+
+		SampleT &operator[](unsigned long frame) const { return data_[frame * stride_]; }
+		unsigned long size() const { return numFrames_; }
+		int stride() const { return stride_; }
+
+	private:
+		SampleT *data_;
+		unsigned long numFrames_;
+		int stride_;
+	};
+
+	template<typename SampleT>
+	class ChannelView<SampleT, false>
+	{
+	public:
+		ChannelView(SampleT *data, unsigned long numFrames) : data_(data), numFrames_(numFrames) {}
+
+		SampleT &operator[](unsigned long frame) const { return data_[frame]; }
+		unsigned long size() const { return numFrames_; }
+		SampleT *data() const { return data_; }
+		SampleT *begin() const { return data_; }
+		SampleT *end() const { return data_ + numFrames_; }
+
+	private:
+		SampleT *data_;
+		unsigned long numFrames_;
+	};
+
+	// ---------------------------------------------------------------------------------------
+
+	//////
+	/// @brief Typed view of a callback's input or output buffer. The view doesn't own the
+	/// samples, and is only valid during the callback.
+	///
+	/// For input buffers SampleT is const qualified. A view of a direction the stream
+	/// doesn't have is empty (0 channels).
+	//////
+	template<typename SampleT, bool Interleaved>
+	class BufferView;
+
+	template<typename SampleT>
+	class BufferView<SampleT, true>
+	{
+	public:
+		typedef ChannelView<SampleT, true> Channel;
+
+		BufferView(SampleT *data, unsigned long numFrames, int numChannels) : data_(data), numFrames_(numFrames), numChannels_(numChannels) {}
+
+		SampleT &operator()(unsigned long frame, int channel) const { return data_[frame * numChannels_ + channel]; }
+		Channel channel(int channel) const { return Channel(data_ + channel, numFrames_, numChannels_); }
+
+		/// Pointer to the numChannels() samples of a frame.
+		SampleT *frame(unsigned long frame) const { return data_ + frame * numChannels_; }
+
+		/// All samples in order, as a single contiguous range.
+		SampleT *data() const { return data_; }
+		SampleT *begin() const { return data_; }
+		SampleT *end() const { return data_ + numFrames_ * numChannels_; }
+
+		unsigned long numFrames() const { return numFrames_; }
+		int numChannels() const { return numChannels_; }
+		bool empty() const { return numChannels_ == 0; }
+
+	private:
+		SampleT *data_;
+		unsigned long numFrames_;
+		int numChannels_;
+	};
+
+	template<typename SampleT>
+	class BufferView<SampleT, false>
+	{
+	public:
+		typedef ChannelView<SampleT, false> Channel;
+
+		BufferView(SampleT *const *data, unsigned long numFrames, int numChannels) : data_(data), numFrames_(numFrames), numChannels_(numChannels) {}
+
+		SampleT &operator()(unsigned long frame, int channel) const { return data_[channel][frame]; }
+		Channel channel(int channel) const { return Channel(data_[channel], numFrames_); }
+
+		unsigned long numFrames() const { return numFrames_; }
+		int numChannels() const { return numChannels_; }
+		bool empty() const { return numChannels_ == 0; }
+
+	private:
+		SampleT *const *data_;
+		unsigned long numFrames_;
+		int numChannels_;
+	};
+
+	// ---------------------------------------------------------------------------------------
+
+	//////
+	/// @brief Callback stream which calls an arbitrary callable (function object, lambda)
+	/// with typed views of the input and output buffers.
+	///
+	/// The callable's type is bound at compile time: open() instantiates a C callback for
+	/// it, which calls it directly. Unlike the other callback streams there is no virtual
+	/// call, and the callable can be inlined into the callback. The callable is called as:
+	/// @verbatim int callable(const InputBuffer &in, const OutputBuffer &out, const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags statusFlags) @endverbatim
+	/// and returns a PaStreamCallbackResult. The callable is held by reference, it must
+	/// outlive the stream. What the callback needs is allocated once, by the first open(),
+	/// so that its address stays valid when the stream is moved.
+	///
+	/// The sample formats of the stream parameters must match SampleT and Interleaved,
+	/// otherwise open() throws a PaException with paSampleFormatNotSupported.
+	///
+	/// Example usage:
+	/// @verbatim Gain gain; TypedCallbackStream<float> stream(parameters, gain); @endverbatim
+	//////
+	template<typename SampleT, bool Interleaved = true>
+	class TypedCallbackStream : public CallbackStream
+	{
+	public:
+		typedef BufferView<const SampleT, Interleaved> InputBuffer;
+		typedef BufferView<SampleT, Interleaved> OutputBuffer;
+
+		// -------------------------------------------------------------------------------
+
+		TypedCallbackStream() : binding_(NULL)
+		{
+		}
+
+		template<typename Callable>
+		TypedCallbackStream(const StreamParameters &parameters, Callable &callable) : binding_(NULL)
+		{
+			try
+			{
+				open(parameters, callable);
+			}
+			catch (...)
+			{
+				delete binding_; // the destructor isn't run
+				throw;
+			}
+		}
+
+		~TypedCallbackStream()
+		{
+			try
+			{
+				close();
+			}
+			catch (...)
+			{
+				// ignore all errors
+			}
+			delete binding_;
+		}
+
+#if PORTAUDIOCPP_HAS_MOVE_SEMANTICS
+		TypedCallbackStream(TypedCallbackStream &&other) noexcept : CallbackStream(std::move(other)), binding_(other.binding_)
+		{
+			other.binding_ = NULL;
+		}
+
+		TypedCallbackStream &operator=(TypedCallbackStream &&other)
+		{
+			if (this != &other)
+			{
+				CallbackStream::operator=(std::move(other));
+				delete binding_;
+				binding_ = other.binding_;
+				other.binding_ = NULL;
+			}
+			return *this;
+		}
+#endif
+
+		template<typename Callable>
+		void open(const StreamParameters &parameters, Callable &callable)
+		{
+			const PaStreamParameters *inputParameters = parameters.inputParameters().paStreamParameters();
+			const PaStreamParameters *outputParameters = parameters.outputParameters().paStreamParameters();
+
+			if (!isMatchingFormat(inputParameters) || !isMatchingFormat(outputParameters))
+				throw PaException(paSampleFormatNotSupported);
+
+			if (binding_ == NULL)
+				binding_ = new Binding;
+
+			binding_->callable = const_cast<void *>(static_cast<const void *>(&callable));
+			binding_->numInputChannels = (inputParameters != NULL) ? inputParameters->channelCount : 0;
+			binding_->numOutputChannels = (outputParameters != NULL) ? outputParameters->channelCount : 0;
+
+			PaError err = Pa_OpenStream(&stream_, inputParameters, outputParameters,
+				parameters.sampleRate(), parameters.framesPerBuffer(), parameters.flags(), &callbackAdapter<Callable>,
+				static_cast<void *>(binding_));
+
+			if (err != paNoError)
+				throw PaException(err);
+		}
+
+	private:
+		TypedCallbackStream(const TypedCallbackStream &); // non-copyable
+		TypedCallbackStream &operator=(const TypedCallbackStream &); // non-copyable
+
+		// passed to the callback as user data
+		struct Binding
+		{
+			void *callable;
+			int numInputChannels;
+			int numOutputChannels;
+		};
+
+		Binding *binding_;
+
+		// selects the buffer pointer type at compile time
+		template<bool IsInterleaved> struct Layout {};
+
+		static bool isMatchingFormat(const PaStreamParameters *parameters)
+		{
+			return parameters == NULL || parameters->sampleFormat ==
+				(SampleFormatTraits<SampleT>::format | (Interleaved ? 0 : paNonInterleaved));
+		}
+
+		static const SampleT *inputPointer(const void *inputBuffer, Layout<true>)
+		{
+			return static_cast<const SampleT *>(inputBuffer);
+		}
+
+		static const SampleT *const *inputPointer(const void *inputBuffer, Layout<false>)
+		{
+			return static_cast<const SampleT *const *>(inputBuffer);
+		}
+
+		static SampleT *outputPointer(void *outputBuffer, Layout<true>)
+		{
+			return static_cast<SampleT *>(outputBuffer);
+		}
+
+		static SampleT *const *outputPointer(void *outputBuffer, Layout<false>)
+		{
+			return static_cast<SampleT *const *>(outputBuffer);
+		}
+
+		template<typename Callable>
+		static int callbackAdapter(const void *inputBuffer, void *outputBuffer, unsigned long numFrames,
+			const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags statusFlags, void *userData)
+		{
+			const Binding *binding = static_cast<const Binding *>(userData);
+
+			return (*static_cast<Callable *>(binding->callable))(
+				InputBuffer(inputPointer(inputBuffer, Layout<Interleaved>()), numFrames, binding->numInputChannels),
+				OutputBuffer(outputPointer(outputBuffer, Layout<Interleaved>()), numFrames, binding->numOutputChannels),
+				timeInfo, statusFlags);
+		}
+	};
+
+
+} // namespace portaudio
+
+// ---------------------------------------------------------------------------------------
+
+#endif // INCLUDED_PORTAUDIO_TYPEDCALLBACKSTREAM_HXX
@@ -10,11 +10,12 @@ namespace portaudio
 
 	// --------------------------------------------------------------------------------------
 
-	BlockingStream::BlockingStream()
+	BlockingStream::BlockingStream() : inputSampleFormat_(0), outputSampleFormat_(0), numInputChannels_(0), numOutputChannels_(0)
 	{
 	}
 
-	BlockingStream::BlockingStream(const StreamParameters &parameters)
+	BlockingStream::BlockingStream(const StreamParameters &parameters) : inputSampleFormat_(0), outputSampleFormat_(0), 
+		numInputChannels_(0), numOutputChannels_(0)
 	{
 		open(parameters);
 	}
@@ -35,13 +36,22 @@ namespace portaudio
 
 	void BlockingStream::open(const StreamParameters &parameters)
 	{
-		PaError err = Pa_OpenStream(&stream_, parameters.inputParameters().paStreamParameters(), parameters.outputParameters().paStreamParameters(), 
+		const PaStreamParameters *inputParameters = parameters.inputParameters().paStreamParameters();
+		const PaStreamParameters *outputParameters = parameters.outputParameters().paStreamParameters();
+
+		PaError err = Pa_OpenStream(&stream_, inputParameters, outputParameters, 
 			parameters.sampleRate(), parameters.framesPerBuffer(), parameters.flags(), NULL, NULL);
 
 		if (err != paNoError)
 		{
 			throw PaException(err);
 		}
+
+		// kept for the typed read/write functions
+		inputSampleFormat_ = (inputParameters != NULL) ? inputParameters->sampleFormat : 0;
+		outputSampleFormat_ = (outputParameters != NULL) ? outputParameters->sampleFormat : 0;
+		numInputChannels_ = (inputParameters != NULL) ? inputParameters->channelCount : 0;
+		numOutputChannels_ = (outputParameters != NULL) ? outputParameters->channelCount : 0;
 	}
 
 	// --------------------------------------------------------------------------------------
@@ -66,6 +76,64 @@ namespace portaudio
 		}
 	}
 
+	//////
+	/// Reads at most maxFrames frames, without blocking: only as many frames as are 
+	/// available are read. Doesn't throw, returns a PaError code instead.
+	//////
+	PaError BlockingStream::tryRead(void *buffer, unsigned long maxFrames, unsigned long &numFramesRead)
+	{
+		numFramesRead = 0;
+
+		signed long available = Pa_GetStreamReadAvailable(stream_);
+
+		if (available < 0)
+			return static_cast<PaError>(available);
+
+		unsigned long numFrames = static_cast<unsigned long>(available);
+
+		if (numFrames > maxFrames)
+			numFrames = maxFrames;
+
+		if (numFrames == 0)
+			return paNoError;
+
+		PaError err = Pa_ReadStream(stream_, buffer, numFrames);
+
+		if (err == paNoError || err == paInputOverflowed)
+			numFramesRead = numFrames;
+
+		return err;
+	}
+
+	//////
+	/// Writes at most maxFrames frames, without blocking: only as many frames as there 
+	/// is space for are written. Doesn't throw, returns a PaError code instead.
+	//////
+	PaError BlockingStream::tryWrite(const void *buffer, unsigned long maxFrames, unsigned long &numFramesWritten)
+	{
+		numFramesWritten = 0;
+
+		signed long available = Pa_GetStreamWriteAvailable(stream_);
+
+		if (available < 0)
+			return static_cast<PaError>(available);
+
+		unsigned long numFrames = static_cast<unsigned long>(available);
+
+		if (numFrames > maxFrames)
+			numFrames = maxFrames;
+
+		if (numFrames == 0)
+			return paNoError;
+
+		PaError err = Pa_WriteStream(stream_, buffer, numFrames);
+
+		if (err == paNoError || err == paOutputUnderflowed)
+			numFramesWritten = numFrames;
+
+		return err;
+	}
+
 	// --------------------------------------------------------------------------------------
 
 	signed long BlockingStream::availableReadSize() const
@@ -94,6 +162,38 @@ namespace portaudio
 
 	// --------------------------------------------------------------------------------------
 
+	PaError BlockingStream::inputFrameCount(PaSampleFormat format, std::size_t numSamples, unsigned long &numFrames) const
+	{
+		if (!isOpen())
+			return paBadStreamPtr;
+
+		if (numInputChannels_ == 0)
+			return paCanNotReadFromAnOutputOnlyStream;
+
+		if (format != inputSampleFormat_)
+			return paSampleFormatNotSupported;
+
+		numFrames = static_cast<unsigned long>(numSamples / numInputChannels_);
+		return paNoError;
+	}
+
+	PaError BlockingStream::outputFrameCount(PaSampleFormat format, std::size_t numSamples, unsigned long &numFrames) const
+	{
+		if (!isOpen())
+			return paBadStreamPtr;
+
+		if (numOutputChannels_ == 0)
+			return paCanNotWriteToAnInputOnlyStream;
+
+		if (format != outputSampleFormat_)
+			return paSampleFormatNotSupported;
+
+		numFrames = static_cast<unsigned long>(numSamples / numOutputChannels_);
+		return paNoError;
+	}
+
+	// --------------------------------------------------------------------------------------
+
 } // portaudio
 
 
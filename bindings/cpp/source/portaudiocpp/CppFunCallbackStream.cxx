@@ -38,13 +38,21 @@ namespace portaudio
 
 	// -----------------------------------------------------------------------------------
 
-	FunCallbackStream::FunCallbackStream()
+	FunCallbackStream::FunCallbackStream() : adapterData_(NULL)
 	{
 	}
 
-	FunCallbackStream::FunCallbackStream(const StreamParameters &parameters, CallbackFunPtr funPtr, void *userData) : adapterData_(funPtr, userData)
+	FunCallbackStream::FunCallbackStream(const StreamParameters &parameters, CallbackFunPtr funPtr, void *userData) : adapterData_(NULL)
 	{
-		open(parameters);
+		try
+		{
+			open(parameters, funPtr, userData);
+		}
+		catch (...)
+		{
+			delete adapterData_; // the destructor isn't run
+			throw;
+		}
 	}
 
 	FunCallbackStream::~FunCallbackStream()
@@ -57,11 +65,17 @@ namespace portaudio
 		{
 			// ignore all errors
 		}
+
+		delete adapterData_;
 	}
 
 	void FunCallbackStream::open(const StreamParameters &parameters, CallbackFunPtr funPtr, void *userData)
 	{
-		adapterData_.init(funPtr, userData);
+		if (adapterData_ == NULL)
+			adapterData_ = new CppToCCallbackData(funPtr, userData);
+		else
+			adapterData_->init(funPtr, userData);
+
 		open(parameters);
 	}
 
@@ -69,7 +83,7 @@ namespace portaudio
 	{
 		PaError err = Pa_OpenStream(&stream_, parameters.inputParameters().paStreamParameters(), parameters.outputParameters().paStreamParameters(), 
 			parameters.sampleRate(), parameters.framesPerBuffer(), parameters.flags(), &impl::cppCallbackToPaCallbackAdapter, 
-			static_cast<void *>(&adapterData_));
+			static_cast<void *>(adapterData_));
 
 		if (err != paNoError)
 		{
@@ -74,15 +74,35 @@ JNIEXPORT jint JNICALL Java_com_portaudio_BlockingStream_getWriteAvailable
 }
 
 
-/*
- * Class:     com_portaudio_BlockingStream
- * Method:    writeFloats
- * Signature: ([FI)Z
- */
-JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_writeFloats
-  (JNIEnv *env, jobject blockingStream, jfloatArray buffer, jint numFrames)
+/* Heap arrays are pinned with GetPrimitiveArrayCritical, which doesn't copy on
+ most VMs, but holds off the garbage collector until it is released. So it is only
+ used when the transfer completes without blocking, otherwise the array elements
+ are accessed with Get<Type>ArrayElements.
+*/
+static void *LockArray( JNIEnv *env, jarray buffer, int isFloat, int critical )
 {
-	jfloat *carr;
+	if( critical )
+		return (*env)->GetPrimitiveArrayCritical( env, buffer, NULL );
+	else if( isFloat )
+		return (*env)->GetFloatArrayElements( env, (jfloatArray) buffer, NULL );
+	else
+		return (*env)->GetShortArrayElements( env, (jshortArray) buffer, NULL );
+}
+
+static void UnlockArray( JNIEnv *env, jarray buffer, void *carr, int isFloat, int critical, jint mode )
+{
+	if( critical )
+		(*env)->ReleasePrimitiveArrayCritical( env, buffer, carr, mode );
+	else if( isFloat )
+		(*env)->ReleaseFloatArrayElements( env, (jfloatArray) buffer, (jfloat *) carr, mode );
+	else
+		(*env)->ReleaseShortArrayElements( env, (jshortArray) buffer, (jshort *) carr, mode );
+}
+
+static jboolean ReadArray( JNIEnv *env, jobject blockingStream, jarray buffer, jint numFrames, int isFloat )
+{
+	void *carr;
+	int critical;
 	jint err;
 	PaStream *stream =jpa_GetStreamPointer( env, blockingStream );
 	if( buffer == NULL )
@@ -91,16 +111,17 @@ JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_writeFloats
                   "null stream buffer");
 		return FALSE;
 	}
-	carr = (*env)->GetFloatArrayElements(env, buffer, NULL);
+	critical = ( Pa_GetStreamReadAvailable( stream ) >= numFrames );
+	carr = LockArray( env, buffer, isFloat, critical );
 	if (carr == NULL)
 	{
 		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
                   "invalid stream buffer");
 		return FALSE;
 	}
-	err = Pa_WriteStream( stream, carr, numFrames );
-	(*env)->ReleaseFloatArrayElements(env, buffer, carr, 0);
-	if( err == paOutputUnderflowed )
+	err = Pa_ReadStream( stream, carr, numFrames );
+	UnlockArray( env, buffer, carr, isFloat, critical, 0 );
+	if( err == paInputOverflowed )
 	{
 		return TRUE;
 	}
@@ -111,15 +132,10 @@ JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_writeFloats
 	}
 }
 
-/*
- * Class:     com_portaudio_BlockingStream
- * Method:    readFloats
- * Signature: ([FI)Z
- */
-JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_readFloats
-  (JNIEnv *env, jobject blockingStream, jfloatArray buffer, jint numFrames)
+static jboolean WriteArray( JNIEnv *env, jobject blockingStream, jarray buffer, jint numFrames, int isFloat )
 {
-	jfloat *carr;
+	void *carr;
+	int critical;
 	jint err;
 	PaStream *stream =jpa_GetStreamPointer( env, blockingStream );
 	if( buffer == NULL )
@@ -128,16 +144,18 @@ JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_readFloats
                   "null stream buffer");
 		return FALSE;
 	}
-	carr = (*env)->GetFloatArrayElements(env, buffer, NULL);
+	critical = ( Pa_GetStreamWriteAvailable( stream ) >= numFrames );
+	carr = LockArray( env, buffer, isFloat, critical );
 	if (carr == NULL)
 	{
 		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
                   "invalid stream buffer");
 		return FALSE;
 	}
-	err = Pa_ReadStream( stream, carr, numFrames );
-	(*env)->ReleaseFloatArrayElements(env, buffer, carr, 0);
-	if( err == paInputOverflowed )
+	err = Pa_WriteStream( stream, carr, numFrames );
+	/* the samples weren't modified, don't copy them back */
+	UnlockArray( env, buffer, carr, isFloat, critical, JNI_ABORT );
+	if( err == paOutputUnderflowed )
 	{
 		return TRUE;
 	}
@@ -148,33 +166,78 @@ JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_readFloats
 	}
 }
 
+/*
+ * Class:     com_portaudio_BlockingStream
+ * Method:    writeFloats
+ * Signature: ([FI)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_writeFloats
+  (JNIEnv *env, jobject blockingStream, jfloatArray buffer, jint numFrames)
+{
+	return WriteArray( env, blockingStream, buffer, numFrames, TRUE );
+}
+
+/*
+ * Class:     com_portaudio_BlockingStream
+ * Method:    readFloats
+ * Signature: ([FI)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_readFloats
+  (JNIEnv *env, jobject blockingStream, jfloatArray buffer, jint numFrames)
+{
+	return ReadArray( env, blockingStream, buffer, numFrames, TRUE );
+}
+
 /*
  * Class:     com_portaudio_BlockingStream
  * Method:    writeShorts
  * Signature: ([SI)Z
  */
 JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_writeShorts
-  (JNIEnv *env, jobject blockingStream, jfloatArray buffer, jint numFrames)
+  (JNIEnv *env, jobject blockingStream, jshortArray buffer, jint numFrames)
 {
-	jshort *carr;
-	jint err;
-	PaStream *stream =jpa_GetStreamPointer( env, blockingStream );
-	if( buffer == NULL )
-	{
-		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
-                  "null stream buffer");
-		return FALSE;
-	}
-	carr = (*env)->GetShortArrayElements(env, buffer, NULL);
-	if (carr == NULL)
+	return WriteArray( env, blockingStream, buffer, numFrames, FALSE );
+}
+
+/*
+ * Class:     com_portaudio_BlockingStream
+ * Method:    readShorts
+ * Signature: ([SI)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_readShorts
+  (JNIEnv *env, jobject blockingStream, jshortArray buffer, jint numFrames)
+{
+	return ReadArray( env, blockingStream, buffer, numFrames, FALSE );
+}
+
+/* Direct buffers aren't moved by the garbage collector, their samples are
+ transferred in place. The Java side checks the format, size and byte order. */
+static char *GetDirectAddress( JNIEnv *env, jobject buffer, jint byteOffset )
+{
+	char *address = (buffer == NULL) ? NULL : (char *) (*env)->GetDirectBufferAddress( env, buffer );
+	if( address == NULL )
 	{
-		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
-                  "invalid stream buffer");
-		return FALSE;
+		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/IllegalArgumentException"),
+                  "not a direct buffer");
+		return NULL;
 	}
-	err = Pa_WriteStream( stream, carr, numFrames );
-	(*env)->ReleaseShortArrayElements(env, buffer, carr, 0);
-	if( err == paOutputUnderflowed )
+	return address + byteOffset;
+}
+
+/*
+ * Class:     com_portaudio_BlockingStream
+ * Method:    readDirect
+ * Signature: (Ljava/nio/Buffer;II)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_readDirect
+  (JNIEnv *env, jobject blockingStream, jobject buffer, jint byteOffset, jint numFrames)
+{
+	jint err;
+	PaStream *stream =jpa_GetStreamPointer( env, blockingStream );
+	char *address = GetDirectAddress( env, buffer, byteOffset );
+	if( address == NULL ) return FALSE;
+	err = Pa_ReadStream( stream, address, numFrames );
+	if( err == paInputOverflowed )
 	{
 		return TRUE;
 	}
@@ -187,31 +250,18 @@ JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_writeShorts
 
 /*
  * Class:     com_portaudio_BlockingStream
- * Method:    readShorts
- * Signature: ([SI)Z
+ * Method:    writeDirect
+ * Signature: (Ljava/nio/Buffer;II)Z
  */
-JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_readShorts
-  (JNIEnv *env, jobject blockingStream, jfloatArray buffer, jint numFrames)
+JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_writeDirect
+  (JNIEnv *env, jobject blockingStream, jobject buffer, jint byteOffset, jint numFrames)
 {
-	jshort *carr;
 	jint err;
 	PaStream *stream =jpa_GetStreamPointer( env, blockingStream );
-	if( buffer == NULL )
-	{
-		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
-                  "null stream buffer");
-		return FALSE;
-	}
-	carr = (*env)->GetShortArrayElements(env, buffer, NULL);
-	if (carr == NULL)
-	{
-		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
-                  "invalid stream buffer");
-		return FALSE;
-	}
-	err = Pa_ReadStream( stream, carr, numFrames );
-	(*env)->ReleaseShortArrayElements(env, buffer, carr, 0);
-	if( err == paInputOverflowed )
+	char *address = GetDirectAddress( env, buffer, byteOffset );
+	if( address == NULL ) return FALSE;
+	err = Pa_WriteStream( stream, address, numFrames );
+	if( err == paOutputUnderflowed )
 	{
 		return TRUE;
 	}
@@ -0,0 +1,626 @@
+/*
+ * Portable Audio I/O Library
+ * Java Binding for PortAudio
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 2008 Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+/* The PortAudio callback of a CallbackStream never calls into the JVM, where it
+ could block, for example for a garbage collection. Instead it hands each block
+ to a bridge thread, which is attached to the JVM once and calls the Java
+ StreamCallback with direct buffers allocated when the stream is opened. The
+ PortAudio callback waits for the bridge thread until a deadline, and plays
+ silence if the Java callback hasn't returned by then.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <process.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#include <dispatch/dispatch.h>
+#else
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <errno.h>
+#endif
+
+#include "com_portaudio_CallbackStream.h"
+#include "com_portaudio_BlockingStream.h"
+#include "portaudio.h"
+#include "jpa_tools.h"
+
+/* The part of a block's duration the PortAudio callback waits for the Java
+ callback, the rest is left to the host API. */
+#define JPA_DEADLINE_FRACTION  (0.75)
+
+#if defined(_WIN32)
+typedef HANDLE JpaSemaphore;
+typedef DWORD JpaDeadline; /* in GetTickCount() milliseconds */
+typedef HANDLE JpaThread;
+#elif defined(__APPLE__)
+typedef dispatch_semaphore_t JpaSemaphore;
+typedef dispatch_time_t JpaDeadline;
+typedef pthread_t JpaThread;
+#else
+typedef sem_t JpaSemaphore;
+typedef struct timespec JpaDeadline;
+typedef pthread_t JpaThread;
+#endif
+
+typedef struct JpaBridge
+{
+	JavaVM *vm;
+	jobject callback; /* global references */
+	jobject inputBuffer;
+	jobject outputBuffer;
+	jmethodID processMethod;
+	jmethodID clearMethod;
+
+	void *inputMemory;
+	void *outputMemory;
+	unsigned long inputBytesPerFrame;
+	unsigned long outputBytesPerFrame;
+	int outputSilence; /* byte value */
+	double deadline; /* in seconds */
+
+	int semaphoresInitialized;
+	JpaSemaphore requestSemaphore;
+	JpaSemaphore doneSemaphore;
+	int threadStarted;
+	JpaThread thread;
+	volatile int quit;
+
+	/* requestCount is only written by the PortAudio callback, completedCount
+	 only by the bridge thread. The bridge thread is busy while they differ. */
+	volatile unsigned long requestCount;
+	volatile unsigned long completedCount;
+	volatile unsigned long frameCount;
+	volatile int statusFlags;
+	volatile int result;
+
+	PaStreamCallbackFlags pendingFlags; /* for the next request */
+	volatile jint missedDeadlineCount;
+} JpaBridge;
+
+/* -------------------------------------------------------------------------- */
+
+#if defined(_WIN32)
+
+static int InitSemaphore( JpaSemaphore *semaphore )
+{
+	*semaphore = CreateSemaphore( NULL, 0, 0x7FFFFFFF, NULL );
+	return (*semaphore != NULL) ? 0 : -1;
+}
+
+static void TermSemaphore( JpaSemaphore *semaphore )
+{
+	CloseHandle( *semaphore );
+}
+
+static void PostSemaphore( JpaSemaphore *semaphore )
+{
+	ReleaseSemaphore( *semaphore, 1, NULL );
+}
+
+static void WaitSemaphore( JpaSemaphore *semaphore )
+{
+	WaitForSingleObject( *semaphore, INFINITE );
+}
+
+static void SetDeadline( JpaDeadline *deadline, double seconds )
+{
+	*deadline = GetTickCount() + (DWORD) (seconds * 1000.);
+}
+
+/* returns non-zero if the semaphore was signalled before the deadline */
+static int TimedWaitSemaphore( JpaSemaphore *semaphore, const JpaDeadline *deadline )
+{
+	LONG remaining = (LONG) (*deadline - GetTickCount());
+	return WaitForSingleObject( *semaphore, (remaining > 0) ? (DWORD) remaining : 0 ) == WAIT_OBJECT_0;
+}
+
+#elif defined(__APPLE__)
+
+static int InitSemaphore( JpaSemaphore *semaphore )
+{
+	*semaphore = dispatch_semaphore_create( 0 );
+	return (*semaphore != NULL) ? 0 : -1;
+}
+
+static void TermSemaphore( JpaSemaphore *semaphore )
+{
+	dispatch_release( *semaphore );
+}
+
+static void PostSemaphore( JpaSemaphore *semaphore )
+{
+	dispatch_semaphore_signal( *semaphore );
+}
+
+static void WaitSemaphore( JpaSemaphore *semaphore )
+{
+	dispatch_semaphore_wait( *semaphore, DISPATCH_TIME_FOREVER );
+}
+
+static void SetDeadline( JpaDeadline *deadline, double seconds )
+{
+	*deadline = dispatch_time( DISPATCH_TIME_NOW, (int64_t) (seconds * 1e9) );
+}
+
+/* returns non-zero if the semaphore was signalled before the deadline */
+static int TimedWaitSemaphore( JpaSemaphore *semaphore, const JpaDeadline *deadline )
+{
+	return dispatch_semaphore_wait( *semaphore, *deadline ) == 0;
+}
+
+#else
+
+static int InitSemaphore( JpaSemaphore *semaphore )
+{
+	return sem_init( semaphore, 0, 0 );
+}
+
+static void TermSemaphore( JpaSemaphore *semaphore )
+{
+	sem_destroy( semaphore );
+}
+
+static void PostSemaphore( JpaSemaphore *semaphore )
+{
+	sem_post( semaphore );
+}
+
+static void WaitSemaphore( JpaSemaphore *semaphore )
+{
+	while( sem_wait( semaphore ) != 0 && errno == EINTR )
+		;
+}
+
+static void SetDeadline( JpaDeadline *deadline, double seconds )
+{
+	long nanoseconds = (long) (seconds * 1e9);
+	clock_gettime( CLOCK_REALTIME, deadline );
+	deadline->tv_sec += nanoseconds / 1000000000;
+	deadline->tv_nsec += nanoseconds % 1000000000;
+	if( deadline->tv_nsec >= 1000000000 )
+	{
+		deadline->tv_sec += 1;
+		deadline->tv_nsec -= 1000000000;
+	}
+}
+
+/* returns non-zero if the semaphore was signalled before the deadline */
+static int TimedWaitSemaphore( JpaSemaphore *semaphore, const JpaDeadline *deadline )
+{
+	int result;
+	while( (result = sem_timedwait( semaphore, deadline )) != 0 && errno == EINTR )
+		;
+	return result == 0;
+}
+
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+static int BridgeCallback( const void *input, void *output,
+		unsigned long frameCount, const PaStreamCallbackTimeInfo* timeInfo,
+		PaStreamCallbackFlags statusFlags, void *userData )
+{
+	JpaBridge *bridge = (JpaBridge *) userData;
+	unsigned long outputBytes = frameCount * bridge->outputBytesPerFrame;
+	JpaDeadline deadline;
+
+	(void) timeInfo; /* unused */
+
+	SetDeadline( &deadline, bridge->deadline );
+
+	if( bridge->completedCount == bridge->requestCount )
+	{
+		if( input != NULL )
+			memcpy( bridge->inputMemory, input, frameCount * bridge->inputBytesPerFrame );
+		bridge->frameCount = frameCount;
+		bridge->statusFlags = (int) (statusFlags | bridge->pendingFlags);
+		bridge->pendingFlags = 0;
+
+		++bridge->requestCount;
+		PostSemaphore( &bridge->requestSemaphore );
+
+		/* skip the wakeups of earlier requests, which completed after their deadline */
+		while( TimedWaitSemaphore( &bridge->doneSemaphore, &deadline ) )
+		{
+			if( bridge->completedCount == bridge->requestCount )
+			{
+				if( output != NULL )
+					memcpy( output, bridge->outputMemory, outputBytes );
+				return bridge->result;
+			}
+		}
+	}
+	else if( input != NULL )
+	{
+		/* still busy with an earlier block, this input is lost */
+		bridge->pendingFlags |= paInputOverflow;
+	}
+
+	if( output != NULL )
+		memset( output, bridge->outputSilence, outputBytes );
+	bridge->pendingFlags |= paOutputUnderflow;
+	++bridge->missedDeadlineCount;
+
+	return paContinue;
+}
+
+static void ClearBuffer( JNIEnv *env, JpaBridge *bridge, jobject buffer )
+{
+	if( buffer != NULL )
+	{
+		/* the bridge thread never returns to Java, so local references have
+		 to be deleted explicitly */
+		jobject result = (*env)->CallObjectMethod( env, buffer, bridge->clearMethod );
+		(*env)->DeleteLocalRef( env, result );
+	}
+}
+
+static void RunBridge( JpaBridge *bridge )
+{
+	JNIEnv *env;
+
+	if( (*bridge->vm)->AttachCurrentThreadAsDaemon( bridge->vm, (void **) &env, NULL ) != JNI_OK )
+		return; /* every block will miss its deadline */
+
+	for( ;; )
+	{
+		unsigned long request;
+		jint result;
+
+		WaitSemaphore( &bridge->requestSemaphore );
+		if( bridge->quit )
+			break;
+		request = bridge->requestCount;
+
+		ClearBuffer( env, bridge, bridge->inputBuffer );
+		ClearBuffer( env, bridge, bridge->outputBuffer );
+		result = (*env)->CallIntMethod( env, bridge->callback, bridge->processMethod,
+				bridge->inputBuffer, bridge->outputBuffer,
+				(jint) bridge->frameCount, (jint) bridge->statusFlags );
+		if( (*env)->ExceptionCheck( env ) )
+		{
+			(*env)->ExceptionDescribe( env );
+			(*env)->ExceptionClear( env );
+			result = paAbort;
+		}
+
+		bridge->result = (result == paComplete || result == paAbort) ? result : paContinue;
+		bridge->completedCount = request;
+		PostSemaphore( &bridge->doneSemaphore );
+	}
+
+	(*bridge->vm)->DetachCurrentThread( bridge->vm );
+}
+
+#if defined(_WIN32)
+static unsigned __stdcall BridgeThreadFunc( void *userData )
+{
+	RunBridge( (JpaBridge *) userData );
+	return 0;
+}
+#else
+static void *BridgeThreadFunc( void *userData )
+{
+	RunBridge( (JpaBridge *) userData );
+	return NULL;
+}
+#endif
+
+static void TermBridge( JNIEnv *env, JpaBridge *bridge )
+{
+	if( bridge->threadStarted )
+	{
+		bridge->quit = 1;
+		PostSemaphore( &bridge->requestSemaphore );
+#if defined(_WIN32)
+		WaitForSingleObject( bridge->thread, INFINITE );
+		CloseHandle( bridge->thread );
+#else
+		pthread_join( bridge->thread, NULL );
+#endif
+	}
+	if( bridge->semaphoresInitialized )
+	{
+		TermSemaphore( &bridge->requestSemaphore );
+		TermSemaphore( &bridge->doneSemaphore );
+	}
+	if( bridge->callback != NULL )
+		(*env)->DeleteGlobalRef( env, bridge->callback );
+	if( bridge->inputBuffer != NULL )
+		(*env)->DeleteGlobalRef( env, bridge->inputBuffer );
+	if( bridge->outputBuffer != NULL )
+		(*env)->DeleteGlobalRef( env, bridge->outputBuffer );
+	free( bridge );
+}
+
+/* returns 0 on success, otherwise a Java exception is pending */
+static int InitBridge( JNIEnv *env, JpaBridge *bridge,
+		const PaStreamParameters *inputParameters, const PaStreamParameters *outputParameters,
+		double sampleRate, unsigned long framesPerBuffer,
+		jobject callback, jobject inputBuffer, jobject outputBuffer )
+{
+	jclass bufferClass;
+
+	if( (*env)->GetJavaVM( env, &bridge->vm ) != JNI_OK )
+		return jpa_ThrowError( env, "Cannot get the Java VM." ), -1;
+
+	bridge->processMethod = (*env)->GetMethodID( env, (*env)->GetObjectClass( env, callback ),
+			"process", "(Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;II)I" );
+	bufferClass = (*env)->FindClass( env, "java/nio/Buffer" );
+	if( bridge->processMethod == NULL || bufferClass == NULL )
+		return -1;
+	bridge->clearMethod = (*env)->GetMethodID( env, bufferClass, "clear", "()Ljava/nio/Buffer;" );
+	if( bridge->clearMethod == NULL )
+		return -1;
+
+	bridge->callback = (*env)->NewGlobalRef( env, callback );
+	if( inputParameters != NULL )
+	{
+		bridge->inputBuffer = (*env)->NewGlobalRef( env, inputBuffer );
+		bridge->inputMemory = (*env)->GetDirectBufferAddress( env, inputBuffer );
+		bridge->inputBytesPerFrame = inputParameters->channelCount * Pa_GetSampleSize( inputParameters->sampleFormat );
+		if( bridge->inputMemory == NULL )
+			return jpa_ThrowError( env, "Invalid input buffer." ), -1;
+	}
+	if( outputParameters != NULL )
+	{
+		bridge->outputBuffer = (*env)->NewGlobalRef( env, outputBuffer );
+		bridge->outputMemory = (*env)->GetDirectBufferAddress( env, outputBuffer );
+		bridge->outputBytesPerFrame = outputParameters->channelCount * Pa_GetSampleSize( outputParameters->sampleFormat );
+		bridge->outputSilence = (outputParameters->sampleFormat == paUInt8) ? 0x80 : 0;
+		if( bridge->outputMemory == NULL )
+			return jpa_ThrowError( env, "Invalid output buffer." ), -1;
+	}
+	bridge->deadline = JPA_DEADLINE_FRACTION * framesPerBuffer / sampleRate;
+
+	if( InitSemaphore( &bridge->requestSemaphore ) != 0 )
+		return jpa_ThrowError( env, "Cannot create semaphore." ), -1;
+	if( InitSemaphore( &bridge->doneSemaphore ) != 0 )
+	{
+		TermSemaphore( &bridge->requestSemaphore );
+		return jpa_ThrowError( env, "Cannot create semaphore." ), -1;
+	}
+	bridge->semaphoresInitialized = 1;
+
+#if defined(_WIN32)
+	bridge->thread = (HANDLE) _beginthreadex( NULL, 0, BridgeThreadFunc, bridge, 0, NULL );
+	if( bridge->thread == NULL )
+#else
+	if( pthread_create( &bridge->thread, NULL, BridgeThreadFunc, bridge ) != 0 )
+#endif
+		return jpa_ThrowError( env, "Cannot create callback thread." ), -1;
+	bridge->threadStarted = 1;
+
+	return 0;
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    open
+ * Signature: (Lcom/portaudio/StreamParameters;Lcom/portaudio/StreamParameters;IIILcom/portaudio/StreamCallback;Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;)V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_open
+  (JNIEnv *env, jobject callbackStream, jobject inParams, jobject outParams, jint sampleRate, jint framesPerBuffer, jint flags,
+  jobject callback, jobject inputBuffer, jobject outputBuffer)
+{
+	int err;
+	PaStreamParameters myInParams, *paInParams;
+	PaStreamParameters myOutParams, *paOutParams;
+	PaStream *stream;
+	JpaBridge *bridge;
+	jclass cls;
+
+	paInParams = jpa_FillStreamParameters(  env, inParams, &myInParams );
+	paOutParams = jpa_FillStreamParameters(  env, outParams, &myOutParams );
+
+	bridge = (JpaBridge *) calloc( 1, sizeof(JpaBridge) );
+	if( bridge == NULL )
+	{
+		jpa_ThrowError( env, "Cannot allocate callback stream." );
+		return;
+	}
+	if( InitBridge( env, bridge, paInParams, paOutParams, sampleRate, framesPerBuffer,
+			callback, inputBuffer, outputBuffer ) != 0 )
+	{
+		TermBridge( env, bridge );
+		return;
+	}
+
+	err = Pa_OpenStream( &stream, paInParams, paOutParams, sampleRate, framesPerBuffer, flags, BridgeCallback, bridge );
+	if( err != paNoError )
+	{
+		TermBridge( env, bridge );
+		jpa_CheckError( env, err );
+		return;
+	}
+
+	cls = (*env)->GetObjectClass(env, callbackStream);
+	jpa_SetLongField( env, cls, callbackStream, "nativeStream", (jlong) stream );
+	jpa_SetLongField( env, cls, callbackStream, "nativeBridge", (jlong) bridge );
+	if( paInParams != NULL )
+	{
+		jpa_SetIntField( env, cls, callbackStream, "inputFormat", paInParams->sampleFormat );
+	}
+	if( paOutParams != NULL )
+	{
+		jpa_SetIntField( env, cls, callbackStream, "outputFormat", paOutParams->sampleFormat );
+	}
+}
+
+/* The stream state functions only use the nativeStream field, they are shared
+ with BlockingStream. */
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    start
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_start
+  (JNIEnv *env, jobject callbackStream )
+{
+	Java_com_portaudio_BlockingStream_start( env, callbackStream );
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    stop
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_stop
+  (JNIEnv *env, jobject callbackStream )
+{
+	Java_com_portaudio_BlockingStream_stop( env, callbackStream );
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    abort
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_abort
+  (JNIEnv *env, jobject callbackStream )
+{
+	Java_com_portaudio_BlockingStream_abort( env, callbackStream );
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    close
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_close
+  (JNIEnv *env, jobject callbackStream )
+{
+	jclass cls = (*env)->GetObjectClass(env, callbackStream);
+	PaStream *stream = jpa_GetStreamPointer( env, callbackStream );
+	JpaBridge *bridge = (JpaBridge *) jpa_GetLongField( env, cls, callbackStream, "nativeBridge" );
+	if( stream != NULL )
+	{
+		int err = Pa_CloseStream( stream );
+		if( err != paNoError )
+		{
+			/* the callback may still be running, keep the bridge */
+			jpa_CheckError( env, err );
+			return;
+		}
+		jpa_SetLongField( env, cls, callbackStream, "nativeStream", (jlong) 0 );
+	}
+	if( bridge != NULL )
+	{
+		TermBridge( env, bridge );
+		jpa_SetLongField( env, cls, callbackStream, "nativeBridge", (jlong) 0 );
+	}
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    isStopped
+ * Signature: ()Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_CallbackStream_isStopped
+  (JNIEnv *env, jobject callbackStream )
+{
+	return Java_com_portaudio_BlockingStream_isStopped( env, callbackStream );
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    isActive
+ * Signature: ()Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_CallbackStream_isActive
+  (JNIEnv *env, jobject callbackStream )
+{
+	return Java_com_portaudio_BlockingStream_isActive( env, callbackStream );
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    getCpuLoad
+ * Signature: ()D
+ */
+JNIEXPORT jdouble JNICALL Java_com_portaudio_CallbackStream_getCpuLoad
+  (JNIEnv *env, jobject callbackStream )
+{
+	PaStream *stream =jpa_GetStreamPointer( env, callbackStream );
+	if( stream == NULL ) return 0.0;
+	return Pa_GetStreamCpuLoad( stream );
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    getMissedDeadlineCount
+ * Signature: ()I
+ */
+JNIEXPORT jint JNICALL Java_com_portaudio_CallbackStream_getMissedDeadlineCount
+  (JNIEnv *env, jobject callbackStream )
+{
+	jclass cls = (*env)->GetObjectClass(env, callbackStream);
+	JpaBridge *bridge = (JpaBridge *) jpa_GetLongField( env, cls, callbackStream, "nativeBridge" );
+	if( bridge == NULL ) return 0;
+	return bridge->missedDeadlineCount;
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    getTime
+ * Signature: ()D
+ */
+JNIEXPORT jdouble JNICALL Java_com_portaudio_CallbackStream_getTime
+  (JNIEnv *env, jobject callbackStream )
+{
+	return Java_com_portaudio_BlockingStream_getTime( env, callbackStream );
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    getInfo
+ * Signature: (Lcom/portaudio/StreamInfo;)V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_getInfo
+  (JNIEnv *env, jobject callbackStream, jobject streamInfo)
+{
+	Java_com_portaudio_BlockingStream_getInfo( env, callbackStream, streamInfo );
+}
@@ -270,10 +270,12 @@ JNIEXPORT void JNICALL Java_com_portaudio_PortAudio_openStream
 		if( paInParams != NULL )
 		{
 			jpa_SetIntField( env, cls, blockingStream, "inputFormat", paInParams->sampleFormat );
+			jpa_SetIntField( env, cls, blockingStream, "inputChannelCount", paInParams->channelCount );
 		}
 		if( paOutParams != NULL )
 		{
 			jpa_SetIntField( env, cls, blockingStream, "outputFormat", paOutParams->sampleFormat );
+			jpa_SetIntField( env, cls, blockingStream, "outputChannelCount", paOutParams->channelCount );
 		}
 	}
 }
@@ -38,6 +38,10 @@
 
 package com.portaudio;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
+
 import junit.framework.TestCase;
 
 /**
@@ -420,6 +424,102 @@ public class TestBasic extends TestCase
 		PortAudio.terminate();
 	}
 
+	public void testBlockingWriteFloatDirect()
+	{
+		PortAudio.initialize();
+
+		StreamParameters streamParameters = new StreamParameters();
+		streamParameters.sampleFormat = PortAudio.FORMAT_FLOAT_32;
+		streamParameters.channelCount = 2;
+		streamParameters.device = PortAudio.getDefaultOutputDevice();
+		streamParameters.suggestedLatency = PortAudio
+				.getDeviceInfo( streamParameters.device ).defaultLowOutputLatency;
+
+		int framesPerBuffer = 256;
+		int flags = 0;
+		BlockingStream stream = PortAudio.openStream( null, streamParameters,
+				44100, framesPerBuffer, flags );
+		assertTrue( "got default stream", stream != null );
+
+		FloatBuffer buffer = ByteBuffer.allocateDirect( framesPerBuffer * 2 * 4 )
+				.order( ByteOrder.nativeOrder() ).asFloatBuffer();
+		SineOscillator osc1 = new SineOscillator( 200.0, 44100 );
+		SineOscillator osc2 = new SineOscillator( 300.0, 44100 );
+
+		int numFrames = 80000;
+		stream.start();
+		long startTime = System.currentTimeMillis();
+		int framesLeft = numFrames;
+		while( framesLeft > 0 )
+		{
+			int framesToWrite = (framesLeft > framesPerBuffer) ? framesPerBuffer
+					: framesLeft;
+			buffer.clear();
+			for( int j = 0; j < framesToWrite; j++ )
+			{
+				buffer.put( (float) osc1.next() );
+				buffer.put( (float) osc2.next() );
+			}
+			buffer.flip();
+			stream.write( buffer, framesToWrite );
+			assertEquals( "buffer drained", 0, buffer.remaining() );
+			framesLeft -= framesToWrite;
+		}
+		stream.stop();
+		long stopTime = System.currentTimeMillis();
+		stream.close();
+
+		double elapsed = (stopTime - startTime) / 1000.0;
+		double expected = numFrames / 44100.0;
+		assertEquals( "elapsed time to play", expected, elapsed, 0.20 );
+		PortAudio.terminate();
+	}
+
+	public void testCallbackWriteFloat() throws InterruptedException
+	{
+		PortAudio.initialize();
+
+		StreamParameters streamParameters = new StreamParameters();
+		streamParameters.sampleFormat = PortAudio.FORMAT_FLOAT_32;
+		streamParameters.channelCount = 2;
+		streamParameters.device = PortAudio.getDefaultOutputDevice();
+		streamParameters.suggestedLatency = PortAudio
+				.getDeviceInfo( streamParameters.device ).defaultHighOutputLatency;
+
+		final SineOscillator osc1 = new SineOscillator( 200.0, 44100 );
+		final SineOscillator osc2 = new SineOscillator( 300.0, 44100 );
+		final int[] framesPlayed = new int[1];
+		StreamCallback callback = new StreamCallback()
+		{
+			public int process( ByteBuffer input, ByteBuffer output,
+					int numFrames, int statusFlags )
+			{
+				FloatBuffer buffer = output.asFloatBuffer();
+				for( int j = 0; j < numFrames; j++ )
+				{
+					buffer.put( (float) osc1.next() );
+					buffer.put( (float) osc2.next() );
+				}
+				framesPlayed[0] += numFrames;
+				return CONTINUE;
+			}
+		};
+
+		CallbackStream stream = PortAudio.openStream( null, streamParameters,
+				44100, 256, 0, callback );
+		assertTrue( "got default stream", stream != null );
+
+		stream.start();
+		Thread.sleep( 1000 );
+		stream.stop();
+		int missedDeadlineCount = stream.getMissedDeadlineCount();
+		stream.close();
+
+		assertTrue( "callback called", framesPlayed[0] > 0 );
+		assertTrue( "few missed deadlines", missedDeadlineCount < 10 );
+		PortAudio.terminate();
+	}
+
 	public void testRecordPlayFloat() throws InterruptedException
 	{
 		checkRecordPlay( PortAudio.FORMAT_FLOAT_32 );
@@ -43,6 +43,12 @@
 */
 package com.portaudio;
 
+import java.nio.Buffer;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
+import java.nio.ShortBuffer;
+
 /**
  * Represents a stream for blocking read/write I/O.
  * 
@@ -51,6 +57,12 @@ package com.portaudio;
  * 
  * To create one of these, call PortAudio.openStream().
  * 
+ * Samples can be read and written from Java arrays, or from direct NIO buffers.
+ * Direct buffers are passed to PortAudio in place, without copying or pinning,
+ * which makes them the better choice for continuous streaming. The buffer
+ * overloads transfer the samples at the buffer's position, and advance the
+ * position past them, like the relative bulk get and put methods of the buffers.
+ * 
  * @see PortAudio
  * 
  * @author Phil Burk
@@ -63,6 +75,8 @@ public class BlockingStream
 	private long nativeStream;
 	private int inputFormat = -1;
 	private int outputFormat = -1;
+	private int inputChannelCount = 0;
+	private int outputChannelCount = 0;
 
 	protected BlockingStream()
 	{
@@ -159,6 +173,168 @@ public class BlockingStream
 		return writeShorts( buffer, numFrames );
 	}
 
+	private native boolean readDirect( Buffer buffer, int byteOffset, int numFrames );
+
+	private native boolean writeDirect( Buffer buffer, int byteOffset, int numFrames );
+
+	private static void checkBuffer( Buffer buffer, int numSamples,
+			ByteOrder order )
+	{
+		if( !buffer.isDirect() )
+		{
+			throw new IllegalArgumentException( "Buffer is not direct." );
+		}
+		if( buffer.remaining() < numSamples )
+		{
+			throw new IllegalArgumentException( "Buffer too small, "
+					+ buffer.remaining() + " < " + numSamples );
+		}
+		if( (order != null) && (order != ByteOrder.nativeOrder()) )
+		{
+			throw new IllegalArgumentException(
+					"Buffer is not in native byte order." );
+		}
+	}
+
+	/**
+	 * Read data in the stream's sample format, in native byte order, into a
+	 * direct buffer.
+	 * 
+	 * @param buffer
+	 *            direct buffer, filled from its position
+	 * @param numFrames
+	 *            number of frames to read
+	 * @return true if an input overflow occurred
+	 */
+	public boolean read( ByteBuffer buffer, int numFrames )
+	{
+		int numBytes = numFrames * inputChannelCount
+				* PortAudio.getBytesPerSample( inputFormat );
+		checkBuffer( buffer, numBytes, null );
+		int position = buffer.position();
+		boolean overflowed = readDirect( buffer, position, numFrames );
+		buffer.position( position + numBytes );
+		return overflowed;
+	}
+
+	/**
+	 * Write data in the stream's sample format, in native byte order, from a
+	 * direct buffer.
+	 * 
+	 * @param buffer
+	 *            direct buffer, drained from its position
+	 * @param numFrames
+	 *            number of frames to write
+	 * @return true if an output underflow occurred
+	 */
+	public boolean write( ByteBuffer buffer, int numFrames )
+	{
+		int numBytes = numFrames * outputChannelCount
+				* PortAudio.getBytesPerSample( outputFormat );
+		checkBuffer( buffer, numBytes, null );
+		int position = buffer.position();
+		boolean underflowed = writeDirect( buffer, position, numFrames );
+		buffer.position( position + numBytes );
+		return underflowed;
+	}
+
+	/**
+	 * Read 32-bit floating point data from the stream into a direct buffer.
+	 * 
+	 * @param buffer
+	 *            direct buffer in native byte order, filled from its position
+	 * @param numFrames
+	 *            number of frames to read
+	 * @return true if an input overflow occurred
+	 */
+	public boolean read( FloatBuffer buffer, int numFrames )
+	{
+		if( inputFormat != PortAudio.FORMAT_FLOAT_32 )
+		{
+			throw new RuntimeException(
+					"Tried to read float samples from a non float stream." );
+		}
+		int numSamples = numFrames * inputChannelCount;
+		checkBuffer( buffer, numSamples, buffer.order() );
+		int position = buffer.position();
+		boolean overflowed = readDirect( buffer, position * 4, numFrames );
+		buffer.position( position + numSamples );
+		return overflowed;
+	}
+
+	/**
+	 * Write 32-bit floating point data to the stream from a direct buffer. The
+	 * data should be in the range -1.0 to +1.0.
+	 * 
+	 * @param buffer
+	 *            direct buffer in native byte order, drained from its position
+	 * @param numFrames
+	 *            number of frames to write
+	 * @return true if an output underflow occurred
+	 */
+	public boolean write( FloatBuffer buffer, int numFrames )
+	{
+		if( outputFormat != PortAudio.FORMAT_FLOAT_32 )
+		{
+			throw new RuntimeException(
+					"Tried to write float samples to a non float stream." );
+		}
+		int numSamples = numFrames * outputChannelCount;
+		checkBuffer( buffer, numSamples, buffer.order() );
+		int position = buffer.position();
+		boolean underflowed = writeDirect( buffer, position * 4, numFrames );
+		buffer.position( position + numSamples );
+		return underflowed;
+	}
+
+	/**
+	 * Read 16-bit integer data from the stream into a direct buffer.
+	 * 
+	 * @param buffer
+	 *            direct buffer in native byte order, filled from its position
+	 * @param numFrames
+	 *            number of frames to read
+	 * @return true if an input overflow occurred
+	 */
+	public boolean read( ShortBuffer buffer, int numFrames )
+	{
+		if( inputFormat != PortAudio.FORMAT_INT_16 )
+		{
+			throw new RuntimeException(
+					"Tried to read short samples from a non short stream." );
+		}
+		int numSamples = numFrames * inputChannelCount;
+		checkBuffer( buffer, numSamples, buffer.order() );
+		int position = buffer.position();
+		boolean overflowed = readDirect( buffer, position * 2, numFrames );
+		buffer.position( position + numSamples );
+		return overflowed;
+	}
+
+	/**
+	 * Write 16-bit integer data to the stream from a direct buffer.
+	 * 
+	 * @param buffer
+	 *            direct buffer in native byte order, drained from its position
+	 * @param numFrames
+	 *            number of frames to write
+	 * @return true if an output underflow occurred
+	 */
+	public boolean write( ShortBuffer buffer, int numFrames )
+	{
+		if( outputFormat != PortAudio.FORMAT_INT_16 )
+		{
+			throw new RuntimeException(
+					"Tried to write short samples from a non short stream." );
+		}
+		int numSamples = numFrames * outputChannelCount;
+		checkBuffer( buffer, numSamples, buffer.order() );
+		int position = buffer.position();
+		boolean underflowed = writeDirect( buffer, position * 2, numFrames );
+		buffer.position( position + numSamples );
+		return underflowed;
+	}
+
 	/**
 	 * Atart audio I/O.
 	 */
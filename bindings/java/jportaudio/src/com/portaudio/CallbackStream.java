@@ -0,0 +1,177 @@
+/*
+ * Portable Audio I/O Library
+ * Java Binding for PortAudio
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 2008 Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+/** @file
+ @ingroup bindings_java
+
+ @brief A callback stream.
+*/
+package com.portaudio;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/**
+ * Represents a stream which calls a StreamCallback to process the audio.
+ * 
+ * The PortAudio callback never calls into the JVM, because it could block
+ * there, for example for a garbage collection. It hands each block to a
+ * native thread which is attached to the JVM once, and which calls the
+ * StreamCallback with direct buffers that are allocated when the stream is
+ * opened. If the StreamCallback does not return before the deadline, silence
+ * is played instead, and a missed deadline is counted. No Java objects are
+ * allocated per block.
+ * 
+ * To create one of these, call PortAudio.openStream() with a StreamCallback.
+ * 
+ * @see PortAudio
+ * @see StreamCallback
+ */
+public class CallbackStream
+{
+	// nativeStream and nativeBridge are only accessed by the native code.
+	// nativeStream contains a pointer to a PaStream, nativeBridge a pointer to
+	// the state shared with the PortAudio callback.
+	private long nativeStream;
+	private long nativeBridge;
+	private int inputFormat = -1;
+	private int outputFormat = -1;
+	private StreamCallback callback;
+	private ByteBuffer inputBuffer;
+	private ByteBuffer outputBuffer;
+
+	protected CallbackStream()
+	{
+	}
+
+	private native void open( StreamParameters inputStreamParameters,
+			StreamParameters outputStreamParameters, int sampleRate,
+			int framesPerBuffer, int flags, StreamCallback callback,
+			ByteBuffer inputBuffer, ByteBuffer outputBuffer );
+
+	private static ByteBuffer allocateBuffer(
+			StreamParameters streamParameters, int framesPerBuffer )
+	{
+		if( streamParameters == null )
+		{
+			return null;
+		}
+		int numBytes = framesPerBuffer * streamParameters.channelCount
+				* PortAudio.getBytesPerSample( streamParameters.sampleFormat );
+		return ByteBuffer.allocateDirect( numBytes ).order(
+				ByteOrder.nativeOrder() );
+	}
+
+	void open( StreamParameters inputStreamParameters,
+			StreamParameters outputStreamParameters, int sampleRate,
+			int framesPerBuffer, int flags, StreamCallback callback )
+	{
+		if( callback == null )
+		{
+			throw new IllegalArgumentException( "null callback" );
+		}
+		if( framesPerBuffer <= 0 )
+		{
+			throw new IllegalArgumentException(
+					"Callback streams need a fixed framesPerBuffer." );
+		}
+		this.callback = callback;
+		inputBuffer = allocateBuffer( inputStreamParameters, framesPerBuffer );
+		outputBuffer = allocateBuffer( outputStreamParameters, framesPerBuffer );
+		open( inputStreamParameters, outputStreamParameters, sampleRate,
+				framesPerBuffer, flags, callback, inputBuffer, outputBuffer );
+	}
+
+	/**
+	 * Start audio I/O.
+	 */
+	public native void start();
+
+	/**
+	 * Wait for the stream to play all of the data that has been processed
+	 * then stop.
+	 */
+	public native void stop();
+
+	/**
+	 * Stop immediately and lose any data that was processed but not played.
+	 */
+	public native void abort();
+
+	/**
+	 * Close the stream, stop the callback thread and zero out the pointers.
+	 * Do not reference the stream after this.
+	 */
+	public native void close();
+
+	public native boolean isStopped();
+
+	public native boolean isActive();
+
+	/**
+	 * @return the fraction of the available CPU time used by the callbacks.
+	 */
+	public native double getCpuLoad();
+
+	/**
+	 * @return the number of blocks for which the StreamCallback did not return
+	 *         in time, and silence was played instead.
+	 */
+	public native int getMissedDeadlineCount();
+
+	public String toString()
+	{
+		return "CallbackStream: streamPtr = " + Long.toHexString( nativeStream )
+				+ ", inFormat = " + inputFormat + ", outFormat = "
+				+ outputFormat;
+	}
+
+	/**
+	 * Get audio time related to this stream. Note that it may not start at 0.0.
+	 */
+	public native double getTime();
+
+	private native void getInfo( StreamInfo streamInfo );
+
+	public StreamInfo getInfo()
+	{
+		StreamInfo streamInfo = new StreamInfo();
+		getInfo( streamInfo );
+		return streamInfo;
+	}
+}
@@ -52,12 +52,15 @@ package com.portaudio;
  * http://portaudio.com/docs/
  * http://portaudio.com/docs/v19-doxydocs/portaudio_8h.html
  * 
- * This Java binding does not support audio callbacks because an audio callback
- * should never block. Calling into a Java virtual machine might block for
- * garbage collection or synchronization. So only the blocking read/write mode
- * is supported.
+ * An audio callback should never block, but calling into a Java virtual
+ * machine might block for garbage collection or synchronization. So the
+ * PortAudio callback of a CallbackStream does not call into the JVM itself: it
+ * hands the audio to a thread which calls the StreamCallback, and plays
+ * silence if that does not finish in time.
  * 
  * @see BlockingStream
+ * @see CallbackStream
+ * @see StreamCallback
  * @see DeviceInfo
  * @see HostApiInfo
  * @see StreamInfo
@@ -258,4 +261,50 @@ public class PortAudio
 		return blockingStream;
 	}
 
+	/**
+	 * Open a stream which calls the callback to process the audio.
+	 * 
+	 * @param inputStreamParameters
+	 *            input description, may be null
+	 * @param outputStreamParameters
+	 *            output description, may be null
+	 * @param sampleRate
+	 *            typically 44100 or 48000, or maybe 22050, 16000, 8000, 96000
+	 * @param framesPerBuffer
+	 *            number of frames passed to each call of the callback, must
+	 *            be greater than zero
+	 * @param flags
+	 * @param callback
+	 * @return
+	 */
+	public static CallbackStream openStream(
+			StreamParameters inputStreamParameters,
+			StreamParameters outputStreamParameters, int sampleRate,
+			int framesPerBuffer, int flags, StreamCallback callback )
+	{
+		CallbackStream callbackStream = new CallbackStream();
+		callbackStream.open( inputStreamParameters, outputStreamParameters,
+				sampleRate, framesPerBuffer, flags, callback );
+		return callbackStream;
+	}
+
+	static int getBytesPerSample( int format )
+	{
+		switch( format )
+		{
+		case FORMAT_FLOAT_32:
+		case FORMAT_INT_32:
+			return 4;
+		case FORMAT_INT_24:
+			return 3;
+		case FORMAT_INT_16:
+			return 2;
+		case FORMAT_INT_8:
+		case FORMAT_UINT_8:
+			return 1;
+		default:
+			throw new RuntimeException( "Unknown sample format " + format );
+		}
+	}
+
 }
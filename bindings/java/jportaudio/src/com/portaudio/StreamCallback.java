@@ -0,0 +1,100 @@
+/*
+ * Portable Audio I/O Library
+ * Java Binding for PortAudio
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 2008 Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+/** @file
+ @ingroup bindings_java
+
+ @brief Interface for the callback of a CallbackStream.
+*/
+package com.portaudio;
+
+import java.nio.ByteBuffer;
+
+/**
+ * Processes the audio of a CallbackStream.
+ * 
+ * process() is called for every block of framesPerBuffer frames. It is not
+ * called on the PortAudio callback thread, but on a thread which is created
+ * by the stream and attached to the JVM once. When it does not return in time,
+ * for example because of a garbage collection, the stream plays silence for
+ * that block and counts a missed deadline.
+ * 
+ * To keep garbage collections rare process() should not allocate objects.
+ * 
+ * @see CallbackStream
+ * @see PortAudio#openStream(StreamParameters, StreamParameters, int, int,
+ *      int, StreamCallback)
+ */
+public interface StreamCallback
+{
+	/** Return value of process(), keep calling process(). */
+	public final static int CONTINUE = 0;
+	/** Return value of process(), finish the stream after the output has played. */
+	public final static int COMPLETE = 1;
+	/** Return value of process(), stop the stream as soon as possible. */
+	public final static int ABORT = 2;
+
+	/** Status flag, some input data was discarded. */
+	public final static int INPUT_UNDERFLOW = 0x00000001;
+	public final static int INPUT_OVERFLOW = 0x00000002;
+	/** Status flag, silence was played because a deadline was missed. */
+	public final static int OUTPUT_UNDERFLOW = 0x00000004;
+	public final static int OUTPUT_OVERFLOW = 0x00000008;
+	public final static int PRIMING_OUTPUT = 0x00000010;
+
+	/**
+	 * Process one block of audio. The buffers are direct and in native byte
+	 * order, and are reused for every call. Their position is 0 and their
+	 * limit is the size of numFrames frames.
+	 * 
+	 * @param input
+	 *            input samples in the stream's input format, or null if the
+	 *            stream has no input
+	 * @param output
+	 *            buffer to fill with output samples in the stream's output
+	 *            format, or null if the stream has no output
+	 * @param numFrames
+	 *            number of frames in the buffers
+	 * @param statusFlags
+	 *            INPUT_UNDERFLOW, INPUT_OVERFLOW, OUTPUT_UNDERFLOW,
+	 *            OUTPUT_OVERFLOW, PRIMING_OUTPUT
+	 * @return CONTINUE, COMPLETE or ABORT
+	 */
+	public int process( ByteBuffer input, ByteBuffer output, int numFrames,
+			int statusFlags );
+}
@@ -1,4 +1,4 @@
 REM Generate the JNI header file from the Java code for JPortAudio
 REM by Phil Burk
 
-javah -classpath ../jportaudio/bin -d ../c/src com.portaudio.PortAudio com.portaudio.BlockingStream
+javah -classpath ../jportaudio/bin -d ../c/src com.portaudio.PortAudio com.portaudio.BlockingStream com.portaudio.CallbackStream
@@ -101,6 +101,14 @@ SOURCE=..\..\src\common\pa_allocation.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\common\pa_callbackprofiler.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\common\pa_clockestimator.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\common\pa_converters.c
 # End Source File
 # Begin Source File
@@ -125,6 +133,10 @@ SOURCE=..\..\src\common\pa_process.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\common\pa_resampler.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\common\pa_ringbuffer.c
 # End Source File
 # Begin Source File
@@ -133,6 +145,10 @@ SOURCE=..\..\src\hostapi\skeleton\pa_hostapi_skeleton.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\common\pa_sequencelock.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\common\pa_stream.c
 # End Source File
 # End Group
@@ -50,13 +50,48 @@
 extern "C" {
 #endif
 
+#define paAlsaUseChannelSelectors      (0x01)
+#define paAlsaShareDevice              (0x02)
+
 typedef struct PaAlsaStreamInfo
 {
-    unsigned long size;
-    PaHostApiTypeId hostApiType;
-    unsigned long version;
+    unsigned long size;             /**< sizeof(PaAlsaStreamInfo) */
+    PaHostApiTypeId hostApiType;    /**< paALSA */
+    unsigned long version;          /**< 2, structures of version 1 end after deviceString */
 
+    /** Name of the ALSA device to open, in which case the stream parameters' device must be
+        paUseHostApiSpecificDeviceSpecification. If NULL, the stream parameters' device is opened.
+    */
     const char *deviceString;
+
+    unsigned long flags;
+
+    /* Support for routing the stream's channels to specific channels of a device.
+        If the paAlsaUseChannelSelectors flag is set, channelSelectors is a
+        pointer to an array of integers specifying the device channel each of the
+        stream's channels maps to, so its length must match the corresponding
+        channelCount parameter to Pa_OpenStream(). The device is opened with enough
+        channels to include every selected channel, output channels that aren't
+        selected are silenced.
+        The values in the selectors array must specify channels within the range
+        of supported channels for the device, and output selectors must be
+        distinct, otherwise paInvalidChannelCount will result.
+    */
+    const int *channelSelectors;
+
+    /* Support for sharing a device between streams of this process.
+        If the paAlsaShareDevice flag is set, the device is opened once for all the
+        streams sharing it in the same direction, and driven by a single callback
+        thread: the output of the streams is mixed, their input is copied from the
+        same captured frames. This is like the dmix and dsnoop plugins, at the
+        latency of the hw device.
+        Only callback streams which are either input or output can share a device,
+        otherwise paIncompatibleHostApiSpecificStreamInfo or paBadIODeviceCombination
+        will result. The first stream opens the device at its sample rate, with all
+        of a hw device's channels; later streams must use the same rate, and their
+        channels (or channel selectors) must lie within the device's channels.
+        The device is closed along with the last stream sharing it.
+    */
 }
 PaAlsaStreamInfo;
 
@@ -93,6 +128,60 @@ PaError PaAlsa_SetNumPeriods( int numPeriods );
  */
 PaError PaAlsa_SetRetriesBusy( int retries );
 
+/** Instruct whether to compensate for drift between capture and playback devices on different cards.
+ *
+ * Full duplex streams whose capture and playback pcms can't be linked, and belong to different cards, are driven
+ * by two independent clocks. With drift compensation (the default) the captured input is resampled to follow the
+ * playback clock, so that such a stream can run indefinitely without xruns. This adds roughly a period of capture
+ * and a host buffer of playback to the stream's input latency. The setting applies to streams opened afterwards.
+ * @param enable Zero to disable drift compensation.
+ */
+PaError PaAlsa_SetDriftCompensation( int enable );
+
+/** Get the ratio between captured and played frames currently applied by drift compensation.
+ *
+ * A ratio above 1 means the capture device runs faster than the playback device. If the stream is not
+ * compensating for drift, the ratio is 1.
+ */
+PaError PaAlsa_GetStreamDriftRatio( PaStream *s, double *ratio );
+
+/** Instruct whether to timestamp callbacks with snd_pcm_htimestamp.
+ *
+ * By default each callback queries the status of the stream's pcms, which is a system call per pcm. With high
+ * resolution timestamps the timestamp and delay are instead taken with nanosecond resolution together with the
+ * available frames, for hw devices without a system call. The delay then doesn't include the extra delay some
+ * drivers report (e.g. of a USB device's FIFO). The setting applies to streams opened afterwards.
+ * @param enable Non-zero to enable high resolution timestamps.
+ */
+PaError PaAlsa_SetHighResolutionTimestamps( int enable );
+
+/** Get an estimate of the ratio between a stream's device clock and the system clock.
+ *
+ * This is the rateRatio of Pa_GetStreamClockInfo(). A ratio above 1 means the device runs faster than its nominal
+ * sample rate. The estimate is only maintained for callback streams, for blocking streams the ratio is 1.
+ */
+PaError PaAlsa_GetStreamClockRatio( PaStream *s, double *ratio );
+
+/** Read from a blocking stream, waiting at most a given time.
+ *
+ * Like Pa_ReadStream(), but returns when the timeout expires even if fewer frames than requested have been read.
+ * A stream's input and output may be read and written concurrently from two threads.
+ * @param timeout Milliseconds to wait for frames. With 0, only the frames that are already available are read, a
+ * negative timeout waits until all frames have been read.
+ * @param framesRead Returns the number of frames read.
+ */
+PaError PaAlsa_ReadStream( PaStream *s, void *buffer, unsigned long frames, int timeout, unsigned long *framesRead );
+
+/** Write to a blocking stream, waiting at most a given time.
+ *
+ * Like Pa_WriteStream(), but returns when the timeout expires even if fewer frames than requested have been written.
+ * @param timeout Milliseconds to wait for space. With 0, only as many frames as there is space for are written, a
+ * negative timeout waits until all frames have been written.
+ * @param framesWritten Returns the number of frames written.
+ */
+PaError PaAlsa_WriteStream( PaStream *s, const void *buffer, unsigned long frames, int timeout,
+        unsigned long *framesWritten );
+
 /** Set the path and name of ALSA library file if PortAudio is configured to load it dynamically (see
  *  PA_ALSA_DYNAMIC). This setting will overwrite the default name set by PA_ALSA_PATHNAME define.
  * @param pathName Full path with filename. Only filename can be used, but dlopen() will lookup default
@@ -0,0 +1,178 @@
+#ifndef PA_NULL_H
+#define PA_NULL_H
+
+/*
+ * $Id$
+ * PortAudio Portable Real-Time Audio Library
+ * Null host API: virtual devices without audio hardware
+ *
+ * Copyright (c) 1999-2000 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ *  @ingroup public_header
+ *  @brief Null host API specific extensions interface.
+ *
+ *  The null host API provides virtual devices that run without audio hardware, to test and benchmark
+ *  applications and PortAudio itself. Input devices capture silence and output is discarded, unless
+ *  they are backed by files, but the streams go through the buffer processor and converters like those
+ *  of any other host API. Together with paNullFreeRunning, files allow rendering audio offline.
+ */
+
+#include "portaudio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Process host buffers as fast as possible, rather than at the pace of the device's clock.
+ *
+ * The stream's time is then derived from the frames processed.
+ */
+#define paNullFreeRunning       (0x01)
+
+/** The device's files hold raw interleaved samples in its hostSampleFormat, in native byte order,
+ * rather than 16 bit PCM WAV. Raw input files have maxInputChannels channels.
+ */
+#define paNullRawFiles          (0x02)
+
+/** Create a loopback pair from the spec: an output device named "<name> Output", and an input device named
+ * "<name> Input" capturing what is played to the output as through a cable, with maxOutputChannels channels.
+ *
+ * Streams on the two devices may be opened independently, or as a full duplex stream which then runs on
+ * the clock of the output. Only one stream at a time may play to the output. Loopbacks can't be free-running
+ * or backed by files. The input waits for frames the output is late with, if they still aren't played the
+ * input is notified with paInputUnderflow.
+ */
+#define paNullLoopback          (0x04)
+
+/** Description of a virtual device, see PaNull_AddDevice. */
+typedef struct PaNullDeviceSpec
+{
+    unsigned long size;                 /**< sizeof(PaNullDeviceSpec) */
+    unsigned long version;              /**< 1 */
+
+    const char *name;                   /**< Copied by PaNull_AddDevice */
+    int maxInputChannels;
+    int maxOutputChannels;
+    double defaultSampleRate;           /**< Also the rate at which streams converting with
+                                             paConvertSampleRate run the device */
+    double minSampleRate;               /**< Lowest supported sample rate, 0 for no limit */
+    double maxSampleRate;               /**< Highest supported sample rate, 0 for no limit */
+
+    /** Format of the device's buffers, one of the standard formats possibly combined with
+        paNonInterleaved. Samples are converted from and to it by the buffer processor. */
+    PaSampleFormat hostSampleFormat;
+
+    /** Frames per host buffer, 0 to follow the streams' buffer sizes. */
+    unsigned long framesPerHostBuffer;
+
+    /** Rate of the device's clock relative to the system clock, so 1.001 runs 0.1% fast. */
+    double clockRatio;
+
+    /** Each wakeup of the stream's thread is delayed by a random time up to maxJitter seconds,
+        if this makes the thread fall behind by more than the device's buffer an xrun occurs.
+        Delays of the system in waking the thread are caught up on, up to half a second. */
+    PaTime maxJitter;
+
+    /** Probability of dropping each host buffer, as if an xrun occurred. The callback is
+        notified with paInputOverflow and/or paOutputUnderflow. */
+    double xrunProbability;
+
+    unsigned long flags;                /**< paNullFreeRunning, paNullRawFiles, paNullLoopback */
+
+    /** File or named pipe captured by the device's input, NULL to capture silence.
+        The channels and sample rate of regular WAV files override those of the spec. Callback
+        streams complete at the end of the file, and their output file ends with it. Blocking
+        reads get silence past the end of the file. */
+    const char *inputFile;
+
+    /** File or named pipe the device's output is written to, NULL to discard output. WAV files have
+        the channels and sample rate of the stream, and are completed when the stream is closed. */
+    const char *outputFile;
+
+    /** Delay of a loopback pair between the time a frame is played and the time it is captured, in seconds.
+        The latencies reported by the streams come on top of it. */
+    PaTime loopbackLatency;
+
+    /** Rate of the input clock of a loopback pair relative to the output clock, so 1.0001 makes the input
+        drift 100 ppm fast. The input captures the output's signal interpolated at the times of its frames. */
+    double loopbackClockRatio;
+
+    /** Probability of losing each host buffer played to a loopback pair, the input captures silence
+        instead. Unlike xrunProbability, the streams are not notified. */
+    double loopbackDropoutProbability;
+}
+PaNullDeviceSpec;
+
+/** Initialize a device spec with the values of the default device: stereo input and output
+ * at 44100 Hz, float buffers following the stream's buffer size, and a nominal clock. Loopbacks
+ * have neither latency, drift nor dropouts.
+ */
+void PaNull_InitializeDeviceSpec( PaNullDeviceSpec *spec );
+
+/** Add a virtual device.
+ *
+ * Devices are created when PortAudio is initialized, so this takes effect with the next
+ * Pa_Initialize(). If no devices have been added, the host API provides a real-time paced device,
+ * a free-running device and a "Null Loopback" pair created from the default spec.
+ * Files are opened when a stream is opened on the device, and closed with it. Frames lost to
+ * xruns are skipped in input files and written as silence to output files.
+ * @return paIncompatibleHostApiSpecificStreamInfo if the size or version of spec is wrong,
+ * paInvalidDevice if a file name is too long, paInsufficientMemory if there are too many devices.
+ */
+PaError PaNull_AddDevice( const PaNullDeviceSpec *spec );
+
+/** Remove the devices added with PaNull_AddDevice, from the next Pa_Initialize() on. */
+void PaNull_ClearDevices( void );
+
+/** Counters of the activity of a null host API stream. */
+typedef struct PaNullStreamStatistics
+{
+    double framesProcessed;             /**< Since the stream was last started */
+    unsigned long hostBuffersProcessed;
+    unsigned long injectedXruns;        /**< Host buffers dropped according to xrunProbability */
+    unsigned long lateXruns;            /**< Xruns due to the stream's thread falling behind */
+    unsigned long loopbackDropouts;     /**< Host buffers lost according to loopbackDropoutProbability */
+    unsigned long loopbackXruns;        /**< Reads from a loopback pair missing frames its writer was late with */
+}
+PaNullStreamStatistics;
+
+/** Get the counters of a stream, which are reset when the stream is started. */
+PaError PaNull_GetStreamStatistics( PaStream *s, PaNullStreamStatistics *statistics );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
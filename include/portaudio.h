@@ -158,6 +158,20 @@ const char *Pa_GetErrorText( PaError errorCode );
  Note that if Pa_Initialize() returns an error code, Pa_Terminate() should
  NOT be called.
 
+ Thread safety: Pa_Initialize() and Pa_Terminate() may be called from any
+ thread, calls to them are serialized. While PortAudio is initialized the
+ other functions may be called concurrently from several threads:
+ - the host API and device information doesn't change until the last
+   Pa_Terminate(), so it may be queried without synchronization
+ - streams may be opened and closed concurrently. Opening and closing is
+   serialized per host API, so streams of different host APIs are opened in
+   parallel
+ - functions operating on different streams may be called concurrently.
+   Functions operating on the same stream must not be called concurrently,
+   unless documented otherwise by the host API.
+ The last Pa_Terminate() must not be called while other threads are using
+ PortAudio.
+
  @return paNoError if successful, otherwise an error code indicating the cause
  of failure.
 
@@ -379,7 +393,9 @@ typedef struct PaHostErrorInfo{
 /** Return information about the last host error encountered. The error
  information returned by Pa_GetLastHostErrorInfo() will never be modified
  asynchronously by errors occurring in other PortAudio owned threads
- (such as the thread that manages the stream callback.)
+ (such as the thread that manages the stream callback.) The information is
+ kept per thread, it describes the last host error encountered by a PortAudio
+ function called on the calling thread.
 
  This function is provided as a last resort, primarily to enhance debugging
  by providing clients with access to all available error information.
@@ -631,7 +647,8 @@ typedef void PaStream;
 
  @see Pa_OpenStream, Pa_OpenDefaultStream
  @see paNoFlag, paClipOff, paDitherOff, paNeverDropInput,
-  paPrimeOutputBuffersUsingStreamCallback, paPlatformSpecificFlags
+  paPrimeOutputBuffersUsingStreamCallback, paConvertSampleRate,
+  paProfileCallback, paPlatformSpecificFlags
 */
 typedef unsigned long PaStreamFlags;
 
@@ -667,6 +684,42 @@ typedef unsigned long PaStreamFlags;
 */
 #define   paPrimeOutputBuffersUsingStreamCallback ((PaStreamFlags) 0x00000008)
 
+/** Open the stream even if the device doesn't support the requested sample
+ rate, converting between the device's nearest sample rate and the requested
+ one. The stream callback is called at the requested sample rate, and the
+ latencies reported by Pa_GetStreamInfo() include the converter's delay.
+ Only valid for callback streams, and currently only supported by the ALSA,
+ OSS and null host APIs; it is ignored by host APIs which don't support it.
+
+ The conversion quality defaults to a compromise between quality and CPU
+ usage, use paSampleRateConversionFast or paSampleRateConversionBest to
+ select another.
+
+ @see PaStreamFlags, paSampleRateConversionFast, paSampleRateConversionBest
+*/
+#define   paConvertSampleRate ((PaStreamFlags) 0x00000010)
+
+/** Use a short, cheap, filter when converting the sample rate.
+ @see PaStreamFlags, paConvertSampleRate
+*/
+#define   paSampleRateConversionFast ((PaStreamFlags) 0x00000020)
+
+/** Use a long, high quality, filter when converting the sample rate.
+ @see PaStreamFlags, paConvertSampleRate
+*/
+#define   paSampleRateConversionBest ((PaStreamFlags) 0x00000040)
+
+/** Time each call of the stream callback against its real-time budget, the
+ duration of the frames it processes, to tell deadline misses of the callback
+ from xruns caused by the system. The profile is retrieved with
+ Pa_GetStreamCallbackProfile(). Only valid for callback streams, and currently
+ only supported by the ALSA, OSS, JACK and null host APIs; it is ignored by
+ host APIs which don't support it.
+
+ @see PaStreamFlags, Pa_GetStreamCallbackProfile
+*/
+#define   paProfileCallback ((PaStreamFlags) 0x00000080)
+
 /** A mask specifying the platform specific bits.
  @see PaStreamFlags
 */
@@ -924,6 +977,11 @@ PaError Pa_OpenDefaultStream( PaStream** stream,
 
 /** Closes an audio stream. If the audio stream is active it
  discards any pending buffers as if Pa_AbortStream() had been called.
+
+ Passing the stream to other functions afterwards usually fails with
+ paBadStreamPtr. This is not guaranteed: streams are identified by their
+ address only, so once a new stream has been opened at the same address
+ the old pointer refers to the new stream.
 */
 PaError Pa_CloseStream( PaStream *stream );
 
@@ -983,6 +1041,43 @@ PaError Pa_StopStream( PaStream *stream );
 PaError Pa_AbortStream( PaStream *stream );
 
 
+/** Commences audio processing on several streams at once.
+
+ All streams are prepared first and then started together. Streams of host
+ APIs which support it are triggered by a single operation (for example
+ linked pcms on ALSA), so that they start within a few samples of each other.
+ The remaining streams are started one after another as soon as the others
+ are running.
+
+ @param streams An array of count streams, which must all be open and stopped.
+ A stream may appear only once.
+
+ @param count The number of streams in the array.
+
+ @param startSkew If non-NULL, receives the estimated difference in seconds
+ between the earliest and the latest start of the streams. It's an estimate,
+ the precision depends on the host APIs involved.
+
+ @return paNoError if all streams were started. Otherwise an error code
+ indicating the cause of the error, in which case none of the streams are
+ left running.
+
+ @see Pa_StartStream, Pa_StopStreams
+*/
+PaError Pa_StartStreams( PaStream **streams, int count, PaTime *startSkew );
+
+
+/** Terminates audio processing on several streams, as Pa_StopStream() does for
+ each of them. Streams which are already stopped are skipped.
+
+ @return paNoError if all streams were stopped, otherwise the error code
+ of the first stream which failed. The remaining streams are still stopped.
+
+ @see Pa_StartStreams, Pa_StopStream
+*/
+PaError Pa_StopStreams( PaStream **streams, int count );
+
+
 /** Determine whether the stream is stopped.
  A stream is considered to be stopped prior to a successful call to
  Pa_StartStream and after a successful call to Pa_StopStream or Pa_AbortStream.
@@ -1105,6 +1200,195 @@ PaTime Pa_GetStreamTime( PaStream *stream );
 double Pa_GetStreamCpuLoad( PaStream* stream );
 
 
+/** A structure containing an estimate of how a stream's device clock runs
+ relative to the system clock.
+
+ The estimate is a smoothed linear mapping between the device's frame
+ positions and system time: frame position p is reached at time
+ time + (p - framePosition) / (sampleRate * rateRatio), where sampleRate
+ is the stream's nominal sample rate.
+
+ @see Pa_GetStreamClockInfo
+*/
+typedef struct PaStreamClockInfo
+{
+    /** this is struct version 1 */
+    int structVersion;
+
+    /** Non-zero once the estimator has observed the device long enough for
+     the estimate to be meaningful. The estimate starts over when the stream
+     is started, and after xruns.
+    */
+    int isLocked;
+
+    /** The device's actual sample rate divided by its nominal sample rate,
+     as measured against the system clock. Above 1 the device runs fast.
+    */
+    double rateRatio;
+
+    /** A frame position of the device, counted since the stream was started.
+     Where the count starts within the device's buffering is specific to the
+     host API, only differences between positions are meaningful.
+    */
+    double framePosition;
+
+    /** The smoothed system time, in seconds, at which the device was at
+     framePosition. The system clock is the one PortAudio uses internally,
+     the wall clock on POSIX systems.
+    */
+    PaTime time;
+} PaStreamClockInfo;
+
+
+/** Retrieve an estimate of how fast a stream's device clock runs relative to
+ the system clock, e.g. to steer a resampler which bridges the two clocks.
+
+ The estimate is updated once per host buffer by a delay-locked loop, fed by
+ the frame counts and timestamps of the host API's callback loop. Only some
+ host APIs (currently ALSA, OSS, JACK and null) provide it, and only for
+ callback streams. This function may be called from any thread, including the
+ stream callback.
+
+ @param stream A pointer to an open stream previously created with
+ Pa_OpenStream.
+
+ @param info A pointer to a structure to receive the estimate.
+
+ @return paNoError on success. paIncompatibleStreamHostApi if the stream's
+ host API doesn't estimate the device clock, otherwise an error code
+ indicating the cause of the error.
+*/
+PaError Pa_GetStreamClockInfo( PaStream *stream, PaStreamClockInfo *info );
+
+
+/** The number of slowest callbacks kept by the profile of a stream opened
+ with paProfileCallback.
+
+ @see PaStreamCallbackProfile
+*/
+#define paCallbackProfileWorstCount (8)
+
+
+/** The timing of a call of the stream callback.
+
+ @see PaStreamCallbackProfile
+*/
+typedef struct PaCallbackTiming
+{
+    /** The system time at which the callback was called, on the clock
+     PortAudio uses internally.
+    */
+    PaTime time;
+
+    /** The time the callback took to return, in seconds. */
+    PaTime duration;
+
+    /** The duration of the frames the callback processed, in seconds. The
+     callback missed its deadline if it took longer than this.
+    */
+    PaTime budget;
+
+    /** The number of frames the callback processed. */
+    unsigned long frameCount;
+} PaCallbackTiming;
+
+
+/** A profile of the calls of a stream's callback, since the stream was
+ opened with paProfileCallback.
+
+ @see Pa_GetStreamCallbackProfile, PaCallbackTiming
+*/
+typedef struct PaStreamCallbackProfile
+{
+    /** this is struct version 1 */
+    int structVersion;
+
+    /** The number of times the callback was called. */
+    unsigned long callbackCount;
+
+    /** The number of calls which took longer than their budget. */
+    unsigned long deadlineMissCount;
+
+    /** The total time spent in the callback, in seconds. */
+    PaTime totalDuration;
+
+    /** The total budget of the calls, in seconds. totalDuration / totalBudget
+     is the average share of the real-time budget used by the callback.
+    */
+    PaTime totalBudget;
+
+    /** The number of valid entries in worst. */
+    int worstCount;
+
+    /** The calls which used the largest share of their budget, the worst
+     first.
+    */
+    PaCallbackTiming worst[paCallbackProfileWorstCount];
+} PaStreamCallbackProfile;
+
+
+/** Retrieve the profile of the stream callback of a stream opened with the
+ paProfileCallback flag. This function may be called from any thread,
+ including the stream callback.
+
+ @param stream A pointer to an open stream previously created with
+ Pa_OpenStream.
+
+ @param profile A pointer to a structure to receive the profile.
+
+ @return paNoError on success. paIncompatibleStreamHostApi if the stream
+ wasn't opened with paProfileCallback, or its host API doesn't support it,
+ otherwise an error code indicating the cause of the error.
+
+ @see paProfileCallback, Pa_SetStreamCallbackProfileReport
+*/
+PaError Pa_GetStreamCallbackProfile( PaStream *stream, PaStreamCallbackProfile *profile );
+
+
+/** Functions of type PaStreamCallbackProfileReport are implemented by
+ PortAudio clients, to be notified of deadline misses of their stream
+ callback.
+
+ @param stream The stream whose callback missed deadlines.
+
+ @param profile The profile of the stream callback.
+
+ @param userData The userData parameter supplied to
+ Pa_SetStreamCallbackProfileReport().
+
+ @see Pa_SetStreamCallbackProfileReport
+*/
+typedef void PaStreamCallbackProfileReport( PaStream *stream,
+        const PaStreamCallbackProfile *profile, void *userData );
+
+
+/** Register a function to be called when the callback of a stream opened with
+ paProfileCallback has missed deadlines.
+
+ The function is called from a thread of normal, non real-time, priority,
+ at most about once per second, if deadlines were missed since the previous
+ report. It may call Pa_GetStreamCallbackProfile() or log, and may call
+ Pa_SetStreamCallbackProfileReport() to stop reporting or register another
+ report, but must not close the stream. Reporting stops when the stream is
+ closed.
+
+ @param stream A pointer to an open stream previously created with
+ Pa_OpenStream.
+
+ @param report The function to be called, or NULL to stop reporting.
+
+ @param userData A pointer passed to the report function.
+
+ @return paNoError on success. paIncompatibleStreamHostApi if the stream
+ wasn't opened with paProfileCallback, or its host API doesn't support it,
+ otherwise an error code indicating the cause of the error.
+
+ @see paProfileCallback, Pa_GetStreamCallbackProfile
+*/
+PaError Pa_SetStreamCallbackProfileReport( PaStream *stream,
+        PaStreamCallbackProfileReport *report, void *userData );
+
+
 /** Read samples from an input stream. The function doesn't return until
  the entire buffer has been filled - this may involve waiting for the operating
  system to supply the data.
@@ -1180,6 +1464,49 @@ signed long Pa_GetStreamReadAvailable( PaStream* stream );
 signed long Pa_GetStreamWriteAvailable( PaStream* stream );
 
 
+/** Unchecked variants of the functions which are commonly called in a loop.
+ They call the host API directly, skipping the validation of the stream
+ pointer and stream state, the check for a stopped stream before each read
+ or write, and API call logging.
+
+ The caller guarantees that stream is a stream returned by Pa_OpenStream()
+ or Pa_OpenDefaultStream() which hasn't been closed, and that
+ Pa_ReadStreamUnchecked() and Pa_WriteStreamUnchecked() are only called with
+ a valid buffer while the stream is running. Otherwise the behavior is
+ undefined.
+
+ @see Pa_ReadStream, Pa_WriteStream, Pa_GetStreamReadAvailable,
+ Pa_GetStreamWriteAvailable, Pa_GetStreamTime, Pa_GetStreamCpuLoad,
+ Pa_IsStreamStopped, Pa_IsStreamActive
+*/
+PaError Pa_ReadStreamUnchecked( PaStream* stream,
+                                void *buffer,
+                                unsigned long frames );
+
+/** @see Pa_ReadStreamUnchecked */
+PaError Pa_WriteStreamUnchecked( PaStream* stream,
+                                 const void *buffer,
+                                 unsigned long frames );
+
+/** @see Pa_ReadStreamUnchecked */
+signed long Pa_GetStreamReadAvailableUnchecked( PaStream* stream );
+
+/** @see Pa_ReadStreamUnchecked */
+signed long Pa_GetStreamWriteAvailableUnchecked( PaStream* stream );
+
+/** @see Pa_ReadStreamUnchecked */
+PaTime Pa_GetStreamTimeUnchecked( PaStream *stream );
+
+/** @see Pa_ReadStreamUnchecked */
+double Pa_GetStreamCpuLoadUnchecked( PaStream* stream );
+
+/** @see Pa_ReadStreamUnchecked */
+PaError Pa_IsStreamStoppedUnchecked( PaStream *stream );
+
+/** @see Pa_ReadStreamUnchecked */
+PaError Pa_IsStreamActiveUnchecked( PaStream *stream );
+
+
 /* Miscellaneous utilities */
 
 
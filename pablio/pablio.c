@@ -45,24 +45,71 @@
 #include <math.h>
 #include "portaudio.h"
 #include "pa_ringbuffer.h"
+#include "pa_memorybarrier.h"
 #include "pablio.h"
 #include <string.h>
 
+/* The blocking calls sleep on a semaphore which is signalled by the callback
+ * whenever it has transferred data while a reader or writer is waiting. On
+ * Linux, POSIX semaphores are implemented with futexes, so an uncontended
+ * signal doesn't enter the kernel.
+ */
+#if defined(_WIN32)
+#include <windows.h>
+typedef HANDLE PABLIO_Semaphore;
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+typedef dispatch_semaphore_t PABLIO_Semaphore;
+#else
+#include <semaphore.h>
+#include <time.h>
+#include <errno.h>
+typedef sem_t PABLIO_Semaphore;
+#endif
+
 /************************************************************************/
 /******** Constants *****************************************************/
 /************************************************************************/
 
 #define FRAMES_PER_BUFFER    (256)
 
+/* Waits are bounded so that a stream which stops without signalling, e.g. on a
+ * device error, doesn't block the caller forever. */
+#define WAIT_TIMEOUT_MSEC    (200)
+
+/************************************************************************/
+/******** Types *********************************************************/
+/************************************************************************/
+
+struct PABLIO_Stream
+{
+    PaUtilRingBuffer   inFIFO;
+    PaUtilRingBuffer   outFIFO;
+    PaStream          *stream;
+    int                inBytesPerFrame;
+    int                outBytesPerFrame;
+    int                isInitialized;   /* Pa_Initialize() has been called */
+    PABLIO_Semaphore   inSemaphore;     /* signalled when frames are written to inFIFO */
+    PABLIO_Semaphore   outSemaphore;    /* signalled when frames are read from outFIFO */
+    volatile int       readerWaiting;
+    volatile int       writerWaiting;
+};
+
 /************************************************************************/
 /******** Prototypes ****************************************************/
 /************************************************************************/
 
-static int blockingIOCallback( void *inputBuffer, void *outputBuffer,
+static int blockingIOCallback( const void *inputBuffer, void *outputBuffer,
                                unsigned long framesPerBuffer,
-                               PaTimestamp outTime, void *userData );
-static PaError PABLIO_InitFIFO( RingBuffer *rbuf, long numFrames, long bytesPerFrame );
-static PaError PABLIO_TermFIFO( RingBuffer *rbuf );
+                               const PaStreamCallbackTimeInfo* timeInfo,
+                               PaStreamCallbackFlags statusFlags,
+                               void *userData );
+static PaError PABLIO_InitFIFO( PaUtilRingBuffer *rbuf, long numFrames, long bytesPerFrame );
+static PaError PABLIO_TermFIFO( PaUtilRingBuffer *rbuf );
+static PaError PABLIO_InitSemaphore( PABLIO_Semaphore *semaphore );
+static void PABLIO_TermSemaphore( PABLIO_Semaphore *semaphore );
+static void PABLIO_SignalSemaphore( PABLIO_Semaphore *semaphore );
+static int PABLIO_WaitSemaphore( PABLIO_Semaphore *semaphore, long timeoutMsec );
 
 /************************************************************************/
 /******** Functions *****************************************************/
@@ -71,87 +118,223 @@ static PaError PABLIO_TermFIFO( RingBuffer *rbuf );
 /* Called from PortAudio.
  * Read and write data only if there is room in FIFOs.
  */
-static int blockingIOCallback( void *inputBuffer, void *outputBuffer,
+static int blockingIOCallback( const void *inputBuffer, void *outputBuffer,
                                unsigned long framesPerBuffer,
-                               PaTimestamp outTime, void *userData )
+                               const PaStreamCallbackTimeInfo* timeInfo,
+                               PaStreamCallbackFlags statusFlags,
+                               void *userData )
 {
     PABLIO_Stream *data = (PABLIO_Stream*)userData;
-    long numBytes = data->bytesPerFrame * framesPerBuffer;
-    (void) outTime;
+    (void) timeInfo;
+    (void) statusFlags;
 
-    /* This may get called with NULL inputBuffer during initial setup. */
     if( inputBuffer != NULL )
     {
-        PaUtil_WriteRingBuffer( &data->inFIFO, inputBuffer, numBytes );
+        PaUtil_WriteRingBuffer( &data->inFIFO, inputBuffer, framesPerBuffer );
+
+        /* Publish the frames before checking for a reader, which checks for
+         * frames after announcing itself. */
+        PaUtil_FullMemoryBarrier();
+        if( data->readerWaiting )
+            PABLIO_SignalSemaphore( &data->inSemaphore );
     }
     if( outputBuffer != NULL )
     {
-        int i;
-        int numRead = PaUtil_ReadRingBuffer( &data->outFIFO, outputBuffer, numBytes );
+        long numRead = PaUtil_ReadRingBuffer( &data->outFIFO, outputBuffer, framesPerBuffer );
         /* Zero out remainder of buffer if we run out of data. */
-        for( i=numRead; i<numBytes; i++ )
-        {
-            ((char *)outputBuffer)[i] = 0;
-        }
+        memset( (char *)outputBuffer + numRead * data->outBytesPerFrame, 0,
+                (framesPerBuffer - numRead) * data->outBytesPerFrame );
+
+        PaUtil_FullMemoryBarrier();
+        if( data->writerWaiting )
+            PABLIO_SignalSemaphore( &data->outSemaphore );
     }
 
-    return 0;
+    return paContinue;
 }
 
 /* Allocate buffer. */
-static PaError PABLIO_InitFIFO( RingBuffer *rbuf, long numFrames, long bytesPerFrame )
+static PaError PABLIO_InitFIFO( PaUtilRingBuffer *rbuf, long numFrames, long bytesPerFrame )
 {
     long numBytes = numFrames * bytesPerFrame;
     char *buffer = (char *) malloc( numBytes );
     if( buffer == NULL ) return paInsufficientMemory;
     memset( buffer, 0, numBytes );
-    return (PaError) PaUtil_InitializeRingBuffer( rbuf, numBytes, buffer );
+    return (PaError) PaUtil_InitializeRingBuffer( rbuf, bytesPerFrame, numFrames, buffer );
 }
 
 /* Free buffer. */
-static PaError PABLIO_TermFIFO( RingBuffer *rbuf )
+static PaError PABLIO_TermFIFO( PaUtilRingBuffer *rbuf )
 {
     if( rbuf->buffer ) free( rbuf->buffer );
     rbuf->buffer = NULL;
     return paNoError;
 }
 
+#if defined(_WIN32)
+
+static PaError PABLIO_InitSemaphore( PABLIO_Semaphore *semaphore )
+{
+    *semaphore = CreateSemaphore( NULL, 0, 0x7FFFFFFF, NULL );
+    return (*semaphore != NULL) ? paNoError : paInsufficientMemory;
+}
+
+static void PABLIO_TermSemaphore( PABLIO_Semaphore *semaphore )
+{
+    CloseHandle( *semaphore );
+}
+
+static void PABLIO_SignalSemaphore( PABLIO_Semaphore *semaphore )
+{
+    ReleaseSemaphore( *semaphore, 1, NULL );
+}
+
+/* Returns 1 if the semaphore was signalled, 0 on timeout. */
+static int PABLIO_WaitSemaphore( PABLIO_Semaphore *semaphore, long timeoutMsec )
+{
+    return WaitForSingleObject( *semaphore, timeoutMsec ) == WAIT_OBJECT_0;
+}
+
+#elif defined(__APPLE__)
+
+static PaError PABLIO_InitSemaphore( PABLIO_Semaphore *semaphore )
+{
+    *semaphore = dispatch_semaphore_create( 0 );
+    return (*semaphore != NULL) ? paNoError : paInsufficientMemory;
+}
+
+static void PABLIO_TermSemaphore( PABLIO_Semaphore *semaphore )
+{
+    dispatch_release( *semaphore );
+}
+
+static void PABLIO_SignalSemaphore( PABLIO_Semaphore *semaphore )
+{
+    dispatch_semaphore_signal( *semaphore );
+}
+
+/* Returns 1 if the semaphore was signalled, 0 on timeout. */
+static int PABLIO_WaitSemaphore( PABLIO_Semaphore *semaphore, long timeoutMsec )
+{
+    return dispatch_semaphore_wait( *semaphore,
+            dispatch_time( DISPATCH_TIME_NOW, timeoutMsec * NSEC_PER_MSEC ) ) == 0;
+}
+
+#else
+
+static PaError PABLIO_InitSemaphore( PABLIO_Semaphore *semaphore )
+{
+    return (sem_init( semaphore, 0, 0 ) == 0) ? paNoError : paInsufficientMemory;
+}
+
+static void PABLIO_TermSemaphore( PABLIO_Semaphore *semaphore )
+{
+    sem_destroy( semaphore );
+}
+
+static void PABLIO_SignalSemaphore( PABLIO_Semaphore *semaphore )
+{
+    sem_post( semaphore );
+}
+
+/* Returns 1 if the semaphore was signalled, 0 on timeout. */
+static int PABLIO_WaitSemaphore( PABLIO_Semaphore *semaphore, long timeoutMsec )
+{
+    struct timespec deadline;
+    int err;
+
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_sec += timeoutMsec / 1000;
+    deadline.tv_nsec += (timeoutMsec % 1000) * 1000000;
+    if( deadline.tv_nsec >= 1000000000 )
+    {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    while( (err = sem_timedwait( semaphore, &deadline )) != 0 && errno == EINTR )
+        ;
+    return err == 0;
+}
+
+#endif
+
+/************************************************************
+ * Wait until getAvailable( rbuf ) returns at least numFrames, or the stream
+ * stops. Returns the number of frames available.
+ */
+static long WaitForFrames( PABLIO_Stream *aStream, PaUtilRingBuffer *rbuf,
+                           ring_buffer_size_t (*getAvailable)( const PaUtilRingBuffer *rbuf ),
+                           PABLIO_Semaphore *semaphore, volatile int *waiting,
+                           long numFrames )
+{
+    long available;
+
+    if( numFrames > rbuf->bufferSize ) numFrames = rbuf->bufferSize;
+
+    while( (available = getAvailable( rbuf )) < numFrames )
+    {
+        /* Announce ourselves before checking again, so that the callback
+         * either sees us waiting or we see its frames. */
+        *waiting = 1;
+        PaUtil_FullMemoryBarrier();
+        if( getAvailable( rbuf ) < numFrames
+                && !PABLIO_WaitSemaphore( semaphore, WAIT_TIMEOUT_MSEC )
+                && Pa_IsStreamActive( aStream->stream ) != 1 )
+        {
+            *waiting = 0;
+            return getAvailable( rbuf );
+        }
+        *waiting = 0;
+    }
+
+    return available;
+}
+
 /************************************************************
  * Write data to ring buffer.
- * Will not return until all the data has been written.
+ * Will not return until all the data has been written, or the stream
+ * has stopped. Returns the number of frames written.
  */
 long WriteAudioStream( PABLIO_Stream *aStream, void *data, long numFrames )
 {
-    long bytesWritten;
     char *p = (char *) data;
-    long numBytes = aStream->bytesPerFrame * numFrames;
-    while( numBytes > 0)
+    long framesWritten = 0;
+    long numWritten;
+
+    while( framesWritten < numFrames )
     {
-        bytesWritten = PaUtil_WriteRingBuffer( &aStream->outFIFO, p, numBytes );
-        numBytes -= bytesWritten;
-        p += bytesWritten;
-        if( numBytes > 0) Pa_Sleep(10);
+        if( WaitForAudioStreamWriteable( aStream, 1 ) == 0 )
+            break; /* the stream has stopped */
+
+        numWritten = PaUtil_WriteRingBuffer( &aStream->outFIFO, p, numFrames - framesWritten );
+        framesWritten += numWritten;
+        p += numWritten * aStream->outBytesPerFrame;
     }
-    return numFrames;
+    return framesWritten;
 }
 
 /************************************************************
  * Read data from ring buffer.
- * Will not return until all the data has been read.
+ * Will not return until all the data has been read, or the stream
+ * has stopped. Returns the number of frames read.
  */
 long ReadAudioStream( PABLIO_Stream *aStream, void *data, long numFrames )
 {
-    long bytesRead;
     char *p = (char *) data;
-    long numBytes = aStream->bytesPerFrame * numFrames;
-    while( numBytes > 0)
+    long framesRead = 0;
+    long numRead;
+
+    while( framesRead < numFrames )
     {
-        bytesRead = PaUtil_ReadRingBuffer( &aStream->inFIFO, p, numBytes );
-        numBytes -= bytesRead;
-        p += bytesRead;
-        if( numBytes > 0) Pa_Sleep(10);
+        if( WaitForAudioStreamReadable( aStream, 1 ) == 0 )
+            break; /* the stream has stopped */
+
+        numRead = PaUtil_ReadRingBuffer( &aStream->inFIFO, p, numFrames - framesRead );
+        framesRead += numRead;
+        p += numRead * aStream->inBytesPerFrame;
     }
-    return numFrames;
+    return framesRead;
 }
 
 /************************************************************
@@ -160,8 +343,7 @@ long ReadAudioStream( PABLIO_Stream *aStream, void *data, long numFrames )
  */
 long GetAudioStreamWriteable( PABLIO_Stream *aStream )
 {
-    int bytesEmpty = PaUtil_GetRingBufferWriteAvailable( &aStream->outFIFO );
-    return bytesEmpty / aStream->bytesPerFrame;
+    return PaUtil_GetRingBufferWriteAvailable( &aStream->outFIFO );
 }
 
 /************************************************************
@@ -170,8 +352,59 @@ long GetAudioStreamWriteable( PABLIO_Stream *aStream )
  */
 long GetAudioStreamReadable( PABLIO_Stream *aStream )
 {
-    int bytesFull = PaUtil_GetRingBufferReadAvailable( &aStream->inFIFO );
-    return bytesFull / aStream->bytesPerFrame;
+    return PaUtil_GetRingBufferReadAvailable( &aStream->inFIFO );
+}
+
+/************************************************************/
+long WaitForAudioStreamWriteable( PABLIO_Stream *aStream, long numFrames )
+{
+    return WaitForFrames( aStream, &aStream->outFIFO, PaUtil_GetRingBufferWriteAvailable,
+                          &aStream->outSemaphore, &aStream->writerWaiting, numFrames );
+}
+
+/************************************************************/
+long WaitForAudioStreamReadable( PABLIO_Stream *aStream, long numFrames )
+{
+    return WaitForFrames( aStream, &aStream->inFIFO, PaUtil_GetRingBufferReadAvailable,
+                          &aStream->inSemaphore, &aStream->readerWaiting, numFrames );
+}
+
+/************************************************************/
+long GetAudioStreamWriteRegions( PABLIO_Stream *aStream, long numFrames,
+                                 void **data1, long *numFrames1,
+                                 void **data2, long *numFrames2 )
+{
+    ring_buffer_size_t size1, size2;
+    long result = PaUtil_GetRingBufferWriteRegions( &aStream->outFIFO, numFrames,
+                                                    data1, &size1, data2, &size2 );
+    *numFrames1 = size1;
+    *numFrames2 = size2;
+    return result;
+}
+
+/************************************************************/
+long AdvanceAudioStreamWriteIndex( PABLIO_Stream *aStream, long numFrames )
+{
+    return PaUtil_AdvanceRingBufferWriteIndex( &aStream->outFIFO, numFrames );
+}
+
+/************************************************************/
+long GetAudioStreamReadRegions( PABLIO_Stream *aStream, long numFrames,
+                                void **data1, long *numFrames1,
+                                void **data2, long *numFrames2 )
+{
+    ring_buffer_size_t size1, size2;
+    long result = PaUtil_GetRingBufferReadRegions( &aStream->inFIFO, numFrames,
+                                                   data1, &size1, data2, &size2 );
+    *numFrames1 = size1;
+    *numFrames2 = size2;
+    return result;
+}
+
+/************************************************************/
+long AdvanceAudioStreamReadIndex( PABLIO_Stream *aStream, long numFrames )
+{
+    return PaUtil_AdvanceRingBufferReadIndex( &aStream->inFIFO, numFrames );
 }
 
 /************************************************************/
@@ -197,20 +430,52 @@ static unsigned long RoundUpToNextPowerOf2( unsigned long n )
  */
 PaError OpenAudioStream( PABLIO_Stream **rwblPtr, double sampleRate,
                          PaSampleFormat format, long flags )
+{
+    int samplesPerFrame = ((flags&PABLIO_MONO) != 0) ? 1 : 2;
+
+    return OpenAudioStreamEx( rwblPtr, sampleRate, format,
+                              ((flags & PABLIO_READ) != 0) ? samplesPerFrame : 0,
+                              ((flags & PABLIO_WRITE) != 0) ? samplesPerFrame : 0,
+                              0 );
+}
+
+/************************************************************
+ * Opens a PortAudio stream on the default devices with any number of
+ * channels. Allocates PABLIO_Stream structure.
+ */
+PaError OpenAudioStreamEx( PABLIO_Stream **rwblPtr, double sampleRate,
+                           PaSampleFormat format, int numInputChannels,
+                           int numOutputChannels, long numFifoFrames )
 {
     long   bytesPerSample;
-    long   doRead = 0;
-    long   doWrite = 0;
     PaError err;
     PABLIO_Stream *aStream;
-    long   minNumBuffers;
-    long   numFrames;
+    PaStreamParameters inputParameters, outputParameters;
+    const PaStreamInfo *streamInfo;
+    const PaDeviceInfo *deviceInfo;
+    double latency;
+
+    *rwblPtr = NULL;
 
     /* Allocate PABLIO_Stream structure for caller. */
     aStream = (PABLIO_Stream *) malloc( sizeof(PABLIO_Stream) );
     if( aStream == NULL ) return paInsufficientMemory;
     memset( aStream, 0, sizeof(PABLIO_Stream) );
 
+    err = PABLIO_InitSemaphore( &aStream->inSemaphore );
+    if( err != paNoError )
+    {
+        free( aStream );
+        return err;
+    }
+    err = PABLIO_InitSemaphore( &aStream->outSemaphore );
+    if( err != paNoError )
+    {
+        PABLIO_TermSemaphore( &aStream->inSemaphore );
+        free( aStream );
+        return err;
+    }
+
     /* Determine size of a sample. */
     bytesPerSample = Pa_GetSampleSize( format );
     if( bytesPerSample < 0 )
@@ -218,58 +483,83 @@ PaError OpenAudioStream( PABLIO_Stream **rwblPtr, double sampleRate,
         err = (PaError) bytesPerSample;
         goto error;
     }
-    aStream->samplesPerFrame = ((flags&PABLIO_MONO) != 0) ? 1 : 2;
-    aStream->bytesPerFrame = bytesPerSample * aStream->samplesPerFrame;
+    aStream->inBytesPerFrame = bytesPerSample * numInputChannels;
+    aStream->outBytesPerFrame = bytesPerSample * numOutputChannels;
 
     /* Initialize PortAudio  */
     err = Pa_Initialize();
     if( err != paNoError ) goto error;
+    aStream->isInitialized = 1;
 
-    /* Warning: numFrames must be larger than amount of data processed per interrupt
-     *    inside PA to prevent glitches. Just to be safe, adjust size upwards.
-     */
-    minNumBuffers = 2 * Pa_GetMinNumBuffers( FRAMES_PER_BUFFER, sampleRate );
-    numFrames = minNumBuffers * FRAMES_PER_BUFFER;
-    numFrames = RoundUpToNextPowerOf2( numFrames );
-
-    /* Initialize Ring Buffers */
-    doRead = ((flags & PABLIO_READ) != 0);
-    doWrite = ((flags & PABLIO_WRITE) != 0);
-    if(doRead)
+    if( numInputChannels > 0 )
     {
-        err = PABLIO_InitFIFO( &aStream->inFIFO, numFrames, aStream->bytesPerFrame );
-        if( err != paNoError ) goto error;
+        inputParameters.device = Pa_GetDefaultInputDevice();
+        if( inputParameters.device == paNoDevice )
+        {
+            err = paInvalidDevice;
+            goto error;
+        }
+        deviceInfo = Pa_GetDeviceInfo( inputParameters.device );
+        inputParameters.channelCount = numInputChannels;
+        inputParameters.sampleFormat = format;
+        inputParameters.suggestedLatency = deviceInfo->defaultHighInputLatency;
+        inputParameters.hostApiSpecificStreamInfo = NULL;
     }
-    if(doWrite)
+    if( numOutputChannels > 0 )
     {
-        long numBytes;
-        err = PABLIO_InitFIFO( &aStream->outFIFO, numFrames, aStream->bytesPerFrame );
-        if( err != paNoError ) goto error;
-        /* Make Write FIFO appear full initially. */
-        numBytes = PaUtil_GetRingBufferWriteAvailable( &aStream->outFIFO );
-        PaUtil_AdvanceRingBufferWriteIndex( &aStream->outFIFO, numBytes );
+        outputParameters.device = Pa_GetDefaultOutputDevice();
+        if( outputParameters.device == paNoDevice )
+        {
+            err = paInvalidDevice;
+            goto error;
+        }
+        deviceInfo = Pa_GetDeviceInfo( outputParameters.device );
+        outputParameters.channelCount = numOutputChannels;
+        outputParameters.sampleFormat = format;
+        outputParameters.suggestedLatency = deviceInfo->defaultHighOutputLatency;
+        outputParameters.hostApiSpecificStreamInfo = NULL;
     }
 
     /* Open a PortAudio stream that we will use to communicate with the underlying
      * audio drivers. */
     err = Pa_OpenStream(
               &aStream->stream,
-              (doRead ? Pa_GetDefaultInputDeviceID() : paNoDevice),
-              (doRead ? aStream->samplesPerFrame : 0 ),
-              format,
-              NULL,
-              (doWrite ? Pa_GetDefaultOutputDeviceID() : paNoDevice),
-              (doWrite ? aStream->samplesPerFrame : 0 ),
-              format,
-              NULL,
+              (numInputChannels > 0) ? &inputParameters : NULL,
+              (numOutputChannels > 0) ? &outputParameters : NULL,
               sampleRate,
               FRAMES_PER_BUFFER,
-              minNumBuffers,
               paClipOff,       /* we won't output out of range samples so don't bother clipping them */
               blockingIOCallback,
               aStream );
     if( err != paNoError ) goto error;
 
+    /* Warning: numFrames must be larger than amount of data processed per interrupt
+     *    inside PA to prevent glitches. Just to be safe, adjust size upwards.
+     */
+    if( numFifoFrames <= 0 )
+    {
+        streamInfo = Pa_GetStreamInfo( aStream->stream );
+        latency = (streamInfo->inputLatency > streamInfo->outputLatency) ?
+                  streamInfo->inputLatency : streamInfo->outputLatency;
+        numFifoFrames = 2 * ((long) (latency * sampleRate) + FRAMES_PER_BUFFER);
+    }
+    numFifoFrames = RoundUpToNextPowerOf2( numFifoFrames );
+
+    /* Initialize Ring Buffers */
+    if( numInputChannels > 0 )
+    {
+        err = PABLIO_InitFIFO( &aStream->inFIFO, numFifoFrames, aStream->inBytesPerFrame );
+        if( err != paNoError ) goto error;
+    }
+    if( numOutputChannels > 0 )
+    {
+        err = PABLIO_InitFIFO( &aStream->outFIFO, numFifoFrames, aStream->outBytesPerFrame );
+        if( err != paNoError ) goto error;
+        /* Make Write FIFO appear full initially. */
+        PaUtil_AdvanceRingBufferWriteIndex( &aStream->outFIFO,
+                PaUtil_GetRingBufferWriteAvailable( &aStream->outFIFO ) );
+    }
+
     err = Pa_StartStream( aStream->stream );
     if( err != paNoError ) goto error;
 
@@ -278,37 +568,32 @@ PaError OpenAudioStream( PABLIO_Stream **rwblPtr, double sampleRate,
 
 error:
     CloseAudioStream( aStream );
-    *rwblPtr = NULL;
     return err;
 }
 
 /************************************************************/
 PaError CloseAudioStream( PABLIO_Stream *aStream )
 {
-    PaError err;
-    int bytesEmpty;
-    int byteSize = aStream->outFIFO.bufferSize;
+    PaError err = paNoError;
 
-    /* If we are writing data, make sure we play everything written. */
-    if( byteSize > 0 )
+    if( aStream->stream != NULL )
     {
-        bytesEmpty = PaUtil_GetRingBufferWriteAvailable( &aStream->outFIFO );
-        while( bytesEmpty < byteSize )
-        {
-            Pa_Sleep( 10 );
-            bytesEmpty = PaUtil_GetRingBufferWriteAvailable( &aStream->outFIFO );
-        }
-    }
+        /* If we are writing data, make sure we play everything written. */
+        if( aStream->outFIFO.buffer != NULL )
+            WaitForAudioStreamWriteable( aStream, aStream->outFIFO.bufferSize );
 
-    err = Pa_StopStream( aStream->stream );
-    if( err != paNoError ) goto error;
-    err = Pa_CloseStream( aStream->stream );
-    if( err != paNoError ) goto error;
-    Pa_Terminate();
+        if( Pa_IsStreamStopped( aStream->stream ) == 0 )
+            err = Pa_StopStream( aStream->stream );
+        if( err == paNoError )
+            err = Pa_CloseStream( aStream->stream );
+    }
+    if( aStream->isInitialized )
+        Pa_Terminate();
 
-error:
     PABLIO_TermFIFO( &aStream->inFIFO );
     PABLIO_TermFIFO( &aStream->outFIFO );
+    PABLIO_TermSemaphore( &aStream->inSemaphore );
+    PABLIO_TermSemaphore( &aStream->outSemaphore );
     free( aStream );
     return err;
 }
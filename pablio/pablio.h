@@ -49,22 +49,10 @@ extern "C"
  * license above.
  */
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <math.h>
 #include "portaudio.h"
-#include "pa_ringbuffer.h"
-#include <string.h>
 
-typedef struct
-{
-    RingBuffer   inFIFO;
-    RingBuffer   outFIFO;
-    PortAudioStream *stream;
-    int          bytesPerFrame;
-    int          samplesPerFrame;
-}
-PABLIO_Stream;
+/* The stream is opaque, it holds platform specific synchronization objects. */
+typedef struct PABLIO_Stream PABLIO_Stream;
 
 /* Values for flags for OpenAudioStream(). */
 #define PABLIO_READ     (1<<0)
@@ -75,13 +63,15 @@ PABLIO_Stream;
 
 /************************************************************
  * Write data to ring buffer.
- * Will not return until all the data has been written.
+ * Will not return until all the data has been written, or the stream
+ * has stopped. Returns the number of frames written.
  */
 long WriteAudioStream( PABLIO_Stream *aStream, void *data, long numFrames );
 
 /************************************************************
  * Read data from ring buffer.
- * Will not return until all the data has been read.
+ * Will not return until all the data has been read, or the stream
+ * has stopped. Returns the number of frames read.
  */
 long ReadAudioStream( PABLIO_Stream *aStream, void *data, long numFrames );
 
@@ -97,6 +87,54 @@ long GetAudioStreamWriteable( PABLIO_Stream *aStream );
  */
 long GetAudioStreamReadable( PABLIO_Stream *aStream );
 
+/************************************************************
+ * Wait until at least numFrames frames can be written without blocking,
+ * or the stream has stopped. numFrames is limited to the FIFO size.
+ * Returns the number of frames that can be written.
+ */
+long WaitForAudioStreamWriteable( PABLIO_Stream *aStream, long numFrames );
+
+/************************************************************
+ * Wait until at least numFrames frames can be read without blocking,
+ * or the stream has stopped. numFrames is limited to the FIFO size.
+ * Returns the number of frames that can be read.
+ */
+long WaitForAudioStreamReadable( PABLIO_Stream *aStream, long numFrames );
+
+/************************************************************
+ * Zero-copy write: get pointers to up to numFrames writeable frames in the
+ * output FIFO. The frames may be split into two regions where the FIFO wraps
+ * around; numFrames2 is 0 if they are not. Doesn't wait.
+ * Fill the regions with interleaved samples, then call
+ * AdvanceAudioStreamWriteIndex() to queue them.
+ * Returns the total number of frames in both regions.
+ */
+long GetAudioStreamWriteRegions( PABLIO_Stream *aStream, long numFrames,
+                                 void **data1, long *numFrames1,
+                                 void **data2, long *numFrames2 );
+
+/************************************************************
+ * Queue numFrames frames which were written to the regions returned by
+ * GetAudioStreamWriteRegions(). Returns the new write position.
+ */
+long AdvanceAudioStreamWriteIndex( PABLIO_Stream *aStream, long numFrames );
+
+/************************************************************
+ * Zero-copy read: get pointers to up to numFrames readable frames in the
+ * input FIFO, as for GetAudioStreamWriteRegions(). Doesn't wait.
+ * Call AdvanceAudioStreamReadIndex() once the frames have been consumed.
+ * Returns the total number of frames in both regions.
+ */
+long GetAudioStreamReadRegions( PABLIO_Stream *aStream, long numFrames,
+                                void **data1, long *numFrames1,
+                                void **data2, long *numFrames2 );
+
+/************************************************************
+ * Release numFrames frames which were read from the regions returned by
+ * GetAudioStreamReadRegions(). Returns the new read position.
+ */
+long AdvanceAudioStreamReadIndex( PABLIO_Stream *aStream, long numFrames );
+
 /************************************************************
  * Opens a PortAudio stream with default characteristics.
  * Allocates PABLIO_Stream structure.
@@ -108,6 +146,21 @@ long GetAudioStreamReadable( PABLIO_Stream *aStream );
 PaError OpenAudioStream( PABLIO_Stream **aStreamPtr, double sampleRate,
                          PaSampleFormat format, long flags );
 
+/************************************************************
+ * Opens a PortAudio stream on the default devices with any number of
+ * channels. Allocates PABLIO_Stream structure.
+ *
+ * numInputChannels, numOutputChannels: channels to read and write,
+ *    0 if the stream is not to be read or written.
+ * numFifoFrames: capacity of each FIFO in frames, rounded up to a power
+ *    of 2, or 0 to derive it from the stream latency. Larger FIFOs allow
+ *    the caller to block for longer without glitches, at the cost of
+ *    latency.
+ */
+PaError OpenAudioStreamEx( PABLIO_Stream **aStreamPtr, double sampleRate,
+                           PaSampleFormat format, int numInputChannels,
+                           int numOutputChannels, long numFifoFrames );
+
 PaError CloseAudioStream( PABLIO_Stream *aStream );
 
 #ifdef __cplusplus
@@ -0,0 +1,136 @@
+/*
+ * $Id$
+ * test_rw_regions.c
+ * Read mono input and write it to both channels of a stereo output,
+ * working directly in the PABLIO FIFOs.
+ *
+ * This program uses PABLIO, the Portable Audio Blocking I/O Library.
+ * PABLIO is built on top of PortAudio, the Portable Audio Library.
+ * For more information see: http://www.portaudio.com
+ * Copyright (c) 1999-2000 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "pablio.h"
+
+#define SAMPLE_RATE          (44100)
+#define NUM_SECONDS              (5)
+#define FRAMES_PER_BLOCK        (64)
+#define FIFO_FRAMES           (2048)
+
+typedef float SAMPLE;
+
+/* Copy numFrames mono frames into stereo frames. */
+static void CopyMonoToStereo( SAMPLE *out, const SAMPLE *in, long numFrames )
+{
+    long i;
+    for( i=0; i<numFrames; i++ )
+    {
+        out[2*i] = out[2*i + 1] = in[i];
+    }
+}
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    long     i;
+    PaError  err;
+    PABLIO_Stream     *aStream;
+    void    *inData[2], *outData[2];
+    long     inFrames[2], outFrames[2];
+    long     numFrames, numDone, numCopy;
+    int      inRegion, outRegion;
+    long     inOffset, outOffset;
+
+    printf("Zero-copy full duplex test using PABLIO regions\n");
+    fflush(stdout);
+
+    /* One input channel, two output channels, and a small FIFO. */
+    err = OpenAudioStreamEx( &aStream, SAMPLE_RATE, paFloat32, 1, 2, FIFO_FRAMES );
+    if( err != paNoError ) goto error;
+
+    for( i=0; i<(NUM_SECONDS * SAMPLE_RATE); i += FRAMES_PER_BLOCK )
+    {
+        /* Wait for a block of input and room for it in the output. */
+        WaitForAudioStreamReadable( aStream, FRAMES_PER_BLOCK );
+        WaitForAudioStreamWriteable( aStream, FRAMES_PER_BLOCK );
+
+        numFrames = GetAudioStreamReadRegions( aStream, FRAMES_PER_BLOCK,
+                        &inData[0], &inFrames[0], &inData[1], &inFrames[1] );
+        numFrames = GetAudioStreamWriteRegions( aStream, numFrames,
+                        &outData[0], &outFrames[0], &outData[1], &outFrames[1] );
+
+        /* Either side may wrap around at a different point. */
+        inRegion = outRegion = 0;
+        inOffset = outOffset = 0;
+        for( numDone = 0; numDone < numFrames; numDone += numCopy )
+        {
+            numCopy = inFrames[inRegion] - inOffset;
+            if( numCopy > outFrames[outRegion] - outOffset )
+                numCopy = outFrames[outRegion] - outOffset;
+
+            CopyMonoToStereo( (SAMPLE *)outData[outRegion] + 2 * outOffset,
+                              (SAMPLE *)inData[inRegion] + inOffset, numCopy );
+
+            inOffset += numCopy;
+            if( inOffset == inFrames[inRegion] )
+            {
+                inRegion++;
+                inOffset = 0;
+            }
+            outOffset += numCopy;
+            if( outOffset == outFrames[outRegion] )
+            {
+                outRegion++;
+                outOffset = 0;
+            }
+        }
+
+        AdvanceAudioStreamReadIndex( aStream, numFrames );
+        AdvanceAudioStreamWriteIndex( aStream, numFrames );
+    }
+
+    CloseAudioStream( aStream );
+
+    printf("Zero-copy full duplex test complete.\n" );
+    fflush(stdout);
+    return 0;
+
+error:
+    fprintf( stderr, "An error occured while using the portaudio stream\n" );
+    fprintf( stderr, "Error number: %d\n", err );
+    fprintf( stderr, "Error message: %s\n", Pa_GetErrorText( err ) );
+    return -1;
+}
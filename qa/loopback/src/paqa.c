@@ -43,6 +43,9 @@
 #include <string.h>
 
 #include "portaudio.h"
+#if PA_USE_NULL
+#include "pa_null.h"
+#endif
 
 #include "qa_tools.h"
 
@@ -139,6 +142,11 @@ typedef struct UserOptions_s
 	const char   *waveFilePath;
 	PaDeviceIndex inputDevice;
 	PaDeviceIndex outputDevice;
+	// Software loopback of the null host API, instead of a cable.
+	int           nullLoopback;
+	double        nullLatency;    // msec
+	double        nullDrift;      // ppm
+	double        nullDropouts;   // probability per buffer
 } UserOptions;
 
 #define BIG_BUFFER_SIZE  (sizeof(float) * 2 * 2 * 1024)
@@ -146,7 +154,9 @@ static unsigned char g_ReadWriteBuffer[BIG_BUFFER_SIZE];
 
 #define MAX_CONVERSION_SAMPLES   (2 * 32 * 1024)
 #define CONVERSION_BUFFER_SIZE  (sizeof(float) * 2 * MAX_CONVERSION_SAMPLES)
-static unsigned char g_ConversionBuffer[CONVERSION_BUFFER_SIZE];
+// Separate for input and output, whose callbacks run concurrently with two streams.
+static unsigned char g_InputConversionBuffer[CONVERSION_BUFFER_SIZE];
+static unsigned char g_OutputConversionBuffer[CONVERSION_BUFFER_SIZE];
 
 /*******************************************************************/
 static int RecordAndPlaySinesCallback( const void *inputBuffer, void *outputBuffer,
@@ -188,7 +198,7 @@ static int RecordAndPlaySinesCallback( const void *inputBuffer, void *outputBuff
 		if( inFormat != paFloat32 )
 		{
 			int samplesToConvert = framesPerBuffer * channelsPerFrame;
-			in = (float *) g_ConversionBuffer;
+			in = (float *) g_InputConversionBuffer;
 			if( samplesToConvert > MAX_CONVERSION_SAMPLES )
 			{
 				// Hack to prevent buffer overflow.
@@ -196,7 +206,7 @@ static int RecordAndPlaySinesCallback( const void *inputBuffer, void *outputBuff
 				printf("Format conversion buffer too small!\n");
 				return paComplete;
 			}
-			PaQa_ConvertToFloat( inputBuffer, samplesToConvert, inFormat, (float *) g_ConversionBuffer );
+			PaQa_ConvertToFloat( inputBuffer, samplesToConvert, inFormat, (float *) g_InputConversionBuffer );
 		}
 		
 		// Read each channel from the buffer.
@@ -219,8 +229,8 @@ static int RecordAndPlaySinesCallback( const void *inputBuffer, void *outputBuff
 		
 		if( outFormat != paFloat32 )
 		{
-			// If we need to convert then mix to the g_ConversionBuffer and then convert into the PA outputBuffer.
-			out = (float *) g_ConversionBuffer;
+			// If we need to convert then mix to the g_OutputConversionBuffer and then convert into the PA outputBuffer.
+			out = (float *) g_OutputConversionBuffer;
 		}
 			
 		PaQa_EraseBuffer( out, framesPerBuffer, channelsPerFrame );
@@ -1434,6 +1444,47 @@ error:
 }
 
 
+#if PA_USE_NULL
+/*******************************************************************/
+/**
+ * Add a loopback pair to the null host API, to be tested instead of a cable.
+ * This must be called before Pa_Initialize().
+ * @return 0 if OK or negative error.
+ */
+static int PaQa_AddNullLoopback( UserOptions *userOptions )
+{
+	PaNullDeviceSpec spec;
+	
+	PaNull_InitializeDeviceSpec( &spec );
+	spec.name = "PaQa Loopback";
+	spec.flags = paNullLoopback;
+	spec.loopbackLatency = userOptions->nullLatency * 0.001;
+	spec.loopbackClockRatio = 1.0 + userOptions->nullDrift * 0.000001;
+	spec.loopbackDropoutProbability = userOptions->nullDropouts;
+	return PaNull_AddDevice( &spec );
+}
+
+/*******************************************************************/
+/**
+ * Select the devices of the loopback pair unless others were requested.
+ */
+static void PaQa_SelectNullLoopback( UserOptions *userOptions )
+{
+	PaHostApiIndex hostApi = Pa_HostApiTypeIdToHostApiIndex( paInDevelopment );
+	if( hostApi < 0 ) return;
+	
+	// The output comes first, followed by the input.
+	if( userOptions->outputDevice < 0 )
+	{
+		userOptions->outputDevice = Pa_HostApiDeviceIndexToDeviceIndex( hostApi, 0 );
+	}
+	if( userOptions->inputDevice < 0 )
+	{
+		userOptions->inputDevice = Pa_HostApiDeviceIndexToDeviceIndex( hostApi, 1 );
+	}
+}
+#endif
+
 /*******************************************************************/
 void usage( const char *name )
 {
@@ -1449,6 +1500,11 @@ void usage( const char *name )
 	printf("  -dDir - Path for Directory for WAV files. Default is current directory.\n");
 	printf("  -m  - Just test the DSP Math code and not the audio devices.\n");
 	printf("  -v  - Verbose reports.\n");
+#if PA_USE_NULL
+	printf("  --nullLoopback # Test the software loopback of the null host API, with a latency in milliseconds.\n");
+	printf("  --nullDrift # Drift of the software loopback's input clock in ppm.\n");
+	printf("  --nullDropouts # Probability of dropping each buffer in the software loopback.\n");
+#endif
 }
 
 /*******************************************************************/
@@ -1538,6 +1594,24 @@ int main( int argc, char **argv )
 						i += 1;
 						userOptions.outputLatency = atoi(argv[i]);					
 					}
+#if PA_USE_NULL
+					else if( strcmp( &arg[2], "nullLoopback" ) == 0 )
+					{
+						i += 1;
+						userOptions.nullLoopback = 1;
+						userOptions.nullLatency = atof(argv[i]);
+					}
+					else if( strcmp( &arg[2], "nullDrift" ) == 0 )
+					{
+						i += 1;
+						userOptions.nullDrift = atof(argv[i]);
+					}
+					else if( strcmp( &arg[2], "nullDropouts" ) == 0 )
+					{
+						i += 1;
+						userOptions.nullDropouts = atof(argv[i]);
+					}
+#endif
 					else
 					{
 						printf("Illegal option: %s\n", arg);
@@ -1573,7 +1647,19 @@ int main( int argc, char **argv )
 	
 	if( (result == 0) && (justMath == 0) )
 	{
+#if PA_USE_NULL
+		if( userOptions.nullLoopback )
+		{
+			PaQa_AddNullLoopback( &userOptions );
+		}
+#endif
 		Pa_Initialize();
+#if PA_USE_NULL
+		if( userOptions.nullLoopback )
+		{
+			PaQa_SelectNullLoopback( &userOptions );
+		}
+#endif
 		printf( "PortAudio version number = %d\nPortAudio version text = '%s'\n",
 			   Pa_GetVersion(), Pa_GetVersionText() );
 		printf( "=============== PortAudio Devices ========================\n" );
@@ -36,7 +36,8 @@
  */
 
 /**
-  * Very simple WAV file writer for saving captured audio.
+  * Very simple WAV file writer for saving captured audio,
+  * and a reader for streaming 16 bit PCM files.
   */
 
 #include <stdio.h>
@@ -79,6 +80,9 @@ static void WriteChunkType( unsigned char **addrPtr, unsigned long cktyp )
         4 + 4 + 16 + /* fmt chunk */ \
         4 + 4 ) /* data chunk */
 
+/* Bytes converted at a time when reading or writing samples. */
+#define WAV_IO_BUFFER_SIZE (1024)
+
 
 /*********************************************************************************
  * Open named file and write WAV header to the file.
@@ -142,7 +146,7 @@ long Audio_WAV_WriteShorts( WAV_Writer *writer,
 		int numSamples
 		)
 {
-	unsigned char buffer[2];
+	unsigned char buffer[WAV_IO_BUFFER_SIZE];
     unsigned char *bufferPtr;
 	int i;
 	short *p = samples;
@@ -153,12 +157,19 @@ long Audio_WAV_WriteShorts( WAV_Writer *writer,
 		return -1;
 	}
 
-    for( i=0; i<numSamples; i++ )
+    /* Convert a block at a time, so long renders are not dominated by calls to fwrite(). */
+    i = 0;
+    while( i<numSamples )
 	{
+        int numBytes;
         bufferPtr = buffer;
-		WriteShortLE( &bufferPtr, *p++ );
-        numWritten = fwrite( buffer, 1, sizeof( buffer), writer->fid );
-        if( numWritten != sizeof(buffer) ) return -1;
+        for( ; i<numSamples && bufferPtr < buffer + sizeof(buffer); i++ )
+        {
+            WriteShortLE( &bufferPtr, *p++ );
+        }
+        numBytes = (int) (bufferPtr - buffer);
+        numWritten = fwrite( buffer, 1, numBytes, writer->fid );
+        if( numWritten != numBytes ) return -1;
 	}
     bytesWritten = numSamples * sizeof(short);
     writer->dataSize += bytesWritten;
@@ -175,29 +186,226 @@ long Audio_WAV_CloseWriter( WAV_Writer *writer )
     unsigned char *bufferPtr;
     int numWritten;
     int riffSize;
+    long result = writer->dataSize;
 
-    /* Go back to beginning of file and update DATA size */
-    int result = fseek( writer->fid, writer->dataSizeOffset, SEEK_SET );
-    if( result < 0 ) return result;
+    /* Go back to beginning of file and update DATA size.
+     * This fails on pipes, readers then have to read until the end of the stream. */
+    if( fseek( writer->fid, writer->dataSizeOffset, SEEK_SET ) < 0 )
+    {
+        result = -1;
+        goto done;
+    }
 
     bufferPtr = buffer;
     WriteLongLE( &bufferPtr, writer->dataSize );
     numWritten = fwrite( buffer, 1, sizeof( buffer), writer->fid );
-    if( numWritten != sizeof(buffer) ) return -1;
+    if( numWritten != sizeof(buffer) )
+    {
+        result = -1;
+        goto done;
+    }
 
     /* Update RIFF size */
-    result = fseek( writer->fid, 4, SEEK_SET );
-    if( result < 0 ) return result;
+    if( fseek( writer->fid, 4, SEEK_SET ) < 0 )
+    {
+        result = -1;
+        goto done;
+    }
 
     riffSize = writer->dataSize + (WAV_HEADER_SIZE - 8);
     bufferPtr = buffer;
     WriteLongLE( &bufferPtr, riffSize );
     numWritten = fwrite( buffer, 1, sizeof( buffer), writer->fid );
-    if( numWritten != sizeof(buffer) ) return -1;
+    if( numWritten != sizeof(buffer) ) result = -1;
 
+done:
     fclose( writer->fid );
     writer->fid = NULL;
-    return writer->dataSize;
+    return result;
+}
+
+/* Read little endian long word data from a byte array. */
+static unsigned long ReadLongLE( const unsigned char *addr )
+{
+	return (unsigned long) addr[0] | ((unsigned long) addr[1] << 8) |
+		((unsigned long) addr[2] << 16) | ((unsigned long) addr[3] << 24);
+}
+
+/* Read little endian short word data from a byte array. */
+static unsigned short ReadShortLE( const unsigned char *addr )
+{
+	return (unsigned short) ( addr[0] | (addr[1] << 8) );
+}
+
+/* Read IFF ChunkType data from a byte array. */
+static unsigned long ReadChunkType( const unsigned char *addr )
+{
+	return ((unsigned long) addr[0] << 24) | ((unsigned long) addr[1] << 16) |
+		((unsigned long) addr[2] << 8) | (unsigned long) addr[3];
+}
+
+/* Skip bytes by reading them, so this works on pipes too. */
+static long SkipBytes( FILE *fid, unsigned long numBytes )
+{
+	unsigned char buffer[WAV_IO_BUFFER_SIZE];
+	while( numBytes > 0 )
+	{
+		size_t numToRead = numBytes < sizeof(buffer) ? numBytes : sizeof(buffer);
+		if( fread( buffer, 1, numToRead, fid ) != numToRead ) return WAV_ERR_TRUNCATED;
+		numBytes -= numToRead;
+	}
+	return 0;
+}
+
+/*********************************************************************************
+ * Open named file and read the WAV header up to the start of the sample data.
+ * The file is read sequentially, so it may be a pipe.
+ * Returns zero or negative error code.
+ */
+long Audio_WAV_OpenReader( WAV_Reader *reader, const char *fileName )
+{
+	unsigned char header[16];
+	unsigned long chunkType, chunkSize;
+	int haveFormat = 0;
+	long result;
+
+	reader->frameRate = 0;
+	reader->samplesPerFrame = 0;
+	reader->dataSizeRemaining = -1;
+
+	reader->fid = fopen( fileName, "rb" );
+	if( reader->fid == NULL )
+	{
+		return -1;
+	}
+
+/* Read RIFF header and WAVE form ID. */
+	if( fread( header, 1, 12, reader->fid ) != 12 )
+	{
+		result = WAV_ERR_TRUNCATED;
+		goto error;
+	}
+	if( ReadChunkType( header ) != RIFF_ID || ReadChunkType( header + 8 ) != WAVE_ID )
+	{
+		result = WAV_ERR_FILE_TYPE;
+		goto error;
+	}
+
+/* Read chunks until the data chunk, skipping the ones we don't understand. */
+	while( 1 )
+	{
+		if( fread( header, 1, 8, reader->fid ) != 8 )
+		{
+			result = WAV_ERR_TRUNCATED;
+			goto error;
+		}
+		chunkType = ReadChunkType( header );
+		chunkSize = ReadLongLE( header + 4 );
+
+		if( chunkType == FMT_ID )
+		{
+			if( chunkSize < 16 )
+			{
+				result = WAV_ERR_CHUNK_SIZE;
+				goto error;
+			}
+			if( fread( header, 1, 16, reader->fid ) != 16 )
+			{
+				result = WAV_ERR_TRUNCATED;
+				goto error;
+			}
+			if( ReadShortLE( header ) != WAVE_FORMAT_PCM )
+			{
+				result = WAV_ERR_FORMAT_TYPE;
+				goto error;
+			}
+			reader->samplesPerFrame = ReadShortLE( header + 2 );
+			reader->frameRate = (int) ReadLongLE( header + 4 );
+			if( ReadShortLE( header + 14 ) != 16 || reader->samplesPerFrame == 0 || reader->frameRate == 0 )
+			{
+				result = WAV_ERR_ILLEGAL_VALUE;
+				goto error;
+			}
+			haveFormat = 1;
+			chunkSize -= 16;
+		}
+		else if( chunkType == DATA_ID )
+		{
+			if( !haveFormat )
+			{
+				result = WAV_ERR_FILE_TYPE;
+				goto error;
+			}
+			/* Streaming writers leave the size at zero or at the maximum. */
+			if( chunkSize != 0 && chunkSize != 0xFFFFFFFFUL )
+			{
+				reader->dataSizeRemaining = (long) chunkSize;
+			}
+			return 0;
+		}
+
+		/* Chunks are padded to an even size. */
+		result = SkipBytes( reader->fid, chunkSize + (chunkSize & 1) );
+		if( result < 0 ) goto error;
+	}
+
+error:
+	fclose( reader->fid );
+	reader->fid = NULL;
+	return result;
+}
+
+/*********************************************************************************
+ * Read from the data chunk portion of a WAV file.
+ * Returns number of samples read, which is less than numSamples at the end of the data,
+ * or negative error code.
+ */
+long Audio_WAV_ReadShorts( WAV_Reader *reader,
+		short *samples,
+		int numSamples
+		)
+{
+	unsigned char buffer[WAV_IO_BUFFER_SIZE];
+	short *p = samples;
+	int numRead = 0;
+
+	while( numRead < numSamples )
+	{
+		size_t numBytes = (size_t) (numSamples - numRead) * sizeof(short);
+		size_t numGot;
+		size_t i;
+
+		if( numBytes > sizeof(buffer) ) numBytes = sizeof(buffer);
+		if( reader->dataSizeRemaining >= 0 && numBytes > (size_t) reader->dataSizeRemaining )
+		{
+			numBytes = (size_t) reader->dataSizeRemaining & ~(size_t)1;
+		}
+		if( numBytes == 0 ) break;
+
+		numGot = fread( buffer, 1, numBytes, reader->fid ) & ~(size_t)1;
+		for( i=0; i<numGot; i += 2 )
+		{
+			*p++ = (short) ReadShortLE( buffer + i );
+		}
+		numRead += (int) (numGot / sizeof(short));
+		if( reader->dataSizeRemaining >= 0 ) reader->dataSizeRemaining -= (long) numGot;
+		if( numGot < numBytes )
+		{
+			if( ferror( reader->fid ) ) return -1;
+			break;
+		}
+	}
+	return numRead;
+}
+
+/*********************************************************************************
+ * Close WAV file opened with Audio_WAV_OpenReader.
+ */
+long Audio_WAV_CloseReader( WAV_Reader *reader )
+{
+	int result = fclose( reader->fid );
+	reader->fid = NULL;
+	return result;
 }
 
 /*********************************************************************************
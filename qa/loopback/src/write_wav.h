@@ -38,7 +38,7 @@
 #define _WAV_WRITER_H
 
 /*
- * WAV file writer.
+ * WAV file writer and reader.
  *
  * Author: Phil Burk
  */
@@ -93,9 +93,41 @@ long Audio_WAV_WriteShorts( WAV_Writer *writer,
 /*********************************************************************************
  * Close WAV file.
  * Update chunk sizes so it can be read by audio applications.
+ * Returns the size of the data or negative error code, the file is closed either way.
  */
 long Audio_WAV_CloseWriter( WAV_Writer *writer );
 
+typedef struct WAV_Reader_s
+{
+    FILE *fid;
+    int   frameRate;
+    int   samplesPerFrame;
+    /* Bytes left in the data chunk, or -1 if unknown, as for files streamed through a pipe. */
+    long  dataSizeRemaining;
+} WAV_Reader;
+
+/*********************************************************************************
+ * Open named file and read the WAV header up to the start of the sample data.
+ * Only 16 bit PCM is supported. The file is read sequentially, so it may be a pipe.
+ * Returns zero or negative error code.
+ */
+long Audio_WAV_OpenReader( WAV_Reader *reader, const char *fileName );
+
+/*********************************************************************************
+ * Read from the data chunk portion of a WAV file.
+ * Returns number of samples read, which is less than numSamples at the end of the data,
+ * or negative error code.
+ */
+long Audio_WAV_ReadShorts( WAV_Reader *reader,
+		short *samples,
+		int numSamples
+		);
+
+/*********************************************************************************
+ * Close WAV file opened with Audio_WAV_OpenReader.
+ */
+long Audio_WAV_CloseReader( WAV_Reader *reader );
+
 #ifdef __cplusplus
 };
 #endif
@@ -44,200 +44,269 @@
 */
 
 
+#include <stddef.h> /* size_t */
+
 #include "pa_allocation.h"
 #include "pa_util.h"
 
 
 /*
-    Maintain 3 singly linked lists...
-    linkBlocks: the buffers used to allocate the links
-    spareLinks: links available for use in the allocations list
-    allocations: the buffers currently allocated using PaUtil_ContextAllocateMemory()
-
-    Link block size is doubled every time new links are allocated.
+    Blocks are allocated by bumping the top of the current chunk. Each block is
+    preceded by a header pointing to its chunk, and each chunk counts its
+    blocks, so that a chunk can be reused or released once all of its blocks
+    have been freed.
+
+    Shared chunk size is doubled every time a new chunk is allocated, up to
+    PA_MAX_CHUNK_SIZE_. Blocks larger than a quarter of the next chunk size,
+    and buffer memory blocks, are given a chunk of their own.
 */
 
 
-#define PA_INITIAL_LINK_COUNT_    16
+#define PA_INITIAL_CHUNK_SIZE_      (4096)
+#define PA_MAX_CHUNK_SIZE_          (64 * 1024)
+
+/* alignment of blocks, suitable for any type */
+#define PA_BLOCK_ALIGNMENT_         (16)
 
-struct PaUtilAllocationGroupLink
+struct PaUtilAllocationGroupChunk
 {
-    struct PaUtilAllocationGroupLink *next;
-    void *buffer;
+    struct PaUtilAllocationGroupChunk *next;
+    struct PaUtilAllocationGroupChunk *previous;
+    char *top;          /* first unallocated byte */
+    char *end;
+    long size;          /* bytes reserved, including this header */
+    long blockCount;    /* blocks currently allocated from the chunk */
+    void (*freeMemory)( void *chunk );
 };
 
-/*
-    Allocate a block of links. The first link will have it's buffer member
-    pointing to the block, and it's next member set to <nextBlock>. The remaining
-    links will have NULL buffer members, and each link will point to
-    the next link except the last, which will point to <nextSpare>
-*/
-static struct PaUtilAllocationGroupLink *AllocateLinks( long count,
-        struct PaUtilAllocationGroupLink *nextBlock,
-        struct PaUtilAllocationGroupLink *nextSpare )
+typedef struct PaUtilAllocationGroupBlock
 {
-    struct PaUtilAllocationGroupLink *result;
-    int i;
-    
-    result = (struct PaUtilAllocationGroupLink *)PaUtil_AllocateMemory(
-            sizeof(struct PaUtilAllocationGroupLink) * count );
+    struct PaUtilAllocationGroupChunk *chunk;
+    long size;
+}PaUtilAllocationGroupBlock;
+
+
+static struct PaUtilAllocationGroupChunk *AllocateChunk( PaUtilAllocationGroup* group,
+        long size, int isBufferMemory, PaUtilBufferMemoryFlags flags )
+{
+    struct PaUtilAllocationGroupChunk *result;
+
+    result = (struct PaUtilAllocationGroupChunk *)( isBufferMemory
+            ? PaUtil_AllocateBufferMemory( size, flags ) : PaUtil_AllocateMemory( size ) );
     if( result )
     {
-        /* the block link */
-        result[0].buffer = result;
-        result[0].next = nextBlock;
-
-        /* the spare links */
-        for( i=1; i<count; ++i )
-        {
-            result[i].buffer = 0;
-            result[i].next = &result[i+1];
-        }
-        result[count-1].next = nextSpare;
+        result->top = (char *)(result + 1);
+        result->end = (char *)result + size;
+        result->size = size;
+        result->blockCount = 0;
+        result->freeMemory = isBufferMemory ? PaUtil_FreeBufferMemory : PaUtil_FreeMemory;
+
+        result->previous = 0;
+        result->next = group->chunks;
+        if( group->chunks )
+            group->chunks->previous = result;
+        group->chunks = result;
+
+        group->statistics.chunkCount += 1;
+        group->statistics.chunkBytes += size;
+        if( group->statistics.chunkBytes > group->statistics.peakChunkBytes )
+            group->statistics.peakChunkBytes = group->statistics.chunkBytes;
     }
-    
+
     return result;
 }
 
 
-PaUtilAllocationGroup* PaUtil_CreateAllocationGroup( void )
+static void FreeChunk( PaUtilAllocationGroup* group, struct PaUtilAllocationGroupChunk *chunk )
 {
-    PaUtilAllocationGroup* result = 0;
-    struct PaUtilAllocationGroupLink *links;
+    if( chunk->previous )
+        chunk->previous->next = chunk->next;
+    else
+        group->chunks = chunk->next;
+    if( chunk->next )
+        chunk->next->previous = chunk->previous;
 
+    if( group->current == chunk )
+        group->current = 0;
 
-    links = AllocateLinks( PA_INITIAL_LINK_COUNT_, 0, 0 );
-    if( links != 0 )
-    {
-        result = (PaUtilAllocationGroup*)PaUtil_AllocateMemory( sizeof(PaUtilAllocationGroup) );
-        if( result )
-        {
-            result->linkCount = PA_INITIAL_LINK_COUNT_;
-            result->linkBlocks = &links[0];
-            result->spareLinks = &links[1];
-            result->allocations = 0;
-        }
-        else
-        {
-            PaUtil_FreeMemory( links );
-        }
-    }
+    group->statistics.chunkCount -= 1;
+    group->statistics.chunkBytes -= chunk->size;
+
+    chunk->freeMemory( chunk );
+}
+
+
+/*
+    Carve a block of size bytes out of chunk. Returns NULL if the block
+    doesn't fit.
+*/
+static void *AllocateBlock( PaUtilAllocationGroup* group,
+        struct PaUtilAllocationGroupChunk *chunk, long size, long alignment )
+{
+    char *result = chunk->top + sizeof(PaUtilAllocationGroupBlock);
+    PaUtilAllocationGroupBlock *block;
+
+    result += (alignment - (size_t)result % alignment) % alignment;
+    if( chunk->end - chunk->top < (result - chunk->top) + size )
+        return 0;
+
+    block = (PaUtilAllocationGroupBlock *)result - 1;
+    block->chunk = chunk;
+    block->size = size;
+
+    chunk->top = result + size;
+    chunk->blockCount += 1;
+
+    group->statistics.blockCount += 1;
+    group->statistics.blockBytes += size;
+    group->statistics.totalBlockCount += 1;
 
     return result;
 }
 
 
-void PaUtil_DestroyAllocationGroup( PaUtilAllocationGroup* group )
+PaUtilAllocationGroup* PaUtil_CreateAllocationGroup( void )
 {
-    struct PaUtilAllocationGroupLink *current = group->linkBlocks;
-    struct PaUtilAllocationGroupLink *next;
+    PaUtilAllocationGroup* result;
 
-    while( current )
+    result = (PaUtilAllocationGroup*)PaUtil_AllocateMemory( sizeof(PaUtilAllocationGroup) );
+    if( result )
     {
-        next = current->next;
-        PaUtil_FreeMemory( current->buffer );
-        current = next;
+        result->chunks = 0;
+        result->current = 0;
+        result->chunkSize = PA_INITIAL_CHUNK_SIZE_;
+        result->statistics.blockCount = 0;
+        result->statistics.blockBytes = 0;
+        result->statistics.chunkCount = 0;
+        result->statistics.chunkBytes = 0;
+        result->statistics.peakChunkBytes = 0;
+        result->statistics.totalBlockCount = 0;
     }
 
+    return result;
+}
+
+
+void PaUtil_DestroyAllocationGroup( PaUtilAllocationGroup* group )
+{
+    while( group->chunks )
+        FreeChunk( group, group->chunks );
+
     PaUtil_FreeMemory( group );
 }
 
 
 void* PaUtil_GroupAllocateMemory( PaUtilAllocationGroup* group, long size )
 {
-    struct PaUtilAllocationGroupLink *links, *link;
+    struct PaUtilAllocationGroupChunk *chunk;
     void *result = 0;
-    
-    /* allocate more links if necessary */
-    if( !group->spareLinks )
+
+    if( size > group->chunkSize / 4 )
     {
-        /* double the link count on each block allocation */
-        links = AllocateLinks( group->linkCount, group->linkBlocks, group->spareLinks );
-        if( links )
-        {
-            group->linkCount += group->linkCount;
-            group->linkBlocks = &links[0];
-            group->spareLinks = &links[1];
-        }
+        /* give large blocks a chunk of their own */
+        chunk = AllocateChunk( group, sizeof(struct PaUtilAllocationGroupChunk)
+                + sizeof(PaUtilAllocationGroupBlock) + PA_BLOCK_ALIGNMENT_ + size, 0, 0 );
+        if( chunk )
+            result = AllocateBlock( group, chunk, size, PA_BLOCK_ALIGNMENT_ );
+        return result;
     }
 
-    if( group->spareLinks )
+    if( group->current )
+        result = AllocateBlock( group, group->current, size, PA_BLOCK_ALIGNMENT_ );
+
+    if( !result )
     {
-        result = PaUtil_AllocateMemory( size );
-        if( result )
+        chunk = AllocateChunk( group, group->chunkSize, 0, 0 );
+        if( chunk )
         {
-            link = group->spareLinks;
-            group->spareLinks = link->next;
+            group->current = chunk;
+            if( group->chunkSize < PA_MAX_CHUNK_SIZE_ )
+                group->chunkSize += group->chunkSize;
 
-            link->buffer = result;
-            link->next = group->allocations;
-
-            group->allocations = link;
+            result = AllocateBlock( group, chunk, size, PA_BLOCK_ALIGNMENT_ );
         }
     }
 
-    return result;    
+    return result;
+}
+
+
+void* PaUtil_GroupAllocateBufferMemory( PaUtilAllocationGroup* group, long size,
+        PaUtilBufferMemoryFlags flags )
+{
+    /* buffer memory chunks are aligned, so the block starts at the first
+        aligned offset past the headers */
+    long offset = (sizeof(struct PaUtilAllocationGroupChunk) + sizeof(PaUtilAllocationGroupBlock)
+            + PA_BUFFER_MEMORY_ALIGNMENT - 1) / PA_BUFFER_MEMORY_ALIGNMENT * PA_BUFFER_MEMORY_ALIGNMENT;
+    struct PaUtilAllocationGroupChunk *chunk;
+    void *result = 0;
+
+    chunk = AllocateChunk( group, offset + size, 1, flags );
+    if( chunk )
+        result = AllocateBlock( group, chunk, size, PA_BUFFER_MEMORY_ALIGNMENT );
+
+    return result;
 }
 
 
 void PaUtil_GroupFreeMemory( PaUtilAllocationGroup* group, void *buffer )
 {
-    struct PaUtilAllocationGroupLink *current = group->allocations;
-    struct PaUtilAllocationGroupLink *previous = 0;
+    PaUtilAllocationGroupBlock *block;
+    struct PaUtilAllocationGroupChunk *chunk;
 
     if( buffer == 0 )
         return;
 
-    /* find the right link and remove it */
-    while( current )
+    block = (PaUtilAllocationGroupBlock *)buffer - 1;
+    chunk = block->chunk;
+
+    group->statistics.blockCount -= 1;
+    group->statistics.blockBytes -= block->size;
+
+    chunk->blockCount -= 1;
+    if( chunk->blockCount == 0 )
     {
-        if( current->buffer == buffer )
-        {
-            if( previous )
-            {
-                previous->next = current->next;
-            }
-            else
-            {
-                group->allocations = current->next;
-            }
-
-            current->buffer = 0;
-            current->next = group->spareLinks;
-            group->spareLinks = current;
-
-            break;
-        }
-        
-        previous = current;
-        current = current->next;
+        if( chunk == group->current )
+            chunk->top = (char *)(chunk + 1);
+        else
+            FreeChunk( group, chunk );
+    }
+    else if( (char *)buffer + block->size == chunk->top )
+    {
+        /* the most recent allocation in the chunk, reuse its memory */
+        chunk->top = (char *)block;
     }
-
-    PaUtil_FreeMemory( buffer ); /* free the memory whether we found it in the list or not */
 }
 
 
 void PaUtil_FreeAllAllocations( PaUtilAllocationGroup* group )
 {
-    struct PaUtilAllocationGroupLink *current = group->allocations;
-    struct PaUtilAllocationGroupLink *previous = 0;
+    struct PaUtilAllocationGroupChunk *current = group->chunks;
+    struct PaUtilAllocationGroupChunk *next;
 
-    /* free all buffers in the allocations list */
+    /* release all chunks except the current one, which is emptied */
     while( current )
     {
-        PaUtil_FreeMemory( current->buffer );
-        current->buffer = 0;
-
-        previous = current;
-        current = current->next;
+        next = current->next;
+        if( current == group->current )
+        {
+            current->top = (char *)(current + 1);
+            current->blockCount = 0;
+        }
+        else
+        {
+            FreeChunk( group, current );
+        }
+        current = next;
     }
 
-    /* link the former allocations list onto the front of the spareLinks list */
-    if( previous )
-    {
-        previous->next = group->spareLinks;
-        group->spareLinks = group->allocations;
-        group->allocations = 0;
-    }
+    group->statistics.blockCount = 0;
+    group->statistics.blockBytes = 0;
 }
 
+
+void PaUtil_GetAllocationGroupStatistics( PaUtilAllocationGroup* group,
+        PaUtilAllocationGroupStatistics *statistics )
+{
+    *statistics = group->statistics;
+}
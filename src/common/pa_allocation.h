@@ -51,23 +51,43 @@
  a list of allocated blocks, and can free all allocations at once. This
  can be usefull for cleaning up after a partially initialized object fails.
 
+ Small blocks are carved out of larger chunks, so allocating them is cheap
+ and doesn't fragment the heap, and freeing all allocations releases a few
+ chunks rather than every block. Large blocks, and blocks allocated with
+ PaUtil_GroupAllocateBufferMemory, are given a chunk of their own.
+
  The allocation group implementation is built on top of the lower
  level allocation functions defined in pa_util.h
 */
 
 
+#include "pa_util.h"
+
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif /* __cplusplus */
 
 
+/** Allocation statistics, as returned by PaUtil_GetAllocationGroupStatistics. */
+typedef struct PaUtilAllocationGroupStatistics
+{
+    unsigned long blockCount;           /**< blocks currently allocated */
+    unsigned long blockBytes;           /**< bytes requested for the blocks currently allocated */
+    unsigned long chunkCount;           /**< chunks currently reserved from the system */
+    unsigned long chunkBytes;           /**< bytes currently reserved from the system */
+    unsigned long peakChunkBytes;       /**< maximum of chunkBytes since the group was created */
+    unsigned long totalBlockCount;      /**< blocks allocated since the group was created */
+}PaUtilAllocationGroupStatistics;
+
+
 typedef struct
 {
-    long linkCount;
-    struct PaUtilAllocationGroupLink *linkBlocks;
-    struct PaUtilAllocationGroupLink *spareLinks;
-    struct PaUtilAllocationGroupLink *allocations;
+    struct PaUtilAllocationGroupChunk *chunks;  /* all chunks, in a doubly linked list */
+    struct PaUtilAllocationGroupChunk *current; /* the chunk small blocks are allocated from, may be NULL */
+    long chunkSize;                             /* size of the next shared chunk */
+    PaUtilAllocationGroupStatistics statistics;
 }PaUtilAllocationGroup;
 
 
@@ -76,7 +96,8 @@ typedef struct
 */
 PaUtilAllocationGroup* PaUtil_CreateAllocationGroup( void );
 
-/** Destroy an allocation group, but not the memory allocated through the group.
+/** Destroy an allocation group. Any memory still allocated through the group
+ is released too, although clients should call PaUtil_FreeAllAllocations first.
 */
 void PaUtil_DestroyAllocationGroup( PaUtilAllocationGroup* group );
 
@@ -84,19 +105,35 @@ void PaUtil_DestroyAllocationGroup( PaUtilAllocationGroup* group );
 */
 void* PaUtil_GroupAllocateMemory( PaUtilAllocationGroup* group, long size );
 
+/** Allocate a block of sample data memory though an allocation group. The
+ block is aligned and backed as described for PaUtil_AllocateBufferMemory,
+ and is released along with the group's other blocks.
+ @see PaUtil_AllocateBufferMemory
+*/
+void* PaUtil_GroupAllocateBufferMemory( PaUtilAllocationGroup* group, long size,
+        PaUtilBufferMemoryFlags flags );
+
 /** Free a block of memory that was previously allocated though an allocation
- group. Calling this function is a relatively time consuming operation.
- Under normal circumstances clients should call PaUtil_FreeAllAllocations to
- free all allocated blocks simultaneously.
+ group. Memory of a small block is only reused once the block was the most
+ recent allocation in its chunk, or once every block in its chunk has been
+ freed. Under normal circumstances clients should call
+ PaUtil_FreeAllAllocations to free all allocated blocks simultaneously.
  @see PaUtil_FreeAllAllocations
 */
 void PaUtil_GroupFreeMemory( PaUtilAllocationGroup* group, void *buffer );
 
 /** Free all blocks of memory which have been allocated through the allocation
- group. This function doesn't destroy the group itself.
+ group. This function doesn't destroy the group itself, and keeps one chunk
+ for subsequent allocations.
 */
 void PaUtil_FreeAllAllocations( PaUtilAllocationGroup* group );
 
+/** Retrieve allocation statistics for a group, e.g. to size chunks or to
+ detect leaks.
+*/
+void PaUtil_GetAllocationGroupStatistics( PaUtilAllocationGroup* group,
+        PaUtilAllocationGroupStatistics *statistics );
+
 
 #ifdef __cplusplus
 }
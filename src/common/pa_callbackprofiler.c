@@ -0,0 +1,184 @@
+/*
+ * $Id$
+ * Portable Audio I/O Library stream callback profiling
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Phil Burk, Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Profiler timing the calls of a stream callback against their
+ real-time budget.
+
+ The callback thread updates the profile under a PaUtilSequenceLock, so
+ that taking it never delays the callback.
+*/
+
+
+#include "pa_callbackprofiler.h"
+
+#include <string.h>
+
+#include "pa_util.h"
+
+
+/* Interval between the checks of the report thread, in seconds */
+#define PA_CALLBACK_PROFILE_REPORT_INTERVAL_    (1.0)
+
+
+void PaUtil_InitializeCallbackProfiler( PaUtilCallbackProfiler* profiler )
+{
+    memset( profiler, 0, sizeof(PaUtilCallbackProfiler) );
+    PaUtil_InitializeSequenceLock( &profiler->lock );
+}
+
+
+void PaUtil_TerminateCallbackProfiler( PaUtilCallbackProfiler* profiler )
+{
+    PaUtil_SetCallbackProfileReport( profiler, NULL, NULL, NULL );
+}
+
+
+static double Load( const PaCallbackTiming *timing )
+{
+    return timing->budget > 0. ? timing->duration / timing->budget : 0.;
+}
+
+
+void PaUtil_ProfileCallback( PaUtilCallbackProfiler* profiler, PaTime time,
+        PaTime duration, unsigned long frameCount, PaTime budget )
+{
+    PaCallbackTiming timing;
+    double load;
+    int i;
+
+    timing.time = time;
+    timing.duration = duration;
+    timing.budget = budget;
+    timing.frameCount = frameCount;
+    load = Load( &timing );
+
+    PaUtil_BeginSequenceLockUpdate( &profiler->lock );
+
+    ++profiler->callbackCount;
+    if( duration > budget )
+        ++profiler->deadlineMissCount;
+    profiler->totalDuration += duration;
+    profiler->totalBudget += budget;
+
+    /* insert into the worst calls, dropping the least bad one when full */
+    if( profiler->worstCount < paCallbackProfileWorstCount
+            || load > Load( &profiler->worst[ paCallbackProfileWorstCount - 1 ] ) )
+    {
+        i = profiler->worstCount < paCallbackProfileWorstCount ? profiler->worstCount++
+                                                             : paCallbackProfileWorstCount - 1;
+        for( ; i > 0 && load > Load( &profiler->worst[i - 1] ); --i )
+            profiler->worst[i] = profiler->worst[i - 1];
+        profiler->worst[i] = timing;
+    }
+
+    PaUtil_EndSequenceLockUpdate( &profiler->lock );
+}
+
+
+void PaUtil_GetCallbackProfile( PaUtilCallbackProfiler* profiler, PaStreamCallbackProfile* profile )
+{
+    unsigned int sequence;
+
+    do
+    {
+        sequence = PaUtil_BeginSequenceLockRead( &profiler->lock );
+
+        profile->callbackCount = profiler->callbackCount;
+        profile->deadlineMissCount = profiler->deadlineMissCount;
+        profile->totalDuration = profiler->totalDuration;
+        profile->totalBudget = profiler->totalBudget;
+        profile->worstCount = profiler->worstCount;
+        memcpy( profile->worst, profiler->worst, sizeof(profile->worst) );
+    }
+    while( PaUtil_RetrySequenceLockRead( &profiler->lock, sequence ) );
+}
+
+
+static void ReportDeadlineMisses( void *userData )
+{
+    PaUtilCallbackProfiler *profiler = (PaUtilCallbackProfiler*)userData;
+    PaStreamCallbackProfile profile;
+
+    profile.structVersion = 1;
+    PaUtil_GetCallbackProfile( profiler, &profile );
+
+    if( profile.deadlineMissCount != profiler->reportedMissCount )
+    {
+        profiler->reportedMissCount = profile.deadlineMissCount;
+        /* last, as the report may stop reporting or register another report */
+        profiler->report( profiler->stream, &profile, profiler->reportUserData );
+    }
+}
+
+
+PaError PaUtil_SetCallbackProfileReport( PaUtilCallbackProfiler* profiler, PaStream *stream,
+        PaStreamCallbackProfileReport *report, void *userData )
+{
+    PaStreamCallbackProfile profile;
+    PaError result = paNoError;
+
+    if( profiler->reportThread )
+    {
+        PaUtil_StopPeriodicThread( profiler->reportThread );
+        profiler->reportThread = NULL;
+    }
+
+    profiler->stream = stream;
+    profiler->report = report;
+    profiler->reportUserData = userData;
+
+    if( report )
+    {
+        /* report the misses from now on */
+        PaUtil_GetCallbackProfile( profiler, &profile );
+        profiler->reportedMissCount = profile.deadlineMissCount;
+
+        result = PaUtil_StartPeriodicThread( &profiler->reportThread, ReportDeadlineMisses, profiler,
+                PA_CALLBACK_PROFILE_REPORT_INTERVAL_ );
+        if( result != paNoError )
+        {
+            profiler->reportThread = NULL;
+            profiler->report = NULL;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,128 @@
+#ifndef PA_CALLBACKPROFILER_H
+#define PA_CALLBACKPROFILER_H
+/*
+ * $Id$
+ * Portable Audio I/O Library stream callback profiling
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Phil Burk, Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+
+/** @file
+ @ingroup common_src
+
+ @brief Profiler timing the calls of a stream callback against their
+ real-time budget. Used to implement the paProfileCallback stream flag and
+ the Pa_GetStreamCallbackProfile() function.
+
+ The buffer processor feeds the profiler with the duration of each call of
+ the stream callback, and the number of frames it processed. A call which
+ takes longer than the duration of its frames misses its deadline, whatever
+ the system does. The profiler counts the calls, the deadline misses, and
+ keeps the calls which used the largest share of their budget.
+
+ The profile may be read from any thread while the callback thread updates
+ it. Reports are delivered by a thread of normal priority.
+*/
+
+
+#include "portaudio.h"
+#include "pa_sequencelock.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+typedef struct PaUtilCallbackProfiler {
+    PaUtilSequenceLock lock;    /**< guards the profile against the callback thread */
+
+    unsigned long callbackCount;
+    unsigned long deadlineMissCount;
+    PaTime totalDuration;
+    PaTime totalBudget;
+    int worstCount;
+    PaCallbackTiming worst[paCallbackProfileWorstCount]; /**< by decreasing share of the budget */
+
+    /* reporting, not accessed by the callback thread */
+    PaStream *stream;
+    PaStreamCallbackProfileReport *report;
+    void *reportUserData;
+    unsigned long reportedMissCount;
+    struct PaUtilPeriodicThread *reportThread;
+} PaUtilCallbackProfiler;
+
+
+/** Initialize the profiler with an empty profile.
+*/
+void PaUtil_InitializeCallbackProfiler( PaUtilCallbackProfiler* profiler );
+
+/** Stop reporting. Call this before the profiler's memory is released.
+*/
+void PaUtil_TerminateCallbackProfiler( PaUtilCallbackProfiler* profiler );
+
+/** Record a call of the stream callback. Only called by the callback thread.
+
+ @param time The system time at which the callback was called.
+
+ @param duration The time the callback took to return.
+
+ @param frameCount The number of frames the callback processed.
+
+ @param budget The duration of frameCount frames.
+*/
+void PaUtil_ProfileCallback( PaUtilCallbackProfiler* profiler, PaTime time,
+        PaTime duration, unsigned long frameCount, PaTime budget );
+
+/** Read the current profile into a PaStreamCallbackProfile structure. May be
+ called from any thread.
+*/
+void PaUtil_GetCallbackProfile( PaUtilCallbackProfiler* profiler, PaStreamCallbackProfile* profile );
+
+/** Start calling report from a thread of normal priority, when deadlines were
+ missed since the previous call, replacing the current report function. NULL
+ stops reporting. Must not be called concurrently for the same profiler.
+
+ @return paNoError, or an error if the report thread couldn't be started.
+*/
+PaError PaUtil_SetCallbackProfileReport( PaUtilCallbackProfiler* profiler, PaStream *stream,
+        PaStreamCallbackProfileReport *report, void *userData );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_CALLBACKPROFILER_H */
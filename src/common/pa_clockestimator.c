@@ -0,0 +1,182 @@
+/*
+ * $Id$
+ * Portable Audio I/O Library device clock estimation
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Phil Burk, Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Delay-locked loop estimating a device's sample clock against the
+ system clock.
+
+ The loop is the second order DLL described by Fons Adriaensen in "Using a
+ DLL to filter time", generalized to host buffers of varying size: the loop
+ gain is scaled by the duration of each step. The bandwidth starts wide so
+ that the loop locks quickly, and narrows down to PA_CLOCK_BANDWIDTH_ as the
+ estimator observes the device for longer.
+
+ The estimate is updated under a PaUtilSequenceLock, and may be read from
+ any thread.
+*/
+
+
+#include "pa_clockestimator.h"
+
+#include <assert.h>
+#include <math.h>
+
+
+/* Final bandwidth of the loop, in Hz */
+#define PA_CLOCK_BANDWIDTH_     (0.1)
+/* Upper bound of the normalized loop bandwidth, for stability with large host buffers */
+#define PA_CLOCK_MAX_OMEGA_     (0.5)
+/* Time the loop must have run before its estimate is considered locked, in seconds */
+#define PA_CLOCK_LOCK_TIME_     (1.0)
+/* Larger errors, in seconds, are taken to be discontinuities (e.g. undetected xruns) and restart tracking */
+#define PA_CLOCK_MAX_ERROR_     (0.05)
+/* Maximum deviation of the estimated rate from the nominal rate */
+#define PA_CLOCK_MAX_DEVIATION_ (0.01)
+
+
+void PaUtil_InitializeClockEstimator( PaUtilClockEstimator* estimator, double sampleRate )
+{
+    assert( sampleRate > 0 );
+
+    estimator->nominalSampleRate = sampleRate;
+    PaUtil_InitializeSequenceLock( &estimator->lock );
+    estimator->hasPosition = 0;
+    estimator->isLocked = 0;
+    estimator->startTime = 0.;
+    estimator->position = 0.;
+    estimator->time = 0.;
+    estimator->secondsPerFrame = 1. / sampleRate;
+}
+
+
+void PaUtil_ResetClockEstimator( PaUtilClockEstimator* estimator )
+{
+    PaUtil_BeginSequenceLockUpdate( &estimator->lock );
+    estimator->hasPosition = 0;
+    estimator->isLocked = 0;
+    PaUtil_EndSequenceLockUpdate( &estimator->lock );
+}
+
+
+void PaUtil_UpdateClockEstimator( PaUtilClockEstimator* estimator, double position, PaTime time )
+{
+    double frames, nominalSecondsPerFrame, bandwidth, omega;
+    PaTime predictedTime, error, elapsed;
+
+    if( estimator->hasPosition )
+    {
+        frames = position - estimator->position;
+        if( frames <= 0. )
+            return;
+
+        predictedTime = estimator->time + frames * estimator->secondsPerFrame;
+        error = time - predictedTime;
+        elapsed = time - estimator->startTime;
+
+        PaUtil_BeginSequenceLockUpdate( &estimator->lock );
+
+        if( fabs( error ) > PA_CLOCK_MAX_ERROR_ )
+        {
+            /* track from here, keeping the rate */
+            estimator->startTime = time;
+            estimator->time = time;
+            estimator->isLocked = 0;
+        }
+        else
+        {
+            bandwidth = PA_CLOCK_BANDWIDTH_;
+            if( elapsed > 0. && 1. / elapsed > bandwidth )
+                bandwidth = 1. / elapsed;
+
+            omega = 2. * 3.14159265358979 * bandwidth * frames * estimator->secondsPerFrame;
+            if( omega > PA_CLOCK_MAX_OMEGA_ )
+                omega = PA_CLOCK_MAX_OMEGA_;
+
+            estimator->time = predictedTime + 1.41421356237310 * omega * error;
+            estimator->secondsPerFrame += omega * omega * error / frames;
+
+            nominalSecondsPerFrame = 1. / estimator->nominalSampleRate;
+            if( estimator->secondsPerFrame > nominalSecondsPerFrame * (1. + PA_CLOCK_MAX_DEVIATION_) )
+                estimator->secondsPerFrame = nominalSecondsPerFrame * (1. + PA_CLOCK_MAX_DEVIATION_);
+            else if( estimator->secondsPerFrame < nominalSecondsPerFrame * (1. - PA_CLOCK_MAX_DEVIATION_) )
+                estimator->secondsPerFrame = nominalSecondsPerFrame * (1. - PA_CLOCK_MAX_DEVIATION_);
+
+            if( elapsed >= PA_CLOCK_LOCK_TIME_ )
+                estimator->isLocked = 1;
+        }
+
+        estimator->position = position;
+        PaUtil_EndSequenceLockUpdate( &estimator->lock );
+    }
+    else
+    {
+        PaUtil_BeginSequenceLockUpdate( &estimator->lock );
+        estimator->startTime = time;
+        estimator->position = position;
+        estimator->time = time;
+        estimator->hasPosition = 1;
+        PaUtil_EndSequenceLockUpdate( &estimator->lock );
+    }
+}
+
+
+void PaUtil_GetClockEstimate( PaUtilClockEstimator* estimator, PaStreamClockInfo* info )
+{
+    unsigned int sequence;
+    int hasPosition;
+
+    do
+    {
+        sequence = PaUtil_BeginSequenceLockRead( &estimator->lock );
+
+        hasPosition = estimator->hasPosition;
+        info->isLocked = estimator->isLocked;
+        info->framePosition = estimator->position;
+        info->time = estimator->time;
+        info->rateRatio = 1. / ( estimator->secondsPerFrame * estimator->nominalSampleRate );
+    }
+    while( PaUtil_RetrySequenceLockRead( &estimator->lock, sequence ) );
+
+    if( !hasPosition )
+    {
+        info->framePosition = 0.;
+        info->time = 0.;
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef PA_CLOCKESTIMATOR_H
+#define PA_CLOCKESTIMATOR_H
+/*
+ * $Id$
+ * Portable Audio I/O Library device clock estimation
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Phil Burk, Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Delay-locked loop estimating a device's sample clock against the
+ system clock. Used to implement the Pa_GetStreamClockInfo() function.
+
+ The host API feeds the estimator once per host buffer with a frame position
+ of the device and the system time at which the device was at that position.
+ The loop filters the jitter out of the times, yielding a smoothed mapping
+ from frame positions to times, and the rate at which the device actually
+ runs.
+
+ The estimate may be read from any thread while the host API's callback
+ thread updates it.
+*/
+
+
+#include "portaudio.h"
+#include "pa_sequencelock.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+typedef struct PaUtilClockEstimator {
+    double nominalSampleRate;
+    PaUtilSequenceLock lock;    /**< guards the members below against the callback thread */
+
+    int hasPosition;
+    int isLocked;
+    PaTime startTime;           /**< time of the first update since the last reset */
+    double position;            /**< frame position of the last update */
+    PaTime time;                /**< filtered time of position */
+    double secondsPerFrame;     /**< filtered duration of a frame */
+} PaUtilClockEstimator;
+
+
+/** Initialize the estimator for a device running at a nominal sample rate.
+*/
+void PaUtil_InitializeClockEstimator( PaUtilClockEstimator* estimator, double sampleRate );
+
+/** Start tracking over, e.g. after the stream was restarted or an xrun broke
+ the relationship between frame positions and times. The rate estimate is
+ kept, and refined from there.
+*/
+void PaUtil_ResetClockEstimator( PaUtilClockEstimator* estimator );
+
+/** Feed the estimator with a measurement.
+
+ @param position The device's frame position, counted by the host API from
+ any fixed origin. Positions must increase between resets.
+
+ @param time The system time at which the device was at position, as
+ returned by PaUtil_GetTime() or on the same clock.
+*/
+void PaUtil_UpdateClockEstimator( PaUtilClockEstimator* estimator, double position, PaTime time );
+
+/** Read the current estimate into a PaStreamClockInfo structure. May be
+ called from any thread.
+*/
+void PaUtil_GetClockEstimate( PaUtilClockEstimator* estimator, PaStreamClockInfo* info );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_CLOCKESTIMATOR_H */
@@ -53,7 +53,16 @@
  implementations via initializer functions stored in the paHostApiInitializers
  global array (usually defined in an os-specific pa_[os]_hostapis.c file).
 
- This file maintains a list of all open streams and closes them at Pa_Terminate().
+ This file maintains a table of all open streams and closes them at Pa_Terminate().
+
+ Locking (see the thread safety notes of Pa_Initialize() in portaudio.h):
+ Pa_Initialize() and Pa_Terminate() hold the process wide initialization
+ lock. The host API and device tables are immutable while PortAudio is
+ initialized, so they are read without locking. The open stream table is
+ updated under its own lock and read without locking, and each host API has
+ a lock which serializes its
+ OpenStream(), IsFormatSupported() and stream Close() functions. The last
+ host error is kept per thread.
 
  Some utility functions declared in pa_util.h are implemented in this file.
 
@@ -74,6 +83,10 @@
 #include "pa_types.h"
 #include "pa_hostapi.h"
 #include "pa_stream.h"
+#include "pa_sequencelock.h"
+#include "pa_memorybarrier.h"
+#include "pa_clockestimator.h"
+#include "pa_callbackprofiler.h"
 #include "pa_trace.h" /* still usefull?*/
 #include "pa_debugprint.h"
 
@@ -137,9 +150,18 @@ const PaVersionInfo* Pa_GetVersionInfo()
 
 #define PA_LAST_HOST_ERROR_TEXT_LENGTH_  1024
 
-static char lastHostErrorText_[ PA_LAST_HOST_ERROR_TEXT_LENGTH_ + 1 ] = {0};
+#if defined(_MSC_VER)
+#define PA_THREAD_LOCAL_ __declspec(thread)
+#elif defined(__GNUC__)
+#define PA_THREAD_LOCAL_ __thread
+#else
+#define PA_THREAD_LOCAL_ /* the last host error is shared by all threads */
+#endif
+
+static PA_THREAD_LOCAL_ char lastHostErrorText_[ PA_LAST_HOST_ERROR_TEXT_LENGTH_ + 1 ] = {0};
 
-static PaHostErrorInfo lastHostErrorInfo_ = { (PaHostApiTypeId)-1, 0, lastHostErrorText_ };
+/* errorText is set on use, the address of a thread local variable isn't a constant */
+static PA_THREAD_LOCAL_ PaHostErrorInfo lastHostErrorInfo_ = { (PaHostApiTypeId)-1, 0, 0 };
 
 
 void PaUtil_SetLastHostErrorInfo( PaHostApiTypeId hostApiType, long errorCode,
@@ -156,13 +178,41 @@ void PaUtil_SetLastHostErrorInfo( PaHostApiTypeId hostApiType, long errorCode,
 static PaUtilHostApiRepresentation **hostApis_ = 0;
 static int hostApisCount_ = 0;
 static int defaultHostApiIndex_ = 0;
-static int initializationCount_ = 0;
+static int initializationCount_ = 0; /* protected by the initialization lock */
+static int isInitialized_ = 0; /* only changed by the first Pa_Initialize() and the last Pa_Terminate() */
 static int deviceCount_ = 0;
 
-PaUtilStreamRepresentation *firstOpenStream_ = NULL;
+/*
+    Open streams are kept in a hash table keyed by the stream pointer, using
+    open addressing with linear probing. Adding, removing and looking up a
+    stream take constant time, and PaUtil_ValidateStreamPointer() rejects
+    pointers to closed streams without dereferencing them. Only the address
+    is compared, so a pointer to a closed stream is taken for a new stream
+    which was allocated at the same address.
+
+    Updates are serialized by openStreamsLock_, so that streams can be opened
+    and closed concurrently by several threads. Lookups don't take the lock,
+    so that the functions which may be called from the stream callback never
+    wait for another thread: they read the table under a sequence lock, and
+    retry when it was updated meanwhile. When the table grows, the previous
+    one is kept until Pa_Terminate(), because lookups may still be reading it.
+*/
+#define PA_MIN_OPEN_STREAMS_CAPACITY_ (16)
+
+typedef struct PaUtilOpenStreamTable
+{
+    unsigned long capacity; /* a power of 2 */
+    PaUtilStreamRepresentation * volatile *streams;
+    struct PaUtilOpenStreamTable *previous; /* the table this one replaced */
+} PaUtilOpenStreamTable;
+
+static PaUtilLock *openStreamsLock_ = NULL;
+static PaUtilSequenceLock openStreamsSequenceLock_;
+static PaUtilOpenStreamTable * volatile openStreams_ = NULL;
+static unsigned long openStreamCount_ = 0; /* protected by openStreamsLock_ */
 
 
-#define PA_IS_INITIALISED_ (initializationCount_ != 0)
+#define PA_IS_INITIALISED_ (isInitialized_ != 0)
 
 
 static int CountHostApiInitializers( void )
@@ -183,6 +233,7 @@ static void TerminateHostApis( void )
     while( hostApisCount_ > 0 )
     {
         --hostApisCount_;
+        PaUtil_DestroyLock( hostApis_[hostApisCount_]->privatePaFrontInfo.lock );
         hostApis_[hostApisCount_]->Terminate( hostApis_[hostApisCount_] );
     }
     hostApisCount_ = 0;
@@ -247,6 +298,13 @@ static PaError InitializeHostApis( void )
 
             hostApi->privatePaFrontInfo.baseDeviceIndex = baseDeviceIndex;
 
+            result = PaUtil_CreateLock( &hostApi->privatePaFrontInfo.lock );
+            if( result != paNoError )
+            {
+                hostApi->Terminate( hostApi );
+                goto error;
+            }
+
             if( hostApi->info.defaultInputDevice != paNoDevice )
                 hostApi->info.defaultInputDevice += baseDeviceIndex;
 
@@ -307,48 +365,235 @@ static int FindHostApi( PaDeviceIndex device, int *hostSpecificDeviceIndex )
 }
 
 
-static void AddOpenStream( PaStream* stream )
+/* the home slot of stream in table */
+static unsigned long OpenStreamHomeSlot( const PaUtilOpenStreamTable *table, PaStream* stream )
+{
+    size_t key = (size_t)stream >> 4; /* the low bits of heap blocks are zero */
+
+    key ^= (key >> 7) ^ (key >> 15);
+    return (unsigned long)key & (table->capacity - 1);
+}
+
+
+/* the slot of stream in table, or the empty slot where it belongs. the probe
+    sequence is bounded, because lookups may race with updates */
+static unsigned long FindOpenStreamSlot( const PaUtilOpenStreamTable *table, PaStream* stream )
 {
-    ((PaUtilStreamRepresentation*)stream)->nextOpenStream = firstOpenStream_;
-    firstOpenStream_ = (PaUtilStreamRepresentation*)stream;
+    unsigned long slot = OpenStreamHomeSlot( table, stream );
+    unsigned long i;
+
+    for( i=1; i < table->capacity; ++i )
+    {
+        if( table->streams[slot] == NULL || (PaStream*)table->streams[slot] == stream )
+            break;
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+    return slot;
 }
 
 
-static void RemoveOpenStream( PaStream* stream )
+static PaError ResizeOpenStreams( unsigned long capacity )
 {
-    PaUtilStreamRepresentation *previous = NULL;
-    PaUtilStreamRepresentation *current = firstOpenStream_;
+    PaUtilOpenStreamTable *previous = openStreams_;
+    PaUtilOpenStreamTable *table;
+    PaUtilStreamRepresentation *stream;
+    unsigned long i;
+
+    table = (PaUtilOpenStreamTable*)PaUtil_AllocateMemory(
+            sizeof(PaUtilOpenStreamTable) + sizeof(PaUtilStreamRepresentation*) * capacity );
+    if( !table )
+        return paInsufficientMemory;
 
-    while( current != NULL )
+    table->capacity = capacity;
+    table->streams = (PaUtilStreamRepresentation * volatile *)(table + 1);
+    table->previous = previous;
+    for( i=0; i < capacity; ++i )
+        table->streams[i] = NULL;
+
+    if( previous != NULL )
     {
-        if( ((PaStream*)current) == stream )
+        for( i=0; i < previous->capacity; ++i )
         {
-            if( previous == NULL )
-            {
-                firstOpenStream_ = current->nextOpenStream;
-            }
-            else
-            {
-                previous->nextOpenStream = current->nextOpenStream;
-            }
-            return;
+            stream = previous->streams[i];
+            if( stream != NULL )
+                table->streams[ FindOpenStreamSlot( table, stream ) ] = stream;
         }
-        else
+    }
+
+    /* both tables hold the same streams, so lookups are right whichever
+        they read. the new one must be complete before it is published */
+    PaUtil_WriteMemoryBarrier();
+    openStreams_ = table;
+
+    return paNoError;
+}
+
+
+static PaError AddOpenStream( PaStream* stream )
+{
+    PaError result = paNoError;
+    PaUtilOpenStreamTable *table;
+
+    PaUtil_AcquireLock( openStreamsLock_ );
+
+    /* keep the table at most half full, so that probe sequences stay short */
+    table = openStreams_;
+    if( table == NULL || (openStreamCount_ + 1) * 2 > table->capacity )
+    {
+        result = ResizeOpenStreams( (table != NULL)
+                ? table->capacity * 2 : PA_MIN_OPEN_STREAMS_CAPACITY_ );
+    }
+
+    if( result == paNoError )
+    {
+        table = openStreams_;
+
+        PaUtil_BeginSequenceLockUpdate( &openStreamsSequenceLock_ );
+        table->streams[ FindOpenStreamSlot( table, stream ) ] = (PaUtilStreamRepresentation*)stream;
+        PaUtil_EndSequenceLockUpdate( &openStreamsSequenceLock_ );
+
+        ++openStreamCount_;
+    }
+
+    PaUtil_ReleaseLock( openStreamsLock_ );
+
+    return result;
+}
+
+
+/* returns 1 if stream was open, 0 otherwise */
+static int RemoveOpenStream( PaStream* stream )
+{
+    PaUtilOpenStreamTable *table;
+    unsigned long mask, hole, slot;
+    int result = 0;
+
+    PaUtil_AcquireLock( openStreamsLock_ );
+
+    if( openStreamCount_ > 0 )
+    {
+        table = openStreams_;
+        mask = table->capacity - 1;
+        hole = FindOpenStreamSlot( table, stream );
+        if( table->streams[hole] != NULL )
         {
-            previous = current;
-            current = current->nextOpenStream;
+            PaUtil_BeginSequenceLockUpdate( &openStreamsSequenceLock_ );
+
+            table->streams[hole] = NULL;
+            --openStreamCount_;
+            result = 1;
+
+            /* move the following streams of the probe sequence back, so that
+                lookups don't stop at the hole. a stream is moved unless its
+                home slot lies between the hole and its slot. */
+            for( slot = (hole + 1) & mask; table->streams[slot] != NULL; slot = (slot + 1) & mask )
+            {
+                unsigned long home = OpenStreamHomeSlot( table, table->streams[slot] );
+
+                if( ((slot - home) & mask) >= ((slot - hole) & mask) )
+                {
+                    table->streams[hole] = table->streams[slot];
+                    table->streams[slot] = NULL;
+                    hole = slot;
+                }
+            }
+
+            PaUtil_EndSequenceLockUpdate( &openStreamsSequenceLock_ );
         }
     }
+
+    PaUtil_ReleaseLock( openStreamsLock_ );
+
+    return result;
+}
+
+
+/* doesn't take openStreamsLock_, so that it may be called from the stream
+    callback */
+static int IsOpenStream( PaStream* stream )
+{
+    PaUtilOpenStreamTable *table;
+    unsigned int sequence;
+    int result;
+
+    do
+    {
+        sequence = PaUtil_BeginSequenceLockRead( &openStreamsSequenceLock_ );
+
+        table = openStreams_;
+        result = table != NULL
+                && (PaStream*)table->streams[ FindOpenStreamSlot( table, stream ) ] == stream;
+    }
+    while( PaUtil_RetrySequenceLockRead( &openStreamsSequenceLock_, sequence ) );
+
+    return result;
+}
+
+
+static PaError CloseStream( PaStream* stream )
+{
+    PaUtilStreamInterface *interface = PA_STREAM_INTERFACE(stream);
+    PaError result;
+
+    /* stop reporting before the profiler goes away, the report may call the front end */
+    if( PA_STREAM_REP( stream )->callbackProfiler )
+        PaUtil_SetCallbackProfileReport( PA_STREAM_REP( stream )->callbackProfiler, NULL, NULL, NULL );
+
+    /* abort the stream if it isn't stopped */
+    result = interface->IsStopped( stream );
+    if( result == 1 )
+        result = paNoError;
+    else if( result == 0 )
+        result = interface->Abort( stream );
+
+    if( result == paNoError )                 /** @todo REVIEW: shouldn't we close anyway? see: http://www.portaudio.com/trac/ticket/115 */
+    {
+        /* the stream is gone after Close() */
+        PaUtilLock *hostApiLock = PA_STREAM_REP( stream )->hostApiLock;
+
+        PaUtil_AcquireLock( hostApiLock );
+        result = interface->Close( stream );
+        PaUtil_ReleaseLock( hostApiLock );
+    }
+
+    return result;
 }
 
 
 static void CloseOpenStreams( void )
 {
-    /* we call Pa_CloseStream() here to ensure that the same destruction
-        logic is used for automatically closed streams */
+    PaUtilOpenStreamTable *table = openStreams_;
+    PaUtilOpenStreamTable *previous;
+    unsigned long slot = 0;
+
+    /* we call CloseStream() here to ensure that the same destruction
+        logic is used for automatically closed streams. removing a stream
+        may move a stream from a later slot into this one, see
+        RemoveOpenStream() */
+
+    while( table != NULL && slot < table->capacity )
+    {
+        PaStream *stream = (PaStream*)table->streams[slot];
+
+        if( stream != NULL )
+        {
+            RemoveOpenStream( stream );
+            CloseStream( stream );
+        }
+        else
+        {
+            ++slot;
+        }
+    }
 
-    while( firstOpenStream_ != NULL )
-        Pa_CloseStream( firstOpenStream_ );
+    /* free the current table and the ones it replaced */
+    while( table != NULL )
+    {
+        previous = table->previous;
+        PaUtil_FreeMemory( table );
+        table = previous;
+    }
+    openStreams_ = NULL;
 }
 
 
@@ -358,6 +603,8 @@ PaError Pa_Initialize( void )
 
     PA_LOGAPI_ENTER( "Pa_Initialize" );
 
+    PaUtil_AcquireInitializationLock();
+
     if( PA_IS_INITIALISED_ )
     {
         ++initializationCount_;
@@ -371,11 +618,26 @@ PaError Pa_Initialize( void )
         PaUtil_InitializeClock();
         PaUtil_ResetTraceMessages();
 
-        result = InitializeHostApis();
+        PaUtil_InitializeSequenceLock( &openStreamsSequenceLock_ );
+        result = PaUtil_CreateLock( &openStreamsLock_ );
         if( result == paNoError )
-            ++initializationCount_;
+        {
+            result = InitializeHostApis();
+            if( result == paNoError )
+            {
+                ++initializationCount_;
+                isInitialized_ = 1;
+            }
+            else
+            {
+                PaUtil_DestroyLock( openStreamsLock_ );
+                openStreamsLock_ = NULL;
+            }
+        }
     }
 
+    PaUtil_ReleaseInitializationLock();
+
     PA_LOGAPI_EXIT_PAERROR( "Pa_Initialize", result );
 
     return result;
@@ -388,11 +650,17 @@ PaError Pa_Terminate( void )
 
     PA_LOGAPI_ENTER( "Pa_Terminate" );
 
+    PaUtil_AcquireInitializationLock();
+
     if( PA_IS_INITIALISED_ )
     {
         if( --initializationCount_ == 0 )
         {
+            isInitialized_ = 0;
+
             CloseOpenStreams();
+            PaUtil_DestroyLock( openStreamsLock_ );
+            openStreamsLock_ = NULL;
 
             TerminateHostApis();
 
@@ -405,6 +673,8 @@ PaError Pa_Terminate( void )
         result=  paNotInitialized;
     }
 
+    PaUtil_ReleaseInitializationLock();
+
     PA_LOGAPI_EXIT_PAERROR( "Pa_Terminate", result );
 
     return result;
@@ -413,6 +683,7 @@ PaError Pa_Terminate( void )
 
 const PaHostErrorInfo* Pa_GetLastHostErrorInfo( void )
 {
+    lastHostErrorInfo_.errorText = lastHostErrorText_;
     return &lastHostErrorInfo_;
 }
 
@@ -1007,7 +1278,13 @@ static PaError ValidateOpenStreamParameters(
     if( (sampleRate < 1000.0) || (sampleRate > 384000.0) )
         return paInvalidSampleRate;
 
-    if( ((streamFlags & ~paPlatformSpecificFlags) & ~(paClipOff | paDitherOff | paNeverDropInput | paPrimeOutputBuffersUsingStreamCallback ) ) != 0 )
+    if( ((streamFlags & ~paPlatformSpecificFlags) & ~(paClipOff | paDitherOff | paNeverDropInput | paPrimeOutputBuffersUsingStreamCallback
+            | paConvertSampleRate | paSampleRateConversionFast | paSampleRateConversionBest
+            | paProfileCallback ) ) != 0 )
+        return paInvalidFlag;
+
+    /* only callbacks can be profiled */
+    if( (streamFlags & paProfileCallback) && !streamCallback )
         return paInvalidFlag;
 
     if( streamFlags & paNeverDropInput )
@@ -1024,6 +1301,18 @@ static PaError ValidateOpenStreamParameters(
         if( framesPerBuffer != paFramesPerBufferUnspecified )
             return paInvalidFlag;
     }
+
+    if( streamFlags & (paConvertSampleRate | paSampleRateConversionFast | paSampleRateConversionBest) )
+    {
+        /* must be a callback stream */
+        if( !streamCallback )
+            return paInvalidFlag;
+
+        /* the quality flags are only meaningful with paConvertSampleRate, and are exclusive */
+        if( !(streamFlags & paConvertSampleRate)
+                || ((streamFlags & paSampleRateConversionFast) && (streamFlags & paSampleRateConversionBest)) )
+            return paInvalidFlag;
+    }
     
     return paNoError;
 }
@@ -1117,9 +1406,11 @@ PaError Pa_IsFormatSupported( const PaStreamParameters *inputParameters,
         hostApiOutputParametersPtr = NULL;
     }
 
+    PaUtil_AcquireLock( hostApi->privatePaFrontInfo.lock );
     result = hostApi->IsFormatSupported( hostApi,
                                   hostApiInputParametersPtr, hostApiOutputParametersPtr,
                                   sampleRate );
+    PaUtil_ReleaseLock( hostApi->privatePaFrontInfo.lock );
 
 #ifdef PA_LOG_API_CALLS
     PA_LOGAPI(("Pa_OpenStream returned:\n" ));
@@ -1251,12 +1542,20 @@ PaError Pa_OpenStream( PaStream** stream,
         hostApiOutputParametersPtr = NULL;
     }
 
+    PaUtil_AcquireLock( hostApi->privatePaFrontInfo.lock );
     result = hostApi->OpenStream( hostApi, stream,
                                   hostApiInputParametersPtr, hostApiOutputParametersPtr,
                                   sampleRate, framesPerBuffer, streamFlags, streamCallback, userData );
+    PaUtil_ReleaseLock( hostApi->privatePaFrontInfo.lock );
 
     if( result == paNoError )
-        AddOpenStream( *stream );
+    {
+        PA_STREAM_REP( *stream )->hostApiLock = hostApi->privatePaFrontInfo.lock;
+
+        result = AddOpenStream( *stream );
+        if( result != paNoError )
+            CloseStream( *stream );
+    }
 
 
     PA_LOGAPI(("Pa_OpenStream returned:\n" ));
@@ -1356,6 +1655,9 @@ PaError PaUtil_ValidateStreamPointer( PaStream* stream )
 
     if( stream == NULL ) return paBadStreamPtr;
 
+    /* reject closed streams without dereferencing them */
+    if( !IsOpenStream( stream ) ) return paBadStreamPtr;
+
     if( ((PaUtilStreamRepresentation*)stream)->magic != PA_STREAM_MAGIC )
         return paBadStreamPtr;
 
@@ -1365,31 +1667,20 @@ PaError PaUtil_ValidateStreamPointer( PaStream* stream )
 
 PaError Pa_CloseStream( PaStream* stream )
 {
-    PaUtilStreamInterface *interface;
     PaError result = PaUtil_ValidateStreamPointer( stream );
 
     PA_LOGAPI_ENTER_PARAMS( "Pa_CloseStream" );
     PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
 
-    /* always remove the open stream from our list, even if this function
-        eventually returns an error. Otherwise CloseOpenStreams() will
-        get stuck in an infinite loop */
-    RemoveOpenStream( stream ); /* be sure to call this _before_ closing the stream */
+    /* always remove the open stream, even if this function eventually
+        returns an error. Removing it also claims the stream for this thread,
+        so that a stream closed concurrently by several threads is only
+        closed once. Be sure to do this _before_ closing the stream */
+    if( result == paNoError && !RemoveOpenStream( stream ) )
+        result = paBadStreamPtr;
 
     if( result == paNoError )
-    {
-        interface = PA_STREAM_INTERFACE(stream);
-
-        /* abort the stream if it isn't stopped */
-        result = interface->IsStopped( stream );
-        if( result == 1 )
-            result = paNoError;
-        else if( result == 0 )
-            result = interface->Abort( stream );
-
-        if( result == paNoError )                 /** @todo REVIEW: shouldn't we close anyway? see: http://www.portaudio.com/trac/ticket/115 */
-            result = interface->Close( stream );
-    }
+        result = CloseStream( stream );
 
     PA_LOGAPI_EXIT_PAERROR( "Pa_CloseStream", result );
 
@@ -1504,6 +1795,182 @@ PaError Pa_AbortStream( PaStream *stream )
 }
 
 
+/* Check that all streams of a Pa_StartStreams() call are valid, stopped and
+   distinct.
+*/
+static PaError ValidateStreamsToStart( PaStream **streams, int count )
+{
+    PaError result = paNoError;
+    int i, j;
+
+    if( !PA_IS_INITIALISED_ )
+        return paNotInitialized;
+
+    if( streams == NULL || count < 0 )
+        return paBadStreamPtr;
+
+    for( i = 0; result == paNoError && i < count; ++i )
+    {
+        result = PaUtil_ValidateStreamPointer( streams[i] );
+
+        for( j = 0; result == paNoError && j < i; ++j )
+        {
+            if( streams[j] == streams[i] )
+                result = paBadStreamPtr;
+        }
+
+        if( result == paNoError )
+        {
+            result = PA_STREAM_INTERFACE(streams[i])->IsStopped( streams[i] );
+            if( result == 0 )
+                result = paStreamIsNotStopped;
+            else if( result == 1 )
+                result = paNoError;
+        }
+    }
+
+    return result;
+}
+
+
+PaError Pa_StartStreams( PaStream **streams, int count, PaTime *startSkew )
+{
+    PaError result;
+    PaStream **group = NULL;
+    unsigned char *isStarted = NULL;
+    PaError (*startStreams)( PaStream **, int, PaTime * );
+    PaTime skew = 0., groupSkew, firstStartTime = 0., startTime;
+    int i, j, groupCount;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_StartStreams" );
+    PA_LOGAPI(("\tPaStream** streams: 0x%p\n", streams ));
+    PA_LOGAPI(("\tint count: %d\n", count ));
+
+    result = ValidateStreamsToStart( streams, count );
+    if( result != paNoError || count == 0 )
+        goto end;
+
+    group = (PaStream**)PaUtil_AllocateMemory( sizeof(PaStream*) * count );
+    isStarted = (unsigned char*)PaUtil_AllocateMemory( count );
+    if( !group || !isStarted )
+    {
+        result = paInsufficientMemory;
+        goto end;
+    }
+    memset( isStarted, 0, count );
+
+    /* Host APIs which can start several streams together get all of theirs
+       in one call, the others are started one at a time. */
+    for( i = 0; i < count; ++i )
+    {
+        if( isStarted[i] )
+            continue;
+
+        startStreams = PA_STREAM_INTERFACE(streams[i])->StartStreams;
+        groupSkew = 0.;
+
+        if( startStreams )
+        {
+            groupCount = 0;
+            for( j = i; j < count; ++j )
+            {
+                if( !isStarted[j] && PA_STREAM_INTERFACE(streams[j])->StartStreams == startStreams )
+                    group[ groupCount++ ] = streams[j];
+            }
+
+            result = startStreams( group, groupCount, &groupSkew );
+            if( result != paNoError )
+                goto error;
+
+            for( j = i; j < count; ++j )
+            {
+                if( PA_STREAM_INTERFACE(streams[j])->StartStreams == startStreams )
+                    isStarted[j] = 1;
+            }
+        }
+        else
+        {
+            result = PA_STREAM_INTERFACE(streams[i])->Start( streams[i] );
+            if( result != paNoError )
+                goto error;
+
+            isStarted[i] = 1;
+        }
+
+        /* streams started by separate calls are at least as far apart as
+           the calls returned */
+        startTime = PaUtil_GetTime();
+        if( i == 0 )
+            firstStartTime = startTime;
+        if( startTime - firstStartTime > skew )
+            skew = startTime - firstStartTime;
+        if( groupSkew > skew )
+            skew = groupSkew;
+    }
+
+    if( startSkew )
+        *startSkew = skew;
+
+    PA_LOGAPI(("\tPaTime skew: %g\n", skew ));
+
+end:
+    if( group )
+        PaUtil_FreeMemory( group );
+    if( isStarted )
+        PaUtil_FreeMemory( isStarted );
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_StartStreams", result );
+
+    return result;
+
+error:
+    for( i = 0; i < count; ++i )
+    {
+        if( isStarted[i] && PA_STREAM_INTERFACE(streams[i])->IsStopped( streams[i] ) == 0 )
+            PA_STREAM_INTERFACE(streams[i])->Abort( streams[i] );
+    }
+    goto end;
+}
+
+
+PaError Pa_StopStreams( PaStream **streams, int count )
+{
+    PaError result = paNoError, streamResult;
+    int i;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_StopStreams" );
+    PA_LOGAPI(("\tPaStream** streams: 0x%p\n", streams ));
+    PA_LOGAPI(("\tint count: %d\n", count ));
+
+    if( !PA_IS_INITIALISED_ )
+        result = paNotInitialized;
+    else if( streams == NULL || count < 0 )
+        result = paBadStreamPtr;
+
+    for( i = 0; result == paNoError && i < count; ++i )
+        result = PaUtil_ValidateStreamPointer( streams[i] );
+
+    if( result != paNoError )
+        count = 0;
+
+    for( i = 0; i < count; ++i )
+    {
+        streamResult = PA_STREAM_INTERFACE(streams[i])->IsStopped( streams[i] );
+        if( streamResult == 0 )
+            streamResult = PA_STREAM_INTERFACE(streams[i])->Stop( streams[i] );
+        else if( streamResult == 1 )
+            streamResult = paNoError;
+
+        if( streamResult != paNoError && result == paNoError )
+            result = streamResult;
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_StopStreams", result );
+
+    return result;
+}
+
+
 PaError Pa_IsStreamStopped( PaStream *stream )
 {
     PaError result = PaUtil_ValidateStreamPointer( stream );
@@ -1632,6 +2099,98 @@ double Pa_GetStreamCpuLoad( PaStream* stream )
 }
 
 
+PaError Pa_GetStreamClockInfo( PaStream *stream, PaStreamClockInfo *info )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_GetStreamClockInfo" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tPaStreamClockInfo* info: 0x%p\n", info ));
+
+    if( result == paNoError )
+    {
+        if( PA_STREAM_REP( stream )->clockEstimator == NULL )
+        {
+            result = paIncompatibleStreamHostApi;
+        }
+        else if( info == NULL )
+        {
+            result = paBadBufferPtr;
+        }
+        else
+        {
+            info->structVersion = 1;
+            PaUtil_GetClockEstimate( PA_STREAM_REP( stream )->clockEstimator, info );
+
+            PA_LOGAPI(("\tPaStreamClockInfo*: isLocked: %d, rateRatio: %.9f\n", info->isLocked, info->rateRatio ));
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_GetStreamClockInfo", result );
+
+    return result;
+}
+
+
+PaError Pa_GetStreamCallbackProfile( PaStream *stream, PaStreamCallbackProfile *profile )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_GetStreamCallbackProfile" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tPaStreamCallbackProfile* profile: 0x%p\n", profile ));
+
+    if( result == paNoError )
+    {
+        if( PA_STREAM_REP( stream )->callbackProfiler == NULL )
+        {
+            result = paIncompatibleStreamHostApi;
+        }
+        else if( profile == NULL )
+        {
+            result = paBadBufferPtr;
+        }
+        else
+        {
+            profile->structVersion = 1;
+            PaUtil_GetCallbackProfile( PA_STREAM_REP( stream )->callbackProfiler, profile );
+
+            PA_LOGAPI(("\tPaStreamCallbackProfile*: callbackCount: %lu, deadlineMissCount: %lu\n",
+                    profile->callbackCount, profile->deadlineMissCount ));
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_GetStreamCallbackProfile", result );
+
+    return result;
+}
+
+
+PaError Pa_SetStreamCallbackProfileReport( PaStream *stream,
+        PaStreamCallbackProfileReport *report, void *userData )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_SetStreamCallbackProfileReport" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tPaStreamCallbackProfileReport* report: 0x%p\n", report ));
+    PA_LOGAPI(("\tvoid* userData: 0x%p\n", userData ));
+
+    if( result == paNoError )
+    {
+        if( PA_STREAM_REP( stream )->callbackProfiler == NULL )
+            result = paIncompatibleStreamHostApi;
+        else
+            result = PaUtil_SetCallbackProfileReport( PA_STREAM_REP( stream )->callbackProfiler,
+                    stream, report, userData );
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_SetStreamCallbackProfileReport", result );
+
+    return result;
+}
+
+
 PaError Pa_ReadStream( PaStream* stream,
                        void *buffer,
                        unsigned long frames )
@@ -1769,6 +2328,60 @@ signed long Pa_GetStreamWriteAvailable( PaStream* stream )
 }
 
 
+/* the unchecked variants trust the caller to pass an open stream, see
+    Pa_ReadStreamUnchecked() in portaudio.h */
+
+PaError Pa_ReadStreamUnchecked( PaStream* stream,
+                                void *buffer,
+                                unsigned long frames )
+{
+    return (frames == 0) ? paNoError : PA_STREAM_INTERFACE(stream)->Read( stream, buffer, frames );
+}
+
+
+PaError Pa_WriteStreamUnchecked( PaStream* stream,
+                                 const void *buffer,
+                                 unsigned long frames )
+{
+    return (frames == 0) ? paNoError : PA_STREAM_INTERFACE(stream)->Write( stream, buffer, frames );
+}
+
+
+signed long Pa_GetStreamReadAvailableUnchecked( PaStream* stream )
+{
+    return PA_STREAM_INTERFACE(stream)->GetReadAvailable( stream );
+}
+
+
+signed long Pa_GetStreamWriteAvailableUnchecked( PaStream* stream )
+{
+    return PA_STREAM_INTERFACE(stream)->GetWriteAvailable( stream );
+}
+
+
+PaTime Pa_GetStreamTimeUnchecked( PaStream *stream )
+{
+    return PA_STREAM_INTERFACE(stream)->GetTime( stream );
+}
+
+
+double Pa_GetStreamCpuLoadUnchecked( PaStream* stream )
+{
+    return PA_STREAM_INTERFACE(stream)->GetCpuLoad( stream );
+}
+
+
+PaError Pa_IsStreamStoppedUnchecked( PaStream *stream )
+{
+    return PA_STREAM_INTERFACE(stream)->IsStopped( stream );
+}
+
+
+PaError Pa_IsStreamActiveUnchecked( PaStream *stream )
+{
+    return PA_STREAM_INTERFACE(stream)->IsActive( stream );
+}
+
 PaError Pa_GetSampleSize( PaSampleFormat format )
 {
     int result;
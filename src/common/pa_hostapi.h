@@ -168,6 +168,9 @@ typedef struct PaUtilPrivatePaFrontHostApiInfo {
 
 
     unsigned long baseDeviceIndex;
+
+    /* serializes opening and closing streams, and IsFormatSupported() */
+    struct PaUtilLock *lock;
 }PaUtilPrivatePaFrontHostApiInfo;
 
 
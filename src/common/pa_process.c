@@ -46,16 +46,84 @@
 
 #include <assert.h>
 #include <string.h> /* memset() */
+#include <math.h>
 
 #include "pa_process.h"
+#include "pa_resampler.h"
+#include "pa_callbackprofiler.h"
 #include "pa_util.h"
 
 
 #define PA_FRAMES_PER_TEMP_BUFFER_WHEN_HOST_BUFFER_SIZE_IS_UNKNOWN_    1024
 
+/* host rate frames converted to or from float at a time when converting the sample rate */
+#define PA_FRAMES_PER_SAMPLE_RATE_CONVERSION_BUFFER_    256
+
+/* flags used to allocate the buffers which are touched in the callback. may be
+    overridden at compile time, e.g. with paUtilLockBufferMemory */
+#ifndef PA_PROCESS_BUFFER_MEMORY_FLAGS
+#define PA_PROCESS_BUFFER_MEMORY_FLAGS      (paUtilPrefaultBufferMemory)
+#endif
+
 #define PA_MIN_( a, b ) ( ((a)<(b)) ? (a) : (b) )
 
 
+/* State used when the host and user sample rates differ.
+
+    Host input is converted to float, resampled to the user rate and queued in
+    inputFifo. The stream callback is called by userBufferProcessor, in blocks
+    of framesPerBlock frames, whose float output is queued in outputFifo and
+    resampled to the host rate on demand.
+*/
+struct PaUtilSampleRateConverter{
+    PaUtilBufferProcessor userBufferProcessor;
+    double hostFramesPerUserFrame;
+    unsigned long framesPerBlock;
+
+    PaUtilResampler inputResampler;
+    PaUtilConverter *inputConverter;            /* host format -> paFloat32 */
+    float *inputConversionBuffer;
+    float *inputFifo;
+    unsigned long inputFifoCapacity, inputFifoFrameCount;
+    unsigned long initialInputFifoFrameCount;   /* silence primed for full duplex streams */
+
+    PaUtilResampler outputResampler;
+    PaUtilConverter *outputConverter;           /* paFloat32 -> host format */
+    float *outputConversionBuffer;
+    float *outputFifo;                          /* a single block */
+    unsigned long outputFifoReadIndex, outputFifoFrameCount;
+
+    unsigned long inputLatencyFrames, outputLatencyFrames;
+
+    PaStreamCallbackTimeInfo timeInfo;          /* for the next block */
+    PaStreamCallbackFlags callbackStatusFlags;  /* to be passed with the next block */
+};
+
+static void TerminateSampleRateConverter( struct PaUtilSampleRateConverter *src );
+static void ResetSampleRateConverter( struct PaUtilSampleRateConverter *src );
+
+
+/* call the stream callback, timing it when the stream is profiled */
+static int CallStreamCallback( PaUtilBufferProcessor *bp, const void *userInput, void *userOutput,
+        unsigned long frameCount )
+{
+    PaTime startTime;
+    int result;
+
+    if( !bp->callbackProfiler )
+        return bp->streamCallback( userInput, userOutput, frameCount, bp->timeInfo,
+                bp->callbackStatusFlags, bp->userData );
+
+    startTime = PaUtil_GetTime();
+    result = bp->streamCallback( userInput, userOutput, frameCount, bp->timeInfo,
+            bp->callbackStatusFlags, bp->userData );
+    PaUtil_ProfileCallback( bp->callbackProfiler, startTime, PaUtil_GetTime() - startTime,
+            frameCount, frameCount * bp->samplePeriod );
+
+    return result;
+}
+
+
 /* greatest common divisor - PGCD in French */
 static unsigned long GCD( unsigned long a, unsigned long b )
 {
@@ -129,6 +197,15 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
     bp->hostInputChannels[0] = bp->hostInputChannels[1] = 0;
     bp->hostOutputChannels[0] = bp->hostOutputChannels[1] = 0;
 
+    bp->hostInputSampleFormat = hostInputSampleFormat;
+    bp->userInputSampleFormat = userInputSampleFormat;
+    bp->hostOutputSampleFormat = hostOutputSampleFormat;
+    bp->userOutputSampleFormat = userOutputSampleFormat;
+    bp->streamFlags = streamFlags;
+
+    bp->sampleRateConverter = 0;
+    bp->callbackProfiler = 0;
+
     if( framesPerUserBuffer == 0 ) /* streamCallback will accept any buffer size */
     {
         bp->useNonAdaptingProcess = 1;
@@ -249,7 +326,7 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         tempInputBufferSize =
             bp->framesPerTempBuffer * bp->bytesPerUserInputSample * inputChannelCount;
          
-        bp->tempInputBuffer = PaUtil_AllocateMemory( tempInputBufferSize );
+        bp->tempInputBuffer = PaUtil_AllocateBufferMemory( tempInputBufferSize, PA_PROCESS_BUFFER_MEMORY_FLAGS );
         if( bp->tempInputBuffer == 0 )
         {
             result = paInsufficientMemory;
@@ -319,7 +396,7 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         tempOutputBufferSize =
                 bp->framesPerTempBuffer * bp->bytesPerUserOutputSample * outputChannelCount;
 
-        bp->tempOutputBuffer = PaUtil_AllocateMemory( tempOutputBufferSize );
+        bp->tempOutputBuffer = PaUtil_AllocateBufferMemory( tempOutputBufferSize, PA_PROCESS_BUFFER_MEMORY_FLAGS );
         if( bp->tempOutputBuffer == 0 )
         {
             result = paInsufficientMemory;
@@ -358,11 +435,22 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
     bp->streamCallback = streamCallback;
     bp->userData = userData;
 
+    if( (streamFlags & paProfileCallback) && streamCallback )
+    {
+        bp->callbackProfiler = (PaUtilCallbackProfiler*)PaUtil_AllocateMemory( sizeof(PaUtilCallbackProfiler) );
+        if( bp->callbackProfiler == 0 )
+        {
+            result = paInsufficientMemory;
+            goto error;
+        }
+        PaUtil_InitializeCallbackProfiler( bp->callbackProfiler );
+    }
+
     return result;
 
 error:
     if( bp->tempInputBuffer )
-        PaUtil_FreeMemory( bp->tempInputBuffer );
+        PaUtil_FreeBufferMemory( bp->tempInputBuffer );
 
     if( bp->tempInputBufferPtrs )
         PaUtil_FreeMemory( bp->tempInputBufferPtrs );
@@ -371,7 +459,7 @@ error:
         PaUtil_FreeMemory( bp->hostInputChannels[0] );
 
     if( bp->tempOutputBuffer )
-        PaUtil_FreeMemory( bp->tempOutputBuffer );
+        PaUtil_FreeBufferMemory( bp->tempOutputBuffer );
 
     if( bp->tempOutputBufferPtrs )
         PaUtil_FreeMemory( bp->tempOutputBufferPtrs );
@@ -386,7 +474,7 @@ error:
 void PaUtil_TerminateBufferProcessor( PaUtilBufferProcessor* bp )
 {
     if( bp->tempInputBuffer )
-        PaUtil_FreeMemory( bp->tempInputBuffer );
+        PaUtil_FreeBufferMemory( bp->tempInputBuffer );
 
     if( bp->tempInputBufferPtrs )
         PaUtil_FreeMemory( bp->tempInputBufferPtrs );
@@ -395,13 +483,22 @@ void PaUtil_TerminateBufferProcessor( PaUtilBufferProcessor* bp )
         PaUtil_FreeMemory( bp->hostInputChannels[0] );
         
     if( bp->tempOutputBuffer )
-        PaUtil_FreeMemory( bp->tempOutputBuffer );
+        PaUtil_FreeBufferMemory( bp->tempOutputBuffer );
 
     if( bp->tempOutputBufferPtrs )
         PaUtil_FreeMemory( bp->tempOutputBufferPtrs );
 
     if( bp->hostOutputChannels[0] )
         PaUtil_FreeMemory( bp->hostOutputChannels[0] );
+
+    if( bp->sampleRateConverter )
+        TerminateSampleRateConverter( bp->sampleRateConverter );
+
+    if( bp->callbackProfiler )
+    {
+        PaUtil_TerminateCallbackProfiler( bp->callbackProfiler );
+        PaUtil_FreeMemory( bp->callbackProfiler );
+    }
 }
 
 
@@ -409,6 +506,9 @@ void PaUtil_ResetBufferProcessor( PaUtilBufferProcessor* bp )
 {
     unsigned long tempInputBufferSize, tempOutputBufferSize;
 
+    if( bp->sampleRateConverter )
+        ResetSampleRateConverter( bp->sampleRateConverter );
+
     bp->framesInTempInputBuffer = bp->initialFramesInTempInputBuffer;
     bp->framesInTempOutputBuffer = bp->initialFramesInTempOutputBuffer;
 
@@ -430,16 +530,215 @@ void PaUtil_ResetBufferProcessor( PaUtilBufferProcessor* bp )
 
 unsigned long PaUtil_GetBufferProcessorInputLatencyFrames( PaUtilBufferProcessor* bp )
 {
+    if( bp->sampleRateConverter )
+        return bp->sampleRateConverter->inputLatencyFrames;
+
     return bp->initialFramesInTempInputBuffer;
 }
 
 
 unsigned long PaUtil_GetBufferProcessorOutputLatencyFrames( PaUtilBufferProcessor* bp )
 {
+    if( bp->sampleRateConverter )
+        return bp->sampleRateConverter->outputLatencyFrames;
+
     return bp->initialFramesInTempOutputBuffer;
 }
 
 
+PaError PaUtil_InitializeBufferProcessorSampleRateConverter( PaUtilBufferProcessor* bp,
+        double hostSampleRate )
+{
+    PaError result = paNoError;
+    struct PaUtilSampleRateConverter *src;
+    double userSampleRate = 1. / bp->samplePeriod;
+    PaUtilResamplerQuality quality = paUtilResamplerQualityMedium;
+    PaStreamFlags userStreamFlags = bp->streamFlags
+            & ~(paConvertSampleRate | paSampleRateConversionFast | paSampleRateConversionBest | paProfileCallback);
+    unsigned long maxFramesPerHostBuffer, maxUserFramesPerHostBuffer;
+
+    /* PaUtil_CopyInput() and PaUtil_CopyOutput() don't convert the sample rate */
+    if( !bp->streamCallback )
+        return paInvalidFlag;
+
+    if( bp->streamFlags & paSampleRateConversionFast )
+        quality = paUtilResamplerQualityFast;
+    else if( bp->streamFlags & paSampleRateConversionBest )
+        quality = paUtilResamplerQualityBest;
+
+    src = (struct PaUtilSampleRateConverter*)PaUtil_AllocateMemory( sizeof(struct PaUtilSampleRateConverter) );
+    if( src == 0 )
+        return paInsufficientMemory;
+    memset( src, 0, sizeof(struct PaUtilSampleRateConverter) );
+
+    src->hostFramesPerUserFrame = hostSampleRate / userSampleRate;
+
+    if( bp->hostBufferSizeMode == paUtilFixedHostBufferSize
+            || bp->hostBufferSizeMode == paUtilBoundedHostBufferSize )
+        maxFramesPerHostBuffer = bp->framesPerHostBuffer;
+    else
+        maxFramesPerHostBuffer = PA_FRAMES_PER_TEMP_BUFFER_WHEN_HOST_BUFFER_SIZE_IS_UNKNOWN_;
+    maxUserFramesPerHostBuffer = (unsigned long)ceil( maxFramesPerHostBuffer / src->hostFramesPerUserFrame );
+
+    /* call the stream callback with the requested buffer size, or with host
+        buffer sized blocks if it doesn't care */
+    if( bp->framesPerUserBuffer != 0 )
+        src->framesPerBlock = bp->framesPerUserBuffer;
+    else
+        src->framesPerBlock = (maxUserFramesPerHostBuffer > 0) ? maxUserFramesPerHostBuffer : 1;
+
+    result = PaUtil_InitializeBufferProcessor( &src->userBufferProcessor,
+            bp->inputChannelCount, bp->userInputSampleFormat, paFloat32,
+            bp->outputChannelCount, bp->userOutputSampleFormat, paFloat32,
+            userSampleRate, userStreamFlags, bp->framesPerUserBuffer, src->framesPerBlock,
+            paUtilFixedHostBufferSize, bp->streamCallback, bp->userData );
+    if( result != paNoError )
+    {
+        PaUtil_FreeMemory( src );
+        return result;
+    }
+
+    /* the callback is profiled by the user buffer processor, on behalf of this one */
+    src->userBufferProcessor.callbackProfiler = bp->callbackProfiler;
+
+    if( bp->inputChannelCount > 0 )
+    {
+        result = PaUtil_InitializeResampler( &src->inputResampler, bp->inputChannelCount,
+                hostSampleRate, userSampleRate, quality );
+        if( result != paNoError )
+            goto error;
+
+        src->inputConverter = PaUtil_SelectConverter( bp->hostInputSampleFormat, paFloat32, bp->streamFlags );
+
+        /* the callback is called as soon as a full block has been queued, so
+            full duplex streams need a block, and the output resampler's
+            lookahead, of input in advance */
+        if( bp->outputChannelCount > 0 )
+        {
+            src->initialInputFifoFrameCount = src->framesPerBlock + 1
+                    + PaUtil_GetResamplerLatencyFrames( &src->inputResampler )
+                    + (unsigned long)ceil( PA_FRAMES_PER_SAMPLE_RATE_CONVERSION_BUFFER_ / src->hostFramesPerUserFrame );
+        }
+        src->inputFifoCapacity = src->initialInputFifoFrameCount
+                + 2 * (src->framesPerBlock + maxUserFramesPerHostBuffer + 1);
+
+        src->inputConversionBuffer = (float*)PaUtil_AllocateBufferMemory(
+                sizeof(float) * bp->inputChannelCount * PA_FRAMES_PER_SAMPLE_RATE_CONVERSION_BUFFER_,
+                PA_PROCESS_BUFFER_MEMORY_FLAGS );
+        src->inputFifo = (float*)PaUtil_AllocateBufferMemory(
+                sizeof(float) * bp->inputChannelCount * src->inputFifoCapacity,
+                PA_PROCESS_BUFFER_MEMORY_FLAGS );
+        if( src->inputConversionBuffer == 0 || src->inputFifo == 0 )
+        {
+            result = paInsufficientMemory;
+            goto error;
+        }
+
+        src->inputLatencyFrames = src->initialInputFifoFrameCount
+                + PaUtil_GetResamplerLatencyFrames( &src->inputResampler )
+                + PaUtil_GetBufferProcessorInputLatencyFrames( &src->userBufferProcessor );
+    }
+
+    if( bp->outputChannelCount > 0 )
+    {
+        result = PaUtil_InitializeResampler( &src->outputResampler, bp->outputChannelCount,
+                userSampleRate, hostSampleRate, quality );
+        if( result != paNoError )
+            goto error;
+
+        src->outputConverter = PaUtil_SelectConverter( paFloat32, bp->hostOutputSampleFormat, bp->streamFlags );
+
+        src->outputConversionBuffer = (float*)PaUtil_AllocateBufferMemory(
+                sizeof(float) * bp->outputChannelCount * PA_FRAMES_PER_SAMPLE_RATE_CONVERSION_BUFFER_,
+                PA_PROCESS_BUFFER_MEMORY_FLAGS );
+        src->outputFifo = (float*)PaUtil_AllocateBufferMemory(
+                sizeof(float) * bp->outputChannelCount * src->framesPerBlock,
+                PA_PROCESS_BUFFER_MEMORY_FLAGS );
+        if( src->outputConversionBuffer == 0 || src->outputFifo == 0 )
+        {
+            result = paInsufficientMemory;
+            goto error;
+        }
+
+        src->outputLatencyFrames = src->framesPerBlock
+                + (unsigned long)ceil( PaUtil_GetResamplerLatencyFrames( &src->outputResampler ) / src->hostFramesPerUserFrame )
+                + PaUtil_GetBufferProcessorOutputLatencyFrames( &src->userBufferProcessor );
+    }
+
+    if( (bp->inputChannelCount > 0 && src->inputConverter == 0)
+            || (bp->outputChannelCount > 0 && src->outputConverter == 0) )
+    {
+        result = paSampleFormatNotSupported;
+        goto error;
+    }
+
+    ResetSampleRateConverter( src );
+
+    /* all buffering now happens in the converter */
+    bp->initialFramesInTempInputBuffer = bp->framesInTempInputBuffer = 0;
+    bp->initialFramesInTempOutputBuffer = bp->framesInTempOutputBuffer = 0;
+
+    bp->sampleRateConverter = src;
+
+    return result;
+
+error:
+    TerminateSampleRateConverter( src );
+
+    return result;
+}
+
+
+static void TerminateSampleRateConverter( struct PaUtilSampleRateConverter *src )
+{
+    /* the profiler belongs to the host buffer processor */
+    src->userBufferProcessor.callbackProfiler = 0;
+    PaUtil_TerminateBufferProcessor( &src->userBufferProcessor );
+
+    PaUtil_TerminateResampler( &src->inputResampler );
+
+    if( src->inputConversionBuffer )
+        PaUtil_FreeBufferMemory( src->inputConversionBuffer );
+
+    if( src->inputFifo )
+        PaUtil_FreeBufferMemory( src->inputFifo );
+
+    PaUtil_TerminateResampler( &src->outputResampler );
+
+    if( src->outputConversionBuffer )
+        PaUtil_FreeBufferMemory( src->outputConversionBuffer );
+
+    if( src->outputFifo )
+        PaUtil_FreeBufferMemory( src->outputFifo );
+
+    PaUtil_FreeMemory( src );
+}
+
+
+static void ResetSampleRateConverter( struct PaUtilSampleRateConverter *src )
+{
+    PaUtilBufferProcessor *userBp = &src->userBufferProcessor;
+
+    PaUtil_ResetBufferProcessor( userBp );
+
+    if( userBp->inputChannelCount > 0 )
+    {
+        PaUtil_ResetResampler( &src->inputResampler );
+
+        src->inputFifoFrameCount = src->initialInputFifoFrameCount;
+        memset( src->inputFifo, 0, sizeof(float) * userBp->inputChannelCount * src->inputFifoFrameCount );
+    }
+
+    if( userBp->outputChannelCount > 0 )
+        PaUtil_ResetResampler( &src->outputResampler );
+
+    src->outputFifoReadIndex = 0;
+    src->outputFifoFrameCount = 0;
+
+    src->callbackStatusFlags = 0;
+}
+
+
 void PaUtil_SetInputFrameCount( PaUtilBufferProcessor* bp,
         unsigned long frameCount )
 {
@@ -669,8 +968,28 @@ void PaUtil_Set2ndNonInterleavedOutputChannel( PaUtilBufferProcessor* bp,
 void PaUtil_BeginBufferProcessing( PaUtilBufferProcessor* bp,
         PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags callbackStatusFlags )
 {
+    struct PaUtilSampleRateConverter *src = bp->sampleRateConverter;
+
     bp->timeInfo = timeInfo;
 
+    if( src )
+    {
+        /* the next block is made of the queued frames, delayed by the resamplers */
+        src->timeInfo = *timeInfo;
+        if( bp->inputChannelCount > 0 )
+        {
+            src->timeInfo.inputBufferAdcTime -= (src->inputFifoFrameCount
+                    + PaUtil_GetResamplerLatencyFrames( &src->inputResampler )) * bp->samplePeriod;
+        }
+        if( bp->outputChannelCount > 0 )
+        {
+            src->timeInfo.outputBufferDacTime += src->outputFifoFrameCount * bp->samplePeriod
+                    + PaUtil_GetResamplerLatencyFrames( &src->outputResampler ) * bp->samplePeriod / src->hostFramesPerUserFrame;
+        }
+
+        src->callbackStatusFlags |= callbackStatusFlags;
+    }
+
     /* the first streamCallback will be called to process samples which are
         currently in the input buffer before the ones starting at the timeInfo time */
         
@@ -870,8 +1189,7 @@ static unsigned long NonAdaptingProcess( PaUtilBufferProcessor *bp,
                 }
             }
         
-            *streamCallbackResult = bp->streamCallback( userInput, userOutput,
-                    frameCount, bp->timeInfo, bp->callbackStatusFlags, bp->userData );
+            *streamCallbackResult = CallStreamCallback( bp, userInput, userOutput, frameCount );
 
             if( *streamCallbackResult == paAbort )
             {
@@ -964,6 +1282,51 @@ static unsigned long NonAdaptingProcess( PaUtilBufferProcessor *bp,
 }
 
 
+/*
+    SetUserBufferToHostBuffer() is used by the adapting processors to pass a
+    whole user buffer to the streamCallback in place, when it lies in a host
+    buffer whose sample format and layout match the user buffer exactly. Returns
+    0 if the user buffer has to go through the temporary buffer instead.
+*/
+static int SetUserBufferToHostBuffer( void **userBuffer, void **userBufferPtrs,
+        PaUtilChannelDescriptor *hostChannels, unsigned int channelCount,
+        unsigned int bytesPerSample, int userSampleFormatIsEqualToHost, int userIsInterleaved )
+{
+    unsigned int i;
+
+    if( !userSampleFormatIsEqualToHost || !hostChannels[0].data )
+        return 0;
+
+    if( userIsInterleaved )
+    {
+        /* the host channels must be adjacent samples of each frame, with
+            nothing in between (eg no extra Alsa hw: channels) */
+        for( i=0; i<channelCount; ++i )
+        {
+            if( hostChannels[i].stride != channelCount
+                    || hostChannels[i].data != ((unsigned char*)hostChannels[0].data) + i * bytesPerSample )
+                return 0;
+        }
+
+        *userBuffer = hostChannels[0].data;
+    }
+    else /* user buffer is not interleaved */
+    {
+        for( i=0; i<channelCount; ++i )
+        {
+            if( hostChannels[i].stride != 1 )
+                return 0;
+
+            userBufferPtrs[i] = hostChannels[i].data;
+        }
+
+        *userBuffer = userBufferPtrs;
+    }
+
+    return 1;
+}
+
+
 /*
     AdaptingInputOnlyProcess() is a half duplex input buffer processor. It
     converts data from the input buffers into the temporary input buffer,
@@ -987,6 +1350,36 @@ static unsigned long AdaptingInputOnlyProcess( PaUtilBufferProcessor *bp,
 
     do
     {
+        if( bp->framesInTempInputBuffer == 0 && framesToGo >= bp->framesPerUserBuffer
+                && *streamCallbackResult == paContinue
+                && SetUserBufferToHostBuffer( &userInput, bp->tempInputBufferPtrs, hostInputChannels,
+                        bp->inputChannelCount, bp->bytesPerHostInputSample,
+                        bp->userInputSampleFormatIsEqualToHost, bp->userInputIsInterleaved ) )
+        {
+            /* a whole user buffer lies in the host buffer, pass it to the callback in place */
+
+            frameCount = bp->framesPerUserBuffer;
+
+            bp->timeInfo->outputBufferDacTime = 0;
+
+            *streamCallbackResult = CallStreamCallback( bp, userInput, userOutput, bp->framesPerUserBuffer );
+
+            bp->timeInfo->inputBufferAdcTime += bp->framesPerUserBuffer * bp->samplePeriod;
+
+            for( i=0; i<bp->inputChannelCount; ++i )
+            {
+                /* advance src ptr for next iteration */
+                hostInputChannels[i].data = ((unsigned char*)hostInputChannels[i].data) +
+                        frameCount * hostInputChannels[i].stride * bp->bytesPerHostInputSample;
+            }
+
+            framesProcessed += frameCount;
+
+            framesToGo -= frameCount;
+
+            continue;
+        }
+
         frameCount = ( bp->framesInTempInputBuffer + framesToGo > bp->framesPerUserBuffer )
                 ? ( bp->framesPerUserBuffer - bp->framesInTempInputBuffer )
                 : framesToGo;
@@ -1052,9 +1445,7 @@ static unsigned long AdaptingInputOnlyProcess( PaUtilBufferProcessor *bp,
             {
                 bp->timeInfo->outputBufferDacTime = 0;
 
-                *streamCallbackResult = bp->streamCallback( userInput, userOutput,
-                        bp->framesPerUserBuffer, bp->timeInfo,
-                        bp->callbackStatusFlags, bp->userData );
+                *streamCallbackResult = CallStreamCallback( bp, userInput, userOutput, bp->framesPerUserBuffer );
 
                 bp->timeInfo->inputBufferAdcTime += bp->framesPerUserBuffer * bp->samplePeriod;
             }
@@ -1092,6 +1483,45 @@ static unsigned long AdaptingOutputOnlyProcess( PaUtilBufferProcessor *bp,
 
     do
     {
+        if( bp->framesInTempOutputBuffer == 0 && framesToGo >= bp->framesPerUserBuffer
+                && *streamCallbackResult == paContinue
+                && SetUserBufferToHostBuffer( &userOutput, bp->tempOutputBufferPtrs, hostOutputChannels,
+                        bp->outputChannelCount, bp->bytesPerHostOutputSample,
+                        bp->userOutputSampleFormatIsEqualToHost, bp->userOutputIsInterleaved ) )
+        {
+            /* a whole user buffer fits in the host buffer, let the callback fill it in place */
+
+            frameCount = bp->framesPerUserBuffer;
+
+            bp->timeInfo->inputBufferAdcTime = 0;
+
+            *streamCallbackResult = CallStreamCallback( bp, 0, userOutput, bp->framesPerUserBuffer );
+
+            if( *streamCallbackResult != paAbort )
+                bp->timeInfo->outputBufferDacTime += bp->framesPerUserBuffer * bp->samplePeriod;
+
+            for( i=0; i<bp->outputChannelCount; ++i )
+            {
+                /* if the callback returned paAbort, we disregard its output */
+                if( *streamCallbackResult == paAbort )
+                {
+                    bp->outputZeroer(   hostOutputChannels[i].data,
+                                        hostOutputChannels[i].stride,
+                                        frameCount );
+                }
+
+                /* advance dest ptr for next iteration */
+                hostOutputChannels[i].data = ((unsigned char*)hostOutputChannels[i].data) +
+                        frameCount * hostOutputChannels[i].stride * bp->bytesPerHostOutputSample;
+            }
+
+            framesProcessed += frameCount;
+
+            framesToGo -= frameCount;
+
+            continue;
+        }
+
         if( bp->framesInTempOutputBuffer == 0 && *streamCallbackResult == paContinue )
         {
             userInput = 0;
@@ -1114,9 +1544,7 @@ static unsigned long AdaptingOutputOnlyProcess( PaUtilBufferProcessor *bp,
 
             bp->timeInfo->inputBufferAdcTime = 0;
             
-            *streamCallbackResult = bp->streamCallback( userInput, userOutput,
-                    bp->framesPerUserBuffer, bp->timeInfo,
-                    bp->callbackStatusFlags, bp->userData );
+            *streamCallbackResult = CallStreamCallback( bp, userInput, userOutput, bp->framesPerUserBuffer );
 
             if( *streamCallbackResult == paAbort )
             {
@@ -1285,6 +1713,9 @@ static void CopyTempOutputBuffersToHostOutputBuffers( PaUtilBufferProcessor *bp)
     consumed and all available output space will be filled. When
     processPartialUserBuffers is non-zero, as many full user buffers
     as possible will be processed, but partial buffers will not be consumed.
+    Whenever a whole user buffer lies in a host buffer, and the formats match,
+    the streamCallback is passed the host buffer in place rather than the
+    temporary buffer.
 */
 static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
         int *streamCallbackResult, int processPartialUserBuffers )
@@ -1300,6 +1731,8 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
     unsigned int destSampleStrideSamples; /* stride from one sample to the next within a channel, in samples */
     unsigned int destChannelStrideBytes; /* stride from one channel to the next, in bytes */
     unsigned int i, j;
+    int hostInputBufferIndex, hostOutputBufferIndex;
+    int userInputIsHostBuffer, userOutputIsHostBuffer;
  
 
     framesAvailable = bp->hostInputFrameCount[0] + bp->hostInputFrameCount[1];/* this is assumed to be the same as the output buffer's frame count */
@@ -1343,8 +1776,38 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
         }          
 
 
+        /* use the host input buffer in place if it holds a whole user buffer
+            and the callback is due */
+        userInputIsHostBuffer = 0;
+        hostInputBufferIndex = ( bp->hostInputFrameCount[0] > 0 ) ? 0 : 1;
+        if( bp->framesInTempInputBuffer == 0 && bp->framesInTempOutputBuffer == 0
+                && *streamCallbackResult == paContinue
+                && bp->hostInputFrameCount[hostInputBufferIndex] >= bp->framesPerUserBuffer )
+        {
+            hostInputChannels = bp->hostInputChannels[hostInputBufferIndex];
+
+            userInputIsHostBuffer = SetUserBufferToHostBuffer( &userInput, bp->tempInputBufferPtrs,
+                    hostInputChannels, bp->inputChannelCount, bp->bytesPerHostInputSample,
+                    bp->userInputSampleFormatIsEqualToHost, bp->userInputIsInterleaved );
+
+            if( userInputIsHostBuffer )
+            {
+                for( i=0; i<bp->inputChannelCount; ++i )
+                {
+                    /* advance src ptr for next iteration */
+                    hostInputChannels[i].data = ((unsigned char*)hostInputChannels[i].data) +
+                            bp->framesPerUserBuffer * hostInputChannels[i].stride * bp->bytesPerHostInputSample;
+                }
+
+                bp->hostInputFrameCount[hostInputBufferIndex] -= bp->framesPerUserBuffer;
+
+                framesAvailable -= bp->framesPerUserBuffer;
+                framesProcessed += bp->framesPerUserBuffer;
+            }
+        }
+
         /* copy frames from host to user input buffers */
-        while( bp->framesInTempInputBuffer < bp->framesPerUserBuffer &&
+        while( !userInputIsHostBuffer && bp->framesInTempInputBuffer < bp->framesPerUserBuffer &&
                 ((bp->hostInputFrameCount[0] + bp->hostInputFrameCount[1]) > 0) )
         {
             maxFramesToCopy = bp->framesPerUserBuffer - bp->framesInTempInputBuffer;
@@ -1409,13 +1872,17 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
         }
 
         /* call streamCallback */
-        if( bp->framesInTempInputBuffer == bp->framesPerUserBuffer &&
+        if( (userInputIsHostBuffer || bp->framesInTempInputBuffer == bp->framesPerUserBuffer) &&
             bp->framesInTempOutputBuffer == 0 )
         {
             if( *streamCallbackResult == paContinue )
             {
                 /* setup userInput */
-                if( bp->userInputIsInterleaved )
+                if( userInputIsHostBuffer )
+                {
+                    /* already set up above */
+                }
+                else if( bp->userInputIsInterleaved )
                 {
                     userInput = bp->tempInputBuffer;
                 }
@@ -1430,8 +1897,24 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
                     userInput = bp->tempInputBufferPtrs;
                 }
 
-                /* setup userOutput */
-                if( bp->userOutputIsInterleaved )
+                /* setup userOutput, in place if a whole user buffer fits in
+                    the host output buffer. Any frames in tempOutputBuffer have
+                    already been copied, so the output stays in order */
+                userOutputIsHostBuffer = 0;
+                hostOutputBufferIndex = ( bp->hostOutputFrameCount[0] > 0 ) ? 0 : 1;
+                hostOutputChannels = bp->hostOutputChannels[hostOutputBufferIndex];
+                if( bp->hostOutputFrameCount[hostOutputBufferIndex] >= bp->framesPerUserBuffer )
+                {
+                    userOutputIsHostBuffer = SetUserBufferToHostBuffer( &userOutput, bp->tempOutputBufferPtrs,
+                            hostOutputChannels, bp->outputChannelCount, bp->bytesPerHostOutputSample,
+                            bp->userOutputSampleFormatIsEqualToHost, bp->userOutputIsInterleaved );
+                }
+
+                if( userOutputIsHostBuffer )
+                {
+                    /* already set up above */
+                }
+                else if( bp->userOutputIsInterleaved )
                 {
                     userOutput = bp->tempOutputBuffer;
                 }
@@ -1448,16 +1931,33 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
 
                 /* call streamCallback */
 
-                *streamCallbackResult = bp->streamCallback( userInput, userOutput,
-                        bp->framesPerUserBuffer, bp->timeInfo,
-                        bp->callbackStatusFlags, bp->userData );
+                *streamCallbackResult = CallStreamCallback( bp, userInput, userOutput, bp->framesPerUserBuffer );
 
                 bp->timeInfo->inputBufferAdcTime += bp->framesPerUserBuffer * bp->samplePeriod;
                 bp->timeInfo->outputBufferDacTime += bp->framesPerUserBuffer * bp->samplePeriod;
 
                 bp->framesInTempInputBuffer = 0;
 
-                if( *streamCallbackResult == paAbort )
+                if( userOutputIsHostBuffer )
+                {
+                    for( i=0; i<bp->outputChannelCount; ++i )
+                    {
+                        /* if the callback returned paAbort, we disregard its output */
+                        if( *streamCallbackResult == paAbort )
+                        {
+                            bp->outputZeroer(   hostOutputChannels[i].data,
+                                                hostOutputChannels[i].stride,
+                                                bp->framesPerUserBuffer );
+                        }
+
+                        /* advance dest ptr for next iteration */
+                        hostOutputChannels[i].data = ((unsigned char*)hostOutputChannels[i].data) +
+                                bp->framesPerUserBuffer * hostOutputChannels[i].stride * bp->bytesPerHostOutputSample;
+                    }
+
+                    bp->hostOutputFrameCount[hostOutputBufferIndex] -= bp->framesPerUserBuffer;
+                }
+                else if( *streamCallbackResult == paAbort )
                     bp->framesInTempOutputBuffer = 0;
                 else
                     bp->framesInTempOutputBuffer = bp->framesPerUserBuffer;
@@ -1481,6 +1981,226 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
 }
 
 
+/*
+    The following functions implement PaUtil_EndBufferProcessing() for buffer
+    processors which convert the sample rate, see
+    PaUtil_InitializeBufferProcessorSampleRateConverter(). All of the host
+    buffers are always consumed or filled.
+*/
+
+static void SampleRateConverterDiscardInput( PaUtilBufferProcessor *bp, unsigned long frameCount )
+{
+    struct PaUtilSampleRateConverter *src = bp->sampleRateConverter;
+
+    memmove( src->inputFifo, src->inputFifo + frameCount * bp->inputChannelCount,
+            sizeof(float) * (src->inputFifoFrameCount - frameCount) * bp->inputChannelCount );
+    src->inputFifoFrameCount -= frameCount;
+}
+
+
+/* Call the stream callback with a block from the input fifo, and queue its output */
+static void SampleRateConvertingProcessBlock( PaUtilBufferProcessor *bp, int *streamCallbackResult )
+{
+    struct PaUtilSampleRateConverter *src = bp->sampleRateConverter;
+    PaUtilBufferProcessor *userBp = &src->userBufferProcessor;
+    PaStreamCallbackTimeInfo timeInfo = src->timeInfo; /* modified by userBp */
+
+    if( bp->inputChannelCount > 0 )
+    {
+        if( src->inputFifoFrameCount < src->framesPerBlock )
+        {
+            memset( src->inputFifo + src->inputFifoFrameCount * bp->inputChannelCount, 0,
+                    sizeof(float) * (src->framesPerBlock - src->inputFifoFrameCount) * bp->inputChannelCount );
+            src->inputFifoFrameCount = src->framesPerBlock;
+            src->callbackStatusFlags |= paInputUnderflow;
+        }
+
+        PaUtil_BeginBufferProcessing( userBp, &timeInfo, src->callbackStatusFlags );
+        PaUtil_SetInputFrameCount( userBp, src->framesPerBlock );
+        PaUtil_SetInterleavedInputChannels( userBp, 0, src->inputFifo, 0 );
+    }
+    else
+    {
+        PaUtil_BeginBufferProcessing( userBp, &timeInfo, src->callbackStatusFlags );
+    }
+
+    if( bp->outputChannelCount > 0 )
+    {
+        PaUtil_SetOutputFrameCount( userBp, src->framesPerBlock );
+        PaUtil_SetInterleavedOutputChannels( userBp, 0, src->outputFifo, 0 );
+    }
+
+    PaUtil_EndBufferProcessing( userBp, streamCallbackResult );
+
+    src->callbackStatusFlags = 0;
+
+    if( bp->inputChannelCount > 0 )
+        SampleRateConverterDiscardInput( bp, src->framesPerBlock );
+
+    src->outputFifoReadIndex = 0;
+    src->outputFifoFrameCount = (bp->outputChannelCount > 0) ? src->framesPerBlock : 0;
+
+    src->timeInfo.inputBufferAdcTime += src->framesPerBlock * bp->samplePeriod;
+    src->timeInfo.outputBufferDacTime += src->framesPerBlock * bp->samplePeriod;
+}
+
+
+/* Resample host input and append it to the input fifo. hostInputChannels may
+    be NULL, in which case silence is queued. */
+static void SampleRateConvertInput( PaUtilBufferProcessor *bp,
+        PaUtilChannelDescriptor *hostInputChannels, unsigned long frameCount )
+{
+    struct PaUtilSampleRateConverter *src = bp->sampleRateConverter;
+    unsigned int channelCount = bp->inputChannelCount;
+    unsigned long framesDone = 0;
+    unsigned int i;
+
+    while( framesDone < frameCount )
+    {
+        unsigned long framesToConvert =
+                PA_MIN_( frameCount - framesDone, PA_FRAMES_PER_SAMPLE_RATE_CONVERSION_BUFFER_ );
+        unsigned long framesResampled = 0;
+
+        if( hostInputChannels )
+        {
+            for( i = 0; i < channelCount; ++i )
+            {
+                unsigned char *hostSamples = (unsigned char*)hostInputChannels[i].data
+                        + framesDone * hostInputChannels[i].stride * bp->bytesPerHostInputSample;
+
+                src->inputConverter( src->inputConversionBuffer + i, channelCount,
+                        hostSamples, hostInputChannels[i].stride,
+                        framesToConvert, &bp->ditherGenerator );
+            }
+        }
+        else
+        {
+            memset( src->inputConversionBuffer, 0, sizeof(float) * framesToConvert * channelCount );
+        }
+
+        while( framesResampled < framesToConvert )
+        {
+            unsigned long framesConsumed = framesToConvert - framesResampled;
+
+            if( src->inputFifoFrameCount == src->inputFifoCapacity )
+            {
+                /* the stream callback isn't being called, drop the oldest block */
+                SampleRateConverterDiscardInput( bp, src->framesPerBlock );
+                src->callbackStatusFlags |= paInputOverflow;
+            }
+
+            src->inputFifoFrameCount += PaUtil_Resample( &src->inputResampler,
+                    src->inputConversionBuffer + framesResampled * channelCount, &framesConsumed,
+                    src->inputFifo + src->inputFifoFrameCount * channelCount,
+                    src->inputFifoCapacity - src->inputFifoFrameCount );
+            framesResampled += framesConsumed;
+        }
+
+        framesDone += framesToConvert;
+    }
+}
+
+
+/* Fill host output with resampled output from the stream callback, calling it
+    when the output fifo runs empty. hostOutputChannels may be NULL, in which
+    case the output is discarded. */
+static void SampleRateConvertOutput( PaUtilBufferProcessor *bp, int *streamCallbackResult,
+        PaUtilChannelDescriptor *hostOutputChannels, unsigned long frameCount )
+{
+    struct PaUtilSampleRateConverter *src = bp->sampleRateConverter;
+    unsigned int channelCount = bp->outputChannelCount;
+    unsigned long framesDone = 0;
+    unsigned int i;
+
+    while( framesDone < frameCount )
+    {
+        unsigned long framesToConvert =
+                PA_MIN_( frameCount - framesDone, PA_FRAMES_PER_SAMPLE_RATE_CONVERSION_BUFFER_ );
+        unsigned long framesResampled = 0;
+
+        while( framesResampled < framesToConvert )
+        {
+            unsigned long framesConsumed;
+
+            if( src->outputFifoFrameCount == 0 )
+                SampleRateConvertingProcessBlock( bp, streamCallbackResult );
+
+            framesConsumed = src->outputFifoFrameCount;
+            framesResampled += PaUtil_Resample( &src->outputResampler,
+                    src->outputFifo + src->outputFifoReadIndex * channelCount, &framesConsumed,
+                    src->outputConversionBuffer + framesResampled * channelCount,
+                    framesToConvert - framesResampled );
+            src->outputFifoReadIndex += framesConsumed;
+            src->outputFifoFrameCount -= framesConsumed;
+        }
+
+        if( hostOutputChannels )
+        {
+            for( i = 0; i < channelCount; ++i )
+            {
+                unsigned char *hostSamples = (unsigned char*)hostOutputChannels[i].data
+                        + framesDone * hostOutputChannels[i].stride * bp->bytesPerHostOutputSample;
+
+                src->outputConverter( hostSamples, hostOutputChannels[i].stride,
+                        src->outputConversionBuffer + i, channelCount,
+                        framesToConvert, &bp->ditherGenerator );
+            }
+        }
+
+        framesDone += framesToConvert;
+    }
+}
+
+
+static unsigned long SampleRateConvertingProcess( PaUtilBufferProcessor *bp, int *streamCallbackResult )
+{
+    struct PaUtilSampleRateConverter *src = bp->sampleRateConverter;
+    unsigned long framesProcessed = 0;
+    int i;
+
+    if( bp->inputChannelCount != 0 )
+    {
+        if( !bp->hostInputChannels[0][0].data )
+        {
+            /* no input was supplied (see PaUtil_SetNoInput), only valid for full duplex */
+            SampleRateConvertInput( bp, 0, bp->hostOutputFrameCount[0] + bp->hostOutputFrameCount[1] );
+        }
+        else
+        {
+            for( i = 0; i < 2; ++i )
+            {
+                if( bp->hostInputFrameCount[i] > 0 )
+                    SampleRateConvertInput( bp, bp->hostInputChannels[i], bp->hostInputFrameCount[i] );
+            }
+        }
+
+        framesProcessed = bp->hostInputFrameCount[0] + bp->hostInputFrameCount[1];
+    }
+
+    if( bp->outputChannelCount != 0 )
+    {
+        for( i = 0; i < 2; ++i )
+        {
+            if( bp->hostOutputFrameCount[i] > 0 )
+            {
+                SampleRateConvertOutput( bp, streamCallbackResult,
+                        bp->hostOutputChannels[0][0].data ? bp->hostOutputChannels[i] : 0,
+                        bp->hostOutputFrameCount[i] );
+            }
+        }
+
+        framesProcessed = bp->hostOutputFrameCount[0] + bp->hostOutputFrameCount[1];
+    }
+    else
+    {
+        while( src->inputFifoFrameCount >= src->framesPerBlock )
+            SampleRateConvertingProcessBlock( bp, streamCallbackResult );
+    }
+
+    return framesProcessed;
+}
+
+
 unsigned long PaUtil_EndBufferProcessing( PaUtilBufferProcessor* bp, int *streamCallbackResult )
 {
     unsigned long framesToProcess, framesToGo;
@@ -1498,7 +2218,11 @@ unsigned long PaUtil_EndBufferProcessing( PaUtilBufferProcessor* bp, int *stream
             || *streamCallbackResult == paComplete
             || *streamCallbackResult == paAbort ); /* don't forget to pass in a valid callback result value */
 
-    if( bp->useNonAdaptingProcess )
+    if( bp->sampleRateConverter )
+    {
+        framesProcessed = SampleRateConvertingProcess( bp, streamCallbackResult );
+    }
+    else if( bp->useNonAdaptingProcess )
     {
         if( bp->inputChannelCount != 0 && bp->outputChannelCount != 0 )
         {
@@ -1655,6 +2379,9 @@ unsigned long PaUtil_EndBufferProcessing( PaUtilBufferProcessor* bp, int *stream
 
 int PaUtil_IsBufferProcessorOutputEmpty( PaUtilBufferProcessor* bp )
 {
+    if( bp->sampleRateConverter )
+        return (bp->sampleRateConverter->outputFifoFrameCount) ? 0 : 1;
+
     return (bp->framesInTempOutputBuffer) ? 0 : 1;
 } 
 
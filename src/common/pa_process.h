@@ -310,6 +310,21 @@ typedef struct {
 
     PaStreamCallback *streamCallback;
     void *userData;
+
+    PaSampleFormat hostInputSampleFormat;
+    PaSampleFormat userInputSampleFormat;
+    PaSampleFormat hostOutputSampleFormat;
+    PaSampleFormat userOutputSampleFormat;
+    PaStreamFlags streamFlags;
+
+    struct PaUtilSampleRateConverter *sampleRateConverter; /**< NULL unless the host buffers are at a different
+                                                                sample rate than the user buffers, see
+                                                                PaUtil_InitializeBufferProcessorSampleRateConverter()
+                                                                */
+    struct PaUtilCallbackProfiler *callbackProfiler; /**< NULL unless the stream was opened with paProfileCallback.
+                                                         host APIs publish it as
+                                                         PaUtilStreamRepresentation::callbackProfiler
+                                                         */
 } PaUtilBufferProcessor;
 
 
@@ -397,6 +412,34 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bufferProcessor
 void PaUtil_TerminateBufferProcessor( PaUtilBufferProcessor* bufferProcessor );
 
 
+/** Make a buffer processor convert between the host sample rate and the
+ sample rate it was initialized with, which is the rate at which the stream
+ callback is called. Intended for host APIs whose devices don't support the
+ sample rate requested by the user, for streams opened with the
+ paConvertSampleRate flag.
+
+ Host buffers are passed to the buffer processor in the usual way, with frame
+ counts at the host sample rate. The quality of the conversion is selected with
+ the paSampleRateConversionFast and paSampleRateConversionBest stream flags.
+ Once this function has succeeded the latencies returned by
+ PaUtil_GetBufferProcessorInputLatencyFrames() and
+ PaUtil_GetBufferProcessorOutputLatencyFrames() include the converter's delay.
+
+ Must be called immediately after PaUtil_InitializeBufferProcessor. The
+ converter is freed by PaUtil_TerminateBufferProcessor.
+
+ @param bufferProcessor The buffer processor.
+
+ @param hostSampleRate The sample rate of the host buffers.
+
+ @return paInvalidFlag for blocking streams, which are not supported,
+ paInsufficientMemory if memory couldn't be allocated, otherwise paNoError.
+ If an error is returned the buffer processor is unchanged.
+*/
+PaError PaUtil_InitializeBufferProcessorSampleRateConverter( PaUtilBufferProcessor* bufferProcessor,
+            double hostSampleRate );
+
+
 /** Clear any internally buffered data. If you call
  PaUtil_InitializeBufferProcessor in your OpenStream routine, make sure you
  call PaUtil_ResetBufferProcessor in your StartStream call.
@@ -406,7 +449,8 @@ void PaUtil_TerminateBufferProcessor( PaUtilBufferProcessor* bufferProcessor );
 void PaUtil_ResetBufferProcessor( PaUtilBufferProcessor* bufferProcessor );
 
 
-/** Retrieve the input latency of a buffer processor, in frames.
+/** Retrieve the input latency of a buffer processor, in frames at the user
+ sample rate.
 
  @param bufferProcessor The buffer processor examine.
 
@@ -416,7 +460,8 @@ void PaUtil_ResetBufferProcessor( PaUtilBufferProcessor* bufferProcessor );
 */
 unsigned long PaUtil_GetBufferProcessorInputLatencyFrames( PaUtilBufferProcessor* bufferProcessor );
 
-/** Retrieve the output latency of a buffer processor, in frames.
+/** Retrieve the output latency of a buffer processor, in frames at the user
+ sample rate.
 
  @param bufferProcessor The buffer processor examine.
 
@@ -0,0 +1,344 @@
+/*
+ * $Id$
+ * Portable Audio I/O Library sample rate converter
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Phil Burk, Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Polyphase sample rate converter implementation.
+
+ Output frame n is computed at position n*step in the input, where step is
+ the ratio of the input and output sample rates. Each output frame is the
+ inner product of tapCount input frames around that position with a
+ subfilter selected, and interpolated, by the fractional part of the
+ position. When downsampling the filter cutoff is lowered, and the filter
+ lengthened, accordingly.
+*/
+
+#include <string.h>
+#include <math.h>
+
+#include "pa_resampler.h"
+#include "pa_util.h"
+
+#if !defined(PA_RESAMPLER_NO_SIMD)
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PA_RESAMPLER_USE_SSE_
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PA_RESAMPLER_USE_NEON_
+#endif
+#endif
+
+
+#ifndef M_PI
+#define M_PI (3.14159265358979323846)
+#endif
+
+/* history capacity beyond that needed to compute one output frame */
+#define PA_RESAMPLER_BLOCK_FRAMES_  (256)
+
+
+typedef struct{
+    int tapCount;
+    int phaseCount;
+    double kaiserBeta;
+    double rolloff;     /* cutoff relative to the lower Nyquist frequency */
+}PaUtilResamplerFilterSpec;
+
+static const PaUtilResamplerFilterSpec filterSpecs_[] = {
+    {  8,  64, 5.0, 0.80 },    /* paUtilResamplerQualityFast */
+    { 24, 128, 7.5, 0.90 },    /* paUtilResamplerQualityMedium */
+    { 64, 256, 9.5, 0.95 }     /* paUtilResamplerQualityBest */
+};
+
+
+/* zeroth order modified Bessel function of the first kind */
+static double BesselI0( double x )
+{
+    double sum = 1., term = 1., halfX = x / 2.;
+    int k;
+
+    for( k = 1; k < 50; ++k )
+    {
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+        if( term < sum * 1e-12 )
+            break;
+    }
+    return sum;
+}
+
+
+static void DesignFilter( PaUtilResampler *r, double cutoff, double kaiserBeta )
+{
+    int halfTapCount = r->tapCount / 2;
+    double i0Beta = BesselI0( kaiserBeta );
+    int phase, tap;
+
+    for( phase = 0; phase <= r->phaseCount; ++phase )
+    {
+        float *subfilter = r->filter + phase * r->tapCount;
+        double fraction = (double)phase / r->phaseCount;
+        double sum = 0.;
+
+        for( tap = 0; tap < r->tapCount; ++tap )
+        {
+            /* distance between this tap and the output position, in input frames */
+            double x = tap - (halfTapCount - 1) - fraction;
+            double u = x / halfTapCount;
+            double window = (u <= -1. || u >= 1.) ? 0. : BesselI0( kaiserBeta * sqrt( 1. - u * u ) ) / i0Beta;
+            double sinc = (x == 0.) ? 1. : sin( M_PI * cutoff * x ) / (M_PI * cutoff * x);
+            double h = cutoff * sinc * window;
+
+            subfilter[tap] = (float)h;
+            sum += h;
+        }
+
+        /* normalize to unity gain at DC */
+        for( tap = 0; tap < r->tapCount; ++tap )
+            subfilter[tap] = (float)(subfilter[tap] / sum);
+    }
+}
+
+
+PaError PaUtil_InitializeResampler( PaUtilResampler *r, int channelCount,
+        double inputSampleRate, double outputSampleRate, PaUtilResamplerQuality quality )
+{
+    PaError result = paNoError;
+    const PaUtilResamplerFilterSpec *spec = &filterSpecs_[ quality ];
+    double cutoff;
+
+    r->filter = 0;
+    r->coefficients = 0;
+    r->history = 0;
+
+    r->channelCount = channelCount;
+    r->phaseCount = spec->phaseCount;
+    r->step = inputSampleRate / outputSampleRate;
+
+    /* when downsampling the filter is stretched to keep its transition band
+        relative to the output rate, rounded up to a multiple of 4 taps */
+    r->tapCount = spec->tapCount;
+    if( r->step > 1. )
+        r->tapCount = (((int)ceil( spec->tapCount * r->step ) + 3) / 4) * 4;
+    r->historyCapacity = r->tapCount + 2 * (unsigned long)ceil( r->step ) + PA_RESAMPLER_BLOCK_FRAMES_;
+
+    r->filter = (float*)PaUtil_AllocateBufferMemory(
+            sizeof(float) * r->tapCount * (r->phaseCount + 1), paUtilPrefaultBufferMemory );
+    r->coefficients = (float*)PaUtil_AllocateBufferMemory(
+            sizeof(float) * r->tapCount, paUtilPrefaultBufferMemory );
+    r->history = (float*)PaUtil_AllocateBufferMemory(
+            sizeof(float) * r->historyCapacity * channelCount, paUtilPrefaultBufferMemory );
+    if( !r->filter || !r->coefficients || !r->history )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+
+    cutoff = spec->rolloff * ((outputSampleRate < inputSampleRate) ? outputSampleRate / inputSampleRate : 1.);
+    DesignFilter( r, cutoff, spec->kaiserBeta );
+
+    PaUtil_ResetResampler( r );
+
+    return result;
+
+error:
+    PaUtil_TerminateResampler( r );
+    return result;
+}
+
+
+void PaUtil_TerminateResampler( PaUtilResampler *r )
+{
+    if( r->filter )
+        PaUtil_FreeBufferMemory( r->filter );
+    if( r->coefficients )
+        PaUtil_FreeBufferMemory( r->coefficients );
+    if( r->history )
+        PaUtil_FreeBufferMemory( r->history );
+
+    r->filter = 0;
+    r->coefficients = 0;
+    r->history = 0;
+}
+
+
+void PaUtil_ResetResampler( PaUtilResampler *r )
+{
+    /* start with enough silence in the history for the first input frame to
+        be centered under the filter */
+    memset( r->history, 0, sizeof(float) * r->historyCapacity * r->channelCount );
+    r->historyFrameCount = r->tapCount / 2 - 1;
+    r->position = (double)r->historyFrameCount;
+}
+
+
+unsigned long PaUtil_GetResamplerLatencyFrames( PaUtilResampler *r )
+{
+    /* the filter looks ahead half its length */
+    return (unsigned long)ceil( (r->tapCount / 2) / r->step );
+}
+
+
+static float DotProduct( const float *a, const float *b, int count )
+{
+#if defined(PA_RESAMPLER_USE_SSE_)
+    __m128 sum = _mm_setzero_ps();
+    float result[4];
+    int i;
+
+    /* tapCount is always a multiple of 4 */
+    for( i = 0; i < count; i += 4 )
+        sum = _mm_add_ps( sum, _mm_mul_ps( _mm_loadu_ps( a + i ), _mm_loadu_ps( b + i ) ) );
+    _mm_storeu_ps( result, sum );
+    return result[0] + result[1] + result[2] + result[3];
+
+#elif defined(PA_RESAMPLER_USE_NEON_)
+    float32x4_t sum = vdupq_n_f32( 0.f );
+    float32x2_t pair;
+    int i;
+
+    for( i = 0; i < count; i += 4 )
+        sum = vmlaq_f32( sum, vld1q_f32( a + i ), vld1q_f32( b + i ) );
+    pair = vadd_f32( vget_low_f32( sum ), vget_high_f32( sum ) );
+    return vget_lane_f32( vpadd_f32( pair, pair ), 0 );
+
+#else
+    float sum = 0.f;
+    int i;
+
+    for( i = 0; i < count; ++i )
+        sum += a[i] * b[i];
+    return sum;
+#endif
+}
+
+
+/* discard history frames which are no longer needed, and append as much
+    input as fits. returns the number of input frames appended. */
+static unsigned long RefillHistory( PaUtilResampler *r, const float *input, unsigned long frameCount )
+{
+    unsigned long firstNeeded = (unsigned long)r->position - (r->tapCount / 2 - 1);
+    unsigned long i;
+    int c;
+
+    if( firstNeeded > r->historyFrameCount )
+        firstNeeded = r->historyFrameCount;
+
+    if( firstNeeded > 0 )
+    {
+        for( c = 0; c < r->channelCount; ++c )
+        {
+            float *channelHistory = r->history + c * r->historyCapacity;
+            memmove( channelHistory, channelHistory + firstNeeded,
+                    sizeof(float) * (r->historyFrameCount - firstNeeded) );
+        }
+        r->historyFrameCount -= firstNeeded;
+        r->position -= firstNeeded;
+    }
+
+    if( frameCount > r->historyCapacity - r->historyFrameCount )
+        frameCount = r->historyCapacity - r->historyFrameCount;
+
+    /* deinterleave into the per channel history */
+    for( c = 0; c < r->channelCount; ++c )
+    {
+        float *dest = r->history + c * r->historyCapacity + r->historyFrameCount;
+        const float *src = input + c;
+
+        for( i = 0; i < frameCount; ++i )
+        {
+            *dest++ = *src;
+            src += r->channelCount;
+        }
+    }
+    r->historyFrameCount += frameCount;
+
+    return frameCount;
+}
+
+
+unsigned long PaUtil_Resample( PaUtilResampler *r,
+        const float *input, unsigned long *inputFrameCount,
+        float *output, unsigned long outputFrameCount )
+{
+    const unsigned long halfTapCount = r->tapCount / 2;
+    unsigned long framesConsumed = 0, framesProduced = 0;
+    int c, tap;
+
+    while( framesProduced < outputFrameCount )
+    {
+        unsigned long index = (unsigned long)r->position;
+        const float *subfilter;
+        double phase;
+        float fraction;
+        int phaseIndex;
+
+        if( index + halfTapCount + 1 > r->historyFrameCount )
+        {
+            /* the filter extends beyond the history, more input is needed */
+            if( framesConsumed == *inputFrameCount )
+                break;
+
+            framesConsumed += RefillHistory( r, input + framesConsumed * r->channelCount,
+                    *inputFrameCount - framesConsumed );
+            continue;
+        }
+
+        /* interpolate between the two nearest subfilters */
+        phase = (r->position - index) * r->phaseCount;
+        phaseIndex = (int)phase;
+        fraction = (float)(phase - phaseIndex);
+        subfilter = r->filter + phaseIndex * r->tapCount;
+        for( tap = 0; tap < r->tapCount; ++tap )
+            r->coefficients[tap] = subfilter[tap] + fraction * (subfilter[tap + r->tapCount] - subfilter[tap]);
+
+        for( c = 0; c < r->channelCount; ++c )
+        {
+            *output++ = DotProduct( r->history + c * r->historyCapacity + index - (halfTapCount - 1),
+                    r->coefficients, r->tapCount );
+        }
+
+        ++framesProduced;
+        r->position += r->step;
+    }
+
+    *inputFrameCount = framesConsumed;
+    return framesProduced;
+}
@@ -0,0 +1,146 @@
+#ifndef PA_RESAMPLER_H
+#define PA_RESAMPLER_H
+/*
+ * $Id$
+ * Portable Audio I/O Library sample rate converter
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Phil Burk, Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Polyphase sample rate converter used by the buffer processor.
+
+ The resampler converts interleaved float samples between two arbitrary
+ sample rates. It uses a windowed sinc filter, stored as a table of
+ polyphase subfilters; coefficients for fractional positions between two
+ subfilters are linearly interpolated.
+
+ The inner product is computed with SSE or NEON when the compiler targets
+ those instruction sets, unless PA_RESAMPLER_NO_SIMD is defined.
+*/
+
+
+#include "portaudio.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/** @brief Quality levels trading filter length against CPU usage. */
+typedef enum {
+    paUtilResamplerQualityFast,     /**< 8 taps, around 50 dB stopband attenuation */
+    paUtilResamplerQualityMedium,   /**< 24 taps, around 75 dB stopband attenuation */
+    paUtilResamplerQualityBest      /**< 64 taps, around 95 dB stopband attenuation */
+}PaUtilResamplerQuality;
+
+
+/** @brief State of a sample rate converter. */
+typedef struct PaUtilResampler{
+    int channelCount;
+    int tapCount;               /**< length of each subfilter, even */
+    int phaseCount;             /**< number of subfilters */
+    float *filter;              /**< (phaseCount + 1) subfilters of tapCount coefficients */
+    float *coefficients;        /**< interpolated subfilter for the current output frame */
+
+    float *history;             /**< channelCount buffers of historyCapacity input samples */
+    unsigned long historyCapacity;
+    unsigned long historyFrameCount;
+
+    double position;            /**< position of the next output frame in history, in input frames */
+    double step;                /**< input frames per output frame */
+}PaUtilResampler;
+
+
+/** Initialize a resampler.
+
+ @param resampler The resampler to initialize.
+
+ @param channelCount The number of interleaved channels to convert.
+
+ @param inputSampleRate The sample rate of the input.
+
+ @param outputSampleRate The sample rate of the output.
+
+ @param quality The filter quality.
+
+ @return paInsufficientMemory if the filter or history couldn't be allocated,
+ otherwise paNoError.
+*/
+PaError PaUtil_InitializeResampler( PaUtilResampler *resampler, int channelCount,
+        double inputSampleRate, double outputSampleRate, PaUtilResamplerQuality quality );
+
+
+/** Free the memory held by a resampler. */
+void PaUtil_TerminateResampler( PaUtilResampler *resampler );
+
+
+/** Discard the resampler's history, so that it starts out with silence. */
+void PaUtil_ResetResampler( PaUtilResampler *resampler );
+
+
+/** Retrieve the delay introduced by the resampler, in output frames. */
+unsigned long PaUtil_GetResamplerLatencyFrames( PaUtilResampler *resampler );
+
+
+/** Convert input frames into output frames.
+
+ Conversion stops when either outputFrameCount frames have been produced, or
+ all input has been consumed. Input that has been consumed is held in the
+ resampler's history, so the caller may discard it.
+
+ @param input Interleaved input samples.
+
+ @param inputFrameCount On entry the number of frames in input, on exit the
+ number of frames consumed.
+
+ @param output Buffer receiving interleaved output samples.
+
+ @param outputFrameCount The maximum number of frames to produce.
+
+ @return The number of frames produced.
+*/
+unsigned long PaUtil_Resample( PaUtilResampler *resampler,
+        const float *input, unsigned long *inputFrameCount,
+        float *output, unsigned long outputFrameCount );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_RESAMPLER_H */
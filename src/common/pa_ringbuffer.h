@@ -64,7 +64,8 @@
 
  The memory area used to store the buffer elements must be allocated by 
  the client prior to calling PaUtil_InitializeRingBuffer() and must outlive
- the use of the ring buffer.
+ the use of the ring buffer. Within PortAudio it should be obtained from
+ PaUtil_AllocateBufferMemory(), which aligns it to a cache line.
  
  @note The ring buffer functions are not normally exposed in the PortAudio libraries. 
  If you want to call them then you will need to add pa_ringbuffer.c to your application source code.
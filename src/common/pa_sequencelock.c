@@ -0,0 +1,85 @@
+/*
+ * $Id$
+ * Portable Audio I/O Library sequence lock
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Phil Burk, Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+
+/** @file
+ @ingroup common_src
+
+ @brief Sequence lock implementation.
+*/
+
+
+#include "pa_sequencelock.h"
+
+#include "pa_memorybarrier.h"
+
+
+void PaUtil_InitializeSequenceLock( PaUtilSequenceLock* lock )
+{
+    lock->sequence = 0;
+}
+
+
+void PaUtil_BeginSequenceLockUpdate( PaUtilSequenceLock* lock )
+{
+    ++lock->sequence;
+    PaUtil_WriteMemoryBarrier();
+}
+
+
+void PaUtil_EndSequenceLockUpdate( PaUtilSequenceLock* lock )
+{
+    PaUtil_WriteMemoryBarrier();
+    ++lock->sequence;
+}
+
+
+unsigned int PaUtil_BeginSequenceLockRead( PaUtilSequenceLock* lock )
+{
+    unsigned int sequence = lock->sequence;
+
+    PaUtil_ReadMemoryBarrier();
+    return sequence;
+}
+
+
+int PaUtil_RetrySequenceLockRead( PaUtilSequenceLock* lock, unsigned int sequence )
+{
+    PaUtil_ReadMemoryBarrier();
+    return (sequence & 1) || sequence != lock->sequence;
+}
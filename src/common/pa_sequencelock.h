@@ -0,0 +1,100 @@
+#ifndef PA_SEQUENCELOCK_H
+#define PA_SEQUENCELOCK_H
+/*
+ * $Id$
+ * Portable Audio I/O Library sequence lock
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Phil Burk, Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+
+/** @file
+ @ingroup common_src
+
+ @brief A sequence lock, which lets readers take a consistent snapshot of
+ data updated by another thread without ever blocking the writer.
+
+ The writer makes the sequence counter odd while it updates the data, and
+ even again when it's done. A reader copies the data, and retries when the
+ counter was odd or changed meanwhile. Readers never block the writer, so the
+ lock is suitable for data which is updated by a real-time thread, or read
+ by one.
+
+ Writers must be serialized by other means, and the data which readers
+ access must remain valid memory while they may access it.
+*/
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+typedef struct PaUtilSequenceLock {
+    volatile unsigned int sequence; /**< odd while an update is in progress */
+} PaUtilSequenceLock;
+
+
+/** Initialize the lock, with no update in progress.
+*/
+void PaUtil_InitializeSequenceLock( PaUtilSequenceLock* lock );
+
+/** Begin an update of the data protected by the lock.
+*/
+void PaUtil_BeginSequenceLockUpdate( PaUtilSequenceLock* lock );
+
+/** End an update begun with PaUtil_BeginSequenceLockUpdate().
+*/
+void PaUtil_EndSequenceLockUpdate( PaUtilSequenceLock* lock );
+
+/** Begin reading the data protected by the lock.
+
+ @return The sequence to pass to PaUtil_RetrySequenceLockRead() once the data
+ has been read.
+*/
+unsigned int PaUtil_BeginSequenceLockRead( PaUtilSequenceLock* lock );
+
+/** Check whether the data read since PaUtil_BeginSequenceLockRead() returned
+ sequence may be inconsistent, because it was updated meanwhile.
+
+ @return Non-zero if the data must be read again.
+*/
+int PaUtil_RetrySequenceLockRead( PaUtilSequenceLock* lock, unsigned int sequence );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_SEQUENCELOCK_H */
@@ -74,6 +74,7 @@ void PaUtil_InitializeStreamInterface( PaUtilStreamInterface *streamInterface,
     streamInterface->Write = Write;
     streamInterface->GetReadAvailable = GetReadAvailable;
     streamInterface->GetWriteAvailable = GetWriteAvailable;
+    streamInterface->StartStreams = 0;
 }
 
 
@@ -83,12 +84,14 @@ void PaUtil_InitializeStreamRepresentation( PaUtilStreamRepresentation *streamRe
         void *userData )
 {
     streamRepresentation->magic = PA_STREAM_MAGIC;
-    streamRepresentation->nextOpenStream = 0;
     streamRepresentation->streamInterface = streamInterface;
     streamRepresentation->streamCallback = streamCallback;
     streamRepresentation->streamFinishedCallback = 0;
 
     streamRepresentation->userData = userData;
+    streamRepresentation->hostApiLock = 0;
+    streamRepresentation->clockEstimator = 0;
+    streamRepresentation->callbackProfiler = 0;
 
     streamRepresentation->streamInfo.inputLatency = 0.;
     streamRepresentation->streamInfo.outputLatency = 0.;
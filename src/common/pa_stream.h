@@ -77,10 +77,19 @@ typedef struct {
     PaError (*Write)( PaStream* stream, const void *buffer, unsigned long frames );
     signed long (*GetReadAvailable)( PaStream* stream );
     signed long (*GetWriteAvailable)( PaStream* stream );
+
+    /** Optional, may be NULL. Start several stopped streams together, as
+     close to simultaneously as the host API allows. Pa_StartStreams() passes
+     all the streams which share the same StartStreams function. On success
+     *startSkew receives the estimated spread of the actual start times, in
+     seconds. On failure none of the streams may be left running.
+    */
+    PaError (*StartStreams)( PaStream **streams, int count, PaTime *startSkew );
 } PaUtilStreamInterface;
 
 
-/** Initialize the fields of a PaUtilStreamInterface structure.
+/** Initialize the fields of a PaUtilStreamInterface structure. The optional
+ fields are set to NULL, host APIs which implement them assign them afterwards.
 */
 void PaUtil_InitializeStreamInterface( PaUtilStreamInterface *streamInterface,
     PaError (*Close)( PaStream* ),
@@ -146,12 +155,14 @@ double PaUtil_DummyGetCpuLoad( PaStream* stream );
 */
 typedef struct PaUtilStreamRepresentation {
     unsigned long magic;    /**< set to PA_STREAM_MAGIC */
-    struct PaUtilStreamRepresentation *nextOpenStream; /**< field used by multi-api code */
     PaUtilStreamInterface *streamInterface;
     PaStreamCallback *streamCallback;
     PaStreamFinishedCallback *streamFinishedCallback;
     void *userData;
     PaStreamInfo streamInfo;
+    struct PaUtilLock *hostApiLock; /**< set by the front end, see PaUtilPrivatePaFrontHostApiInfo */
+    struct PaUtilClockEstimator *clockEstimator; /**< set by host APIs which implement Pa_GetStreamClockInfo(), NULL otherwise */
+    struct PaUtilCallbackProfiler *callbackProfiler; /**< set by host APIs which support paProfileCallback, from their buffer processor */
 } PaUtilStreamRepresentation;
 
 
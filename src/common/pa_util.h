@@ -117,7 +117,12 @@ void PaUtil_SetLastHostErrorInfo( PaHostApiTypeId hostApiType, long errorCode,
  .c file
 */
 
-/** Allocate size bytes, guaranteed to be aligned to a FIXME byte boundary */
+/** Allocate size bytes, aligned as by the C library allocator. Memory which
+ is processed sample by sample, or which must not cause page faults when
+ touched in the callback, should be allocated with PaUtil_AllocateBufferMemory.
+
+ @see PaUtil_AllocateBufferMemory
+*/
 void *PaUtil_AllocateMemory( long size );
 
 
@@ -125,6 +130,53 @@ void *PaUtil_AllocateMemory( long size );
 void PaUtil_FreeMemory( void *block );
 
 
+/** The alignment, in bytes, of blocks returned by PaUtil_AllocateBufferMemory.
+ This is the cache line size of current processors, and suffices for any
+ SIMD load or store.
+*/
+#define PA_BUFFER_MEMORY_ALIGNMENT (64)
+
+
+/** Flags which may be passed to PaUtil_AllocateBufferMemory. */
+typedef unsigned long PaUtilBufferMemoryFlags;
+
+/** Lock the block into physical memory so that it is never paged out. If the
+ process lacks the privilege, or exceeds its limit, the block is returned
+ unlocked.
+*/
+#define paUtilLockBufferMemory      ((PaUtilBufferMemoryFlags) 0x01)
+
+/** Back the block with huge pages where the platform supports them, reducing
+ TLB misses on large buffers. The block is rounded up to a whole number of
+ huge pages, so this should only be requested for large blocks.
+*/
+#define paUtilHugePageBufferMemory  ((PaUtilBufferMemoryFlags) 0x02)
+
+/** Touch every page of the block on allocation, so that the first access in
+ the callback doesn't page fault. The block is filled with zeros.
+*/
+#define paUtilPrefaultBufferMemory  ((PaUtilBufferMemoryFlags) 0x04)
+
+
+/** Allocate size bytes for sample data, aligned to a PA_BUFFER_MEMORY_ALIGNMENT
+ byte boundary. Blocks allocated by this function must be released with
+ PaUtil_FreeBufferMemory, and are counted by
+ PaUtil_CountCurrentlyAllocatedBlocks.
+
+ @param size The number of bytes to allocate.
+
+ @param flags A combination of the paUtil*BufferMemory flags, or 0. Flags
+ which can't be honored on the current platform are ignored.
+
+ @return The block, or NULL if it couldn't be allocated.
+*/
+void *PaUtil_AllocateBufferMemory( long size, PaUtilBufferMemoryFlags flags );
+
+
+/** Release a block allocated with PaUtil_AllocateBufferMemory. block may be NULL */
+void PaUtil_FreeBufferMemory( void *block );
+
+
 /** Return the number of currently allocated blocks. This function can be
  used for detecting memory leaks.
 
@@ -149,6 +201,73 @@ void PaUtil_InitializeClock( void );
 double PaUtil_GetTime( void );
 
 
+/** A mutual exclusion lock. Locks are not recursive.
+
+ @see PaUtil_CreateLock
+*/
+typedef struct PaUtilLock PaUtilLock;
+
+
+/** Create a lock, which must be destroyed with PaUtil_DestroyLock.
+
+ @return paNoError, or paInsufficientMemory if the lock couldn't be created.
+*/
+PaError PaUtil_CreateLock( PaUtilLock **lock );
+
+
+/** Destroy a lock created with PaUtil_CreateLock. lock may be NULL */
+void PaUtil_DestroyLock( PaUtilLock *lock );
+
+
+/** Wait until no other thread holds the lock, and acquire it. */
+void PaUtil_AcquireLock( PaUtilLock *lock );
+
+
+/** Release a lock acquired with PaUtil_AcquireLock. */
+void PaUtil_ReleaseLock( PaUtilLock *lock );
+
+
+/** Acquire the process wide lock which serializes Pa_Initialize() and
+ Pa_Terminate(). Unlike a PaUtilLock it doesn't need to be created. The lock
+ is not recursive.
+*/
+void PaUtil_AcquireInitializationLock( void );
+
+
+/** Release the lock acquired with PaUtil_AcquireInitializationLock. */
+void PaUtil_ReleaseInitializationLock( void );
+
+
+/** A thread which calls a function periodically, for housekeeping which must
+ not disturb the audio threads. It runs at the normal, non real-time,
+ priority of the system even if it is started by a real-time thread.
+
+ @see PaUtil_StartPeriodicThread
+*/
+typedef struct PaUtilPeriodicThread PaUtilPeriodicThread;
+
+/** The function called by a PaUtilPeriodicThread. */
+typedef void PaUtilPeriodicFunction( void *userData );
+
+
+/** Start a thread which calls function every period seconds, until it is
+ stopped with PaUtil_StopPeriodicThread.
+
+ @return paNoError, paInsufficientMemory, or paInternalError if the thread
+ couldn't be created.
+*/
+PaError PaUtil_StartPeriodicThread( PaUtilPeriodicThread **thread,
+        PaUtilPeriodicFunction *function, void *userData, PaTime period );
+
+
+/** Stop a thread started with PaUtil_StartPeriodicThread, waiting for a call
+ of its function in progress to return. thread may be NULL. When called from
+ the function itself it returns without waiting, the function is not called
+ again and the thread releases itself once the function returns.
+*/
+void PaUtil_StopPeriodicThread( PaUtilPeriodicThread *thread );
+
+
 /* void Pa_Sleep( long msec );  must also be implemented in per-platform .c file */
 
 
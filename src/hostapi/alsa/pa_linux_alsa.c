@@ -55,6 +55,7 @@
 
 #include <sys/poll.h>
 #include <string.h> /* strlen() */
+#include <stddef.h> /* offsetof() */
 #include <limits.h>
 #include <math.h>
 #include <pthread.h>
@@ -73,9 +74,12 @@
 #include "pa_hostapi.h"
 #include "pa_stream.h"
 #include "pa_cpuload.h"
+#include "pa_clockestimator.h"
 #include "pa_process.h"
+#include "pa_converters.h"
 #include "pa_endianness.h"
 #include "pa_debugprint.h"
+#include "pa_memorybarrier.h"
 
 #include "pa_linux_alsa.h"
 
@@ -106,6 +110,7 @@ _PA_DEFINE_FUNC(snd_pcm_resume);
 _PA_DEFINE_FUNC(snd_pcm_wait);
 _PA_DEFINE_FUNC(snd_pcm_state);
 _PA_DEFINE_FUNC(snd_pcm_avail_update);
+_PA_DEFINE_FUNC(snd_pcm_htimestamp);
 _PA_DEFINE_FUNC(snd_pcm_areas_silence);
 _PA_DEFINE_FUNC(snd_pcm_mmap_begin);
 _PA_DEFINE_FUNC(snd_pcm_mmap_commit);
@@ -113,6 +118,10 @@ _PA_DEFINE_FUNC(snd_pcm_readi);
 _PA_DEFINE_FUNC(snd_pcm_readn);
 _PA_DEFINE_FUNC(snd_pcm_writei);
 _PA_DEFINE_FUNC(snd_pcm_writen);
+_PA_DEFINE_FUNC(snd_pcm_mmap_readi);
+_PA_DEFINE_FUNC(snd_pcm_mmap_readn);
+_PA_DEFINE_FUNC(snd_pcm_mmap_writei);
+_PA_DEFINE_FUNC(snd_pcm_mmap_writen);
 _PA_DEFINE_FUNC(snd_pcm_drain);
 _PA_DEFINE_FUNC(snd_pcm_recover);
 _PA_DEFINE_FUNC(snd_pcm_drop);
@@ -122,6 +131,7 @@ _PA_DEFINE_FUNC(snd_pcm_poll_descriptors_count);
 _PA_DEFINE_FUNC(snd_pcm_poll_descriptors_revents);
 _PA_DEFINE_FUNC(snd_pcm_format_size);
 _PA_DEFINE_FUNC(snd_pcm_link);
+_PA_DEFINE_FUNC(snd_pcm_unlink);
 _PA_DEFINE_FUNC(snd_pcm_delay);
 
 _PA_DEFINE_FUNC(snd_pcm_hw_params_sizeof);
@@ -387,6 +397,7 @@ static int PaAlsa_LoadLibrary()
     _PA_LOAD_FUNC(snd_pcm_wait);
     _PA_LOAD_FUNC(snd_pcm_state);
     _PA_LOAD_FUNC(snd_pcm_avail_update);
+    _PA_LOAD_FUNC(snd_pcm_htimestamp);
     _PA_LOAD_FUNC(snd_pcm_areas_silence);
     _PA_LOAD_FUNC(snd_pcm_mmap_begin);
     _PA_LOAD_FUNC(snd_pcm_mmap_commit);
@@ -394,6 +405,10 @@ static int PaAlsa_LoadLibrary()
     _PA_LOAD_FUNC(snd_pcm_readn);
     _PA_LOAD_FUNC(snd_pcm_writei);
     _PA_LOAD_FUNC(snd_pcm_writen);
+    _PA_LOAD_FUNC(snd_pcm_mmap_readi);
+    _PA_LOAD_FUNC(snd_pcm_mmap_readn);
+    _PA_LOAD_FUNC(snd_pcm_mmap_writei);
+    _PA_LOAD_FUNC(snd_pcm_mmap_writen);
     _PA_LOAD_FUNC(snd_pcm_drain);
     _PA_LOAD_FUNC(snd_pcm_recover);
     _PA_LOAD_FUNC(snd_pcm_drop);
@@ -403,6 +418,7 @@ static int PaAlsa_LoadLibrary()
     _PA_LOAD_FUNC(snd_pcm_poll_descriptors_revents);
     _PA_LOAD_FUNC(snd_pcm_format_size);
     _PA_LOAD_FUNC(snd_pcm_link);
+    _PA_LOAD_FUNC(snd_pcm_unlink);
     _PA_LOAD_FUNC(snd_pcm_delay);
 
     _PA_LOAD_FUNC(snd_pcm_hw_params_sizeof);
@@ -564,8 +580,8 @@ static void PaAlsa_CloseLibrary()
         int __pa_unsure_error_id;\
         if( UNLIKELY( (__pa_unsure_error_id = (expr)) < 0 ) ) \
         { \
-            /* PaUtil_SetLastHostErrorInfo should only be used in the main thread */ \
-            if( (code) == paUnanticipatedHostError && pthread_equal( pthread_self(), paUnixMainThread) ) \
+            /* the last host error is per thread */ \
+            if( (code) == paUnanticipatedHostError ) \
             { \
                 PaUtil_SetLastHostErrorInfo( paALSA, __pa_unsure_error_id, alsa_snd_strerror( __pa_unsure_error_id ) ); \
             } \
@@ -586,6 +602,8 @@ static void PaAlsa_CloseLibrary()
 
 static int numPeriods_ = 4;
 static int busyRetries_ = 100;
+static int driftCompensation_ = 1;
+static int highResolutionTimestamps_ = 0;
 
 int PaAlsa_SetNumPeriods( int numPeriods )
 {
@@ -621,8 +639,57 @@ typedef struct
     StreamDirection streamDir;
 
     snd_pcm_channel_area_t *channelAreas;  /* Needed for channel adaption */
+    int *channelMap;            /* Host channel of each user channel, NULL if they're the first host channels */
+    int duplicateMono;          /* bool: copy the last user channel to the next host channel, to fill a pair */
+    int *silentChannels;        /* Host output channels that are not written, to be silenced */
+    int numSilentChannels;
+    snd_pcm_uframes_t silentFrames; /* Frames of silentChannels silenced since the pcm was prepared */
+
+    int useHtimestamp;          /* Take timestamps with snd_pcm_htimestamp when querying available frames */
+    int haveTimestamp;          /* bool: are timestamp and delay current? */
+    PaTime timestamp;           /* Time of the last hardware pointer update */
+    snd_pcm_sframes_t delay;    /* Frames between the hardware and application pointers at that time */
+    double framesTransferred;   /* Frames processed since the stream started */
+
+    int directTransfer;         /* bool: blocking transfers can go between the user buffer and ALSA without conversion */
 } PaAlsaStreamComponent;
 
+/* Maximum deviation from the nominal ratio the drift compensator will apply (0.5%) */
+#define PA_ALSA_DRIFT_MAX_CORRECTION_ 0.005
+/* Proportional and integral gains of the drift control loop, with the error expressed in seconds */
+#define PA_ALSA_DRIFT_KP_ 0.1
+#define PA_ALSA_DRIFT_KI_ 0.0025
+/* Smoothing applied to the measured fill level, to suppress the jitter of period sized transfers */
+#define PA_ALSA_DRIFT_SMOOTHING_ 0.05
+/* Frames the interpolator needs to look ahead */
+#define PA_ALSA_DRIFT_MARGIN_ 4
+
+/** Drift compensation for full duplex streams whose capture and playback devices run off different clocks.
+ *
+ * Playback drives the stream. Captured frames are converted to float and queued, and the input handed to the
+ * buffer processor is interpolated from the queue with a variable ratio, steered so that the queue stays at a
+ * constant fill level.
+ */
+typedef struct
+{
+    int enabled;
+    int numChannels;
+    PaUtilConverter *converter;     /* Converts from the capture host format to paFloat32 */
+
+    float *fifo;                    /* Interleaved captured frames */
+    unsigned long fifoCapacity, fifoFrames;
+    float *output;                  /* Interleaved resampled frames, registered with the buffer processor */
+    unsigned long outputCapacity;
+
+    int primed;                     /* Has enough input been queued to start consuming it? */
+    double position;                /* Read position in fifo, in (fractional) frames */
+    double ratio;                   /* Captured frames consumed per played frame */
+    double filteredError, integral;
+    unsigned long targetFrames;     /* Fill level the control loop steers towards */
+
+    int underflow, overflow;        /* To be reported to the callback */
+} PaAlsaDriftCompensator;
+
 /* Implementation specific stream structure */
 typedef struct PaAlsaStream
 {
@@ -637,6 +704,7 @@ typedef struct PaAlsaStream
     int callbackMode;              /* bool: are we running in callback mode? */
     int pcmsSynced;                /* Have we successfully synced pcms */
     int rtSched;
+    int deferPcmStart;             /* bool: prepare only, StartStreams triggers the pcms */
 
     /* the callback thread uses these to poll the sound device(s), waiting
      * for data to be ready/available */
@@ -648,16 +716,70 @@ typedef struct PaAlsaStream
     volatile sig_atomic_t callbackAbort;    /* Drop frames? */
     volatile sig_atomic_t isActive;         /* Is stream in active state? (Between StartStream and StopStream || !paContinue) */
     PaUnixMutex stateMtx;                   /* Used to synchronize access to stream state */
+    PaUnixMutex blockingMtx;                /* Serializes conversions of concurrent blocking reads and writes */
 
     int neverDropInput;
+    int convertSampleRate;         /* bool: resample in the buffer processor if the device doesn't support the rate? */
+    double hostSampleRate;         /* The rate the device(s) actually run at */
 
     PaTime underrun;
     PaTime overrun;
 
     PaAlsaStreamComponent capture, playback;
+    PaAlsaDriftCompensator drift;   /* Used if capture and playback are on different cards */
+    PaUtilClockEstimator clock;     /* Estimates the device clock, for Pa_GetStreamClockInfo */
 }
 PaAlsaStream;
 
+/* Maximum number of streams sharing a device */
+#define PA_ALSA_MAX_SHARED_STREAMS_ 32
+
+struct PaAlsaSharedStream;
+
+/** A device shared by streams opened with paAlsaShareDevice, in one direction.
+ *
+ * The device is opened once, by an internal callback stream with float channels, whose callback mixes the output of
+ * the streams sharing it or passes its input on to them.
+ */
+typedef struct PaAlsaSharedDevice
+{
+    char *name;                     /* ALSA name of the device */
+    StreamDirection streamDir;
+    PaAlsaStream *stream;           /* Drives the device */
+    int numChannels;
+    unsigned long maxFramesPerBuffer;
+    int rtSched;
+
+    PaUnixMutex mtx;                /* Serializes starting and stopping */
+    int numStarted;
+    int numStreams;
+    struct PaAlsaSharedStream * volatile streams[PA_ALSA_MAX_SHARED_STREAMS_];
+
+    volatile int isMixing;          /* bool: is the callback processing the streams? */
+    volatile unsigned long mixCount; /* Incremented after each pass over the streams */
+
+    struct PaAlsaSharedDevice *next;
+}
+PaAlsaSharedDevice;
+
+/** A stream on a shared device. */
+typedef struct PaAlsaSharedStream
+{
+    PaUtilStreamRepresentation streamRepresentation;
+    PaUtilCpuLoadMeasurer cpuLoadMeasurer;
+    PaUtilBufferProcessor bufferProcessor;
+    int hasBufferProcessor;
+
+    PaAlsaSharedDevice *device;
+    int numChannels;
+    int *channelMap;                /* Device channel of each of the stream's channels */
+    float *mixBuffer;               /* Output channels, rendered before they're mixed */
+
+    volatile sig_atomic_t isActive; /* bool: is the stream processed by the device's callback? */
+    int isStarted;
+}
+PaAlsaSharedStream;
+
 /* PaAlsaHostApiRepresentation - host api datastructure specific to this implementation */
 
 typedef struct PaAlsaHostApiRepresentation
@@ -665,6 +787,10 @@ typedef struct PaAlsaHostApiRepresentation
     PaUtilHostApiRepresentation baseHostApiRep;
     PaUtilStreamInterface callbackStreamInterface;
     PaUtilStreamInterface blockingStreamInterface;
+    PaUtilStreamInterface sharedStreamInterface;
+
+    PaAlsaSharedDevice *sharedDevices;
+    PaUnixMutex sharedDevicesMtx;   /* Protects sharedDevices, and the streams of each */
 
     PaUtilAllocationGroup *allocations;
 
@@ -701,6 +827,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                            void *userData );
 static PaError CloseStream( PaStream* stream );
 static PaError StartStream( PaStream *stream );
+static PaError StartStreams( PaStream **streams, int count, PaTime *startSkew );
 static PaError StopStream( PaStream *stream );
 static PaError AbortStream( PaStream *stream );
 static PaError IsStreamStopped( PaStream *s );
@@ -721,6 +848,19 @@ static signed long GetStreamWriteAvailable( PaStream* s );
 static PaError ReadStream( PaStream* stream, void *buffer, unsigned long frames );
 static PaError WriteStream( PaStream* stream, const void *buffer, unsigned long frames );
 
+/* Device sharing prototypes */
+static PaError OpenSharedStream( PaAlsaHostApiRepresentation *alsaApi, PaStream** s,
+        const PaStreamParameters *inputParameters, const PaStreamParameters *outputParameters, double sampleRate,
+        unsigned long framesPerBuffer, PaStreamFlags streamFlags, PaStreamCallback *callback, void *userData );
+static PaError CloseSharedStream( PaStream* stream );
+static PaError StartSharedStream( PaStream *stream );
+static PaError StopSharedStream( PaStream *stream );
+static PaError AbortSharedStream( PaStream *stream );
+static PaError IsSharedStreamStopped( PaStream *s );
+static PaError IsSharedStreamActive( PaStream *stream );
+static PaTime GetSharedStreamTime( PaStream *stream );
+static double GetSharedStreamCpuLoad( PaStream* stream );
+
 
 static const PaAlsaDeviceInfo *GetDeviceInfo( const PaUtilHostApiRepresentation *hostApi, int device )
 {
@@ -783,6 +923,19 @@ PaError PaAlsa_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
                                       GetStreamReadAvailable,
                                       GetStreamWriteAvailable );
 
+    alsaHostApi->callbackStreamInterface.StartStreams = StartStreams;
+    alsaHostApi->blockingStreamInterface.StartStreams = StartStreams;
+
+    PaUtil_InitializeStreamInterface( &alsaHostApi->sharedStreamInterface,
+                                      CloseSharedStream, StartSharedStream,
+                                      StopSharedStream, AbortSharedStream,
+                                      IsSharedStreamStopped, IsSharedStreamActive,
+                                      GetSharedStreamTime, GetSharedStreamCpuLoad,
+                                      PaUtil_DummyRead, PaUtil_DummyWrite,
+                                      PaUtil_DummyGetReadAvailable,
+                                      PaUtil_DummyGetWriteAvailable );
+    PA_ENSURE( PaUnixMutex_Initialize( &alsaHostApi->sharedDevicesMtx ) );
+
     PA_ENSURE( PaUnixThreading_Initialize() );
 
     return result;
@@ -812,6 +965,10 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
     */
     /*snd_lib_error_set_handler(NULL);*/
 
+    /* Streams are closed before the host API is terminated, and devices along with their last stream */
+    assert( !alsaHostApi->sharedDevices );
+    PaUnixMutex_Terminate( &alsaHostApi->sharedDevicesMtx );
+
     if( alsaHostApi->allocations )
     {
         PaUtil_FreeAllAllocations( alsaHostApi->allocations );
@@ -1479,43 +1636,113 @@ error:
     goto end;
 }
 
+/** Get the device name given in the stream parameters' PaAlsaStreamInfo.
+ *
+ * @return NULL if the device is given by the stream parameters' device index.
+ */
+static const char *GetStreamInfoDeviceString( const PaStreamParameters *parameters )
+{
+    const PaAlsaStreamInfo *streamInfo = parameters->hostApiSpecificStreamInfo;
+    return streamInfo ? streamInfo->deviceString : NULL;
+}
+
+/** Get the channel selectors given in the stream parameters' PaAlsaStreamInfo.
+ *
+ * @return NULL if the stream's channels map to the device's first channels.
+ */
+static const int *GetStreamInfoChannelSelectors( const PaStreamParameters *parameters )
+{
+    const PaAlsaStreamInfo *streamInfo = parameters->hostApiSpecificStreamInfo;
+    return streamInfo && streamInfo->version >= 2 && ( streamInfo->flags & paAlsaUseChannelSelectors ) ?
+        streamInfo->channelSelectors : NULL;
+}
+
+/** Does the stream parameters' PaAlsaStreamInfo ask for the device to be shared? */
+static int IsStreamInfoSharingDevice( const PaStreamParameters *parameters )
+{
+    const PaAlsaStreamInfo *streamInfo = parameters->hostApiSpecificStreamInfo;
+    return streamInfo && streamInfo->version >= 2 && ( streamInfo->flags & paAlsaShareDevice );
+}
+
 /* Check against known device capabilities */
 static PaError ValidateParameters( const PaStreamParameters *parameters, PaUtilHostApiRepresentation *hostApi, StreamDirection mode )
 {
     PaError result = paNoError;
-    int maxChans;
+    int maxChans = INT_MAX;
     const PaAlsaDeviceInfo *deviceInfo = NULL;
+    const PaAlsaStreamInfo *streamInfo;
+    const int *channelSelectors;
     assert( parameters );
 
+    if( ( streamInfo = parameters->hostApiSpecificStreamInfo ) )
+    {
+        /* Version 1 structures lack the fields from flags on */
+        PA_UNLESS( ( streamInfo->size == sizeof (PaAlsaStreamInfo) && streamInfo->version == 2 ) ||
+                ( streamInfo->size == offsetof( PaAlsaStreamInfo, flags ) && streamInfo->version == 1 ),
+                paIncompatibleHostApiSpecificStreamInfo );
+    }
+
     if( parameters->device != paUseHostApiSpecificDeviceSpecification )
     {
         assert( parameters->device < hostApi->info.deviceCount );
-        PA_UNLESS( parameters->hostApiSpecificStreamInfo == NULL, paBadIODeviceCombination );
+        PA_UNLESS( GetStreamInfoDeviceString( parameters ) == NULL, paBadIODeviceCombination );
         deviceInfo = GetDeviceInfo( hostApi, parameters->device );
+        maxChans = ( StreamDirection_In == mode ? deviceInfo->baseDeviceInfo.maxInputChannels :
+            deviceInfo->baseDeviceInfo.maxOutputChannels );
+        PA_UNLESS( parameters->channelCount <= maxChans, paInvalidChannelCount );
     }
     else
     {
-        const PaAlsaStreamInfo *streamInfo = parameters->hostApiSpecificStreamInfo;
+        PA_UNLESS( GetStreamInfoDeviceString( parameters ) != NULL, paInvalidDevice );
+        /* We know nothing about the device's channels */
+    }
 
-        PA_UNLESS( parameters->device == paUseHostApiSpecificDeviceSpecification, paInvalidDevice );
-        PA_UNLESS( streamInfo->size == sizeof (PaAlsaStreamInfo) && streamInfo->version == 1,
-                paIncompatibleHostApiSpecificStreamInfo );
-        PA_UNLESS( streamInfo->deviceString != NULL, paInvalidDevice );
+    if( ( channelSelectors = GetStreamInfoChannelSelectors( parameters ) ) )
+    {
+        int i, j;
 
-        /* Skip further checking */
-        return paNoError;
-    }
+        for( i = 0; i < parameters->channelCount; ++i )
+        {
+            PA_UNLESS( channelSelectors[i] >= 0 && channelSelectors[i] < maxChans, paInvalidChannelCount );
 
-    assert( deviceInfo );
-    assert( parameters->hostApiSpecificStreamInfo == NULL );
-    maxChans = ( StreamDirection_In == mode ? deviceInfo->baseDeviceInfo.maxInputChannels :
-        deviceInfo->baseDeviceInfo.maxOutputChannels );
-    PA_UNLESS( parameters->channelCount <= maxChans, paInvalidChannelCount );
+            /* Several stream channels can read a device channel, but not write it */
+            for( j = 0; StreamDirection_Out == mode && j < i; ++j )
+                PA_UNLESS( channelSelectors[j] != channelSelectors[i], paInvalidChannelCount );
+        }
+    }
 
 error:
     return result;
 }
 
+/** Calculate the number of channels to open a device with, for the stream parameters' channels.
+ */
+static int CalculateNumHostChannels( const PaUtilHostApiRepresentation *hostApi, const PaStreamParameters *parameters,
+        StreamDirection streamDir )
+{
+    const int *channelSelectors = GetStreamInfoChannelSelectors( parameters );
+    int numHostChannels = parameters->channelCount;
+    int i;
+
+    if( channelSelectors )
+    {
+        /* Open enough channels to include the highest selected one */
+        numHostChannels = 0;
+        for( i = 0; i < parameters->channelCount; ++i )
+            numHostChannels = PA_MAX( numHostChannels, channelSelectors[i] + 1 );
+    }
+
+    /* We're blissfully unaware of the minimum channelCount of devices given by name */
+    if( !GetStreamInfoDeviceString( parameters ) )
+    {
+        const PaAlsaDeviceInfo *devInfo = GetDeviceInfo( hostApi, parameters->device );
+        numHostChannels = PA_MAX( numHostChannels, StreamDirection_In == streamDir ? devInfo->minInputChannels :
+                devInfo->minOutputChannels );
+    }
+
+    return numHostChannels;
+}
+
 /* Given an open stream, what sample formats are available? */
 static PaSampleFormat GetAvailableFormats( snd_pcm_t *pcm )
 {
@@ -1714,17 +1941,14 @@ static PaError AlsaOpen( const PaUtilHostApiRepresentation *hostApi, const PaStr
 {
     PaError result = paNoError;
     int ret;
-    const char* deviceName = "";
+    const char* deviceName = GetStreamInfoDeviceString( params );
     const PaAlsaDeviceInfo *deviceInfo = NULL;
-    PaAlsaStreamInfo *streamInfo = (PaAlsaStreamInfo *)params->hostApiSpecificStreamInfo;
 
-    if( !streamInfo )
+    if( !deviceName )
     {
         deviceInfo = GetDeviceInfo( hostApi, params->device );
         deviceName = deviceInfo->alsaName;
     }
-    else
-        deviceName = streamInfo->deviceString;
 
     PA_DEBUG(( "%s: Opening device %s\n", __FUNCTION__, deviceName ));
     if( (ret = OpenPcm( pcm, deviceName, streamDir == StreamDirection_In ? SND_PCM_STREAM_CAPTURE : SND_PCM_STREAM_PLAYBACK,
@@ -1750,20 +1974,11 @@ static PaError TestParameters( const PaUtilHostApiRepresentation *hostApi, const
     snd_pcm_t *pcm = NULL;
     PaSampleFormat availableFormats;
     /* We are able to adapt to a number of channels less than what the device supports */
-    unsigned int numHostChannels;
+    unsigned int numHostChannels = CalculateNumHostChannels( hostApi, parameters, streamDir );
     PaSampleFormat hostFormat;
     snd_pcm_hw_params_t *hwParams;
     alsa_snd_pcm_hw_params_alloca( &hwParams );
 
-    if( !parameters->hostApiSpecificStreamInfo )
-    {
-        const PaAlsaDeviceInfo *devInfo = GetDeviceInfo( hostApi, parameters->device );
-        numHostChannels = PA_MAX( parameters->channelCount, StreamDirection_In == streamDir ?
-                devInfo->minInputChannels : devInfo->minOutputChannels );
-    }
-    else
-        numHostChannels = parameters->channelCount;
-
     PA_ENSURE( AlsaOpen( hostApi, parameters, streamDir, &pcm ) );
 
     alsa_snd_pcm_hw_params_any( pcm, hwParams );
@@ -1868,6 +2083,51 @@ error:
 }
 
 
+/** Work out which host channels the user's channels map to, and which host output channels must be silenced.
+ *
+ * Without channel selectors the user channels map to the first host channels. If a mono output has to be opened as a
+ * pair, the user channel is duplicated to both channels of the pair.
+ *
+ * @param channelSelectors Host channel of each user channel, may be NULL.
+ */
+static PaError PaAlsaStreamComponent_InitializeChannelMap( PaAlsaStreamComponent *self, const int *channelSelectors )
+{
+    PaError result = paNoError;
+    int i, j;
+
+    if( channelSelectors )
+    {
+        PA_UNLESS( self->channelMap = (int *)PaUtil_AllocateMemory( sizeof (int) * self->numUserChannels ),
+                paInsufficientMemory );
+        memcpy( self->channelMap, channelSelectors, sizeof (int) * self->numUserChannels );
+    }
+    else
+    {
+        self->duplicateMono = StreamDirection_Out == self->streamDir && self->numHostChannels > self->numUserChannels &&
+            ( self->numHostChannels % 2 ) == 0 && ( self->numUserChannels % 2 ) != 0;
+    }
+
+    if( StreamDirection_In == self->streamDir || self->numHostChannels == self->numUserChannels )
+        goto end;
+
+    PA_UNLESS( self->silentChannels = (int *)PaUtil_AllocateMemory( sizeof (int) * self->numHostChannels ),
+            paInsufficientMemory );
+    for( i = 0; i < self->numHostChannels; ++i )
+    {
+        int isUsed = self->duplicateMono && i == self->numUserChannels;
+
+        for( j = 0; j < self->numUserChannels && !isUsed; ++j )
+            isUsed = ( self->channelMap ? self->channelMap[j] : j ) == i;
+        if( !isUsed )
+            self->silentChannels[self->numSilentChannels++] = i;
+    }
+
+end:
+    return result;
+error:
+    goto end;
+}
+
 static PaError PaAlsaStreamComponent_Initialize( PaAlsaStreamComponent *self, PaAlsaHostApiRepresentation *alsaApi,
         const PaStreamParameters *params, StreamDirection streamDir, int callbackMode )
 {
@@ -1878,20 +2138,20 @@ static PaError PaAlsaStreamComponent_Initialize( PaAlsaStreamComponent *self, Pa
     /* Make sure things have an initial value */
     memset( self, 0, sizeof (PaAlsaStreamComponent) );
 
-    if( NULL == params->hostApiSpecificStreamInfo )
+    /* snd_pcm_htimestamp may be missing if ALSA is loaded dynamically */
+    self->useHtimestamp = highResolutionTimestamps_ && alsa_snd_pcm_htimestamp;
+
+    self->numHostChannels = CalculateNumHostChannels( &alsaApi->baseHostApiRep, params, streamDir );
+    if( NULL == GetStreamInfoDeviceString( params ) )
     {
         const PaAlsaDeviceInfo *devInfo = GetDeviceInfo( &alsaApi->baseHostApiRep, params->device );
-        self->numHostChannels = PA_MAX( params->channelCount, StreamDirection_In == streamDir ? devInfo->minInputChannels
-                : devInfo->minOutputChannels );
         self->deviceIsPlug = devInfo->isPlug;
         PA_DEBUG(( "%s: Host Chans %c %i\n", __FUNCTION__, streamDir == StreamDirection_In ? 'C' : 'P', self->numHostChannels ));
     }
     else
     {
-        /* We're blissfully unaware of the minimum channelCount */
-        self->numHostChannels = params->channelCount;
         /* Check if device name does not start with hw: to determine if it is a 'plug' device */
-        if( strncmp( "hw:", ((PaAlsaStreamInfo *)params->hostApiSpecificStreamInfo)->deviceString, 3 ) != 0  )
+        if( strncmp( "hw:", GetStreamInfoDeviceString( params ), 3 ) != 0  )
             self->deviceIsPlug = 1; /* An Alsa plug device, not a direct hw device */
     }
     if( self->deviceIsPlug && alsaApi->alsaLibVersion < ALSA_VERSION_INT( 1, 0, 16 ) )
@@ -1913,6 +2173,8 @@ static PaError PaAlsaStreamComponent_Initialize( PaAlsaStreamComponent *self, Pa
     self->nonMmapBuffer = NULL;
     self->nonMmapBufferSize = 0;
 
+    PA_ENSURE( PaAlsaStreamComponent_InitializeChannelMap( self, GetStreamInfoChannelSelectors( params ) ) );
+
     if( !callbackMode && !self->userInterleaved )
     {
         /* Pre-allocate non-interleaved user provided buffers */
@@ -1936,7 +2198,9 @@ static void PaAlsaStreamComponent_Terminate( PaAlsaStreamComponent *self )
 {
     alsa_snd_pcm_close( self->pcm );
     PaUtil_FreeMemory( self->userBuffers ); /* (Ptr can be NULL; PaUtil_FreeMemory includes a NULL check) */
-    PaUtil_FreeMemory( self->nonMmapBuffer );
+    PaUtil_FreeBufferMemory( self->nonMmapBuffer );
+    PaUtil_FreeMemory( self->channelMap );
+    PaUtil_FreeMemory( self->silentChannels );
 }
 
 /*
@@ -1951,7 +2215,7 @@ static int nearbyint_(float value) {
  *
  */
 static PaError PaAlsaStreamComponent_InitialConfigure( PaAlsaStreamComponent *self, const PaStreamParameters *params,
-        int primeBuffers, snd_pcm_hw_params_t *hwParams, double *sampleRate )
+        int primeBuffers, int convertSampleRate, snd_pcm_hw_params_t *hwParams, double *sampleRate )
 {
     /* Configuration consists of setting all of ALSA's parameters.
      * These parameters come in two flavors: hardware parameters
@@ -2040,7 +2304,10 @@ static PaError PaAlsaStreamComponent_InitialConfigure( PaAlsaStreamComponent *se
         if( result == paInvalidSampleRate ) /* From the SetApproximateSampleRate() call above */
         { /* The sample rate was returned as 'out of tolerance' of the one requested */
             PA_DEBUG(( "%s: Wanted %.3f, closest sample rate was %.3f\n", __FUNCTION__, sampleRate, sr ));
-            PA_ENSURE( paInvalidSampleRate );
+            /* Unless the buffer processor is to convert from the closest rate */
+            if( !convertSampleRate )
+                PA_ENSURE( paInvalidSampleRate );
+            result = paNoError;
         }
     }
     else
@@ -2154,6 +2421,7 @@ static PaError PaAlsaStream_Initialize( PaAlsaStream *self, PaAlsaHostApiReprese
 
     self->framesPerUserBuffer = framesPerUserBuffer;
     self->neverDropInput = streamFlags & paNeverDropInput;
+    self->convertSampleRate = (streamFlags & paConvertSampleRate) ? 1 : 0;
     /* XXX: Ignore paPrimeOutputBuffersUsingStreamCallback untill buffer priming is fully supported in pa_process.c */
     /*
     if( outParams & streamFlags & paPrimeOutputBuffersUsingStreamCallback )
@@ -2177,11 +2445,86 @@ static PaError PaAlsaStream_Initialize( PaAlsaStream *self, PaAlsaHostApiReprese
 
     PaUtil_InitializeCpuLoadMeasurer( &self->cpuLoadMeasurer, sampleRate );
     ASSERT_CALL_( PaUnixMutex_Initialize( &self->stateMtx ), paNoError );
+    ASSERT_CALL_( PaUnixMutex_Initialize( &self->blockingMtx ), paNoError );
 
 error:
     return result;
 }
 
+/** Set up drift compensation between the capture and playback components.
+ *
+ * Compensation is only engaged if the two pcms belong to different cards, pcms on the same card are assumed to share
+ * a clock even if they can't be linked.
+ *
+ * @param framesPerHostBuffer The maximum number of frames that will be processed in one go.
+ */
+static PaError PaAlsaDriftCompensator_Initialize( PaAlsaDriftCompensator *self, const PaAlsaStreamComponent *capture,
+        const PaAlsaStreamComponent *playback, unsigned long framesPerHostBuffer )
+{
+    PaError result = paNoError;
+    snd_pcm_info_t *pcmInfo;
+    int captureCard, playbackCard;
+
+    memset( self, 0, sizeof (PaAlsaDriftCompensator) );
+
+    alsa_snd_pcm_info_alloca( &pcmInfo );
+    ENSURE_( alsa_snd_pcm_info( capture->pcm, pcmInfo ), paUnanticipatedHostError );
+    captureCard = alsa_snd_pcm_info_get_card( pcmInfo );
+    ENSURE_( alsa_snd_pcm_info( playback->pcm, pcmInfo ), paUnanticipatedHostError );
+    playbackCard = alsa_snd_pcm_info_get_card( pcmInfo );
+    if( captureCard == playbackCard )
+        goto end;
+
+    PA_UNLESS( self->converter = PaUtil_SelectConverter( capture->hostSampleFormat, paFloat32, paClipOff | paDitherOff ),
+            paSampleFormatNotSupported );
+
+    self->numChannels = capture->numUserChannels;
+    /* Captured frames arrive a period at a time, while playback may consume up to a host buffer at a time */
+    self->targetFrames = capture->framesPerPeriod + PA_MAX( playback->framesPerPeriod, framesPerHostBuffer ) +
+        PA_ALSA_DRIFT_MARGIN_;
+    self->fifoCapacity = 2 * self->targetFrames + capture->alsaBufferSize;
+    self->outputCapacity = framesPerHostBuffer;
+
+    PA_UNLESS( self->fifo = (float *)PaUtil_AllocateBufferMemory( self->fifoCapacity * self->numChannels * sizeof (float),
+                paUtilPrefaultBufferMemory ), paInsufficientMemory );
+    PA_UNLESS( self->output = (float *)PaUtil_AllocateBufferMemory( self->outputCapacity * self->numChannels * sizeof (float),
+                paUtilPrefaultBufferMemory ), paInsufficientMemory );
+
+    self->ratio = 1.0;
+    self->position = 1.0;
+    self->enabled = 1;
+    PA_DEBUG(( "%s: Compensating drift between cards %d and %d, target fill: %lu frames\n", __FUNCTION__,
+                captureCard, playbackCard, self->targetFrames ));
+
+end:
+    return result;
+
+error:
+    PaUtil_FreeBufferMemory( self->fifo );
+    self->fifo = NULL;
+    goto end;
+}
+
+static void PaAlsaDriftCompensator_Terminate( PaAlsaDriftCompensator *self )
+{
+    PaUtil_FreeBufferMemory( self->fifo );
+    PaUtil_FreeBufferMemory( self->output );
+    self->fifo = self->output = NULL;
+}
+
+/** Discard queued input, e.g. when (re)starting the stream.
+ *
+ * The estimated ratio is kept, since it reflects the devices' clocks rather than the stream state.
+ */
+static void PaAlsaDriftCompensator_Reset( PaAlsaDriftCompensator *self )
+{
+    self->fifoFrames = 0;
+    self->position = 1.0;
+    self->primed = 0;
+    self->filteredError = 0.0;
+    self->underflow = self->overflow = 0;
+}
+
 /** Free resources associated with stream, and eventually stream itself.
  *
  * Frees allocated memory, and terminates individual StreamComponents.
@@ -2199,8 +2542,11 @@ static void PaAlsaStream_Terminate( PaAlsaStream *self )
         PaAlsaStreamComponent_Terminate( &self->playback );
     }
 
+    PaAlsaDriftCompensator_Terminate( &self->drift );
+
     PaUtil_FreeMemory( self->pfds );
     ASSERT_CALL_( PaUnixMutex_Terminate( &self->stateMtx ), paNoError );
+    ASSERT_CALL_( PaUnixMutex_Terminate( &self->blockingMtx ), paNoError );
 
     PaUtil_FreeMemory( self );
 }
@@ -2212,9 +2558,9 @@ static void PaAlsaStream_Terminate( PaAlsaStream *self )
  */
 static int CalculatePollTimeout( const PaAlsaStream *stream, unsigned long frames )
 {
-    assert( stream->streamRepresentation.streamInfo.sampleRate > 0.0 );
+    assert( stream->hostSampleRate > 0.0 );
     /* Period in msecs, rounded up */
-    return (int)ceil( 1000 * frames / stream->streamRepresentation.streamInfo.sampleRate );
+    return (int)ceil( 1000 * frames / stream->hostSampleRate );
 }
 
 /** Align value in backward direction.
@@ -2710,11 +3056,11 @@ static PaError PaAlsaStream_Configure( PaAlsaStream *self, const PaStreamParamet
     alsa_snd_pcm_hw_params_alloca( &hwParamsPlayback );
 
     if( self->capture.pcm )
-        PA_ENSURE( PaAlsaStreamComponent_InitialConfigure( &self->capture, inParams, self->primeBuffers, hwParamsCapture,
-                    &realSr ) );
+        PA_ENSURE( PaAlsaStreamComponent_InitialConfigure( &self->capture, inParams, self->primeBuffers,
+                    self->convertSampleRate, hwParamsCapture, &realSr ) );
     if( self->playback.pcm )
-        PA_ENSURE( PaAlsaStreamComponent_InitialConfigure( &self->playback, outParams, self->primeBuffers, hwParamsPlayback,
-                    &realSr ) );
+        PA_ENSURE( PaAlsaStreamComponent_InitialConfigure( &self->playback, outParams, self->primeBuffers,
+                    self->convertSampleRate, hwParamsPlayback, &realSr ) );
 
     PA_ENSURE( PaAlsaStream_DetermineFramesPerBuffer( self, realSr, inParams, outParams, framesPerUserBuffer,
                 hwParamsCapture, hwParamsPlayback, hostBufferSizeMode ) );
@@ -2735,7 +3081,9 @@ static PaError PaAlsaStream_Configure( PaAlsaStream *self, const PaStreamParamet
     }
 
     /* Should be exact now */
-    self->streamRepresentation.streamInfo.sampleRate = realSr;
+    self->hostSampleRate = realSr;
+    /* When converting, the user sees the rate asked for */
+    self->streamRepresentation.streamInfo.sampleRate = self->convertSampleRate ? sampleRate : realSr;
 
     /* this will cause the two streams to automatically start/stop/prepare in sync.
      * We only need to execute these operations on one of the pair.
@@ -2750,6 +3098,15 @@ static PaError PaAlsaStream_Configure( PaAlsaStream *self, const PaStreamParamet
             PA_DEBUG(( "%s: Unable to sync pcms: %s\n", __FUNCTION__, alsa_snd_strerror( err ) ));
     }
 
+    /* Unlinked pcms on different cards will drift apart, unless we compensate for it */
+    if( self->callbackMode && self->capture.pcm && self->playback.pcm && !self->pcmsSynced && driftCompensation_ )
+    {
+        PA_ENSURE( PaAlsaDriftCompensator_Initialize( &self->drift, &self->capture, &self->playback,
+                    self->maxFramesPerHostBuffer ) );
+        if( self->drift.enabled )
+            *inputLatency += self->drift.targetFrames / realSr;
+    }
+
     {
         unsigned long minFramesPerHostBuffer = PA_MIN( self->capture.pcm ? self->capture.framesPerPeriod : ULONG_MAX,
             self->playback.pcm ? self->playback.framesPerPeriod : ULONG_MAX );
@@ -2784,6 +3141,15 @@ error:
     return result;
 }
 
+/** Determine whether samples can be transferred between the user's buffers and ALSA as they are.
+ */
+static int IsDirectTransfer( const PaAlsaStreamComponent *self, PaSampleFormat userSampleFormat )
+{
+    return ( userSampleFormat & ~paNonInterleaved ) == self->hostSampleFormat &&
+        self->userInterleaved == self->hostInterleaved && self->numUserChannels == self->numHostChannels &&
+        !self->channelMap;
+}
+
 static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                            PaStream** s,
                            const PaStreamParameters *inputParameters,
@@ -2823,6 +3189,13 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         outputSampleFormat = outputParameters->sampleFormat;
     }
 
+    if( ( inputParameters && IsStreamInfoSharingDevice( inputParameters ) ) ||
+            ( outputParameters && IsStreamInfoSharingDevice( outputParameters ) ) )
+    {
+        return OpenSharedStream( alsaHostApi, s, inputParameters, outputParameters, sampleRate, framesPerBuffer,
+                streamFlags, callback, userData );
+    }
+
     /* XXX: Why do we support this anyway? */
     if( framesPerBuffer == paFramesPerBufferUnspecified && getenv( "PA_ALSA_PERIODSIZE" ) != NULL )
     {
@@ -2837,6 +3210,11 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     PA_ENSURE( PaAlsaStream_Configure( stream, inputParameters, outputParameters, sampleRate, framesPerBuffer,
                 &inputLatency, &outputLatency, &hostBufferSizeMode ) );
     hostInputSampleFormat = stream->capture.hostSampleFormat | (!stream->capture.hostInterleaved ? paNonInterleaved : 0);
+    if( stream->drift.enabled )
+    {
+        /* The buffer processor is fed with interleaved float frames from the drift compensator */
+        hostInputSampleFormat = paFloat32;
+    }
     hostOutputSampleFormat = stream->playback.hostSampleFormat | (!stream->playback.hostInterleaved ? paNonInterleaved : 0);
 
     PA_ENSURE( PaUtil_InitializeBufferProcessor( &stream->bufferProcessor,
@@ -2844,6 +3222,20 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                     numOutputChannels, outputSampleFormat, hostOutputSampleFormat,
                     sampleRate, streamFlags, framesPerBuffer, stream->maxFramesPerHostBuffer,
                     hostBufferSizeMode, callback, userData ) );
+    stream->streamRepresentation.callbackProfiler = stream->bufferProcessor.callbackProfiler;
+
+    if( stream->convertSampleRate && stream->hostSampleRate != sampleRate )
+    {
+        PA_DEBUG(( "%s: Converting between %.3f Hz (device) and %.3f Hz\n", __FUNCTION__, stream->hostSampleRate, sampleRate ));
+        if( (result = PaUtil_InitializeBufferProcessorSampleRateConverter( &stream->bufferProcessor,
+                        stream->hostSampleRate )) != paNoError )
+        {
+            PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
+            goto error;
+        }
+        /* The buffer processor reports the number of frames processed at the device rate */
+        PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, stream->hostSampleRate );
+    }
 
     /* Ok, buffer processor is initialized, now we can deduce it's latency */
     if( numInputChannels > 0 )
@@ -2853,6 +3245,21 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         stream->streamRepresentation.streamInfo.outputLatency = outputLatency + (PaTime)(
                 PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor ) / sampleRate);
 
+    /* The callback thread feeds the estimator with device positions, at the device rate */
+    if( stream->callbackMode )
+    {
+        PaUtil_InitializeClockEstimator( &stream->clock, stream->hostSampleRate );
+        stream->streamRepresentation.clockEstimator = &stream->clock;
+    }
+    else
+    {
+        /* Blocking reads and writes bypass the buffer processor when the user's and ALSA's layouts are identical */
+        if( numInputChannels > 0 )
+            stream->capture.directTransfer = IsDirectTransfer( &stream->capture, inputSampleFormat );
+        if( numOutputChannels > 0 )
+            stream->playback.directTransfer = IsDirectTransfer( &stream->playback, outputSampleFormat );
+    }
+
     PA_DEBUG(( "%s: Stream: framesPerBuffer = %lu, maxFramesPerHostBuffer = %lu, latency i=%f, o=%f\n", __FUNCTION__, framesPerBuffer, stream->maxFramesPerHostBuffer, stream->streamRepresentation.streamInfo.inputLatency, stream->streamRepresentation.streamInfo.outputLatency));
 
     *s = (PaStream*)stream;
@@ -2900,11 +3307,18 @@ static void SilenceBuffer( PaAlsaStream *stream )
  * be started automatically as the user writes to output.
  *
  * The capture pcm, however, will simply be prepared and started.
+ *
+ * If deferPcmStart is set the pcms are only prepared, StartStreams triggers them afterwards.
  */
 static PaError AlsaStart( PaAlsaStream *stream, int priming )
 {
     PaError result = paNoError;
 
+    PaUtil_ResetClockEstimator( &stream->clock );
+    stream->capture.framesTransferred = stream->playback.framesTransferred = 0;
+    stream->capture.haveTimestamp = stream->playback.haveTimestamp = 0;
+    stream->playback.silentFrames = 0;
+
     if( stream->playback.pcm )
     {
         if( stream->callbackMode )
@@ -2916,7 +3330,7 @@ static PaError AlsaStart( PaAlsaStream *stream, int priming )
                 if( stream->playback.canMmap )
                     SilenceBuffer( stream );
             }
-            if( stream->playback.canMmap )
+            if( stream->playback.canMmap && !stream->deferPcmStart )
                 ENSURE_( alsa_snd_pcm_start( stream->playback.pcm ), paUnanticipatedHostError );
         }
         else
@@ -2924,9 +3338,12 @@ static PaError AlsaStart( PaAlsaStream *stream, int priming )
     }
     if( stream->capture.pcm && !stream->pcmsSynced )
     {
+        if( stream->drift.enabled )
+            PaAlsaDriftCompensator_Reset( &stream->drift );
         ENSURE_( alsa_snd_pcm_prepare( stream->capture.pcm ), paUnanticipatedHostError );
         /* For a blocking stream we want to start capture as well, since nothing will happen otherwise */
-        ENSURE_( alsa_snd_pcm_start( stream->capture.pcm ), paUnanticipatedHostError );
+        if( !stream->deferPcmStart )
+            ENSURE_( alsa_snd_pcm_start( stream->capture.pcm ), paUnanticipatedHostError );
     }
 
 end:
@@ -3010,6 +3427,95 @@ error:
     goto end;
 }
 
+/** Start several streams together.
+ *
+ * The streams are first started as usual, except that AlsaStart only prepares their pcms. The pcms are then
+ * linked to the first one and started by a single snd_pcm_start, so the driver triggers them at once. Pcms which
+ * can't be linked (other cards without link support, plugins, or pcms already linked to the other direction of
+ * their stream) are started right after. The links are removed again afterwards, they would otherwise also tie
+ * the streams together when stopping.
+ *
+ * Playback of blocking streams isn't triggered here, it starts with the first write as with StartStream.
+ *
+ * The skew is taken from the trigger timestamps of the pcms.
+ */
+static PaError StartStreams( PaStream **s, int count, PaTime *startSkew )
+{
+    PaError result = paNoError;
+    PaAlsaStream **streams = (PaAlsaStream **)s;
+    snd_pcm_t **pcms = NULL;
+    int *isLinked = NULL;
+    int numPcms = 0, numStarted = 0, i;
+    snd_pcm_status_t *status;
+    snd_timestamp_t timestamp;
+    PaTime triggerTime, firstTriggerTime = 0., lastTriggerTime = 0.;
+
+    PA_UNLESS( pcms = (snd_pcm_t **)PaUtil_AllocateMemory( 2 * count * sizeof (snd_pcm_t *) ), paInsufficientMemory );
+    PA_UNLESS( isLinked = (int *)PaUtil_AllocateMemory( 2 * count * sizeof (int) ), paInsufficientMemory );
+    memset( isLinked, 0, 2 * count * sizeof (int) );
+
+    for( i = 0; i < count; ++i )
+    {
+        PaAlsaStream *stream = streams[i];
+
+        /* With a callback thread the flag is read before StartStream returns, as it waits for the thread */
+        stream->deferPcmStart = 1;
+        result = StartStream( stream );
+        stream->deferPcmStart = 0;
+        PA_ENSURE( result );
+        ++numStarted;
+
+        if( stream->playback.pcm && stream->callbackMode && stream->playback.canMmap )
+            pcms[numPcms++] = stream->playback.pcm;
+        if( stream->capture.pcm && !stream->pcmsSynced )
+            pcms[numPcms++] = stream->capture.pcm;
+    }
+
+    for( i = 1; i < numPcms; ++i )
+        isLinked[i] = alsa_snd_pcm_link( pcms[0], pcms[i] ) >= 0;
+
+    if( numPcms > 0 )
+        ENSURE_( alsa_snd_pcm_start( pcms[0] ), paUnanticipatedHostError );
+    for( i = 1; i < numPcms; ++i )
+    {
+        if( !isLinked[i] )
+            ENSURE_( alsa_snd_pcm_start( pcms[i] ), paUnanticipatedHostError );
+    }
+
+    alsa_snd_pcm_status_alloca( &status );
+    for( i = 0; i < numPcms; ++i )
+    {
+        if( alsa_snd_pcm_status( pcms[i], status ) < 0 )
+            continue;
+        alsa_snd_pcm_status_get_trigger_tstamp( status, &timestamp );
+        triggerTime = timestamp.tv_sec + (PaTime)timestamp.tv_usec / 1e6;
+
+        if( i == 0 || triggerTime < firstTriggerTime )
+            firstTriggerTime = triggerTime;
+        if( i == 0 || triggerTime > lastTriggerTime )
+            lastTriggerTime = triggerTime;
+    }
+    *startSkew = lastTriggerTime - firstTriggerTime;
+    PA_DEBUG(( "%s: Started %d streams (%d pcms), skew: %g s\n", __FUNCTION__, count, numPcms, *startSkew ));
+
+end:
+    for( i = 1; i < numPcms; ++i )
+    {
+        if( isLinked[i] )
+            alsa_snd_pcm_unlink( pcms[i] );
+    }
+    if( pcms )
+        PaUtil_FreeMemory( pcms );
+    if( isLinked )
+        PaUtil_FreeMemory( isLinked );
+
+    return result;
+error:
+    for( i = 0; i < numStarted; ++i )
+        AbortStream( streams[i] );
+    goto end;
+}
+
 /** Stop PCM handle, either softly or abruptly.
  */
 static PaError AlsaStop( PaAlsaStream *stream, int abort )
@@ -3302,6 +3808,8 @@ static PaError PaAlsaStream_HandleXrun( PaAlsaStream *self )
         }
     }
 
+    PaUtil_ResetClockEstimator( &self->clock );
+
     if( restartAlsa )
     {
         PA_DEBUG(( "%s: restarting Alsa to recover from XRUN\n", __FUNCTION__ ));
@@ -3397,39 +3905,55 @@ static void OnExit( void *data )
     stream->isActive = 0;
 }
 
+/** Get the time of the last hardware pointer update of a pcm, and the delay at that time.
+ *
+ * The timestamp cached by PaAlsaStreamComponent_GetAvailableFrames is used if there is one, otherwise the pcm's
+ * status is queried.
+ */
+static void PaAlsaStreamComponent_GetTimestamp( PaAlsaStreamComponent *self, PaTime *timestamp, snd_pcm_sframes_t *delay )
+{
+    if( self->haveTimestamp )
+    {
+        *timestamp = self->timestamp;
+        *delay = self->delay;
+        self->haveTimestamp = 0;
+    }
+    else
+    {
+        snd_pcm_status_t *status;
+        snd_timestamp_t statusTimestamp;
+
+        alsa_snd_pcm_status_alloca( &status );
+        alsa_snd_pcm_status( self->pcm, status );
+        alsa_snd_pcm_status_get_tstamp( status, &statusTimestamp );
+
+        *timestamp = statusTimestamp.tv_sec + ( (PaTime)statusTimestamp.tv_usec / 1000000.0 );
+        *delay = alsa_snd_pcm_status_get_delay( status );
+    }
+}
+
 static void CalculateTimeInfo( PaAlsaStream *stream, PaStreamCallbackTimeInfo *timeInfo )
 {
-    snd_pcm_status_t *capture_status, *playback_status;
-    snd_timestamp_t capture_timestamp, playback_timestamp;
     PaTime capture_time = 0., playback_time = 0.;
-
-    alsa_snd_pcm_status_alloca( &capture_status );
-    alsa_snd_pcm_status_alloca( &playback_status );
+    snd_pcm_sframes_t capture_delay = 0, playback_delay = 0;
 
     if( stream->capture.pcm )
     {
-        snd_pcm_sframes_t capture_delay;
-
-        alsa_snd_pcm_status( stream->capture.pcm, capture_status );
-        alsa_snd_pcm_status_get_tstamp( capture_status, &capture_timestamp );
-
-        capture_time = capture_timestamp.tv_sec +
-            ( (PaTime)capture_timestamp.tv_usec / 1000000.0 );
+        PaAlsaStreamComponent_GetTimestamp( &stream->capture, &capture_time, &capture_delay );
         timeInfo->currentTime = capture_time;
 
-        capture_delay = alsa_snd_pcm_status_get_delay( capture_status );
         timeInfo->inputBufferAdcTime = timeInfo->currentTime -
-            (PaTime)capture_delay / stream->streamRepresentation.streamInfo.sampleRate;
+            (PaTime)capture_delay / stream->hostSampleRate;
+        if( stream->drift.enabled )
+        {
+            /* Account for the frames queued by the drift compensator */
+            timeInfo->inputBufferAdcTime -= ( stream->drift.fifoFrames - stream->drift.position ) /
+                stream->hostSampleRate;
+        }
     }
     if( stream->playback.pcm )
     {
-        snd_pcm_sframes_t playback_delay;
-
-        alsa_snd_pcm_status( stream->playback.pcm, playback_status );
-        alsa_snd_pcm_status_get_tstamp( playback_status, &playback_timestamp );
-
-        playback_time = playback_timestamp.tv_sec +
-            ((PaTime)playback_timestamp.tv_usec / 1000000.0);
+        PaAlsaStreamComponent_GetTimestamp( &stream->playback, &playback_time, &playback_delay );
 
         if( stream->capture.pcm ) /* Full duplex */
         {
@@ -3441,9 +3965,18 @@ static void CalculateTimeInfo( PaAlsaStream *stream, PaStreamCallbackTimeInfo *t
         else
             timeInfo->currentTime = playback_time;
 
-        playback_delay = alsa_snd_pcm_status_get_delay( playback_status );
         timeInfo->outputBufferDacTime = timeInfo->currentTime +
-            (PaTime)playback_delay / stream->streamRepresentation.streamInfo.sampleRate;
+            (PaTime)playback_delay / stream->hostSampleRate;
+
+        /* The hardware pointer trails the frames written by the delay */
+        PaUtil_UpdateClockEstimator( &stream->clock, stream->playback.framesTransferred - playback_delay,
+                playback_time );
+    }
+    else
+    {
+        /* The hardware pointer leads the frames read by the delay */
+        PaUtil_UpdateClockEstimator( &stream->clock, stream->capture.framesTransferred + capture_delay,
+                capture_time );
     }
 }
 
@@ -3473,13 +4006,13 @@ static PaError PaAlsaStreamComponent_EndProcessing( PaAlsaStreamComponent *self,
         else
         {
             void *bufs[self->numHostChannels];
-            int bufsize = alsa_snd_pcm_format_size( self->nativeFormat, self->framesPerPeriod + 1 );
+            unsigned int buf_per_ch_size = self->nonMmapBufferSize / self->numHostChannels;
             unsigned char *buffer = self->nonMmapBuffer;
             int i;
             for( i = 0; i < self->numHostChannels; ++i )
             {
                 bufs[i] = buffer;
-                buffer += bufsize;
+                buffer += buf_per_ch_size;
             }
             res = alsa_snd_pcm_writen( self->pcm, bufs, numFrames );
         }
@@ -3495,6 +4028,7 @@ static PaError PaAlsaStreamComponent_EndProcessing( PaAlsaStreamComponent *self,
     else
     {
         ENSURE_( res, paUnanticipatedHostError );
+        self->framesTransferred += numFrames;
     }
 
 end:
@@ -3508,70 +4042,88 @@ static unsigned char *ExtractAddress( const snd_pcm_channel_area_t *area, snd_pc
     return (unsigned char *) area->addr + ( area->first + offset * area->step ) / 8;
 }
 
-/** Do necessary adaption between user and host channels.
+/** Get the host channel a user channel maps to.
+ */
+static int PaAlsaStreamComponent_HostChannel( const PaAlsaStreamComponent *self, int userChannel )
+{
+    return self->channelMap ? self->channelMap[userChannel] : userChannel;
+}
+
+/** Describe the host buffer being processed as channel areas.
  *
-    @concern ChannelAdaption Adapting between user and host channels can involve silencing unused channels and
-    duplicating mono information if host outputs come in pairs.
+ * For mmap access these are the areas obtained from ALSA, otherwise they describe the non-mmap buffer, so that both
+ * can be operated on with the snd_pcm_area functions.
+ *
+ * @param nonMmapAreas Room for numHostChannels areas, used for the non-mmap buffer.
+ * @param offset Return the offset of the frames being processed within the areas.
  */
-static PaError PaAlsaStreamComponent_DoChannelAdaption( PaAlsaStreamComponent *self, PaUtilBufferProcessor *bp, int numFrames )
+static const snd_pcm_channel_area_t *PaAlsaStreamComponent_GetChannelAreas( const PaAlsaStreamComponent *self,
+        snd_pcm_channel_area_t *nonMmapAreas, snd_pcm_uframes_t *offset )
 {
-    PaError result = paNoError;
-    unsigned char *p;
+    unsigned int sampleBits = alsa_snd_pcm_format_size( self->nativeFormat, 1 ) * 8;
     int i;
-    int unusedChans = self->numHostChannels - self->numUserChannels;
-    unsigned char *src, *dst;
-    int convertMono = ( self->numHostChannels % 2 ) == 0 && ( self->numUserChannels % 2 ) != 0;
 
-    assert( StreamDirection_Out == self->streamDir );
-
-    if( self->hostInterleaved )
+    if( self->canMmap )
     {
-        int swidth = alsa_snd_pcm_format_size( self->nativeFormat, 1 );
-        unsigned char *buffer = self->canMmap ? ExtractAddress( self->channelAreas, self->offset ) : self->nonMmapBuffer;
-
-        /* Start after the last user channel */
-        p = buffer + self->numUserChannels * swidth;
+        *offset = self->offset;
+        return self->channelAreas;
+    }
 
-        if( convertMono )
+    for( i = 0; i < self->numHostChannels; ++i )
+    {
+        if( self->hostInterleaved )
         {
-            /* Convert the last user channel into stereo pair */
-            src = buffer + ( self->numUserChannels - 1 ) * swidth;
-            for( i = 0; i < numFrames; ++i )
-            {
-                dst = src + swidth;
-                memcpy( dst, src, swidth );
-                src += self->numHostChannels * swidth;
-            }
-
-            /* Don't touch the channel we just wrote to */
-            p += swidth;
-            --unusedChans;
+            nonMmapAreas[i].addr = self->nonMmapBuffer;
+            nonMmapAreas[i].first = i * sampleBits;
+            nonMmapAreas[i].step = self->numHostChannels * sampleBits;
         }
-
-        if( unusedChans > 0 )
+        else
         {
-            /* Silence unused output channels */
-            for( i = 0; i < numFrames; ++i )
-            {
-                memset( p, 0, swidth * unusedChans );
-                p += self->numHostChannels * swidth;
-            }
+            nonMmapAreas[i].addr = (unsigned char *)self->nonMmapBuffer + i * ( self->nonMmapBufferSize / self->numHostChannels );
+            nonMmapAreas[i].first = 0;
+            nonMmapAreas[i].step = sampleBits;
         }
     }
-    else
-    {
-        /* We extract the last user channel */
-        if( convertMono )
-        {
-            ENSURE_( alsa_snd_pcm_area_copy( self->channelAreas + self->numUserChannels, self->offset, self->channelAreas +
-                    ( self->numUserChannels - 1 ), self->offset, numFrames, self->nativeFormat ), paUnanticipatedHostError );
-            --unusedChans;
-        }
-        if( unusedChans > 0 )
-        {
-            alsa_snd_pcm_areas_silence( self->channelAreas + ( self->numHostChannels - unusedChans ), self->offset, unusedChans, numFrames,
-                    self->nativeFormat );
-        }
+    *offset = 0;
+    return nonMmapAreas;
+}
+
+/** Do necessary adaption between user and host channels.
+ *
+    @concern ChannelAdaption Adapting between user and host channels can involve silencing unused channels and
+    duplicating mono information if host outputs come in pairs. The buffer processor writes the user channels to
+    the host channels they map to directly. Unused channels are never written, so once a buffer's worth of
+    frames has been silenced they stay silent, until the pcm is prepared again.
+ */
+static PaError PaAlsaStreamComponent_DoChannelAdaption( PaAlsaStreamComponent *self, PaUtilBufferProcessor *bp, int numFrames )
+{
+    PaError result = paNoError;
+    snd_pcm_channel_area_t nonMmapAreas[self->numHostChannels];
+    const snd_pcm_channel_area_t *areas;
+    snd_pcm_uframes_t offset;
+    int i;
+
+    assert( StreamDirection_Out == self->streamDir );
+
+    areas = PaAlsaStreamComponent_GetChannelAreas( self, nonMmapAreas, &offset );
+
+    if( self->duplicateMono )
+    {
+        /* Convert the last user channel into stereo pair */
+        ENSURE_( alsa_snd_pcm_area_copy( areas + self->numUserChannels, offset, areas + ( self->numUserChannels - 1 ),
+                    offset, numFrames, self->nativeFormat ), paUnanticipatedHostError );
+    }
+
+    if( self->numSilentChannels > 0 && self->silentFrames < self->alsaBufferSize )
+    {
+        /* One call for all channels, ALSA merges adjacent interleaved channels into wider fills */
+        snd_pcm_channel_area_t silentAreas[self->numSilentChannels];
+        for( i = 0; i < self->numSilentChannels; ++i )
+            silentAreas[i] = areas[self->silentChannels[i]];
+
+        ENSURE_( alsa_snd_pcm_areas_silence( silentAreas, offset, self->numSilentChannels, numFrames, self->nativeFormat ),
+                paUnanticipatedHostError );
+        self->silentFrames += numFrames;
     }
 
 error:
@@ -3583,7 +4135,7 @@ static PaError PaAlsaStream_EndProcessing( PaAlsaStream *self, unsigned long num
     PaError result = paNoError;
     int xrun = 0;
 
-    if( self->capture.pcm )
+    if( self->capture.pcm && !self->drift.enabled )
     {
         PA_ENSURE( PaAlsaStreamComponent_EndProcessing( &self->capture, numFrames, &xrun ) );
     }
@@ -3604,6 +4156,28 @@ error:
 /** Update the number of available frames.
  *
  */
+/** Grow the buffer of a component which can't mmap to at least bufferSize bytes.
+ *
+ * The contents of the buffer aren't preserved.
+ * @return paInsufficientMemory if the buffer couldn't be allocated, in which case the component has no buffer.
+ */
+static PaError PaAlsaStreamComponent_ReserveNonMmapBuffer( PaAlsaStreamComponent *self, unsigned int bufferSize )
+{
+    PaError result = paNoError;
+
+    if( bufferSize > self->nonMmapBufferSize )
+    {
+        PaUtil_FreeBufferMemory( self->nonMmapBuffer );
+        self->nonMmapBufferSize = 0;
+        PA_UNLESS( self->nonMmapBuffer = PaUtil_AllocateBufferMemory( bufferSize, paUtilPrefaultBufferMemory ),
+                paInsufficientMemory );
+        self->nonMmapBufferSize = bufferSize;
+    }
+
+error:
+    return result;
+}
+
 static PaError PaAlsaStreamComponent_GetAvailableFrames( PaAlsaStreamComponent *self, unsigned long *numFrames, int *xrunOccurred )
 {
     PaError result = paNoError;
@@ -3618,6 +4192,22 @@ static PaError PaAlsaStreamComponent_GetAvailableFrames( PaAlsaStreamComponent *
     else
     {
         ENSURE_( framesAvail, paUnanticipatedHostError );
+
+        if( self->useHtimestamp )
+        {
+            /* Unlike snd_pcm_status this doesn't need a system call for hw devices, and the timestamp is
+             * consistent with the returned avail. If timestamps aren't available, the status is used instead */
+            snd_pcm_uframes_t avail;
+            snd_htimestamp_t timestamp;
+
+            if( alsa_snd_pcm_htimestamp( self->pcm, &avail, &timestamp ) == 0 && ( timestamp.tv_sec || timestamp.tv_nsec ) )
+            {
+                self->timestamp = timestamp.tv_sec + (PaTime)timestamp.tv_nsec / 1000000000.0;
+                self->delay = StreamDirection_Out == self->streamDir ?
+                    (snd_pcm_sframes_t)self->alsaBufferSize - (snd_pcm_sframes_t)avail : (snd_pcm_sframes_t)avail;
+                self->haveTimestamp = 1;
+            }
+        }
     }
 
     *numFrames = framesAvail;
@@ -3740,6 +4330,140 @@ error:
     return result;
 }
 
+/** Queue available capture frames with the drift compensator, and update the conversion ratio.
+ *
+ * The capture pcm isn't polled when compensating drift, instead it is drained each time playback is ready. The
+ * conversion ratio is steered by the queue's fill level, through a PI controller.
+ *
+ * @param xrunOccurred Return whether an xrun has occurred
+ */
+static PaError PaAlsaStream_CompensateDrift( PaAlsaStream *self, int *xrunOccurred )
+{
+    PaError result = paNoError;
+    PaAlsaDriftCompensator *drift = &self->drift;
+    PaAlsaStreamComponent *capture = &self->capture;
+    int swidth = alsa_snd_pcm_format_size( capture->nativeFormat, 1 );
+    unsigned long framesAvail, framesQueued = 0;
+    int xrun = 0;
+
+    assert( drift->enabled );
+
+    while( 1 )
+    {
+        snd_pcm_uframes_t frames;
+        const snd_pcm_channel_area_t *areas = NULL;
+        float *dst;
+        int i;
+
+        PA_ENSURE( PaAlsaStreamComponent_GetAvailableFrames( capture, &framesAvail, &xrun ) );
+        if( xrun || 0 == framesAvail )
+            break;
+
+        frames = framesAvail;
+        if( frames > drift->fifoCapacity - drift->fifoFrames )
+        {
+            /* Input is queuing up faster than we consume it, start over */
+            PA_DEBUG(( "%s: Drift compensation queue overflow\n", __FUNCTION__ ));
+            PaAlsaDriftCompensator_Reset( drift );
+            drift->overflow = 1;
+            frames = PA_MIN( frames, drift->fifoCapacity );
+        }
+
+        if( capture->canMmap )
+        {
+            ENSURE_( alsa_snd_pcm_mmap_begin( capture->pcm, &areas, &capture->offset, &frames ),
+                    paUnanticipatedHostError );
+        }
+        else
+        {
+            snd_pcm_sframes_t res;
+            unsigned int bufferSize = capture->numHostChannels * alsa_snd_pcm_format_size( capture->nativeFormat, frames );
+            PA_ENSURE( PaAlsaStreamComponent_ReserveNonMmapBuffer( capture, bufferSize ) );
+
+            if( capture->hostInterleaved )
+                res = alsa_snd_pcm_readi( capture->pcm, capture->nonMmapBuffer, frames );
+            else
+            {
+                void *bufs[capture->numHostChannels];
+                unsigned int buf_per_ch_size = capture->nonMmapBufferSize / capture->numHostChannels;
+                unsigned char *buffer = capture->nonMmapBuffer;
+                for( i = 0; i < capture->numHostChannels; ++i )
+                {
+                    bufs[i] = buffer;
+                    buffer += buf_per_ch_size;
+                }
+                res = alsa_snd_pcm_readn( capture->pcm, bufs, frames );
+            }
+            if( res == -EPIPE || res == -ESTRPIPE )
+            {
+                xrun = 1;
+                break;
+            }
+            ENSURE_( res, paUnanticipatedHostError );
+            frames = res;
+        }
+
+        /* Convert each channel into the interleaved float queue */
+        dst = drift->fifo + drift->fifoFrames * drift->numChannels;
+        for( i = 0; i < drift->numChannels; ++i )
+        {
+            unsigned char *src;
+            int srcStride;
+
+            int hostChannel = PaAlsaStreamComponent_HostChannel( capture, i );
+
+            if( capture->canMmap )
+            {
+                src = ExtractAddress( areas + hostChannel, capture->offset );
+                srcStride = areas[hostChannel].step / ( 8 * swidth );
+            }
+            else if( capture->hostInterleaved )
+            {
+                src = (unsigned char *)capture->nonMmapBuffer + hostChannel * swidth;
+                srcStride = capture->numHostChannels;
+            }
+            else
+            {
+                src = (unsigned char *)capture->nonMmapBuffer + hostChannel * ( capture->nonMmapBufferSize /
+                        capture->numHostChannels );
+                srcStride = 1;
+            }
+            drift->converter( dst + i, drift->numChannels, src, srcStride, frames, NULL );
+        }
+        drift->fifoFrames += frames;
+        framesQueued += frames;
+
+        if( capture->canMmap )
+        {
+            snd_pcm_sframes_t res = alsa_snd_pcm_mmap_commit( capture->pcm, capture->offset, frames );
+            if( res == -EPIPE || res == -ESTRPIPE )
+            {
+                xrun = 1;
+                break;
+            }
+            ENSURE_( res, paUnanticipatedHostError );
+        }
+    }
+
+    if( drift->primed && framesQueued > 0 )
+    {
+        double sampleRate = self->hostSampleRate;
+        double error = ( drift->fifoFrames - drift->position - drift->targetFrames ) / sampleRate;
+        double correction;
+
+        drift->filteredError += PA_ALSA_DRIFT_SMOOTHING_ * ( error - drift->filteredError );
+        drift->integral += PA_ALSA_DRIFT_KI_ * drift->filteredError * framesQueued / sampleRate;
+        drift->integral = PA_MAX( -PA_ALSA_DRIFT_MAX_CORRECTION_, PA_MIN( drift->integral, PA_ALSA_DRIFT_MAX_CORRECTION_ ) );
+
+        correction = PA_ALSA_DRIFT_KP_ * drift->filteredError + drift->integral;
+        drift->ratio = 1.0 + PA_MAX( -PA_ALSA_DRIFT_MAX_CORRECTION_, PA_MIN( correction, PA_ALSA_DRIFT_MAX_CORRECTION_ ) );
+    }
+
+error:
+    *xrunOccurred = xrun;
+    return result;
+}
+
 /** Wait for and report available buffer space from ALSA.
  *
  * Unless ALSA reports a minimum of frames available for I/O, we poll the ALSA filedescriptors for more.
@@ -3753,7 +4477,8 @@ error:
 static PaError PaAlsaStream_WaitForFrames( PaAlsaStream *self, unsigned long *framesAvail, int *xrunOccurred )
 {
     PaError result = paNoError;
-    int pollPlayback = self->playback.pcm != NULL, pollCapture = self->capture.pcm != NULL;
+    /* When compensating drift, playback drives the stream and capture is drained as playback becomes ready */
+    int pollPlayback = self->playback.pcm != NULL, pollCapture = self->capture.pcm != NULL && !self->drift.enabled;
     int pollTimeout = self->pollTimeout;
     int xrun = 0, timeouts = 0;
     int pollResults;
@@ -3869,7 +4594,7 @@ static PaError PaAlsaStream_WaitForFrames( PaAlsaStream *self, unsigned long *fr
          * If there is less than half a period's worth of samples left of frames in the other pcm's buffer we will
          * stop polling.
          */
-        if( self->capture.pcm && self->playback.pcm )
+        if( self->capture.pcm && self->playback.pcm && !self->drift.enabled )
         {
             if( pollCapture && !pollPlayback )
             {
@@ -3889,11 +4614,18 @@ static PaError PaAlsaStream_WaitForFrames( PaAlsaStream *self, unsigned long *fr
          * the other direction is returned. Output is normally preferred over capture however, so capture frames may be
          * discarded to avoid overrun unless paNeverDropInput is specified.
          */
-        int captureReady = self->capture.pcm ? self->capture.ready : 0,
+        int captureReady = self->capture.pcm && !self->drift.enabled ? self->capture.ready : 0,
             playbackReady = self->playback.pcm ? self->playback.ready : 0;
         PA_ENSURE( PaAlsaStream_GetAvailableFrames( self, captureReady, playbackReady, framesAvail, &xrun ) );
 
-        if( self->capture.pcm && self->playback.pcm )
+        if( self->drift.enabled )
+        {
+            if( !xrun )
+            {
+                PA_ENSURE( PaAlsaStream_CompensateDrift( self, &xrun ) );
+            }
+        }
+        else if( self->capture.pcm && self->playback.pcm )
         {
             if( !self->playback.ready && !self->neverDropInput )
             {
@@ -3969,25 +4701,23 @@ static PaError PaAlsaStreamComponent_RegisterChannels( PaAlsaStreamComponent* se
         unsigned int bufferSize = self->numHostChannels * alsa_snd_pcm_format_size( self->nativeFormat, *numFrames );
         if( bufferSize > self->nonMmapBufferSize )
         {
-            self->nonMmapBuffer = realloc( self->nonMmapBuffer, ( self->nonMmapBufferSize = bufferSize ) );
-            if( !self->nonMmapBuffer )
-            {
-                result = paInsufficientMemory;
-                goto error;
-            }
+            PA_ENSURE( PaAlsaStreamComponent_ReserveNonMmapBuffer( self, bufferSize ) );
+            /* The channels have moved, silence them anew */
+            self->silentFrames = 0;
         }
     }
 
+    /* The buffer processor reads or writes each user channel directly in the host channel it maps to */
     if( self->hostInterleaved )
     {
         int swidth = alsa_snd_pcm_format_size( self->nativeFormat, 1 );
 
-        p = buffer = self->canMmap ? ExtractAddress( areas, self->offset ) : self->nonMmapBuffer;
+        buffer = self->canMmap ? ExtractAddress( areas, self->offset ) : self->nonMmapBuffer;
         for( i = 0; i < self->numUserChannels; ++i )
         {
             /* We're setting the channels up to userChannels, but the stride will be hostChannels samples */
+            p = buffer + PaAlsaStreamComponent_HostChannel( self, i ) * swidth;
             setChannel( bp, i, p, self->numHostChannels );
-            p += swidth;
         }
     }
     else
@@ -3996,7 +4726,7 @@ static PaError PaAlsaStreamComponent_RegisterChannels( PaAlsaStreamComponent* se
         {
             for( i = 0; i < self->numUserChannels; ++i )
             {
-                area = areas + i;
+                area = areas + PaAlsaStreamComponent_HostChannel( self, i );
                 buffer = ExtractAddress( area, self->offset );
                 setChannel( bp, i, buffer, 1 );
             }
@@ -4004,11 +4734,11 @@ static PaError PaAlsaStreamComponent_RegisterChannels( PaAlsaStreamComponent* se
         else
         {
             unsigned int buf_per_ch_size = self->nonMmapBufferSize / self->numHostChannels;
-            buffer = self->nonMmapBuffer;
             for( i = 0; i < self->numUserChannels; ++i )
             {
+                buffer = (unsigned char *)self->nonMmapBuffer + PaAlsaStreamComponent_HostChannel( self, i ) *
+                    buf_per_ch_size;
                 setChannel( bp, i, buffer, 1 );
-                buffer += buf_per_ch_size;
             }
         }
     }
@@ -4044,6 +4774,73 @@ error:
     return result;
 }
 
+/** Produce a number of input frames from the drift compensation queue.
+ *
+ * The queue is resampled by the current ratio using 4-point Hermite interpolation, into the output buffer. If the
+ * queue runs dry the remainder is silenced, and we wait for the queue to fill up again.
+ */
+static void PaAlsaDriftCompensator_Resample( PaAlsaDriftCompensator *self, unsigned long frames )
+{
+    const int numChannels = self->numChannels;
+    float *out = self->output;
+    unsigned long i, consumed;
+    int c;
+
+    assert( frames <= self->outputCapacity );
+
+    if( !self->primed )
+    {
+        if( self->fifoFrames < self->targetFrames )
+        {
+            memset( out, 0, frames * numChannels * sizeof (float) );
+            return;
+        }
+        self->primed = 1;
+    }
+
+    for( i = 0; i < frames; ++i )
+    {
+        unsigned long k = (unsigned long)self->position;
+        float t = (float)( self->position - k );
+        const float *xm1, *x0, *x1, *x2;
+
+        if( k + 2 >= self->fifoFrames )
+        {
+            PA_DEBUG(( "%s: Drift compensation queue underflow\n", __FUNCTION__ ));
+            memset( out, 0, ( frames - i ) * numChannels * sizeof (float) );
+            self->position = 1.0;
+            self->primed = 0;
+            self->underflow = 1;
+            break;
+        }
+
+        /* position is always at least 1, so there is a frame of history */
+        xm1 = self->fifo + ( k - 1 ) * numChannels;
+        x0 = xm1 + numChannels;
+        x1 = x0 + numChannels;
+        x2 = x1 + numChannels;
+        for( c = 0; c < numChannels; ++c )
+        {
+            float c1 = 0.5f * ( x1[c] - xm1[c] );
+            float c2 = xm1[c] - 2.5f * x0[c] + 2.f * x1[c] - 0.5f * x2[c];
+            float c3 = 0.5f * ( x2[c] - xm1[c] ) + 1.5f * ( x0[c] - x1[c] );
+            out[c] = ( ( c3 * t + c2 ) * t + c1 ) * t + x0[c];
+        }
+        out += numChannels;
+        self->position += self->ratio;
+    }
+
+    /* Discard consumed frames, keeping one frame of history */
+    consumed = PA_MIN( (unsigned long)self->position - 1, self->fifoFrames );
+    if( consumed > 0 )
+    {
+        memmove( self->fifo, self->fifo + consumed * numChannels,
+                ( self->fifoFrames - consumed ) * numChannels * sizeof (float) );
+        self->fifoFrames -= consumed;
+        self->position -= consumed;
+    }
+}
+
 /** Initiate buffer processing.
  *
  * ALSA buffers are registered with the PA buffer processor and the buffer size (in frames) set.
@@ -4117,7 +4914,14 @@ static PaError PaAlsaStream_SetUpBuffers( PaAlsaStream* self, unsigned long* num
      */
     if( self->capture.pcm )
     {
-        if( self->capture.ready )
+        if( self->drift.enabled )
+        {
+            /* Input comes from the drift compensator, in step with playback */
+            PaAlsaDriftCompensator_Resample( &self->drift, commonFrames );
+            PaUtil_SetInterleavedInputChannels( &self->bufferProcessor, 0, self->drift.output, self->drift.numChannels );
+            PaUtil_SetInputFrameCount( &self->bufferProcessor, commonFrames );
+        }
+        else if( self->capture.ready )
         {
             PaUtil_SetInputFrameCount( &self->bufferProcessor, commonFrames );
         }
@@ -4280,7 +5084,15 @@ static void *CallbackThreadFunc( void *userData )
                 cbFlags |= paInputOverflow;
                 stream->overrun = 0.0;
             }
-            if( stream->capture.pcm && stream->playback.pcm )
+            if( stream->drift.enabled )
+            {
+                if( stream->drift.underflow )
+                    cbFlags |= paInputUnderflow;
+                if( stream->drift.overflow )
+                    cbFlags |= paInputOverflow;
+                stream->drift.underflow = stream->drift.overflow = 0;
+            }
+            else if( stream->capture.pcm && stream->playback.pcm )
             {
                 /** @concern FullDuplex It's possible that only one direction is being processed to avoid an
                  * under- or overflow, this should be reported correspondingly */
@@ -4357,173 +5169,374 @@ error:
 
 /* Blocking interface */
 
-static PaError ReadStream( PaStream* s, void *buffer, unsigned long frames )
+/** Recover one of a blocking stream's pcms from an xrun.
+ *
+ * Unlike PaAlsaStream_HandleXrun this leaves the other direction alone, so a read and a write may be in progress in
+ * different threads. A recovered capture pcm is restarted, a playback pcm is started again once enough frames have
+ * been written.
+ */
+static PaError PaAlsaStreamComponent_HandleXrun( PaAlsaStreamComponent *self, PaAlsaStream *stream )
 {
     PaError result = paNoError;
-    PaAlsaStream *stream = (PaAlsaStream*)s;
-    unsigned long framesGot, framesAvail;
-    void *userBuffer;
-    snd_pcm_t *save = stream->playback.pcm;
-
-    assert( stream );
-
-    PA_UNLESS( stream->capture.pcm, paCanNotReadFromAnOutputOnlyStream );
-
-    /* Disregard playback */
-    stream->playback.pcm = NULL;
-
-    if( stream->overrun > 0. )
-    {
-        result = paInputOverflowed;
-        stream->overrun = 0.0;
-    }
+    snd_pcm_status_t *st;
+    snd_timestamp_t t;
+    PaTime now = PaUtil_GetTime();
+    int err;
 
-    if( stream->capture.userInterleaved )
-    {
-        userBuffer = buffer;
-    }
-    else
-    {
-        /* Copy channels into local array */
-        userBuffer = stream->capture.userBuffers;
-        memcpy( userBuffer, buffer, sizeof (void *) * stream->capture.numUserChannels );
-    }
+    alsa_snd_pcm_status_alloca( &st );
+    ENSURE_( alsa_snd_pcm_status( self->pcm, st ), paUnanticipatedHostError );
 
-    /* Start stream if in prepared state */
-    if( alsa_snd_pcm_state( stream->capture.pcm ) == SND_PCM_STATE_PREPARED )
+    switch( alsa_snd_pcm_status_get_state( st ) )
     {
-        ENSURE_( alsa_snd_pcm_start( stream->capture.pcm ), paUnanticipatedHostError );
+    case SND_PCM_STATE_XRUN:
+        alsa_snd_pcm_status_get_trigger_tstamp( st, &t );
+        if( StreamDirection_Out == self->streamDir )
+            stream->underrun = now * 1000 - ( (PaTime)t.tv_sec * 1000 + (PaTime)t.tv_usec / 1000 );
+        else
+            stream->overrun = now * 1000 - ( (PaTime)t.tv_sec * 1000 + (PaTime)t.tv_usec / 1000 );
+        err = -EPIPE;
+        break;
+    case SND_PCM_STATE_SUSPENDED:
+        err = -ESTRPIPE;
+        break;
+    default:
+        goto end;   /* Nothing to recover from */
     }
 
-    while( frames > 0 )
+    ENSURE_( alsa_snd_pcm_recover( self->pcm, err, 1 ), paUnanticipatedHostError );
+    if( StreamDirection_In == self->streamDir )
     {
-        int xrun = 0;
-        PA_ENSURE( PaAlsaStream_WaitForFrames( stream, &framesAvail, &xrun ) );
-        framesGot = PA_MIN( framesAvail, frames );
-
-        PA_ENSURE( PaAlsaStream_SetUpBuffers( stream, &framesGot, &xrun ) );
-        if( framesGot > 0 )
-        {
-            framesGot = PaUtil_CopyInput( &stream->bufferProcessor, &userBuffer, framesGot );
-            PA_ENSURE( PaAlsaStream_EndProcessing( stream, framesGot, &xrun ) );
-            frames -= framesGot;
-        }
+        ENSURE_( alsa_snd_pcm_start( self->pcm ), paUnanticipatedHostError );
     }
+    self->haveTimestamp = 0;
+    self->silentFrames = 0;
 
 end:
-    stream->playback.pcm = save;
     return result;
 error:
     goto end;
 }
 
-static PaError WriteStream( PaStream* s, const void *buffer, unsigned long frames )
+/** Start a prepared blocking playback pcm once a period's worth of frames has been written.
+ */
+static PaError PaAlsaStreamComponent_StartPlayback( PaAlsaStreamComponent *self )
 {
     PaError result = paNoError;
-    signed long err;
-    PaAlsaStream *stream = (PaAlsaStream*)s;
-    snd_pcm_uframes_t framesGot, framesAvail;
-    const void *userBuffer;
-    snd_pcm_t *save = stream->capture.pcm;
-
-    assert( stream );
-
-    PA_UNLESS( stream->playback.pcm, paCanNotWriteToAnInputOnlyStream );
-
-    /* Disregard capture */
-    stream->capture.pcm = NULL;
+    snd_pcm_sframes_t framesAvail;
 
-    if( stream->underrun > 0. )
-    {
-        result = paOutputUnderflowed;
-        stream->underrun = 0.0;
-    }
-
-    if( stream->playback.userInterleaved )
-        userBuffer = buffer;
-    else /* Copy channels into local array */
-    {
-        userBuffer = stream->playback.userBuffers;
-        memcpy( (void *)userBuffer, buffer, sizeof (void *) * stream->playback.numUserChannels );
-    }
+    if( alsa_snd_pcm_state( self->pcm ) != SND_PCM_STATE_PREPARED )
+        goto end;
 
-    while( frames > 0 )
+    ENSURE_( framesAvail = alsa_snd_pcm_avail_update( self->pcm ), paUnanticipatedHostError );
+    if( self->alsaBufferSize - (snd_pcm_uframes_t)framesAvail >= self->framesPerPeriod )
     {
-        int xrun = 0;
-        snd_pcm_uframes_t hwAvail;
-
-        PA_ENSURE( PaAlsaStream_WaitForFrames( stream, &framesAvail, &xrun ) );
-        framesGot = PA_MIN( framesAvail, frames );
-
-        PA_ENSURE( PaAlsaStream_SetUpBuffers( stream, &framesGot, &xrun ) );
-        if( framesGot > 0 )
-        {
-            framesGot = PaUtil_CopyOutput( &stream->bufferProcessor, &userBuffer, framesGot );
-            PA_ENSURE( PaAlsaStream_EndProcessing( stream, framesGot, &xrun ) );
-            frames -= framesGot;
-        }
-
-        /* Start stream after one period of samples worth */
-
-        /* Frames residing in buffer */
-        PA_ENSURE( err = GetStreamWriteAvailable( stream ) );
-        framesAvail = err;
-        hwAvail = stream->playback.alsaBufferSize - framesAvail;
-
-        if( alsa_snd_pcm_state( stream->playback.pcm ) == SND_PCM_STATE_PREPARED &&
-                hwAvail >= stream->playback.framesPerPeriod )
-        {
-            ENSURE_( alsa_snd_pcm_start( stream->playback.pcm ), paUnanticipatedHostError );
-        }
+        ENSURE_( alsa_snd_pcm_start( self->pcm ), paUnanticipatedHostError );
     }
 
 end:
-    stream->capture.pcm = save;
     return result;
 error:
     goto end;
 }
 
-/* Return frames available for reading. In the event of an overflow, the capture pcm will be restarted */
-static signed long GetStreamReadAvailable( PaStream* s )
+/** Transfer frames directly between the user's buffer and ALSA.
+ *
+ * @param userBuffer The user's interleaved buffer, or array of channel buffers.
+ * @param numFrames On entrance the number of frames to transfer, on exit the number transferred.
+ */
+static PaError PaAlsaStreamComponent_TransferDirect( PaAlsaStreamComponent *self, void *userBuffer,
+        unsigned long *numFrames, int *xrun )
 {
     PaError result = paNoError;
-    PaAlsaStream *stream = (PaAlsaStream*)s;
-    unsigned long avail;
-    int xrun;
+    snd_pcm_sframes_t res;
+    const int capture = StreamDirection_In == self->streamDir;
 
-    PA_ENSURE( PaAlsaStreamComponent_GetAvailableFrames( &stream->capture, &avail, &xrun ) );
-    if( xrun )
+    if( self->hostInterleaved )
     {
-        PA_ENSURE( PaAlsaStream_HandleXrun( stream ) );
-        PA_ENSURE( PaAlsaStreamComponent_GetAvailableFrames( &stream->capture, &avail, &xrun ) );
-        if( xrun )
-            PA_ENSURE( paInputOverflowed );
+        if( self->canMmap )
+            res = capture ? alsa_snd_pcm_mmap_readi( self->pcm, userBuffer, *numFrames ) :
+                alsa_snd_pcm_mmap_writei( self->pcm, userBuffer, *numFrames );
+        else
+            res = capture ? alsa_snd_pcm_readi( self->pcm, userBuffer, *numFrames ) :
+                alsa_snd_pcm_writei( self->pcm, userBuffer, *numFrames );
+    }
+    else
+    {
+        if( self->canMmap )
+            res = capture ? alsa_snd_pcm_mmap_readn( self->pcm, (void **)userBuffer, *numFrames ) :
+                alsa_snd_pcm_mmap_writen( self->pcm, (void **)userBuffer, *numFrames );
+        else
+            res = capture ? alsa_snd_pcm_readn( self->pcm, (void **)userBuffer, *numFrames ) :
+                alsa_snd_pcm_writen( self->pcm, (void **)userBuffer, *numFrames );
     }
 
-    return (signed long)avail;
+    if( res == -EPIPE || res == -ESTRPIPE )
+    {
+        *xrun = 1;
+        res = 0;
+    }
+    else if( res == -EAGAIN )
+        res = 0;
+    ENSURE_( res, paUnanticipatedHostError );
 
-error:
+    *numFrames = res;
+    self->framesTransferred += res;
+
+end:
     return result;
+error:
+    *numFrames = 0;
+    goto end;
 }
 
-static signed long GetStreamWriteAvailable( PaStream* s )
+/** Transfer frames between the user's buffer and one of a blocking stream's pcms.
+ *
+ * Only this direction's pcm is waited on, with snd_pcm_wait, so a full duplex stream may be read and written
+ * concurrently from two threads (but each direction from one thread at a time). Frames are transferred directly if
+ * IsDirectTransfer, otherwise the buffer processor converts them into or out of the mmapped buffer.
+ *
+ * @param userBuffer The user's buffer. For non-interleaved buffers the component's userBuffers must hold the channel
+ * pointers, which are advanced.
+ * @param timeout Milliseconds to wait for the transfer to complete, 0 to transfer only what is available and negative
+ * to wait indefinitely.
+ * @param framesTransferred Return the number of frames transferred, which is less than frames if the timeout expired.
+ */
+static PaError PaAlsaStream_BlockingTransfer( PaAlsaStream *self, PaAlsaStreamComponent *component, void *userBuffer,
+        unsigned long frames, int timeout, unsigned long *framesTransferred )
 {
     PaError result = paNoError;
-    PaAlsaStream *stream = (PaAlsaStream*)s;
-    unsigned long avail;
-    int xrun;
+    const int capture = StreamDirection_In == component->streamDir;
+    const int frameSize = alsa_snd_pcm_format_size( component->nativeFormat, 1 ) *
+        ( component->userInterleaved ? component->numUserChannels : 1 );
+    PaTime deadline = PaUtil_GetTime() + timeout / 1000.;
+    unsigned long done = 0;
+    int i;
 
-    PA_ENSURE( PaAlsaStreamComponent_GetAvailableFrames( &stream->playback, &avail, &xrun ) );
-    if( xrun )
+    /* EndProcessing only commits ready components, there is no polling to mark them here */
+    component->ready = 1;
+
+    while( done < frames )
     {
-        snd_pcm_sframes_t savail;
+        unsigned long framesAvail, framesGot;
+        int xrun = 0;
 
-        PA_ENSURE( PaAlsaStream_HandleXrun( stream ) );
-        savail = alsa_snd_pcm_avail_update( stream->playback.pcm );
+        PA_ENSURE( PaAlsaStreamComponent_GetAvailableFrames( component, &framesAvail, &xrun ) );
+        if( !xrun && 0 == framesAvail )
+        {
+            int waitTime = -1, err;
 
-        /* savail should not contain -EPIPE now, since PaAlsaStream_HandleXrun will only prepare the pcm */
-        ENSURE_( savail, paUnanticipatedHostError );
+            if( !capture )
+            {
+                /* The buffer is full, make sure it's being played */
+                PA_ENSURE( PaAlsaStreamComponent_StartPlayback( component ) );
+            }
+            if( timeout >= 0 )
+            {
+                waitTime = (int)ceil( ( deadline - PaUtil_GetTime() ) * 1000 );
+                if( waitTime <= 0 )
+                    break;
+            }
+
+            err = alsa_snd_pcm_wait( component->pcm, waitTime );
+            if( err == -EPIPE || err == -ESTRPIPE )
+                xrun = 1;
+            else
+            {
+                ENSURE_( err, paUnanticipatedHostError );
+                continue;
+            }
+        }
+        if( xrun )
+        {
+            PA_ENSURE( PaAlsaStreamComponent_HandleXrun( component, self ) );
+            continue;
+        }
+
+        framesGot = PA_MIN( framesAvail, frames - done );
+        if( component->directTransfer )
+        {
+            PA_ENSURE( PaAlsaStreamComponent_TransferDirect( component, component->userInterleaved ? userBuffer :
+                        (void *)component->userBuffers, &framesGot, &xrun ) );
+
+            if( component->userInterleaved )
+                userBuffer = (unsigned char *)userBuffer + framesGot * frameSize;
+            else
+            {
+                for( i = 0; i < component->numUserChannels; ++i )
+                    component->userBuffers[i] = (unsigned char *)component->userBuffers[i] + framesGot * frameSize;
+            }
+        }
+        else
+        {
+            PA_ENSURE( PaAlsaStreamComponent_RegisterChannels( component, &self->bufferProcessor, &framesGot, &xrun ) );
+            if( !xrun )
+            {
+                void *buffer = component->userInterleaved ? userBuffer : (void *)component->userBuffers;
+
+                /* The dither generator is shared between the converters */
+                PA_ENSURE( PaUnixMutex_Lock( &self->blockingMtx ) );
+                if( capture )
+                {
+                    PaUtil_SetInputFrameCount( &self->bufferProcessor, framesGot );
+                    framesGot = PaUtil_CopyInput( &self->bufferProcessor, &buffer, framesGot );
+                }
+                else
+                {
+                    PaUtil_SetOutputFrameCount( &self->bufferProcessor, framesGot );
+                    framesGot = PaUtil_CopyOutput( &self->bufferProcessor, (const void **)&buffer, framesGot );
+                }
+                PA_ENSURE( PaUnixMutex_Unlock( &self->blockingMtx ) );
+
+                if( component->userInterleaved )
+                    userBuffer = buffer;
+
+                if( !capture && component->numHostChannels > component->numUserChannels )
+                {
+                    PA_ENSURE( PaAlsaStreamComponent_DoChannelAdaption( component, &self->bufferProcessor, framesGot ) );
+                }
+                PA_ENSURE( PaAlsaStreamComponent_EndProcessing( component, framesGot, &xrun ) );
+            }
+        }
+
+        if( xrun )
+        {
+            /* Frames that weren't committed are lost, like the ones dropped by the xrun itself */
+            PA_ENSURE( PaAlsaStreamComponent_HandleXrun( component, self ) );
+        }
+        done += framesGot;
+
+        if( !capture )
+        {
+            PA_ENSURE( PaAlsaStreamComponent_StartPlayback( component ) );
+        }
+    }
+
+end:
+    *framesTransferred = done;
+    return result;
+error:
+    goto end;
+}
+
+static PaError PaAlsaStream_Read( PaAlsaStream *stream, void *buffer, unsigned long frames, int timeout,
+        unsigned long *framesRead )
+{
+    PaError result = paNoError;
+
+    *framesRead = 0;
+    PA_UNLESS( stream->capture.pcm, paCanNotReadFromAnOutputOnlyStream );
+
+    if( stream->overrun > 0. )
+    {
+        result = paInputOverflowed;
+        stream->overrun = 0.0;
+    }
+
+    if( !stream->capture.userInterleaved )
+    {
+        /* Copy channels into local array */
+        memcpy( stream->capture.userBuffers, buffer, sizeof (void *) * stream->capture.numUserChannels );
+    }
+
+    /* Start stream if in prepared state */
+    if( alsa_snd_pcm_state( stream->capture.pcm ) == SND_PCM_STATE_PREPARED )
+    {
+        ENSURE_( alsa_snd_pcm_start( stream->capture.pcm ), paUnanticipatedHostError );
+    }
+
+    PA_ENSURE( PaAlsaStream_BlockingTransfer( stream, &stream->capture, buffer, frames, timeout, framesRead ) );
+
+end:
+    return result;
+error:
+    goto end;
+}
+
+static PaError PaAlsaStream_Write( PaAlsaStream *stream, const void *buffer, unsigned long frames, int timeout,
+        unsigned long *framesWritten )
+{
+    PaError result = paNoError;
+
+    *framesWritten = 0;
+    PA_UNLESS( stream->playback.pcm, paCanNotWriteToAnInputOnlyStream );
+
+    if( stream->underrun > 0. )
+    {
+        result = paOutputUnderflowed;
+        stream->underrun = 0.0;
+    }
+
+    if( !stream->playback.userInterleaved )
+    {
+        /* Copy channels into local array */
+        memcpy( stream->playback.userBuffers, buffer, sizeof (void *) * stream->playback.numUserChannels );
+    }
+
+    PA_ENSURE( PaAlsaStream_BlockingTransfer( stream, &stream->playback, (void *)buffer, frames, timeout,
+                framesWritten ) );
+
+end:
+    return result;
+error:
+    goto end;
+}
+
+static PaError ReadStream( PaStream* s, void *buffer, unsigned long frames )
+{
+    unsigned long framesRead;
+    assert( s );
+
+    return PaAlsaStream_Read( (PaAlsaStream*)s, buffer, frames, -1, &framesRead );
+}
+
+static PaError WriteStream( PaStream* s, const void *buffer, unsigned long frames )
+{
+    unsigned long framesWritten;
+    assert( s );
+
+    return PaAlsaStream_Write( (PaAlsaStream*)s, buffer, frames, -1, &framesWritten );
+}
+
+/* Return frames available for reading. In the event of an overflow, the capture pcm will be restarted */
+static signed long GetStreamReadAvailable( PaStream* s )
+{
+    PaError result = paNoError;
+    PaAlsaStream *stream = (PaAlsaStream*)s;
+    unsigned long avail;
+    int xrun;
+
+    PA_ENSURE( PaAlsaStreamComponent_GetAvailableFrames( &stream->capture, &avail, &xrun ) );
+    if( xrun )
+    {
+        PA_ENSURE( PaAlsaStreamComponent_HandleXrun( &stream->capture, stream ) );
+        PA_ENSURE( PaAlsaStreamComponent_GetAvailableFrames( &stream->capture, &avail, &xrun ) );
+        if( xrun )
+            PA_ENSURE( paInputOverflowed );
+    }
+
+    return (signed long)avail;
+
+error:
+    return result;
+}
+
+static signed long GetStreamWriteAvailable( PaStream* s )
+{
+    PaError result = paNoError;
+    PaAlsaStream *stream = (PaAlsaStream*)s;
+    unsigned long avail;
+    int xrun;
+
+    PA_ENSURE( PaAlsaStreamComponent_GetAvailableFrames( &stream->playback, &avail, &xrun ) );
+    if( xrun )
+    {
+        snd_pcm_sframes_t savail;
+
+        PA_ENSURE( PaAlsaStreamComponent_HandleXrun( &stream->playback, stream ) );
+        savail = alsa_snd_pcm_avail_update( stream->playback.pcm );
+
+        /* savail should not contain -EPIPE now, since the xrun handler will only prepare the pcm */
+        ENSURE_( savail, paUnanticipatedHostError );
 
         avail = (unsigned long) savail;
     }
@@ -4534,20 +5547,487 @@ error:
     return result;
 }
 
+/* Device sharing */
+
+/** Wait until the mixer is done with the streams it may have picked up before the caller withdrew a stream.
+ *
+ * The caller must have cleared the stream's slot or isActive flag beforehand.
+ */
+static void PaAlsaSharedDevice_WaitForMixer( PaAlsaSharedDevice *self )
+{
+    unsigned long mixCount;
+
+    /* Pairs with the barrier in SharedDeviceCallback, so either the mixer sees the withdrawn stream or we see
+     * it mixing */
+    PaUtil_FullMemoryBarrier();
+    mixCount = self->mixCount;
+    while( self->isMixing && self->mixCount == mixCount )
+        Pa_Sleep( 1 );
+}
+
+/** Clear a shared stream's isActive flag.
+ *
+ * The mixer deactivates a stream whose callback finishes, and RealStopShared deactivates a stream which is stopped,
+ * possibly at the same time. Whichever clears the flag calls the stream finished callback, so that it's called once.
+ *
+ * @return 1 if this call cleared the flag, 0 if the stream was already inactive.
+ */
+static int PaAlsaSharedStream_Deactivate( PaAlsaSharedStream *self )
+{
+    return __sync_bool_compare_and_swap( &self->isActive, 1, 0 );
+}
+
+/** Process one of the streams sharing a device.
+ *
+ * Input is handed to the stream's buffer processor straight from the device's channels, output is rendered into
+ * the stream's mix buffer and added to the device's channels.
+ */
+static void PaAlsaSharedStream_Process( PaAlsaSharedStream *self, const float *const *input, float **output,
+        unsigned long frames, const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags statusFlags )
+{
+    PaUtilBufferProcessor *bp = &self->bufferProcessor;
+    const unsigned long mixBufferFrames = self->device->maxFramesPerBuffer;
+    PaStreamCallbackTimeInfo streamTimeInfo = *timeInfo; /* Adjusted by the buffer processor */
+    int callbackResult = paContinue;
+    unsigned long i;
+    int c;
+
+    PaUtil_BeginCpuLoadMeasurement( &self->cpuLoadMeasurer );
+    PaUtil_BeginBufferProcessing( bp, &streamTimeInfo, statusFlags );
+
+    if( input )
+    {
+        PaUtil_SetInputFrameCount( bp, frames );
+        for( c = 0; c < self->numChannels; ++c )
+            PaUtil_SetNonInterleavedInputChannel( bp, c, (void *)input[self->channelMap[c]] );
+    }
+    else
+    {
+        PaUtil_SetOutputFrameCount( bp, frames );
+        for( c = 0; c < self->numChannels; ++c )
+            PaUtil_SetNonInterleavedOutputChannel( bp, c, self->mixBuffer + c * mixBufferFrames );
+    }
+
+    frames = PaUtil_EndBufferProcessing( bp, &callbackResult );
+
+    if( output )
+    {
+        for( c = 0; c < self->numChannels; ++c )
+        {
+            /* Contiguous float runs, which the compiler vectorizes */
+            float *dst = output[self->channelMap[c]];
+            const float *src = self->mixBuffer + c * mixBufferFrames;
+            for( i = 0; i < frames; ++i )
+                dst[i] += src[i];
+        }
+    }
+
+    PaUtil_EndCpuLoadMeasurement( &self->cpuLoadMeasurer, frames );
+
+    if( callbackResult != paContinue )
+    {
+        PA_DEBUG(( "%s: Shared stream callback finished: %d\n", __FUNCTION__, callbackResult ));
+        if( PaAlsaSharedStream_Deactivate( self ) && self->streamRepresentation.streamFinishedCallback )
+            self->streamRepresentation.streamFinishedCallback( self->streamRepresentation.userData );
+    }
+}
+
+/** Callback of the stream driving a shared device.
+ *
+ * The streams are picked up from the device's slots without locking, streams are withdrawn by clearing their slot or
+ * isActive flag and then waiting for the mixer, see PaAlsaSharedDevice_WaitForMixer.
+ */
+static int SharedDeviceCallback( const void *input, void *output, unsigned long frames,
+        const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags statusFlags, void *userData )
+{
+    PaAlsaSharedDevice *device = (PaAlsaSharedDevice *)userData;
+    float **out = (float **)output;
+    int i;
+
+    device->isMixing = 1;
+    PaUtil_FullMemoryBarrier();
+
+    if( out )
+    {
+        for( i = 0; i < device->numChannels; ++i )
+            memset( out[i], 0, frames * sizeof (float) );
+    }
+
+    for( i = 0; i < PA_ALSA_MAX_SHARED_STREAMS_; ++i )
+    {
+        PaAlsaSharedStream *stream = device->streams[i];
+
+        if( stream && stream->isActive )
+        {
+            PaUtil_ReadMemoryBarrier();
+            PaAlsaSharedStream_Process( stream, (const float *const *)input, out, frames, timeInfo, statusFlags );
+        }
+    }
+
+    PaUtil_WriteMemoryBarrier();
+    ++device->mixCount;
+    device->isMixing = 0;
+
+    return paContinue;
+}
+
+/** Open a device to be shared, with an internal stream to drive it.
+ *
+ * The device is opened at the given sample rate, with float channels. For hw devices all of the device's channels are
+ * opened, so that later streams may use any of them, otherwise the channels the first stream needs.
+ *
+ * @param params The stream parameters of the first stream opened on the device.
+ */
+static PaError PaAlsaSharedDevice_Open( PaAlsaHostApiRepresentation *alsaApi, const PaStreamParameters *params,
+        StreamDirection streamDir, const char *name, double sampleRate, PaAlsaSharedDevice **device )
+{
+    PaError result = paNoError;
+    PaAlsaSharedDevice *self = NULL;
+    PaStreamParameters deviceParams = *params;
+    PaAlsaStreamInfo streamInfo;
+    PaStream *s = NULL;
+
+    PA_UNLESS( self = (PaAlsaSharedDevice *)PaUtil_AllocateMemory( sizeof (PaAlsaSharedDevice) ), paInsufficientMemory );
+    memset( self, 0, sizeof (PaAlsaSharedDevice) );
+    self->streamDir = streamDir;
+    PA_UNLESS( self->name = (char *)PaUtil_AllocateMemory( strlen( name ) + 1 ), paInsufficientMemory );
+    strcpy( self->name, name );
+
+    deviceParams.sampleFormat = paFloat32 | paNonInterleaved;
+    deviceParams.channelCount = CalculateNumHostChannels( &alsaApi->baseHostApiRep, params, streamDir );
+    if( GetStreamInfoDeviceString( params ) )
+    {
+        PaAlsa_InitializeStreamInfo( &streamInfo );
+        streamInfo.deviceString = self->name;
+        deviceParams.hostApiSpecificStreamInfo = &streamInfo;
+    }
+    else
+    {
+        const PaAlsaDeviceInfo *devInfo = GetDeviceInfo( &alsaApi->baseHostApiRep, params->device );
+        if( !devInfo->isPlug )
+            deviceParams.channelCount = StreamDirection_In == streamDir ? devInfo->baseDeviceInfo.maxInputChannels :
+                devInfo->baseDeviceInfo.maxOutputChannels;
+        deviceParams.hostApiSpecificStreamInfo = NULL;
+    }
+
+    PA_ENSURE( OpenStream( &alsaApi->baseHostApiRep, &s, StreamDirection_In == streamDir ? &deviceParams : NULL,
+                StreamDirection_Out == streamDir ? &deviceParams : NULL, sampleRate, paFramesPerBufferUnspecified,
+                paNoFlag, SharedDeviceCallback, self ) );
+    self->stream = (PaAlsaStream *)s;
+    self->numChannels = deviceParams.channelCount;
+    self->maxFramesPerBuffer = self->stream->maxFramesPerHostBuffer;
+    self->rtSched = 1;
+    ASSERT_CALL_( PaUnixMutex_Initialize( &self->mtx ), paNoError );
+
+    PA_DEBUG(( "%s: Sharing %s, %d channels, %lu frames per buffer\n", __FUNCTION__, name, self->numChannels,
+                self->maxFramesPerBuffer ));
+
+    *device = self;
+
+end:
+    return result;
+
+error:
+    if( self )
+    {
+        PaUtil_FreeMemory( self->name );
+        PaUtil_FreeMemory( self );
+    }
+    goto end;
+}
+
+static void PaAlsaSharedDevice_Close( PaAlsaSharedDevice *self )
+{
+    assert( 0 == self->numStreams );
+
+    CloseStream( (PaStream *)self->stream );
+    ASSERT_CALL_( PaUnixMutex_Terminate( &self->mtx ), paNoError );
+    PaUtil_FreeMemory( self->name );
+    PaUtil_FreeMemory( self );
+}
+
+/** Open a stream on a shared device, opening the device if no other stream has.
+ *
+ * Only callback streams in one direction can share a device, like with dmix and dsnoop. All streams sharing a device
+ * must use the sample rate the first one opened it with.
+ */
+static PaError OpenSharedStream( PaAlsaHostApiRepresentation *alsaApi, PaStream** s,
+        const PaStreamParameters *inputParameters, const PaStreamParameters *outputParameters, double sampleRate,
+        unsigned long framesPerBuffer, PaStreamFlags streamFlags, PaStreamCallback *callback, void *userData )
+{
+    PaError result = paNoError;
+    const PaStreamParameters *params = inputParameters ? inputParameters : outputParameters;
+    StreamDirection streamDir = inputParameters ? StreamDirection_In : StreamDirection_Out;
+    const char *name = GetStreamInfoDeviceString( params );
+    const int *channelSelectors = GetStreamInfoChannelSelectors( params );
+    PaAlsaSharedDevice *device = NULL;
+    PaAlsaSharedStream *stream = NULL;
+    int locked = 0, slot = -1, i;
+
+    PA_UNLESS( !( inputParameters && outputParameters ), paBadIODeviceCombination );
+    PA_UNLESS( callback, paIncompatibleHostApiSpecificStreamInfo );
+
+    if( !name )
+        name = GetDeviceInfo( &alsaApi->baseHostApiRep, params->device )->alsaName;
+
+    PA_ENSURE( PaUnixMutex_Lock( &alsaApi->sharedDevicesMtx ) );
+    locked = 1;
+
+    for( device = alsaApi->sharedDevices; device; device = device->next )
+    {
+        if( device->streamDir == streamDir && !strcmp( device->name, name ) )
+            break;
+    }
+    if( !device )
+    {
+        PA_ENSURE( PaAlsaSharedDevice_Open( alsaApi, params, streamDir, name, sampleRate, &device ) );
+        device->next = alsaApi->sharedDevices;
+        alsaApi->sharedDevices = device;
+    }
+
+    PA_UNLESS( fabs( sampleRate - device->stream->streamRepresentation.streamInfo.sampleRate ) <=
+            sampleRate / RATE_MAX_DEVIATE_RATIO, paInvalidSampleRate );
+    for( i = 0; i < params->channelCount; ++i )
+        PA_UNLESS( ( channelSelectors ? channelSelectors[i] : i ) < device->numChannels, paInvalidChannelCount );
+    for( i = 0; i < PA_ALSA_MAX_SHARED_STREAMS_ && slot < 0; ++i )
+    {
+        if( !device->streams[i] )
+            slot = i;
+    }
+    PA_UNLESS( slot >= 0, paDeviceUnavailable );
+
+    PA_UNLESS( stream = (PaAlsaSharedStream *)PaUtil_AllocateMemory( sizeof (PaAlsaSharedStream) ), paInsufficientMemory );
+    memset( stream, 0, sizeof (PaAlsaSharedStream) );
+    stream->device = device;
+    stream->numChannels = params->channelCount;
+
+    PA_UNLESS( stream->channelMap = (int *)PaUtil_AllocateMemory( sizeof (int) * stream->numChannels ),
+            paInsufficientMemory );
+    for( i = 0; i < stream->numChannels; ++i )
+        stream->channelMap[i] = channelSelectors ? channelSelectors[i] : i;
+    if( StreamDirection_Out == streamDir )
+    {
+        PA_UNLESS( stream->mixBuffer = (float *)PaUtil_AllocateBufferMemory( stream->numChannels *
+                    device->maxFramesPerBuffer * sizeof (float), paUtilPrefaultBufferMemory ), paInsufficientMemory );
+    }
+
+    PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation, &alsaApi->sharedStreamInterface,
+            callback, userData );
+    PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+
+    /* The device's samples are passed on as they are, block adaption provides the stream's buffer size */
+    PA_ENSURE( PaUtil_InitializeBufferProcessor( &stream->bufferProcessor,
+                inputParameters ? stream->numChannels : 0, inputParameters ? inputParameters->sampleFormat : 0,
+                paFloat32 | paNonInterleaved,
+                outputParameters ? stream->numChannels : 0, outputParameters ? outputParameters->sampleFormat : 0,
+                paFloat32 | paNonInterleaved,
+                sampleRate, streamFlags, framesPerBuffer, device->maxFramesPerBuffer, paUtilBoundedHostBufferSize,
+                callback, userData ) );
+    stream->hasBufferProcessor = 1;
+
+    stream->streamRepresentation.streamInfo.sampleRate = device->stream->streamRepresentation.streamInfo.sampleRate;
+    if( inputParameters )
+        stream->streamRepresentation.streamInfo.inputLatency = device->stream->streamRepresentation.streamInfo.inputLatency +
+            PaUtil_GetBufferProcessorInputLatencyFrames( &stream->bufferProcessor ) / sampleRate;
+    else
+        stream->streamRepresentation.streamInfo.outputLatency = device->stream->streamRepresentation.streamInfo.outputLatency +
+            PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor ) / sampleRate;
+    /* The device's clock is the stream's clock */
+    stream->streamRepresentation.clockEstimator = device->stream->streamRepresentation.clockEstimator;
+    stream->streamRepresentation.callbackProfiler = stream->bufferProcessor.callbackProfiler;
+
+    /* Publish the stream, the mixer skips it until it's started */
+    PaUtil_WriteMemoryBarrier();
+    device->streams[slot] = stream;
+    ++device->numStreams;
+
+    PA_ENSURE( PaUnixMutex_Unlock( &alsaApi->sharedDevicesMtx ) );
+
+    *s = (PaStream *)stream;
+
+    return result;
+
+error:
+    if( stream )
+    {
+        if( stream->hasBufferProcessor )
+            PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
+        PaUtil_FreeBufferMemory( stream->mixBuffer );
+        PaUtil_FreeMemory( stream->channelMap );
+        PaUtil_FreeMemory( stream );
+    }
+    if( device && 0 == device->numStreams )
+    {
+        /* Only just opened */
+        alsaApi->sharedDevices = device->next;
+        PaAlsaSharedDevice_Close( device );
+    }
+    if( locked )
+        PaUnixMutex_Unlock( &alsaApi->sharedDevicesMtx );
+
+    return result;
+}
+
+static PaError CloseSharedStream( PaStream* s )
+{
+    PaError result = paNoError;
+    PaAlsaSharedStream *stream = (PaAlsaSharedStream *)s;
+    PaAlsaSharedDevice *device = stream->device;
+    PaAlsaHostApiRepresentation *alsaApi;
+    PaAlsaSharedDevice **link;
+    int i;
+
+    PA_ENSURE( PaUtil_GetHostApiRepresentation( (PaUtilHostApiRepresentation **)&alsaApi, paALSA ) );
+    PA_ENSURE( PaUnixMutex_Lock( &alsaApi->sharedDevicesMtx ) );
+
+    for( i = 0; i < PA_ALSA_MAX_SHARED_STREAMS_; ++i )
+    {
+        if( device->streams[i] == stream )
+            device->streams[i] = NULL;
+    }
+    PaAlsaSharedDevice_WaitForMixer( device );
+
+    if( 0 == --device->numStreams )
+    {
+        for( link = &alsaApi->sharedDevices; *link != device; link = &(*link)->next )
+            ;
+        *link = device->next;
+        PaAlsaSharedDevice_Close( device );
+    }
+
+    PaUnixMutex_Unlock( &alsaApi->sharedDevicesMtx );
+
+    PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
+    PaUtil_TerminateStreamRepresentation( &stream->streamRepresentation );
+    PaUtil_FreeBufferMemory( stream->mixBuffer );
+    PaUtil_FreeMemory( stream->channelMap );
+    PaUtil_FreeMemory( stream );
+
+error:
+    return result;
+}
+
+/** Start a stream sharing a device, the device is started along with the first stream.
+ */
+static PaError StartSharedStream( PaStream *s )
+{
+    PaError result = paNoError;
+    PaAlsaSharedStream *stream = (PaAlsaSharedStream *)s;
+    PaAlsaSharedDevice *device = stream->device;
+
+    PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+
+    PA_ENSURE( PaUnixMutex_Lock( &device->mtx ) );
+
+    if( 0 == device->numStarted )
+    {
+        device->stream->rtSched = device->rtSched;
+        result = StartStream( (PaStream *)device->stream );
+    }
+    if( paNoError == result )
+    {
+        ++device->numStarted;
+        stream->isStarted = 1;
+
+        PaUtil_WriteMemoryBarrier();
+        stream->isActive = 1;
+    }
+
+    PaUnixMutex_Unlock( &device->mtx );
+
+error:
+    return result;
+}
+
+/** Stop a stream sharing a device, the device is stopped along with the last stream.
+ *
+ * Output that has been mixed is left to play out, also when aborting.
+ */
+static PaError RealStopShared( PaAlsaSharedStream *stream, int abort )
+{
+    PaError result = paNoError;
+    PaAlsaSharedDevice *device = stream->device;
+    int wasActive;
+
+    PA_ENSURE( PaUnixMutex_Lock( &device->mtx ) );
+
+    if( stream->isStarted )
+    {
+        /* If the callback finished meanwhile, the mixer has called the finished callback */
+        wasActive = PaAlsaSharedStream_Deactivate( stream );
+        PaAlsaSharedDevice_WaitForMixer( device );
+        stream->isStarted = 0;
+
+        if( 0 == --device->numStarted )
+            result = RealStop( device->stream, abort );
+
+        if( wasActive && stream->streamRepresentation.streamFinishedCallback )
+            stream->streamRepresentation.streamFinishedCallback( stream->streamRepresentation.userData );
+    }
+
+    PaUnixMutex_Unlock( &device->mtx );
+
+error:
+    return result;
+}
+
+static PaError StopSharedStream( PaStream *s )
+{
+    return RealStopShared( (PaAlsaSharedStream *)s, 0 );
+}
+
+static PaError AbortSharedStream( PaStream *s )
+{
+    return RealStopShared( (PaAlsaSharedStream *)s, 1 );
+}
+
+static PaError IsSharedStreamStopped( PaStream *s )
+{
+    return !( (PaAlsaSharedStream *)s )->isStarted;
+}
+
+static PaError IsSharedStreamActive( PaStream *s )
+{
+    return ( (PaAlsaSharedStream *)s )->isActive;
+}
+
+static PaTime GetSharedStreamTime( PaStream *s )
+{
+    return GetStreamTime( (PaStream *)( (PaAlsaSharedStream *)s )->device->stream );
+}
+
+static double GetSharedStreamCpuLoad( PaStream* s )
+{
+    return PaUtil_GetCpuLoad( &( (PaAlsaSharedStream *)s )->cpuLoadMeasurer );
+}
+
 /* Extensions */
 
 void PaAlsa_InitializeStreamInfo( PaAlsaStreamInfo *info )
 {
     info->size = sizeof (PaAlsaStreamInfo);
     info->hostApiType = paALSA;
-    info->version = 1;
+    info->version = 2;
     info->deviceString = NULL;
+    info->flags = 0;
+    info->channelSelectors = NULL;
 }
 
 void PaAlsa_EnableRealtimeScheduling( PaStream *s, int enable )
 {
-    PaAlsaStream *stream = (PaAlsaStream *) s;
-    stream->rtSched = enable;
+    PaUtilHostApiRepresentation* hostApi;
+
+    if( PaUtil_GetHostApiRepresentation( &hostApi, paALSA ) == paNoError &&
+            PA_STREAM_REP( s )->streamInterface == &( (PaAlsaHostApiRepresentation *)hostApi )->sharedStreamInterface )
+    {
+        /* Applies to the device's thread, when it's started next */
+        ( (PaAlsaSharedStream *)s )->device->rtSched = enable;
+    }
+    else
+    {
+        PaAlsaStream *stream = (PaAlsaStream *) s;
+        stream->rtSched = enable;
+    }
 }
 
 #if 0
@@ -4568,13 +6048,20 @@ static PaError GetAlsaStreamPointer( PaStream* s, PaAlsaStream** stream )
     PA_ENSURE( PaUtil_GetHostApiRepresentation( &hostApi, paALSA ) );
     alsaHostApi = (PaAlsaHostApiRepresentation*)hostApi;
 
+    if( PA_STREAM_REP( s )->streamInterface == &alsaHostApi->sharedStreamInterface )
+    {
+        /* The stream driving the shared device */
+        *stream = ( (PaAlsaSharedStream *)s )->device->stream;
+        return result;
+    }
+
     PA_UNLESS( PA_STREAM_REP( s )->streamInterface == &alsaHostApi->callbackStreamInterface
             || PA_STREAM_REP( s )->streamInterface == &alsaHostApi->blockingStreamInterface,
         paIncompatibleStreamHostApi );
 
     *stream = (PaAlsaStream*)s;
 error:
-    return paNoError;
+    return result;
 }
 
 PaError PaAlsa_GetStreamInputCard( PaStream* s, int* card )
@@ -4620,3 +6107,77 @@ PaError PaAlsa_SetRetriesBusy( int retries )
     busyRetries_ = retries;
     return paNoError;
 }
+
+PaError PaAlsa_SetDriftCompensation( int enable )
+{
+    driftCompensation_ = enable;
+    return paNoError;
+}
+
+PaError PaAlsa_SetHighResolutionTimestamps( int enable )
+{
+    highResolutionTimestamps_ = enable;
+    return paNoError;
+}
+
+PaError PaAlsa_GetStreamClockRatio( PaStream* s, double* ratio )
+{
+    PaAlsaStream *stream;
+    PaError result = paNoError;
+
+    PA_ENSURE( GetAlsaStreamPointer( s, &stream ) );
+
+    if( stream->callbackMode )
+    {
+        PaStreamClockInfo info;
+        PaUtil_GetClockEstimate( &stream->clock, &info );
+        *ratio = info.rateRatio;
+    }
+    else
+        *ratio = 1.0;
+
+error:
+    return result;
+}
+
+PaError PaAlsa_ReadStream( PaStream* s, void *buffer, unsigned long frames, int timeout, unsigned long *framesRead )
+{
+    PaAlsaStream *stream;
+    PaError result = paNoError;
+
+    PA_ENSURE( GetAlsaStreamPointer( s, &stream ) );
+    PA_UNLESS( !stream->callbackMode, paCanNotReadFromACallbackStream );
+
+    result = PaAlsaStream_Read( stream, buffer, frames, timeout, framesRead );
+
+error:
+    return result;
+}
+
+PaError PaAlsa_WriteStream( PaStream* s, const void *buffer, unsigned long frames, int timeout,
+        unsigned long *framesWritten )
+{
+    PaAlsaStream *stream;
+    PaError result = paNoError;
+
+    PA_ENSURE( GetAlsaStreamPointer( s, &stream ) );
+    PA_UNLESS( !stream->callbackMode, paCanNotWriteToACallbackStream );
+
+    result = PaAlsaStream_Write( stream, buffer, frames, timeout, framesWritten );
+
+error:
+    return result;
+}
+
+PaError PaAlsa_GetStreamDriftRatio( PaStream* s, double* ratio )
+{
+    PaAlsaStream *stream;
+    PaError result = paNoError;
+
+    PA_ENSURE( GetAlsaStreamPointer( s, &stream ) );
+
+    *ratio = stream->drift.enabled ? stream->drift.ratio : 1.0;
+
+error:
+    return result;
+}
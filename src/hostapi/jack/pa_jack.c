@@ -68,6 +68,7 @@
 #include "pa_process.h"
 #include "pa_allocation.h"
 #include "pa_cpuload.h"
+#include "pa_clockestimator.h"
 #include "pa_ringbuffer.h"
 #include "pa_debugprint.h"
 
@@ -210,6 +211,9 @@ typedef struct PaJackStream
 
     jack_nframes_t t0;
 
+    PaUtilClockEstimator clock;
+    double clockPosition;   /* Frames processed since the stream was started */
+
     PaUtilAllocationGroup *stream_memory;
 
     /* These are useful in the process callback */
@@ -258,16 +262,15 @@ static int JackCallback( jack_nframes_t frames, void *userData );
 static PaError BlockingInitFIFO( PaUtilRingBuffer *rbuf, long numFrames, long bytesPerFrame )
 {
     long numBytes = numFrames * bytesPerFrame;
-    char *buffer = (char *) malloc( numBytes );
+    char *buffer = (char *) PaUtil_AllocateBufferMemory( numBytes, paUtilPrefaultBufferMemory );
     if( buffer == NULL ) return paInsufficientMemory;
-    memset( buffer, 0, numBytes );
     return (PaError) PaUtil_InitializeRingBuffer( rbuf, 1, numBytes, buffer );
 }
 
 /* Free buffer. */
 static PaError BlockingTermFIFO( PaUtilRingBuffer *rbuf )
 {
-    if( rbuf->buffer ) free( rbuf->buffer );
+    PaUtil_FreeBufferMemory( rbuf->buffer );
     rbuf->buffer = NULL;
     return paNoError;
 }
@@ -1296,6 +1299,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                   streamCallback,
                   userData ) );
     bpInitialized = 1;
+    stream->streamRepresentation.callbackProfiler = stream->bufferProcessor.callbackProfiler;
 
     if( stream->num_incoming_connections > 0 )
         stream->streamRepresentation.streamInfo.inputLatency = (jack_port_get_latency( stream->remote_output_ports[0] )
@@ -1309,6 +1313,9 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     stream->streamRepresentation.streamInfo.sampleRate = jackSr;
     stream->t0 = jack_frame_time( jackHostApi->jack_client );   /* A: Time should run from Pa_OpenStream */
 
+    PaUtil_InitializeClockEstimator( &stream->clock, jackSr );
+    stream->streamRepresentation.clockEstimator = &stream->clock;
+
     /* Add to queue of opened streams */
     ENSURE_PA( AddStream( stream ) );
 
@@ -1377,7 +1384,13 @@ static PaError RealProcess( PaJackStream *stream, jack_nframes_t frames )
         /* XXX: Any way to tell which of these occurred? */
         cbFlags = paOutputUnderflow | paInputOverflow;
         stream->xrun = FALSE;
+        PaUtil_ResetClockEstimator( &stream->clock );
     }
+
+    /* The process callback runs as JACK's device completes each period, the clock estimator filters out the
+     * scheduling jitter */
+    PaUtil_UpdateClockEstimator( &stream->clock, stream->clockPosition, PaUtil_GetTime() );
+    stream->clockPosition += frames;
     PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo,
             cbFlags );
 
@@ -1532,6 +1545,8 @@ static int JackCallback( jack_nframes_t frames, void *userData )
                     ASSERT_CALL( pthread_cond_signal( &stream->hostApi->cond ), 0 );
                     stream->callbackResult = paContinue;
                     stream->isSilenced = 0;
+                    PaUtil_ResetClockEstimator( &stream->clock );
+                    stream->clockPosition = 0;
                 }
 
                 ASSERT_CALL( pthread_mutex_unlock( &stream->hostApi->mtx ), 0 );
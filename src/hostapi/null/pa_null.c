@@ -0,0 +1,1760 @@
+/*
+ * $Id$
+ * PortAudio Portable Real-Time Audio Library
+ * Null host API: virtual devices without audio hardware
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Ross Bencina, Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/**
+ @file
+ @ingroup hostapi_src
+
+ @brief Host API implementation with virtual devices, which run without audio hardware.
+
+ Each stream is driven by a thread that processes a host buffer whenever the device's clock
+ has advanced by one, or as fast as possible for free-running devices. Input devices capture
+ silence and output is discarded, unless they are backed by files, everything in between is done
+ as with hardware: the buffer processor adapts buffer sizes and converts from and to the device's
+ sample format.
+
+ Files are either 16 bit PCM WAV files, handled by the reader and writer of the loopback test,
+ or raw samples in the device's format. They are read and written sequentially so named pipes
+ work too, in which case a free-running stream goes at the pace of the other end of the pipe.
+
+ A loopback pair connects an output device to an input device as a cable would. Output streams
+ write what they play to a buffer along with the timeline of their device's clock, input streams
+ capture from it the signal played at the time of each frame minus the latency of the cable,
+ interpolating between frames when the clocks of the two devices drift apart.
+
+ The device's clock is simulated from the system clock, optionally running at a different rate.
+ The thread's wakeups can be delayed by a random jitter, and host buffers can be dropped at
+ random, to exercise the handling of xruns.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/stat.h>
+
+#include "portaudio.h"
+#include "pa_util.h"
+#include "pa_unix_util.h"
+#include "pa_allocation.h"
+#include "pa_hostapi.h"
+#include "pa_stream.h"
+#include "pa_cpuload.h"
+#include "pa_clockestimator.h"
+#include "pa_process.h"
+#include "pa_converters.h"
+#include "pa_debugprint.h"
+
+#include "pa_null.h"
+#include "write_wav.h"
+
+/* Maximum number of devices that can be added with PaNull_AddDevice */
+#define PA_NULL_MAX_DEVICES_ 64
+/* Maximum length of device names, including the terminator */
+#define PA_NULL_MAX_NAME_ 64
+/* Maximum length of file names, including the terminator */
+#define PA_NULL_MAX_PATH_ 1024
+/* Host buffer size when neither the device nor the stream specify one */
+#define PA_NULL_DEFAULT_FRAMES_PER_BUFFER_ 256
+/* Host buffers in the device's buffer, the thread may fall behind by this much before an xrun occurs */
+#define PA_NULL_NUM_HOST_BUFFERS_ 2
+/* Seconds of audio a loopback keeps beyond its latency, to absorb the scheduling of its streams */
+#define PA_NULL_LOOPBACK_SLACK_ 1.
+/* Seconds a thread may be woken late by the system before an xrun occurs, less than PA_NULL_LOOPBACK_SLACK_ */
+#define PA_NULL_MAX_LATENESS_ .5
+
+typedef struct
+{
+    PaNullDeviceSpec spec;
+    char name[PA_NULL_MAX_NAME_];
+    char inputFile[PA_NULL_MAX_PATH_];
+    char outputFile[PA_NULL_MAX_PATH_];
+}
+PaNullDeviceConfig;
+
+static PaNullDeviceConfig deviceConfigs_[PA_NULL_MAX_DEVICES_];
+static int numDeviceConfigs_ = 0;
+
+struct PaNullStream;
+
+/** The connection between the devices of a loopback pair.
+ *
+ * Frame p played by the writer is heard at writerStartTime + ( p + writerLatencyFrames ) / writerRate, the buffer
+ * keeps the last bufferFrames frames written with all of the loopback's channels.
+ */
+typedef struct
+{
+    int numChannels;
+    PaTime latency;
+    double dropoutProbability;
+
+    PaUnixMutex mtx;                    /* Serializes the writer and readers */
+    pthread_cond_t written;             /* Signalled when frames are written, or the writer stops */
+    const struct PaNullStream *writer;  /* The stream open on the output device, if any */
+    int writerActive;                   /* Whether the writer has written since it was started */
+    PaTime writerStartTime;
+    double writerRate;
+    double writerLatencyFrames;
+    float *buffer;
+    unsigned long bufferFrames;
+    double framesWritten;
+}
+PaNullLoopback;
+
+/* PaNullHostApiRepresentation - host api datastructure specific to this implementation */
+
+typedef struct
+{
+    PaUtilHostApiRepresentation baseHostApiRep;
+    PaUtilStreamInterface callbackStreamInterface;
+    PaUtilStreamInterface blockingStreamInterface;
+
+    PaUtilAllocationGroup *allocations;
+
+    PaHostApiIndex hostApiIndex;
+
+    PaNullLoopback **loopbacks;
+    int numLoopbacks;
+}
+PaNullHostApiRepresentation;
+
+typedef struct
+{
+    PaDeviceInfo baseDeviceInfo;
+    PaNullDeviceSpec spec;
+    PaNullLoopback *loopback;           /* Set for both devices of a loopback pair */
+}
+PaNullDeviceInfo;
+
+/** One direction of a stream. */
+typedef struct
+{
+    const PaNullDeviceInfo *device;
+    int numChannels;
+    int numHostChannels;                /* Channels in the host buffer, input files may have more than the stream */
+    PaSampleFormat hostSampleFormat;    /* Without paNonInterleaved */
+    int hostInterleaved;
+    unsigned long framesPerHostBuffer;
+    void *buffer;                       /* A host buffer */
+    void **userBuffers;                 /* Copy of the user's channel pointers for non-interleaved blocking I/O */
+
+    FILE *rawFile;
+    WAV_Reader wavReader;               /* Open if wavReader.fid is set */
+    WAV_Writer wavWriter;               /* Open if wavWriter.fid is set */
+    int endOfFile;
+    unsigned long framesRead;           /* Frames of the host buffer read from the input file */
+    double framesLost;                  /* Frames lost to xruns of blocking streams, which are skipped in files */
+
+    float *loopbackBuffer;              /* A host buffer in the loopback's format */
+    PaUtilConverter *loopbackConverter; /* Between the host buffer and loopbackBuffer */
+}
+PaNullStreamComponent;
+
+typedef struct PaNullStream
+{
+    PaUtilStreamRepresentation streamRepresentation;
+    PaUtilCpuLoadMeasurer cpuLoadMeasurer;
+    PaUtilBufferProcessor bufferProcessor;
+    PaUnixThread thread;
+
+    int callbackMode;
+    int freeRunning;
+    double sampleRate;                  /* The device's rate, which differs from the user's when converting */
+    const PaNullDeviceSpec *clockSpec;  /* Spec of the device whose clock drives the stream */
+    unsigned long framesPerHostBuffer;
+    unsigned int randomSeed;
+
+    PaNullStreamComponent capture, playback;
+
+    PaTime startTime;                   /* When the device was started, in system time, or in stream time when
+                                           free-running */
+    PaNullStreamStatistics statistics;
+    double readPosition, writePosition; /* Frames transferred by blocking reads and writes */
+    PaStreamCallbackFlags blockingFlags; /* Xruns to report to blocking reads and writes */
+    PaUnixMutex blockingMtx;            /* Serializes conversions of concurrent blocking reads and writes */
+
+    volatile sig_atomic_t isActive;
+    volatile sig_atomic_t callbackAbort;
+    int isStopped;
+
+    PaUtilClockEstimator clock;
+}
+PaNullStream;
+
+/* prototypes for functions declared in this file */
+
+PaError PaNull_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
+
+static void Terminate( struct PaUtilHostApiRepresentation *hostApi );
+static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
+                                  const PaStreamParameters *inputParameters,
+                                  const PaStreamParameters *outputParameters,
+                                  double sampleRate );
+static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
+                           PaStream** s,
+                           const PaStreamParameters *inputParameters,
+                           const PaStreamParameters *outputParameters,
+                           double sampleRate,
+                           unsigned long framesPerBuffer,
+                           PaStreamFlags streamFlags,
+                           PaStreamCallback *streamCallback,
+                           void *userData );
+static PaError CloseStream( PaStream* stream );
+static PaError StartStream( PaStream *stream );
+static PaError StopStream( PaStream *stream );
+static PaError AbortStream( PaStream *stream );
+static PaError IsStreamStopped( PaStream *s );
+static PaError IsStreamActive( PaStream *stream );
+static PaTime GetStreamTime( PaStream *stream );
+static double GetStreamCpuLoad( PaStream* stream );
+static PaError ReadStream( PaStream* stream, void *buffer, unsigned long frames );
+static PaError WriteStream( PaStream* stream, const void *buffer, unsigned long frames );
+static signed long GetStreamReadAvailable( PaStream* stream );
+static signed long GetStreamWriteAvailable( PaStream* stream );
+
+
+/* Device configuration */
+
+void PaNull_InitializeDeviceSpec( PaNullDeviceSpec *spec )
+{
+    memset( spec, 0, sizeof (PaNullDeviceSpec) );
+    spec->size = sizeof (PaNullDeviceSpec);
+    spec->version = 1;
+    spec->name = "Null";
+    spec->maxInputChannels = 2;
+    spec->maxOutputChannels = 2;
+    spec->defaultSampleRate = 44100.;
+    spec->hostSampleFormat = paFloat32;
+    spec->clockRatio = 1.;
+    spec->loopbackClockRatio = 1.;
+}
+
+PaError PaNull_AddDevice( const PaNullDeviceSpec *spec )
+{
+    PaError result = paNoError;
+    PaNullDeviceConfig *config;
+    PaSampleFormat format;
+
+    PA_UNLESS( spec->size == sizeof (PaNullDeviceSpec) && spec->version == 1, paIncompatibleHostApiSpecificStreamInfo );
+    PA_UNLESS( spec->maxInputChannels >= 0 && spec->maxOutputChannels >= 0 &&
+            spec->maxInputChannels + spec->maxOutputChannels > 0, paInvalidChannelCount );
+    PA_UNLESS( spec->defaultSampleRate > 0 && spec->clockRatio > 0, paInvalidSampleRate );
+    format = spec->hostSampleFormat & ~paNonInterleaved;
+    PA_UNLESS( format == paFloat32 || format == paInt32 || format == paInt24 || format == paInt16 ||
+            format == paInt8 || format == paUInt8, paSampleFormatNotSupported );
+    PA_UNLESS( !( spec->flags & ~( paNullFreeRunning | paNullRawFiles | paNullLoopback ) ), paInvalidFlag );
+    if( spec->flags & paNullLoopback )
+    {
+        PA_UNLESS( spec->maxOutputChannels > 0, paInvalidChannelCount );
+        PA_UNLESS( spec->loopbackClockRatio > 0, paInvalidSampleRate );
+        PA_UNLESS( spec->loopbackLatency >= 0 && !( spec->flags & paNullFreeRunning ) &&
+                !spec->inputFile && !spec->outputFile, paInvalidFlag );
+    }
+    PA_UNLESS( ( !spec->inputFile || strlen( spec->inputFile ) < PA_NULL_MAX_PATH_ ) &&
+            ( !spec->outputFile || strlen( spec->outputFile ) < PA_NULL_MAX_PATH_ ), paInvalidDevice );
+    PA_UNLESS( numDeviceConfigs_ < PA_NULL_MAX_DEVICES_, paInsufficientMemory );
+
+    config = &deviceConfigs_[numDeviceConfigs_++];
+    config->spec = *spec;
+    strncpy( config->name, spec->name ? spec->name : "Null", PA_NULL_MAX_NAME_ - 1 );
+    config->name[PA_NULL_MAX_NAME_ - 1] = '\0';
+    config->spec.name = config->name;
+    if( spec->inputFile )
+        config->spec.inputFile = strcpy( config->inputFile, spec->inputFile );
+    if( spec->outputFile )
+        config->spec.outputFile = strcpy( config->outputFile, spec->outputFile );
+
+error:
+    return result;
+}
+
+void PaNull_ClearDevices( void )
+{
+    numDeviceConfigs_ = 0;
+}
+
+/* Host API */
+
+static PaError CopyString( PaNullHostApiRepresentation *nullHostApi, const char **string )
+{
+    PaError result = paNoError;
+    char *copy;
+
+    PA_UNLESS( copy = PaUtil_GroupAllocateMemory( nullHostApi->allocations, strlen( *string ) + 1 ),
+            paInsufficientMemory );
+    *string = strcpy( copy, *string );
+
+error:
+    return result;
+}
+
+/** Take the channels and sample rate of a device from its input file, if it is a regular WAV file.
+ *
+ * Named pipes aren't opened here, as that would block until the writer shows up and consume the header.
+ */
+static void ProbeInputFile( PaNullDeviceSpec *spec )
+{
+    struct stat fileStat;
+    WAV_Reader reader;
+
+    if( !spec->inputFile || ( spec->flags & paNullRawFiles ) ||
+            stat( spec->inputFile, &fileStat ) != 0 || !S_ISREG( fileStat.st_mode ) )
+        return;
+
+    if( Audio_WAV_OpenReader( &reader, spec->inputFile ) < 0 )
+    {
+        PA_DEBUG(( "%s: %s is not a supported WAV file\n", __FUNCTION__, spec->inputFile ));
+        return;
+    }
+    spec->maxInputChannels = reader.samplesPerFrame;
+    spec->defaultSampleRate = spec->minSampleRate = spec->maxSampleRate = reader.frameRate;
+    Audio_WAV_CloseReader( &reader );
+}
+
+static PaError InitializeDeviceInfo( PaNullHostApiRepresentation *nullHostApi, PaNullDeviceInfo *devInfo,
+        const PaNullDeviceSpec *spec )
+{
+    PaError result = paNoError;
+    PaDeviceInfo *baseDeviceInfo = &devInfo->baseDeviceInfo;
+    double framesPerBuffer = spec->framesPerHostBuffer ? spec->framesPerHostBuffer :
+        PA_NULL_DEFAULT_FRAMES_PER_BUFFER_;
+
+    devInfo->spec = *spec;
+    devInfo->loopback = NULL;
+    PA_ENSURE( CopyString( nullHostApi, &devInfo->spec.name ) );
+    if( spec->inputFile )
+        PA_ENSURE( CopyString( nullHostApi, &devInfo->spec.inputFile ) );
+    if( spec->outputFile )
+        PA_ENSURE( CopyString( nullHostApi, &devInfo->spec.outputFile ) );
+    ProbeInputFile( &devInfo->spec );
+    spec = &devInfo->spec;
+
+    baseDeviceInfo->structVersion = 2;
+    baseDeviceInfo->name = spec->name;
+    baseDeviceInfo->hostApi = nullHostApi->hostApiIndex;
+    baseDeviceInfo->maxInputChannels = spec->maxInputChannels;
+    baseDeviceInfo->maxOutputChannels = spec->maxOutputChannels;
+    baseDeviceInfo->defaultSampleRate = spec->defaultSampleRate;
+    baseDeviceInfo->defaultLowInputLatency = baseDeviceInfo->defaultLowOutputLatency =
+        PA_NULL_NUM_HOST_BUFFERS_ * framesPerBuffer / spec->defaultSampleRate;
+    baseDeviceInfo->defaultHighInputLatency = baseDeviceInfo->defaultHighOutputLatency =
+        4 * baseDeviceInfo->defaultLowInputLatency;
+
+error:
+    return result;
+}
+
+/** Create the output and input devices of a loopback pair.
+ *
+ * The input device has the channels of the output, and its clock runs at loopbackClockRatio relative to the output's.
+ */
+static PaError InitializeLoopbackDevices( PaNullHostApiRepresentation *nullHostApi, PaNullDeviceInfo *outputInfo,
+        PaNullDeviceInfo *inputInfo, const PaNullDeviceSpec *spec )
+{
+    PaError result = paNoError;
+    PaNullDeviceSpec outputSpec = *spec, inputSpec = *spec;
+    char name[PA_NULL_MAX_NAME_ + 8];
+    PaNullLoopback *loopback;
+
+    PA_UNLESS( loopback = (PaNullLoopback *)PaUtil_GroupAllocateMemory( nullHostApi->allocations,
+                sizeof (PaNullLoopback) ), paInsufficientMemory );
+    memset( loopback, 0, sizeof (PaNullLoopback) );
+    loopback->numChannels = spec->maxOutputChannels;
+    loopback->latency = spec->loopbackLatency;
+    loopback->dropoutProbability = spec->loopbackDropoutProbability;
+    PA_ENSURE( PaUnixMutex_Initialize( &loopback->mtx ) );
+    if( pthread_cond_init( &loopback->written, NULL ) != 0 )
+    {
+        PaUnixMutex_Terminate( &loopback->mtx );
+        PA_ENSURE( paInternalError );
+    }
+    nullHostApi->loopbacks[nullHostApi->numLoopbacks++] = loopback;
+
+    snprintf( name, sizeof (name), "%s Output", spec->name );
+    outputSpec.name = name;
+    outputSpec.maxInputChannels = 0;
+    PA_ENSURE( InitializeDeviceInfo( nullHostApi, outputInfo, &outputSpec ) );
+    outputInfo->loopback = loopback;
+
+    snprintf( name, sizeof (name), "%s Input", spec->name );
+    inputSpec.name = name;
+    inputSpec.maxInputChannels = spec->maxOutputChannels;
+    inputSpec.maxOutputChannels = 0;
+    inputSpec.clockRatio *= spec->loopbackClockRatio;
+    PA_ENSURE( InitializeDeviceInfo( nullHostApi, inputInfo, &inputSpec ) );
+    inputInfo->loopback = loopback;
+
+error:
+    return result;
+}
+
+static PaError BuildDeviceList( PaNullHostApiRepresentation *nullHostApi )
+{
+    PaError result = paNoError;
+    PaUtilHostApiRepresentation *baseApi = &nullHostApi->baseHostApiRep;
+    PaNullDeviceInfo *deviceInfoArray;
+    PaNullDeviceSpec defaultSpecs[3];
+    const PaNullDeviceSpec *specs[PA_NULL_MAX_DEVICES_];
+    int i, numSpecs = numDeviceConfigs_, numDevices = 0, numLoopbacks = 0;
+
+    if( numSpecs > 0 )
+    {
+        for( i = 0; i < numSpecs; ++i )
+            specs[i] = &deviceConfigs_[i].spec;
+    }
+    else
+    {
+        for( i = 0; i < 3; ++i )
+        {
+            PaNull_InitializeDeviceSpec( &defaultSpecs[i] );
+            specs[i] = &defaultSpecs[i];
+        }
+        defaultSpecs[1].name = "Null (free-running)";
+        defaultSpecs[1].flags = paNullFreeRunning;
+        defaultSpecs[2].name = "Null Loopback";
+        defaultSpecs[2].flags = paNullLoopback;
+        numSpecs = 3;
+    }
+
+    /* Loopbacks provide two devices */
+    for( i = 0; i < numSpecs; ++i )
+        numLoopbacks += 0 != ( specs[i]->flags & paNullLoopback );
+    numDevices = numSpecs + numLoopbacks;
+
+    PA_UNLESS( baseApi->deviceInfos = (PaDeviceInfo **)PaUtil_GroupAllocateMemory( nullHostApi->allocations,
+                sizeof (PaDeviceInfo *) * numDevices ), paInsufficientMemory );
+    PA_UNLESS( deviceInfoArray = (PaNullDeviceInfo *)PaUtil_GroupAllocateMemory( nullHostApi->allocations,
+                sizeof (PaNullDeviceInfo) * numDevices ), paInsufficientMemory );
+    if( numLoopbacks > 0 )
+    {
+        PA_UNLESS( nullHostApi->loopbacks = (PaNullLoopback **)PaUtil_GroupAllocateMemory( nullHostApi->allocations,
+                    sizeof (PaNullLoopback *) * numLoopbacks ), paInsufficientMemory );
+    }
+
+    for( i = 0, numDevices = 0; i < numSpecs; ++i )
+    {
+        PaNullDeviceInfo *devInfo = &deviceInfoArray[numDevices];
+
+        if( specs[i]->flags & paNullLoopback )
+        {
+            PA_ENSURE( InitializeLoopbackDevices( nullHostApi, devInfo, devInfo + 1, specs[i] ) );
+            baseApi->deviceInfos[numDevices++] = &devInfo->baseDeviceInfo;
+            baseApi->deviceInfos[numDevices++] = &devInfo[1].baseDeviceInfo;
+        }
+        else
+        {
+            PA_ENSURE( InitializeDeviceInfo( nullHostApi, devInfo, specs[i] ) );
+            baseApi->deviceInfos[numDevices++] = &devInfo->baseDeviceInfo;
+        }
+    }
+    baseApi->info.deviceCount = numDevices;
+
+    baseApi->info.defaultInputDevice = paNoDevice;
+    baseApi->info.defaultOutputDevice = paNoDevice;
+    for( i = 0; i < numDevices; ++i )
+    {
+        if( baseApi->info.defaultInputDevice == paNoDevice && baseApi->deviceInfos[i]->maxInputChannels > 0 )
+            baseApi->info.defaultInputDevice = i;
+        if( baseApi->info.defaultOutputDevice == paNoDevice && baseApi->deviceInfos[i]->maxOutputChannels > 0 )
+            baseApi->info.defaultOutputDevice = i;
+    }
+
+error:
+    return result;
+}
+
+static void TerminateLoopbacks( PaNullHostApiRepresentation *nullHostApi )
+{
+    int i;
+
+    for( i = 0; i < nullHostApi->numLoopbacks; ++i )
+    {
+        assert( !nullHostApi->loopbacks[i]->writer );
+        pthread_cond_destroy( &nullHostApi->loopbacks[i]->written );
+        PaUnixMutex_Terminate( &nullHostApi->loopbacks[i]->mtx );
+    }
+    nullHostApi->numLoopbacks = 0;
+}
+
+PaError PaNull_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex hostApiIndex )
+{
+    PaError result = paNoError;
+    PaNullHostApiRepresentation *nullHostApi = NULL;
+
+    PA_UNLESS( nullHostApi = (PaNullHostApiRepresentation*)PaUtil_AllocateMemory(
+                sizeof(PaNullHostApiRepresentation) ), paInsufficientMemory );
+    memset( nullHostApi, 0, sizeof (PaNullHostApiRepresentation) );
+    PA_UNLESS( nullHostApi->allocations = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
+    nullHostApi->hostApiIndex = hostApiIndex;
+
+    *hostApi = (PaUtilHostApiRepresentation*)nullHostApi;
+    (*hostApi)->info.structVersion = 1;
+    (*hostApi)->info.type = paInDevelopment;
+    (*hostApi)->info.name = "Null";
+
+    (*hostApi)->Terminate = Terminate;
+    (*hostApi)->OpenStream = OpenStream;
+    (*hostApi)->IsFormatSupported = IsFormatSupported;
+
+    PA_ENSURE( BuildDeviceList( nullHostApi ) );
+
+    PaUtil_InitializeStreamInterface( &nullHostApi->callbackStreamInterface,
+                                      CloseStream, StartStream,
+                                      StopStream, AbortStream,
+                                      IsStreamStopped, IsStreamActive,
+                                      GetStreamTime, GetStreamCpuLoad,
+                                      PaUtil_DummyRead, PaUtil_DummyWrite,
+                                      PaUtil_DummyGetReadAvailable,
+                                      PaUtil_DummyGetWriteAvailable );
+
+    PaUtil_InitializeStreamInterface( &nullHostApi->blockingStreamInterface,
+                                      CloseStream, StartStream,
+                                      StopStream, AbortStream,
+                                      IsStreamStopped, IsStreamActive,
+                                      GetStreamTime, PaUtil_DummyGetCpuLoad,
+                                      ReadStream, WriteStream,
+                                      GetStreamReadAvailable,
+                                      GetStreamWriteAvailable );
+
+    PA_ENSURE( PaUnixThreading_Initialize() );
+
+    return result;
+
+error:
+    if( nullHostApi )
+    {
+        TerminateLoopbacks( nullHostApi );
+        if( nullHostApi->allocations )
+        {
+            PaUtil_FreeAllAllocations( nullHostApi->allocations );
+            PaUtil_DestroyAllocationGroup( nullHostApi->allocations );
+        }
+
+        PaUtil_FreeMemory( nullHostApi );
+    }
+
+    return result;
+}
+
+static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
+{
+    PaNullHostApiRepresentation *nullHostApi = (PaNullHostApiRepresentation*)hostApi;
+
+    assert( hostApi );
+
+    TerminateLoopbacks( nullHostApi );
+    if( nullHostApi->allocations )
+    {
+        PaUtil_FreeAllAllocations( nullHostApi->allocations );
+        PaUtil_DestroyAllocationGroup( nullHostApi->allocations );
+    }
+
+    PaUtil_FreeMemory( nullHostApi );
+}
+
+static const PaNullDeviceInfo *GetDeviceInfo( const PaUtilHostApiRepresentation *hostApi, int device )
+{
+    return (const PaNullDeviceInfo *)hostApi->deviceInfos[device];
+}
+
+static PaError ValidateParameters( struct PaUtilHostApiRepresentation *hostApi, const PaStreamParameters *parameters,
+        int isInput, double sampleRate )
+{
+    PaError result = paNoError;
+    const PaNullDeviceSpec *spec;
+
+    /* all standard sample formats are supported by the buffer adapter,
+        this implementation doesn't support any custom sample formats */
+    PA_UNLESS( !( parameters->sampleFormat & paCustomFormat ), paSampleFormatNotSupported );
+    PA_UNLESS( parameters->device != paUseHostApiSpecificDeviceSpecification, paInvalidDevice );
+    PA_UNLESS( !parameters->hostApiSpecificStreamInfo, paIncompatibleHostApiSpecificStreamInfo );
+
+    spec = &GetDeviceInfo( hostApi, parameters->device )->spec;
+    PA_UNLESS( parameters->channelCount <= ( isInput ? spec->maxInputChannels : spec->maxOutputChannels ),
+            paInvalidChannelCount );
+    PA_UNLESS( ( spec->minSampleRate <= 0 || sampleRate >= spec->minSampleRate ) &&
+            ( spec->maxSampleRate <= 0 || sampleRate <= spec->maxSampleRate ), paInvalidSampleRate );
+
+error:
+    return result;
+}
+
+static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
+                                  const PaStreamParameters *inputParameters,
+                                  const PaStreamParameters *outputParameters,
+                                  double sampleRate )
+{
+    PaError result = paNoError;
+
+    if( inputParameters )
+        PA_ENSURE( ValidateParameters( hostApi, inputParameters, 1, sampleRate ) );
+    if( outputParameters )
+        PA_ENSURE( ValidateParameters( hostApi, outputParameters, 0, sampleRate ) );
+
+    return paFormatIsSupported;
+
+error:
+    return result;
+}
+
+/* Stream */
+
+/** Report the failure of a file operation as a host error. */
+static PaError FileError( void )
+{
+    PaUtil_SetLastHostErrorInfo( paInDevelopment, errno, strerror( errno ) );
+    return paUnanticipatedHostError;
+}
+
+/** Open the file backing a component, if its device has one.
+ *
+ * Files are interleaved, and WAV files are 16 bit, so this determines the component's host format.
+ */
+static PaError PaNullStreamComponent_OpenFile( PaNullStreamComponent *self, int isInput, double sampleRate )
+{
+    PaError result = paNoError;
+    const PaNullDeviceSpec *spec = &self->device->spec;
+    const char *fileName = isInput ? spec->inputFile : spec->outputFile;
+
+    if( !fileName )
+        return paNoError;
+
+    self->hostInterleaved = 1;
+    if( spec->flags & paNullRawFiles )
+    {
+        /* Raw input files have as many channels as the device */
+        if( isInput )
+            self->numHostChannels = spec->maxInputChannels;
+        PA_UNLESS( self->rawFile = fopen( fileName, isInput ? "rb" : "wb" ), paDeviceUnavailable );
+    }
+    else if( isInput )
+    {
+        self->hostSampleFormat = paInt16;
+        PA_UNLESS( Audio_WAV_OpenReader( &self->wavReader, fileName ) >= 0, paDeviceUnavailable );
+        PA_UNLESS( self->wavReader.samplesPerFrame >= self->numChannels, paInvalidChannelCount );
+        PA_UNLESS( self->wavReader.frameRate == (int)sampleRate, paInvalidSampleRate );
+        self->numHostChannels = self->wavReader.samplesPerFrame;
+    }
+    else
+    {
+        self->hostSampleFormat = paInt16;
+        PA_UNLESS( Audio_WAV_OpenWriter( &self->wavWriter, fileName, (int)sampleRate, self->numChannels ) >= 0,
+                paDeviceUnavailable );
+    }
+
+error:
+    return result;
+}
+
+static void PaNullStreamComponent_CloseFile( PaNullStreamComponent *self )
+{
+    if( self->rawFile )
+        fclose( self->rawFile );
+    if( self->wavReader.fid )
+        Audio_WAV_CloseReader( &self->wavReader );
+    /* This fails on pipes, which can't be rewound to complete the header */
+    if( self->wavWriter.fid && Audio_WAV_CloseWriter( &self->wavWriter ) < 0 )
+    {
+        PA_DEBUG(( "%s: Failed to complete the header of %s\n", __FUNCTION__, self->device->spec.outputFile ));
+    }
+    self->rawFile = NULL;
+}
+
+static int PaNullStreamComponent_HasFile( const PaNullStreamComponent *self )
+{
+    return self->rawFile || self->wavReader.fid || self->wavWriter.fid;
+}
+
+/** Fill the host buffer from the input file, with silence past its end. */
+static PaError PaNullStreamComponent_ReadFile( PaNullStreamComponent *self, unsigned long frames )
+{
+    PaError result = paNoError;
+    const unsigned long bytesPerFrame = self->numHostChannels * Pa_GetSampleSize( self->hostSampleFormat );
+    unsigned long framesRead = 0;
+
+    if( !self->endOfFile )
+    {
+        if( self->rawFile )
+        {
+            framesRead = fread( self->buffer, bytesPerFrame, frames, self->rawFile );
+            PA_UNLESS( !ferror( self->rawFile ), FileError() );
+        }
+        else
+        {
+            long samplesRead = Audio_WAV_ReadShorts( &self->wavReader, self->buffer, frames * self->numHostChannels );
+            PA_UNLESS( samplesRead >= 0, FileError() );
+            framesRead = samplesRead / self->numHostChannels;
+        }
+        /* The end of a WAV file's data is known, so that the stream completes with its last frame rather than after
+         * a buffer of silence */
+        self->endOfFile = framesRead < frames || ( self->wavReader.fid && 0 == self->wavReader.dataSizeRemaining );
+    }
+    self->framesRead = framesRead;
+
+    if( framesRead < frames )
+        memset( (unsigned char *)self->buffer + framesRead * bytesPerFrame, 0, ( frames - framesRead ) * bytesPerFrame );
+
+error:
+    return result;
+}
+
+/** Write the host buffer to the output file. */
+static PaError PaNullStreamComponent_WriteFile( PaNullStreamComponent *self, unsigned long frames )
+{
+    PaError result = paNoError;
+
+    if( frames == 0 )
+        return paNoError;
+
+    if( self->rawFile )
+    {
+        PA_UNLESS( fwrite( self->buffer, self->numHostChannels * Pa_GetSampleSize( self->hostSampleFormat ), frames,
+                    self->rawFile ) == frames, FileError() );
+    }
+    else
+    {
+        PA_UNLESS( Audio_WAV_WriteShorts( &self->wavWriter, self->buffer, frames * self->numHostChannels ) >= 0,
+                FileError() );
+    }
+
+error:
+    return result;
+}
+
+/** Account for frames lost to an xrun: they are skipped in input files, output files get silence. */
+static PaError PaNullStreamComponent_SkipFrames( PaNullStreamComponent *self, double frames, int isInput )
+{
+    PaError result = paNoError;
+
+    if( !PaNullStreamComponent_HasFile( self ) )
+        return paNoError;
+
+    if( !isInput )
+        memset( self->buffer, 0, self->framesPerHostBuffer * self->numHostChannels *
+                Pa_GetSampleSize( self->hostSampleFormat ) );
+    while( frames > 0 )
+    {
+        unsigned long framesToSkip = (unsigned long)PA_MIN( frames, self->framesPerHostBuffer );
+        if( isInput )
+        {
+            PA_ENSURE( PaNullStreamComponent_ReadFile( self, framesToSkip ) );
+        }
+        else
+        {
+            PA_ENSURE( PaNullStreamComponent_WriteFile( self, framesToSkip ) );
+        }
+        frames -= framesToSkip;
+    }
+
+error:
+    return result;
+}
+
+static PaError PaNullStreamComponent_Initialize( PaNullStreamComponent *self, PaUtilHostApiRepresentation *hostApi,
+        const PaStreamParameters *parameters, unsigned long framesPerHostBuffer, int isInput, double sampleRate )
+{
+    PaError result = paNoError;
+
+    self->device = GetDeviceInfo( hostApi, parameters->device );
+    self->numChannels = self->numHostChannels = parameters->channelCount;
+    self->hostSampleFormat = self->device->spec.hostSampleFormat & ~paNonInterleaved;
+    self->hostInterleaved = !( self->device->spec.hostSampleFormat & paNonInterleaved );
+    self->framesPerHostBuffer = framesPerHostBuffer;
+
+    PA_ENSURE( PaNullStreamComponent_OpenFile( self, isInput, sampleRate ) );
+
+    if( self->device->loopback )
+    {
+        /* The input captures all of the loopback's channels, which are carried as float */
+        self->hostInterleaved = 1;
+        if( isInput )
+            self->numHostChannels = self->device->loopback->numChannels;
+        PA_UNLESS( self->loopbackBuffer = PaUtil_AllocateMemory( framesPerHostBuffer * self->numHostChannels *
+                    sizeof (float) ), paInsufficientMemory );
+        self->loopbackConverter = isInput ? PaUtil_SelectConverter( paFloat32, self->hostSampleFormat, paDitherOff ) :
+            PaUtil_SelectConverter( self->hostSampleFormat, paFloat32, paNoFlag );
+    }
+
+    PA_UNLESS( self->buffer = PaUtil_AllocateBufferMemory( framesPerHostBuffer * self->numHostChannels *
+                Pa_GetSampleSize( self->hostSampleFormat ), paUtilPrefaultBufferMemory ), paInsufficientMemory );
+    memset( self->buffer, 0, framesPerHostBuffer * self->numHostChannels *
+            Pa_GetSampleSize( self->hostSampleFormat ) );
+
+    if( parameters->sampleFormat & paNonInterleaved )
+    {
+        PA_UNLESS( self->userBuffers = PaUtil_AllocateMemory( sizeof (void *) * self->numChannels ),
+                paInsufficientMemory );
+    }
+
+error:
+    return result;
+}
+
+static void PaNullStreamComponent_Terminate( PaNullStreamComponent *self )
+{
+    PaNullStreamComponent_CloseFile( self );
+    PaUtil_FreeBufferMemory( self->buffer );
+    PaUtil_FreeMemory( self->userBuffers );
+    PaUtil_FreeMemory( self->loopbackBuffer );
+}
+
+static PaSampleFormat PaNullStreamComponent_GetHostFormat( const PaNullStreamComponent *self )
+{
+    return self->device ? self->hostSampleFormat | ( self->hostInterleaved ? 0 : paNonInterleaved ) : 0;
+}
+
+/** Register a component's host buffer with the buffer processor. */
+static void PaNullStreamComponent_RegisterChannels( PaNullStreamComponent *self, PaUtilBufferProcessor *bp,
+        unsigned long frames, unsigned long framesPerHostBuffer, int isInput )
+{
+    int i;
+
+    if( self->hostInterleaved )
+    {
+        if( isInput )
+        {
+            /* The host buffer may have more channels than the stream, taken from an input file */
+            const unsigned int bytesPerSample = Pa_GetSampleSize( self->hostSampleFormat );
+            for( i = 0; i < self->numChannels; ++i )
+                PaUtil_SetInputChannel( bp, i, (unsigned char *)self->buffer + i * bytesPerSample,
+                        self->numHostChannels );
+        }
+        else
+            PaUtil_SetInterleavedOutputChannels( bp, 0, self->buffer, self->numChannels );
+    }
+    else
+    {
+        const unsigned long channelSize = framesPerHostBuffer * Pa_GetSampleSize( self->hostSampleFormat );
+
+        for( i = 0; i < self->numChannels; ++i )
+        {
+            void *channel = (unsigned char *)self->buffer + i * channelSize;
+            if( isInput )
+                PaUtil_SetNonInterleavedInputChannel( bp, i, channel );
+            else
+                PaUtil_SetNonInterleavedOutputChannel( bp, i, channel );
+        }
+    }
+
+    if( isInput )
+        PaUtil_SetInputFrameCount( bp, frames );
+    else
+        PaUtil_SetOutputFrameCount( bp, frames );
+}
+
+/** Make a stream the writer of a loopback, there can only be one at a time. */
+static PaError PaNullLoopback_Attach( PaNullLoopback *self, const struct PaNullStream *writer, double sampleRate,
+        unsigned long framesPerHostBuffer )
+{
+    PaError result = paNoError;
+    int locked = 0;
+
+    PA_ENSURE( PaUnixMutex_Lock( &self->mtx ) );
+    locked = 1;
+    PA_UNLESS( !self->writer, paDeviceUnavailable );
+
+    self->bufferFrames = (unsigned long)ceil( ( self->latency + PA_NULL_LOOPBACK_SLACK_ ) * sampleRate ) +
+        2 * PA_NULL_NUM_HOST_BUFFERS_ * framesPerHostBuffer;
+    PA_UNLESS( self->buffer = PaUtil_AllocateMemory( self->bufferFrames * self->numChannels * sizeof (float) ),
+            paInsufficientMemory );
+    self->writer = writer;
+    self->writerActive = 0;
+    /* The timeline is set by the first write */
+    self->writerStartTime = -1;
+    self->framesWritten = 0;
+
+error:
+    if( locked )
+        PaUnixMutex_Unlock( &self->mtx );
+    return result;
+}
+
+static void PaNullLoopback_Detach( PaNullLoopback *self )
+{
+    PaUnixMutex_Lock( &self->mtx );
+    PaUtil_FreeMemory( self->buffer );
+    self->buffer = NULL;
+    self->writer = NULL;
+    self->writerActive = 0;
+    self->framesWritten = 0;
+    pthread_cond_broadcast( &self->written );
+    PaUnixMutex_Unlock( &self->mtx );
+}
+
+/** Stop waiting readers from waiting for the frames of a writer that has stopped. */
+static void PaNullLoopback_StopWriter( PaNullLoopback *self )
+{
+    PaUnixMutex_Lock( &self->mtx );
+    self->writerActive = 0;
+    pthread_cond_broadcast( &self->written );
+    PaUnixMutex_Unlock( &self->mtx );
+}
+
+/** A frame of the loopback's buffer, or NULL if it hasn't been written or was overwritten. */
+static float *PaNullLoopback_GetFrame( const PaNullLoopback *self, double frame )
+{
+    if( frame < 0 || frame >= self->framesWritten || frame < self->framesWritten - self->bufferFrames )
+        return NULL;
+    return self->buffer + (unsigned long)fmod( frame, self->bufferFrames ) * self->numChannels;
+}
+
+static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
+                           PaStream** s,
+                           const PaStreamParameters *inputParameters,
+                           const PaStreamParameters *outputParameters,
+                           double sampleRate,
+                           unsigned long framesPerBuffer,
+                           PaStreamFlags streamFlags,
+                           PaStreamCallback *streamCallback,
+                           void *userData )
+{
+    PaError result = paNoError;
+    PaNullHostApiRepresentation *nullHostApi = (PaNullHostApiRepresentation*)hostApi;
+    PaNullStream *stream = NULL;
+    const PaNullDeviceSpec *spec;
+    double hostSampleRate = sampleRate;
+    int bufferProcessorInitialized = 0, mutexInitialized = 0, loopbackAttached = 0;
+
+    if( ( streamFlags & paPlatformSpecificFlags ) != 0 )
+        return paInvalidFlag;
+
+    /* The output device drives full duplex streams */
+    spec = &GetDeviceInfo( hostApi, ( outputParameters ? outputParameters : inputParameters )->device )->spec;
+
+    /* When converting, a device which doesn't support the rate runs at its default one */
+    if( ( streamFlags & paConvertSampleRate ) && ( ( spec->minSampleRate > 0 && sampleRate < spec->minSampleRate ) ||
+                ( spec->maxSampleRate > 0 && sampleRate > spec->maxSampleRate ) ) )
+    {
+        hostSampleRate = spec->defaultSampleRate;
+    }
+
+    if( inputParameters )
+        PA_ENSURE( ValidateParameters( hostApi, inputParameters, 1, hostSampleRate ) );
+    if( outputParameters )
+        PA_ENSURE( ValidateParameters( hostApi, outputParameters, 0, hostSampleRate ) );
+
+    PA_UNLESS( stream = (PaNullStream*)PaUtil_AllocateMemory( sizeof(PaNullStream) ), paInsufficientMemory );
+    memset( stream, 0, sizeof (PaNullStream) );
+
+    stream->clockSpec = spec;
+    stream->freeRunning = 0 != ( spec->flags & paNullFreeRunning );
+    stream->sampleRate = hostSampleRate;
+    stream->framesPerHostBuffer = spec->framesPerHostBuffer;
+    if( !stream->framesPerHostBuffer )
+    {
+        stream->framesPerHostBuffer = framesPerBuffer != paFramesPerBufferUnspecified ? framesPerBuffer :
+            PA_NULL_DEFAULT_FRAMES_PER_BUFFER_;
+    }
+    stream->randomSeed = (unsigned int)(size_t)stream;
+
+    if( streamCallback )
+    {
+        PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
+                &nullHostApi->callbackStreamInterface, streamCallback, userData );
+        stream->callbackMode = 1;
+        PaUtil_InitializeClockEstimator( &stream->clock, hostSampleRate );
+        stream->streamRepresentation.clockEstimator = &stream->clock;
+    }
+    else
+    {
+        PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
+                &nullHostApi->blockingStreamInterface, streamCallback, userData );
+    }
+    /* The buffer processor reports the frames processed at the device rate */
+    PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, hostSampleRate );
+
+    if( inputParameters )
+        PA_ENSURE( PaNullStreamComponent_Initialize( &stream->capture, hostApi, inputParameters,
+                    stream->framesPerHostBuffer, 1, hostSampleRate ) );
+    if( outputParameters )
+        PA_ENSURE( PaNullStreamComponent_Initialize( &stream->playback, hostApi, outputParameters,
+                    stream->framesPerHostBuffer, 0, hostSampleRate ) );
+
+    PA_ENSURE( PaUtil_InitializeBufferProcessor( &stream->bufferProcessor,
+                inputParameters ? inputParameters->channelCount : 0,
+                inputParameters ? inputParameters->sampleFormat : 0,
+                PaNullStreamComponent_GetHostFormat( &stream->capture ),
+                outputParameters ? outputParameters->channelCount : 0,
+                outputParameters ? outputParameters->sampleFormat : 0,
+                PaNullStreamComponent_GetHostFormat( &stream->playback ),
+                sampleRate, streamFlags, framesPerBuffer, stream->framesPerHostBuffer, paUtilFixedHostBufferSize,
+                streamCallback, userData ) );
+    bufferProcessorInitialized = 1;
+    stream->streamRepresentation.callbackProfiler = stream->bufferProcessor.callbackProfiler;
+
+    if( hostSampleRate != sampleRate )
+    {
+        PA_DEBUG(( "%s: Converting between %f Hz (device) and %f Hz\n", __FUNCTION__, hostSampleRate, sampleRate ));
+        PA_ENSURE( PaUtil_InitializeBufferProcessorSampleRateConverter( &stream->bufferProcessor, hostSampleRate ) );
+    }
+
+    PA_ENSURE( PaUnixMutex_Initialize( &stream->blockingMtx ) );
+    mutexInitialized = 1;
+
+    if( outputParameters && stream->playback.device->loopback )
+    {
+        PA_ENSURE( PaNullLoopback_Attach( stream->playback.device->loopback, stream,
+                    hostSampleRate * spec->clockRatio, stream->framesPerHostBuffer ) );
+        loopbackAttached = 1;
+    }
+
+    stream->streamRepresentation.streamInfo.sampleRate = sampleRate;
+    if( inputParameters )
+    {
+        stream->streamRepresentation.streamInfo.inputLatency = (PaTime)stream->framesPerHostBuffer / hostSampleRate +
+            (PaTime)PaUtil_GetBufferProcessorInputLatencyFrames( &stream->bufferProcessor ) / sampleRate;
+    }
+    if( outputParameters )
+    {
+        stream->streamRepresentation.streamInfo.outputLatency = (PaTime)( PA_NULL_NUM_HOST_BUFFERS_ *
+                stream->framesPerHostBuffer ) / hostSampleRate +
+            (PaTime)PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor ) / sampleRate;
+    }
+
+    stream->isStopped = 1;
+    stream->startTime = PaUtil_GetTime();
+
+    *s = (PaStream*)stream;
+
+    return result;
+
+error:
+    if( stream )
+    {
+        if( loopbackAttached )
+            PaNullLoopback_Detach( stream->playback.device->loopback );
+        if( mutexInitialized )
+            PaUnixMutex_Terminate( &stream->blockingMtx );
+        if( bufferProcessorInitialized )
+            PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
+        PaNullStreamComponent_Terminate( &stream->capture );
+        PaNullStreamComponent_Terminate( &stream->playback );
+        PaUtil_FreeMemory( stream );
+    }
+
+    return result;
+}
+
+static PaError CloseStream( PaStream* s )
+{
+    PaError result = paNoError;
+    PaNullStream *stream = (PaNullStream*)s;
+
+    if( stream->playback.device && stream->playback.device->loopback )
+        PaNullLoopback_Detach( stream->playback.device->loopback );
+    PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
+    PaUtil_TerminateStreamRepresentation( &stream->streamRepresentation );
+    PaUnixMutex_Terminate( &stream->blockingMtx );
+    PaNullStreamComponent_Terminate( &stream->capture );
+    PaNullStreamComponent_Terminate( &stream->playback );
+    PaUtil_FreeMemory( stream );
+
+    return result;
+}
+
+/** The system time at which the device's clock reaches a position, in frames since the stream was started. */
+static PaTime PaNullStream_FramesToTime( const PaNullStream *self, double frames )
+{
+    return self->startTime + frames / ( self->sampleRate * self->clockSpec->clockRatio );
+}
+
+/** The position of the device's clock at a system time. */
+static double PaNullStream_TimeToFrames( const PaNullStream *self, PaTime time )
+{
+    return ( time - self->startTime ) * self->sampleRate * self->clockSpec->clockRatio;
+}
+
+/** Sleep until a system time, this is a cancellation point. */
+static void SleepUntil( PaTime time )
+{
+    PaTime remaining = time - PaUtil_GetTime();
+
+    if( remaining > 0 )
+    {
+        struct timespec ts;
+        ts.tv_sec = (time_t)remaining;
+        ts.tv_nsec = (long)( ( remaining - ts.tv_sec ) * 1e9 );
+        nanosleep( &ts, NULL );
+    }
+}
+
+/** Draw whether a random event of some probability occurs. */
+static int PaNullStream_Chance( PaNullStream *self, double probability )
+{
+    return probability > 0 && rand_r( &self->randomSeed ) < probability * RAND_MAX;
+}
+
+static PaStreamCallbackFlags PaNullStream_XrunFlags( const PaNullStream *self )
+{
+    return ( self->capture.device ? paInputOverflow : 0 ) | ( self->playback.device ? paOutputUnderflow : 0 );
+}
+
+/** Skip the frames lost to an xrun in the stream's files. */
+static PaError PaNullStream_SkipFrames( PaNullStream *self, double frames )
+{
+    PaError result = paNoError;
+
+    PA_ENSURE( PaNullStreamComponent_SkipFrames( &self->capture, frames, 1 ) );
+    PA_ENSURE( PaNullStreamComponent_SkipFrames( &self->playback, frames, 0 ) );
+
+error:
+    return result;
+}
+
+/** The frame of a loopback's writer heard at a position of the reading stream, minus the writer's start. */
+static double PaNullStream_LoopbackSource( const PaNullStream *self, const PaNullLoopback *loopback,
+        double position )
+{
+    return ( PaNullStream_FramesToTime( self, position ) - loopback->latency - loopback->writerStartTime ) *
+        loopback->writerRate - loopback->writerLatencyFrames;
+}
+
+/** Capture the input host buffer from a loopback, for the frames starting at a position of the stream.
+ *
+ * Each frame gets what was played at its time minus the loopback's latency, interpolated between the frames
+ * of the writer. The writer's thread may be late like any other, so the frames it hasn't written yet are waited
+ * for up to PA_NULL_MAX_LATENESS_. Frames which the writer is still late with, or has overwritten since, are
+ * silent and flagged with paInputUnderflow or paInputOverflow. Frames before the writer started, or after it
+ * stopped, are silent.
+ */
+static PaError PaNullStream_ReadLoopback( PaNullStream *self, double position, unsigned long frames,
+        PaStreamCallbackFlags *flags )
+{
+    PaError result = paNoError;
+    PaNullStreamComponent *component = &self->capture;
+    PaNullLoopback *loopback = component->device->loopback;
+    const int numChannels = loopback->numChannels;
+    float *dest = component->loopbackBuffer;
+    PaStreamCallbackFlags xrunFlags = 0;
+    unsigned long i;
+    int j;
+
+    PA_ENSURE( PaUnixMutex_Lock( &loopback->mtx ) );
+
+    /* A full duplex stream has played the frames it captures, only readers of another stream wait for them */
+    if( loopback->writer != self && loopback->writerActive )
+    {
+        struct timespec deadline;
+        int res = 0, cancelState;
+
+        /* condition variables wait on the real-time clock by default */
+        clock_gettime( CLOCK_REALTIME, &deadline );
+        deadline.tv_sec += (time_t)PA_NULL_MAX_LATENESS_;
+        deadline.tv_nsec += (long)( ( PA_NULL_MAX_LATENESS_ - (time_t)PA_NULL_MAX_LATENESS_ ) * 1e9 );
+        if( deadline.tv_nsec >= 1000000000 )
+        {
+            deadline.tv_nsec -= 1000000000;
+            ++deadline.tv_sec;
+        }
+
+        /* Waiting is bounded, so it isn't made a cancellation point which would leave the mutex locked */
+        pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, &cancelState );
+        /* The last frame is interpolated with the one after it */
+        while( loopback->writerActive && ETIMEDOUT != res && loopback->framesWritten <=
+                floor( PaNullStream_LoopbackSource( self, loopback, position + frames - 1 ) ) + 1 )
+        {
+            res = pthread_cond_timedwait( &loopback->written, &loopback->mtx.mtx, &deadline );
+        }
+        pthread_setcancelstate( cancelState, NULL );
+    }
+
+    if( loopback->writer && loopback->writerStartTime >= 0 )
+    {
+        const double step = loopback->writerRate / ( self->sampleRate * self->clockSpec->clockRatio );
+        double source = PaNullStream_LoopbackSource( self, loopback, position );
+
+        for( i = 0; i < frames; ++i, source += step )
+        {
+            const double index = floor( source );
+            const float fraction = (float)( source - index );
+            const float *previous = PaNullLoopback_GetFrame( loopback, index );
+            const float *next = PaNullLoopback_GetFrame( loopback, index + 1 );
+
+            if( index >= 0 && index < loopback->framesWritten - loopback->bufferFrames )
+                xrunFlags |= paInputOverflow;
+            else if( loopback->writerActive && index + 1 >= loopback->framesWritten )
+                xrunFlags |= paInputUnderflow;
+
+            for( j = 0; j < numChannels; ++j )
+                *dest++ = ( previous ? ( 1.f - fraction ) * previous[j] : 0.f ) + ( next ? fraction * next[j] : 0.f );
+        }
+    }
+    else
+    {
+        memset( dest, 0, frames * numChannels * sizeof (float) );
+    }
+    PA_ENSURE( PaUnixMutex_Unlock( &loopback->mtx ) );
+
+    if( xrunFlags )
+    {
+        PA_DEBUG(( "%s: Frames of the loopback weren't available\n", __FUNCTION__ ));
+        ++self->statistics.loopbackXruns;
+        *flags |= xrunFlags;
+    }
+
+    component->loopbackConverter( component->buffer, 1, component->loopbackBuffer, 1, frames * numChannels, NULL );
+
+error:
+    return result;
+}
+
+/** Play the output host buffer to a loopback, for the frames starting at a position of the stream.
+ *
+ * Frames skipped since the last write are silent, as is the whole buffer if a dropout is injected.
+ */
+static PaError PaNullStream_WriteLoopback( PaNullStream *self, double position, unsigned long frames )
+{
+    PaError result = paNoError;
+    PaNullStreamComponent *component = &self->playback;
+    PaNullLoopback *loopback = component->device->loopback;
+    const float *source = component->loopbackBuffer;
+    const int dropout = PaNullStream_Chance( self, loopback->dropoutProbability );
+    unsigned long i;
+    int j;
+
+    component->loopbackConverter( component->loopbackBuffer, 1, component->buffer, 1,
+            frames * component->numChannels, NULL );
+    if( dropout )
+        ++self->statistics.loopbackDropouts;
+
+    PA_ENSURE( PaUnixMutex_Lock( &loopback->mtx ) );
+    if( loopback->writerStartTime != self->startTime )
+    {
+        /* The stream was (re)started, frames are played from its new start time on */
+        loopback->writerStartTime = self->startTime;
+        loopback->writerRate = self->sampleRate * self->clockSpec->clockRatio;
+        /* Callback streams play a host buffer after the device's buffer, blocking writes at their position */
+        loopback->writerLatencyFrames = self->callbackMode ? PA_NULL_NUM_HOST_BUFFERS_ * self->framesPerHostBuffer : 0;
+        loopback->framesWritten = 0;
+    }
+    loopback->writerActive = 1;
+
+    loopback->framesWritten = PA_MAX( loopback->framesWritten, position - loopback->bufferFrames );
+    for( ; loopback->framesWritten < position; ++loopback->framesWritten )
+        memset( loopback->buffer + (unsigned long)fmod( loopback->framesWritten, loopback->bufferFrames ) *
+                loopback->numChannels, 0, loopback->numChannels * sizeof (float) );
+
+    for( i = 0; i < frames; ++i, source += component->numChannels )
+    {
+        float *frame = loopback->buffer + (unsigned long)fmod( position + i, loopback->bufferFrames ) *
+            loopback->numChannels;
+        for( j = 0; j < loopback->numChannels; ++j )
+            frame[j] = !dropout && j < component->numChannels ? source[j] : 0.f;
+    }
+    loopback->framesWritten = PA_MAX( loopback->framesWritten, position + frames );
+    pthread_cond_broadcast( &loopback->written );
+    PA_ENSURE( PaUnixMutex_Unlock( &loopback->mtx ) );
+
+error:
+    return result;
+}
+
+/** Clean up after thread exit.
+ *
+ * Aspect StreamState: If the user has registered a streamFinishedCallback it will be called here
+ */
+static void OnExit( void *data )
+{
+    PaNullStream *stream = (PaNullStream *) data;
+
+    assert( data );
+
+    PaUtil_ResetCpuLoadMeasurer( &stream->cpuLoadMeasurer );
+
+    /* Readers of the loopback don't wait for frames which won't be played */
+    if( stream->playback.device && stream->playback.device->loopback )
+        PaNullLoopback_StopWriter( stream->playback.device->loopback );
+
+    /* Eventually notify user all buffers have played */
+    if( stream->streamRepresentation.streamFinishedCallback )
+    {
+        stream->streamRepresentation.streamFinishedCallback( stream->streamRepresentation.userData );
+    }
+    stream->isActive = 0;
+}
+
+/** Thread procedure for callback processing.
+ *
+ * A host buffer is processed whenever the device's clock has advanced by one, if the jitter makes the thread fall
+ * behind by more than the device's buffer the frames in between are lost. Being woken late by the system is
+ * caught up on, unless the thread falls behind by more than PA_NULL_MAX_LATENESS_. Free-running streams process
+ * host buffers back to back, with timestamps derived from the frames processed. The stream completes at the end
+ * of its input file, which is also where its output file ends.
+ */
+static void *CallbackThreadFunc( void *userData )
+{
+    /* Changed after pthread_cleanup_push, which may be implemented with setjmp */
+    volatile PaError result = paNoError;
+    volatile PaStreamCallbackFlags cbFlags = 0;
+    PaNullStream *stream = (PaNullStream*) userData;
+    const PaNullDeviceSpec *spec = stream->clockSpec;
+    const unsigned long framesPerHostBuffer = stream->framesPerHostBuffer;
+    int callbackResult = paContinue;
+
+    assert( stream );
+
+    /* Execute OnExit when exiting */
+    pthread_cleanup_push( &OnExit, stream );
+
+    PA_ENSURE( PaUnixThread_PrepareNotify( &stream->thread ) );
+    if( !stream->freeRunning )
+        stream->startTime = PaUtil_GetTime();
+    PA_ENSURE( PaUnixThread_NotifyParent( &stream->thread ) );
+
+    while( 1 )
+    {
+        PaStreamCallbackTimeInfo timeInfo = {0, 0, 0};
+        double position = stream->statistics.framesProcessed;
+        PaTime bufferTime, now;
+        unsigned long framesProcessed;
+
+#ifdef PTHREAD_CANCELED
+        pthread_testcancel();
+#endif
+
+        /* @concern StreamStop if the main thread has requested a stop and the stream has not been effectively
+         * stopped we signal this condition by modifying callbackResult (we'll want to flush buffered output).
+         */
+        if( PaUnixThread_StopRequested( &stream->thread ) && paContinue == callbackResult )
+        {
+            PA_DEBUG(( "Setting callbackResult to paComplete\n" ));
+            callbackResult = paComplete;
+        }
+
+        if( paContinue != callbackResult )
+        {
+            stream->callbackAbort = ( paAbort == callbackResult );
+            if( stream->callbackAbort ||
+                    /** @concern BlockAdaption: Go on if adaption buffers are empty */
+                    PaUtil_IsBufferProcessorOutputEmpty( &stream->bufferProcessor ) )
+            {
+                goto end;
+            }
+        }
+
+        /* The host buffer is complete when the device's clock has advanced past it */
+        bufferTime = PaNullStream_FramesToTime( stream, position + framesPerHostBuffer );
+        if( stream->freeRunning )
+        {
+            now = bufferTime;
+        }
+        else
+        {
+            PaTime jitter = spec->maxJitter > 0 ? spec->maxJitter * rand_r( &stream->randomSeed ) / RAND_MAX : 0;
+            PaTime wakeupTime = bufferTime + jitter;
+            double lag;
+
+            SleepUntil( wakeupTime );
+            now = PaUtil_GetTime();
+
+            /* The thread doesn't run at real-time priority, so it catches up on the system waking it late by
+             * processing host buffers back to back. Only the jitter, or lateness beyond PA_NULL_MAX_LATENESS_,
+             * counts against the device's buffer.
+             */
+            lag = PaNullStream_TimeToFrames( stream, now - wakeupTime > PA_NULL_MAX_LATENESS_ ? now :
+                    PA_MIN( now, wakeupTime ) ) - position;
+            if( lag > PA_NULL_NUM_HOST_BUFFERS_ * framesPerHostBuffer )
+            {
+                /* Skip the host buffers the device has overwritten, or played without us */
+                double lost = floor( lag / framesPerHostBuffer );
+                PA_DEBUG(( "%s: Thread fell behind by %g host buffers\n", __FUNCTION__, lost ));
+                stream->statistics.framesProcessed += ( lost - 1 ) * framesPerHostBuffer;
+                ++stream->statistics.lateXruns;
+                PA_ENSURE( PaNullStream_SkipFrames( stream, ( lost - 1 ) * framesPerHostBuffer ) );
+                cbFlags |= PaNullStream_XrunFlags( stream );
+                continue;
+            }
+        }
+
+        if( PaNullStream_Chance( stream, spec->xrunProbability ) )
+        {
+            stream->statistics.framesProcessed += framesPerHostBuffer;
+            ++stream->statistics.injectedXruns;
+            PA_ENSURE( PaNullStream_SkipFrames( stream, framesPerHostBuffer ) );
+            cbFlags |= PaNullStream_XrunFlags( stream );
+            continue;
+        }
+
+        PaUtil_UpdateClockEstimator( &stream->clock, position + framesPerHostBuffer, now );
+
+        timeInfo.currentTime = now;
+        timeInfo.inputBufferAdcTime = PaNullStream_FramesToTime( stream, position );
+        timeInfo.outputBufferDacTime = PaNullStream_FramesToTime( stream, position +
+                PA_NULL_NUM_HOST_BUFFERS_ * framesPerHostBuffer );
+
+        if( PaNullStreamComponent_HasFile( &stream->capture ) )
+            PA_ENSURE( PaNullStreamComponent_ReadFile( &stream->capture, framesPerHostBuffer ) );
+        if( stream->capture.device && stream->capture.device->loopback )
+        {
+            PaStreamCallbackFlags loopbackFlags = 0;
+            PA_ENSURE( PaNullStream_ReadLoopback( stream, position, framesPerHostBuffer, &loopbackFlags ) );
+            cbFlags |= loopbackFlags;
+        }
+
+        PaUtil_BeginCpuLoadMeasurement( &stream->cpuLoadMeasurer );
+
+        PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo, cbFlags );
+        cbFlags = 0;
+        if( stream->capture.device )
+            PaNullStreamComponent_RegisterChannels( &stream->capture, &stream->bufferProcessor, framesPerHostBuffer,
+                    framesPerHostBuffer, 1 );
+        if( stream->playback.device )
+            PaNullStreamComponent_RegisterChannels( &stream->playback, &stream->bufferProcessor, framesPerHostBuffer,
+                    framesPerHostBuffer, 0 );
+        framesProcessed = PaUtil_EndBufferProcessing( &stream->bufferProcessor, &callbackResult );
+
+        PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
+
+        /* The output file ends where the input file does, rather than with the silence past its end */
+        if( PaNullStreamComponent_HasFile( &stream->playback ) )
+            PA_ENSURE( PaNullStreamComponent_WriteFile( &stream->playback,
+                        stream->capture.endOfFile ? stream->capture.framesRead : framesPerHostBuffer ) );
+        if( stream->playback.device && stream->playback.device->loopback )
+            PA_ENSURE( PaNullStream_WriteLoopback( stream, position, framesPerHostBuffer ) );
+        if( stream->capture.endOfFile && paContinue == callbackResult )
+        {
+            PA_DEBUG(( "%s: End of input file\n", __FUNCTION__ ));
+            callbackResult = paComplete;
+        }
+
+        stream->statistics.framesProcessed += framesPerHostBuffer;
+        ++stream->statistics.hostBuffersProcessed;
+    }
+
+end:
+    ; /* Hack to fix "label at end of compound statement" error caused by pthread_cleanup_pop(1) macro. */
+    /* Match pthread_cleanup_push */
+    pthread_cleanup_pop( 1 );
+
+    PaUnixThreading_EXIT( result );
+
+error:
+    PA_DEBUG(( "%s: Thread is canceled due to error %d\n ", __FUNCTION__, result ));
+    goto end;
+}
+
+static PaError StartStream( PaStream *s )
+{
+    PaError result = paNoError;
+    PaNullStream *stream = (PaNullStream*)s;
+
+    /* The time of free-running streams goes on from where it stopped */
+    stream->startTime = stream->freeRunning ? GetStreamTime( s ) : PaUtil_GetTime();
+
+    PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    memset( &stream->statistics, 0, sizeof (PaNullStreamStatistics) );
+    stream->readPosition = stream->writePosition = 0;
+    stream->blockingFlags = 0;
+
+    /* Set now, so we can test for activity further down */
+    stream->isActive = 1;
+    stream->isStopped = 0;
+
+    if( stream->callbackMode )
+    {
+        PaUtil_ResetClockEstimator( &stream->clock );
+        PA_ENSURE( PaUnixThread_New( &stream->thread, &CallbackThreadFunc, stream, 1., 0 ) );
+    }
+
+end:
+    return result;
+error:
+    stream->isActive = 0;
+    stream->isStopped = 1;
+    goto end;
+}
+
+static PaError RealStop( PaNullStream *stream, int abort )
+{
+    PaError result = paNoError;
+
+    if( stream->callbackMode )
+    {
+        PaError threadRes;
+        stream->callbackAbort = abort;
+
+        PA_ENSURE( PaUnixThread_Terminate( &stream->thread, !abort, &threadRes ) );
+        if( threadRes != paNoError )
+        {
+            PA_DEBUG(( "Callback thread returned: %d\n", threadRes ));
+        }
+    }
+    else if( stream->playback.device && stream->playback.device->loopback )
+    {
+        PaNullLoopback_StopWriter( stream->playback.device->loopback );
+    }
+
+    stream->isActive = 0;
+    stream->isStopped = 1;
+
+end:
+    return result;
+
+error:
+    goto end;
+}
+
+static PaError StopStream( PaStream *s )
+{
+    return RealStop( (PaNullStream *)s, 0 );
+}
+
+static PaError AbortStream( PaStream *s )
+{
+    return RealStop( (PaNullStream *)s, 1 );
+}
+
+static PaError IsStreamStopped( PaStream *s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+
+    return stream->isStopped;
+}
+
+static PaError IsStreamActive( PaStream *s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+
+    return stream->isActive;
+}
+
+static PaTime GetStreamTime( PaStream *s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+
+    if( stream->freeRunning )
+    {
+        double position = stream->callbackMode ? stream->statistics.framesProcessed :
+            PA_MAX( stream->readPosition, stream->writePosition );
+        return PaNullStream_FramesToTime( stream, position );
+    }
+
+    return PaUtil_GetTime();
+}
+
+static double GetStreamCpuLoad( PaStream* s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+
+    return PaUtil_GetCpuLoad( &stream->cpuLoadMeasurer );
+}
+
+/* Blocking interface */
+
+/** Frames a blocking read or write can transfer without waiting.
+ *
+ * The device's buffer is captured from, or played, at the pace of its clock. If the read or write position has
+ * fallen behind by more than the buffer, the frames in between are lost and the position catches up.
+ */
+static unsigned long PaNullStream_GetAvailableFrames( PaNullStream *self, int isInput )
+{
+    const double bufferFrames = PA_NULL_NUM_HOST_BUFFERS_ * self->framesPerHostBuffer;
+    double *position = isInput ? &self->readPosition : &self->writePosition;
+    double devicePosition;
+
+    if( self->freeRunning )
+        return (unsigned long)bufferFrames;
+
+    devicePosition = floor( PaNullStream_TimeToFrames( self, PaUtil_GetTime() ) );
+    if( isInput )
+    {
+        if( devicePosition - *position > bufferFrames )
+        {
+            self->capture.framesLost += devicePosition - bufferFrames - *position;
+            *position = devicePosition - bufferFrames;
+            self->blockingFlags |= paInputOverflow;
+        }
+        return (unsigned long)( devicePosition - *position );
+    }
+
+    if( *position < devicePosition )
+    {
+        if( *position > 0 )
+        {
+            self->playback.framesLost += devicePosition - *position;
+            self->blockingFlags |= paOutputUnderflow;
+        }
+        *position = devicePosition;
+    }
+    return (unsigned long)( bufferFrames - ( *position - devicePosition ) );
+}
+
+static PaError PaNullStream_BlockingTransfer( PaNullStream *self, void *userBuffer, unsigned long frames, int isInput )
+{
+    PaError result = paNoError;
+    PaNullStreamComponent *component = isInput ? &self->capture : &self->playback;
+    double *position = isInput ? &self->readPosition : &self->writePosition;
+    void *buffer = userBuffer;
+
+    if( component->userBuffers )
+    {
+        memcpy( component->userBuffers, userBuffer, sizeof (void *) * component->numChannels );
+        buffer = component->userBuffers;
+    }
+
+    while( frames > 0 )
+    {
+        unsigned long framesAvail = PaNullStream_GetAvailableFrames( self, isInput ), framesGot;
+
+        if( 0 == framesAvail )
+        {
+            /* Wait for the device's clock to reach the next frame */
+            SleepUntil( PaNullStream_FramesToTime( self, isInput ? *position + 1 :
+                        *position + 1 - PA_NULL_NUM_HOST_BUFFERS_ * self->framesPerHostBuffer ) );
+            continue;
+        }
+
+        framesGot = PA_MIN( PA_MIN( framesAvail, frames ), self->framesPerHostBuffer );
+
+        if( component->framesLost > 0 )
+        {
+            PA_ENSURE( PaNullStreamComponent_SkipFrames( component, component->framesLost, isInput ) );
+            component->framesLost = 0;
+        }
+        if( isInput && PaNullStreamComponent_HasFile( component ) )
+            PA_ENSURE( PaNullStreamComponent_ReadFile( component, framesGot ) );
+        if( isInput && component->device->loopback )
+            PA_ENSURE( PaNullStream_ReadLoopback( self, *position, framesGot, &self->blockingFlags ) );
+
+        /* The dither generator is shared between the converters */
+        PA_ENSURE( PaUnixMutex_Lock( &self->blockingMtx ) );
+        PaNullStreamComponent_RegisterChannels( component, &self->bufferProcessor, framesGot,
+                self->framesPerHostBuffer, isInput );
+        if( isInput )
+            framesGot = PaUtil_CopyInput( &self->bufferProcessor, &buffer, framesGot );
+        else
+            framesGot = PaUtil_CopyOutput( &self->bufferProcessor, (const void **)&buffer, framesGot );
+        PA_ENSURE( PaUnixMutex_Unlock( &self->blockingMtx ) );
+
+        if( !isInput && PaNullStreamComponent_HasFile( component ) )
+            PA_ENSURE( PaNullStreamComponent_WriteFile( component, framesGot ) );
+        if( !isInput && component->device->loopback )
+            PA_ENSURE( PaNullStream_WriteLoopback( self, *position, framesGot ) );
+
+        *position += framesGot;
+        frames -= framesGot;
+    }
+
+error:
+    return result;
+}
+
+static PaError ReadStream( PaStream* s, void *buffer, unsigned long frames )
+{
+    PaError result = paNoError;
+    PaNullStream *stream = (PaNullStream*)s;
+
+    PA_UNLESS( stream->capture.device, paCanNotReadFromAnOutputOnlyStream );
+    PA_ENSURE( PaNullStream_BlockingTransfer( stream, buffer, frames, 1 ) );
+
+    /* Pa_ReadStream() reports any discontinuity of the input as an overflow */
+    if( stream->blockingFlags & ( paInputOverflow | paInputUnderflow ) )
+    {
+        stream->blockingFlags &= ~( paInputOverflow | paInputUnderflow );
+        result = paInputOverflowed;
+    }
+
+error:
+    return result;
+}
+
+static PaError WriteStream( PaStream* s, const void *buffer, unsigned long frames )
+{
+    PaError result = paNoError;
+    PaNullStream *stream = (PaNullStream*)s;
+
+    PA_UNLESS( stream->playback.device, paCanNotWriteToAnInputOnlyStream );
+    PA_ENSURE( PaNullStream_BlockingTransfer( stream, (void *)buffer, frames, 0 ) );
+
+    if( stream->blockingFlags & paOutputUnderflow )
+    {
+        stream->blockingFlags &= ~paOutputUnderflow;
+        result = paOutputUnderflowed;
+    }
+
+error:
+    return result;
+}
+
+static signed long GetStreamReadAvailable( PaStream* s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+
+    if( !stream->capture.device )
+        return paCanNotReadFromAnOutputOnlyStream;
+    return PaNullStream_GetAvailableFrames( stream, 1 );
+}
+
+static signed long GetStreamWriteAvailable( PaStream* s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+
+    if( !stream->playback.device )
+        return paCanNotWriteToAnInputOnlyStream;
+    return PaNullStream_GetAvailableFrames( stream, 0 );
+}
+
+/* Extensions */
+
+PaError PaNull_GetStreamStatistics( PaStream *s, PaNullStreamStatistics *statistics )
+{
+    PaError result = paNoError;
+    PaUtilHostApiRepresentation *hostApi;
+    PaNullHostApiRepresentation *nullHostApi;
+    PaNullStream *stream = (PaNullStream *)s;
+
+    PA_ENSURE( PaUtil_ValidateStreamPointer( s ) );
+    PA_ENSURE( PaUtil_GetHostApiRepresentation( &hostApi, paInDevelopment ) );
+    nullHostApi = (PaNullHostApiRepresentation *)hostApi;
+    PA_UNLESS( PA_STREAM_REP( s )->streamInterface == &nullHostApi->callbackStreamInterface
+            || PA_STREAM_REP( s )->streamInterface == &nullHostApi->blockingStreamInterface,
+        paIncompatibleStreamHostApi );
+
+    *statistics = stream->statistics;
+    if( !stream->callbackMode )
+        statistics->framesProcessed = PA_MAX( stream->readPosition, stream->writePosition );
+
+error:
+    return result;
+}
@@ -86,6 +86,7 @@
 #include "pa_hostapi.h"
 #include "pa_stream.h"
 #include "pa_cpuload.h"
+#include "pa_clockestimator.h"
 #include "pa_process.h"
 #include "pa_unix_util.h"
 #include "pa_debugprint.h"
@@ -155,6 +156,7 @@ typedef struct
     void *buffer;
     PaSampleFormat userFormat, hostFormat;
     double latency;
+    double sampleRate;  /* As configured on the device */
     unsigned long hostFrames, numBufs;
     void **userBuffers; /* For non-interleaved blocking */
 } PaOssStreamComponent;
@@ -167,6 +169,7 @@ typedef struct PaOssStream
     PaUtilStreamRepresentation streamRepresentation;
     PaUtilCpuLoadMeasurer cpuLoadMeasurer;
     PaUtilBufferProcessor bufferProcessor;
+    PaUtilClockEstimator clock;
 
     PaUtilThreading threading;
 
@@ -183,6 +186,7 @@ typedef struct PaOssStream
     int framesProcessed;
 
     double sampleRate;
+    int convertSampleRate;  /* Let the buffer processor convert from the rate the device supports? */
 
     int callbackMode;
     volatile int callbackStop, callbackAbort;
@@ -777,7 +781,7 @@ static void PaOssStreamComponent_Terminate( PaOssStreamComponent *component )
     if( component->fd >= 0 )
         close( component->fd );
     if( component->buffer )
-        PaUtil_FreeMemory( component->buffer );
+        PaUtil_FreeBufferMemory( component->buffer );
 
     if( component->userBuffers )
         PaUtil_FreeMemory( component->userBuffers );
@@ -862,6 +866,7 @@ static PaError PaOssStream_Initialize( PaOssStream *stream, const PaStreamParame
 
     memset( stream, 0, sizeof (PaOssStream) );
     stream->isStopped = 1;
+    stream->convertSampleRate = (streamFlags & paConvertSampleRate) ? 1 : 0;
 
     PA_ENSURE( PaUtil_InitializeThreading( &stream->threading ) );
 
@@ -985,8 +990,8 @@ static unsigned long PaOssStreamComponent_BufferSize( PaOssStreamComponent *comp
 
 /** Configure stream component device parameters.
  */
-static PaError PaOssStreamComponent_Configure( PaOssStreamComponent *component, double sampleRate, unsigned long
-        framesPerBuffer, StreamMode streamMode, PaOssStreamComponent *master )
+static PaError PaOssStreamComponent_Configure( PaOssStreamComponent *component, double sampleRate, int convertSampleRate,
+        unsigned long framesPerBuffer, StreamMode streamMode, PaOssStreamComponent *master )
 {
     PaError result = paNoError;
     int temp, nativeFormat;
@@ -1050,12 +1055,14 @@ static PaError PaOssStreamComponent_Configure( PaOssStreamComponent *component,
         /* try to set the sample rate */
         ENSURE_( ioctl( component->fd, SNDCTL_DSP_SPEED, &sr ), paInvalidSampleRate );
 
-        /* reject if there's no sample rate within 1% of the one requested */
+        /* reject if there's no sample rate within 1% of the one requested, unless we are to convert */
         if( (fabs( sampleRate - sr ) / sampleRate) > 0.01 )
         {
             PA_DEBUG(("%s: Wanted %f, closest sample rate was %d\n", __FUNCTION__, sampleRate, sr ));
-            PA_ENSURE( paInvalidSampleRate );
+            if( !convertSampleRate )
+                PA_ENSURE( paInvalidSampleRate );
         }
+        component->sampleRate = sr;
 
         ENSURE_( ioctl( component->fd, streamMode == StreamMode_In ? SNDCTL_DSP_GETISPACE : SNDCTL_DSP_GETOSPACE, &bufInfo ),
                 paUnanticipatedHostError );
@@ -1074,10 +1081,11 @@ static PaError PaOssStreamComponent_Configure( PaOssStreamComponent *component,
         component->hostFrames = master->hostFrames;
         component->hostChannelCount = master->hostChannelCount;
         component->numBufs = master->numBufs;
+        component->sampleRate = master->sampleRate;
     }
 
-    PA_UNLESS( component->buffer = PaUtil_AllocateMemory( PaOssStreamComponent_BufferSize( component ) ),
-            paInsufficientMemory );
+    PA_UNLESS( component->buffer = PaUtil_AllocateBufferMemory( PaOssStreamComponent_BufferSize( component ),
+                paUtilPrefaultBufferMemory ), paInsufficientMemory );
 
 error:
     return result;
@@ -1122,6 +1130,7 @@ static PaError PaOssStream_Configure( PaOssStream *stream, double sampleRate, un
     PaError result = paNoError;
     int duplex = stream->capture && stream->playback;
     unsigned long framesPerHostBuffer = 0;
+    double hostSampleRate = sampleRate;
 
     /* We should request full duplex first thing after opening the device */
     if( duplex && stream->sharedDevice )
@@ -1130,24 +1139,33 @@ static PaError PaOssStream_Configure( PaOssStream *stream, double sampleRate, un
     if( stream->capture )
     {
         PaOssStreamComponent *component = stream->capture;
-        PA_ENSURE( PaOssStreamComponent_Configure( component, sampleRate, framesPerBuffer, StreamMode_In,
-                    NULL ) );
+        PA_ENSURE( PaOssStreamComponent_Configure( component, sampleRate, stream->convertSampleRate, framesPerBuffer,
+                    StreamMode_In, NULL ) );
 
         assert( component->hostChannelCount > 0 );
         assert( component->hostFrames > 0 );
 
-        *inputLatency = (component->hostFrames * (component->numBufs - 1)) / sampleRate;
+        if( stream->convertSampleRate )
+            hostSampleRate = component->sampleRate;
+        *inputLatency = (component->hostFrames * (component->numBufs - 1)) / hostSampleRate;
     }
     if( stream->playback )
     {
         PaOssStreamComponent *component = stream->playback, *master = stream->sharedDevice ? stream->capture : NULL;
-        PA_ENSURE( PaOssStreamComponent_Configure( component, sampleRate, framesPerBuffer, StreamMode_Out,
-                    master ) );
+        PA_ENSURE( PaOssStreamComponent_Configure( component, sampleRate, stream->convertSampleRate, framesPerBuffer,
+                    StreamMode_Out, master ) );
 
         assert( component->hostChannelCount > 0 );
         assert( component->hostFrames > 0 );
 
-        *outputLatency = (component->hostFrames * (component->numBufs - 1)) / sampleRate;
+        if( stream->convertSampleRate )
+        {
+            /* Both directions are converted by the same buffer processor */
+            if( duplex )
+                PA_UNLESS( component->sampleRate == hostSampleRate, paInvalidSampleRate );
+            hostSampleRate = component->sampleRate;
+        }
+        *outputLatency = (component->hostFrames * (component->numBufs - 1)) / hostSampleRate;
     }
 
     if( duplex )
@@ -1158,9 +1176,10 @@ static PaError PaOssStream_Configure( PaOssStream *stream, double sampleRate, un
         framesPerHostBuffer = stream->playback->hostFrames;
 
     stream->framesPerHostBuffer = framesPerHostBuffer;
-    stream->pollTimeout = (int) ceil( 1e6 * framesPerHostBuffer / sampleRate );    /* Period in usecs, rounded up */
+    stream->pollTimeout = (int) ceil( 1e6 * framesPerHostBuffer / hostSampleRate );    /* Period in usecs, rounded up */
 
-    stream->sampleRate = stream->streamRepresentation.streamInfo.sampleRate = sampleRate;
+    stream->sampleRate = hostSampleRate;
+    stream->streamRepresentation.streamInfo.sampleRate = sampleRate;
 
 error:
     return result;
@@ -1250,20 +1269,18 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 
     PA_ENSURE( PaOssStream_Configure( stream, sampleRate, framesPerBuffer, &inLatency, &outLatency ) );
 
-    PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+    /* Frames are counted at the device's rate */
+    PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, stream->sampleRate );
+    if( stream->callbackMode )
+    {
+        PaUtil_InitializeClockEstimator( &stream->clock, stream->sampleRate );
+        stream->streamRepresentation.clockEstimator = &stream->clock;
+    }
 
     if( inputParameters )
-    {
         inputHostFormat = stream->capture->hostFormat;
-        stream->streamRepresentation.streamInfo.inputLatency = inLatency +
-            PaUtil_GetBufferProcessorInputLatencyFrames( &stream->bufferProcessor ) / sampleRate;
-    }
     if( outputParameters )
-    {
         outputHostFormat = stream->playback->hostFormat;
-        stream->streamRepresentation.streamInfo.outputLatency = outLatency +
-            PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor ) / sampleRate;
-    }
 
     /* Initialize buffer processor with fixed host buffer size.
      * Aspect StreamSampleFormat: Here we commit the user and host sample formats, PA infrastructure will
@@ -1274,6 +1291,24 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
               outputHostFormat, sampleRate, streamFlags, framesPerBuffer, stream->framesPerHostBuffer,
               paUtilFixedHostBufferSize, streamCallback, userData ) );
     bpInitialized = 1;
+    stream->streamRepresentation.callbackProfiler = stream->bufferProcessor.callbackProfiler;
+
+    if( stream->sampleRate != sampleRate )
+    {
+        PA_DEBUG(( "%s: Converting between %f Hz (device) and %f Hz\n", __FUNCTION__, stream->sampleRate, sampleRate ));
+        PA_ENSURE( PaUtil_InitializeBufferProcessorSampleRateConverter( &stream->bufferProcessor, stream->sampleRate ) );
+    }
+
+    if( inputParameters )
+    {
+        stream->streamRepresentation.streamInfo.inputLatency = inLatency +
+            PaUtil_GetBufferProcessorInputLatencyFrames( &stream->bufferProcessor ) / sampleRate;
+    }
+    if( outputParameters )
+    {
+        stream->streamRepresentation.streamInfo.outputLatency = outLatency +
+            PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor ) / sampleRate;
+    }
 
     *s = (PaStream*)stream;
 
@@ -1662,6 +1697,11 @@ static void *PaOSS_AudioThreadProc( void *userData )
             /* Wait on available frames */
             PA_ENSURE( PaOssStream_WaitForFrames( stream, &framesAvail ) );
             assert( framesAvail % stream->framesPerHostBuffer == 0 );
+
+            /* OSS doesn't timestamp its buffers, but the thread wakes up as the device makes frames available,
+             * the clock estimator filters out the scheduling jitter */
+            PaUtil_UpdateClockEstimator( &stream->clock, (double)stream->framesProcessed + framesAvail,
+                    PaUtil_GetTime() );
         }
         else
         {
@@ -1805,6 +1845,8 @@ static PaError StartStream( PaStream *s )
     stream->lastPosPtr = 0;
     stream->lastStreamBytes = 0;
     stream->framesProcessed = 0;
+    if( stream->callbackMode )
+        PaUtil_ResetClockEstimator( &stream->clock );
 
     /* only use the thread for callback streams */
     if( stream->bufferProcessor.streamCallback )
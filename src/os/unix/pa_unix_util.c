@@ -50,6 +50,7 @@
 #include <string.h> /* For memset */
 #include <math.h>
 #include <errno.h>
+#include <sys/mman.h>
 
 #if defined(__APPLE__) && !defined(HAVE_MACH_ABSOLUTE_TIME)
 #define HAVE_MACH_ABSOLUTE_TIME
@@ -64,10 +65,17 @@
 
 /*
    Track memory allocations to avoid leaks.
+   Streams of different host APIs may be opened and closed concurrently,
+   so the count is updated atomically where the compiler supports it.
  */
 
 #if PA_TRACK_MEMORY
-static int numAllocations_ = 0;
+static volatile int numAllocations_ = 0;
+#if defined(__GNUC__)
+#define PA_COUNT_ALLOCATIONS_( n )  __sync_fetch_and_add( &numAllocations_, (n) )
+#else
+#define PA_COUNT_ALLOCATIONS_( n )  ( numAllocations_ += (n) )
+#endif
 #endif
 
 
@@ -76,7 +84,7 @@ void *PaUtil_AllocateMemory( long size )
     void *result = malloc( size );
 
 #if PA_TRACK_MEMORY
-    if( result != NULL ) numAllocations_ += 1;
+    if( result != NULL ) PA_COUNT_ALLOCATIONS_( 1 );
 #endif
     return result;
 }
@@ -88,13 +96,137 @@ void PaUtil_FreeMemory( void *block )
     {
         free( block );
 #if PA_TRACK_MEMORY
-        numAllocations_ -= 1;
+        PA_COUNT_ALLOCATIONS_( -1 );
 #endif
 
     }
 }
 
 
+/*
+   Buffer memory is either carved out of a malloc()ed block, or, when it is to
+   be locked or backed by huge pages, mapped separately so that neither
+   affects other allocations sharing its pages. A header preceding each block
+   records how to release it.
+ */
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#define PA_HUGE_PAGE_SIZE_ (2 * 1024 * 1024)
+
+typedef struct PaUtilBufferMemoryHeader
+{
+    void *base;
+    size_t mappedSize;  /* 0 unless base was obtained with mmap() */
+    int locked;
+}
+PaUtilBufferMemoryHeader;
+
+static size_t RoundUp( size_t size, size_t granularity )
+{
+    return (size + granularity - 1) / granularity * granularity;
+}
+
+void *PaUtil_AllocateBufferMemory( long size, PaUtilBufferMemoryFlags flags )
+{
+    PaUtilBufferMemoryHeader header = { NULL, 0, 0 };
+    char *result;
+
+    if( flags & (paUtilLockBufferMemory | paUtilHugePageBufferMemory) )
+    {
+        /* the header occupies the first PA_BUFFER_MEMORY_ALIGNMENT bytes of the mapping */
+        size_t totalSize = size + PA_BUFFER_MEMORY_ALIGNMENT;
+
+#ifdef MAP_HUGETLB
+        if( flags & paUtilHugePageBufferMemory )
+        {
+            header.mappedSize = RoundUp( totalSize, PA_HUGE_PAGE_SIZE_ );
+            header.base = mmap( NULL, header.mappedSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+            if( header.base == MAP_FAILED )
+            {
+                PA_DEBUG(( "%s: No huge pages available: %s\n", __FUNCTION__, strerror( errno ) ));
+                header.base = NULL;
+            }
+        }
+#endif
+        if( !header.base )
+        {
+            header.mappedSize = RoundUp( totalSize, (flags & paUtilHugePageBufferMemory) ?
+                    PA_HUGE_PAGE_SIZE_ : (size_t)sysconf( _SC_PAGESIZE ) );
+            header.base = mmap( NULL, header.mappedSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+            if( header.base == MAP_FAILED )
+                return NULL;
+#ifdef MADV_HUGEPAGE
+            /* fall back on transparent huge pages */
+            if( flags & paUtilHugePageBufferMemory )
+                madvise( header.base, header.mappedSize, MADV_HUGEPAGE );
+#endif
+        }
+
+        if( flags & paUtilLockBufferMemory )
+        {
+            header.locked = mlock( header.base, header.mappedSize ) == 0;
+            if( !header.locked )
+            {
+                PA_DEBUG(( "%s: Failed to lock %lu bytes: %s\n", __FUNCTION__,
+                            (unsigned long)header.mappedSize, strerror( errno ) ));
+            }
+        }
+
+        result = (char *)header.base + PA_BUFFER_MEMORY_ALIGNMENT;
+    }
+    else
+    {
+        header.base = malloc( size + PA_BUFFER_MEMORY_ALIGNMENT + sizeof (PaUtilBufferMemoryHeader) );
+        if( !header.base )
+            return NULL;
+
+        result = (char *)header.base + sizeof (PaUtilBufferMemoryHeader);
+        result += (PA_BUFFER_MEMORY_ALIGNMENT - (size_t)result % PA_BUFFER_MEMORY_ALIGNMENT) % PA_BUFFER_MEMORY_ALIGNMENT;
+    }
+
+    memcpy( result - sizeof (PaUtilBufferMemoryHeader), &header, sizeof (PaUtilBufferMemoryHeader) );
+
+    if( flags & paUtilPrefaultBufferMemory )
+        memset( result, 0, size );
+
+#if PA_TRACK_MEMORY
+    PA_COUNT_ALLOCATIONS_( 1 );
+#endif
+    return result;
+}
+
+
+void PaUtil_FreeBufferMemory( void *block )
+{
+    PaUtilBufferMemoryHeader header;
+
+    if( block == NULL )
+        return;
+
+    memcpy( &header, (char *)block - sizeof (PaUtilBufferMemoryHeader), sizeof (PaUtilBufferMemoryHeader) );
+
+    if( header.mappedSize )
+    {
+        if( header.locked )
+            munlock( header.base, header.mappedSize );
+        munmap( header.base, header.mappedSize );
+    }
+    else
+    {
+        free( header.base );
+    }
+
+#if PA_TRACK_MEMORY
+    PA_COUNT_ALLOCATIONS_( -1 );
+#endif
+}
+
+
 int PaUtil_CountCurrentlyAllocatedBlocks( void )
 {
 #if PA_TRACK_MEMORY
@@ -169,6 +301,185 @@ PaTime PaUtil_GetTime( void )
 #endif
 }
 
+
+struct PaUtilLock
+{
+    pthread_mutex_t mutex;
+};
+
+PaError PaUtil_CreateLock( PaUtilLock **lock )
+{
+    *lock = (PaUtilLock *) PaUtil_AllocateMemory( sizeof(PaUtilLock) );
+    if( *lock == NULL )
+        return paInsufficientMemory;
+
+    if( pthread_mutex_init( &(*lock)->mutex, NULL ) != 0 )
+    {
+        PaUtil_FreeMemory( *lock );
+        *lock = NULL;
+        return paInsufficientMemory;
+    }
+    return paNoError;
+}
+
+void PaUtil_DestroyLock( PaUtilLock *lock )
+{
+    if( lock == NULL )
+        return;
+
+    pthread_mutex_destroy( &lock->mutex );
+    PaUtil_FreeMemory( lock );
+}
+
+void PaUtil_AcquireLock( PaUtilLock *lock )
+{
+    pthread_mutex_lock( &lock->mutex );
+}
+
+void PaUtil_ReleaseLock( PaUtilLock *lock )
+{
+    pthread_mutex_unlock( &lock->mutex );
+}
+
+
+static pthread_mutex_t initializationMutex_ = PTHREAD_MUTEX_INITIALIZER;
+
+void PaUtil_AcquireInitializationLock( void )
+{
+    pthread_mutex_lock( &initializationMutex_ );
+}
+
+void PaUtil_ReleaseInitializationLock( void )
+{
+    pthread_mutex_unlock( &initializationMutex_ );
+}
+
+
+struct PaUtilPeriodicThread
+{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int stopRequested;
+    int stoppedByFunction;  /* the thread releases itself when the function returns */
+    PaUtilPeriodicFunction *function;
+    void *userData;
+    PaTime period;
+};
+
+static void *PeriodicThreadFunc( void *threadArg )
+{
+    PaUtilPeriodicThread *thread = (PaUtilPeriodicThread *)threadArg;
+    struct timeval now;
+    struct timespec deadline;
+    double seconds;
+
+    pthread_mutex_lock( &thread->mutex );
+    while( !thread->stopRequested )
+    {
+        /* condition variables wait on the real-time clock by default */
+        gettimeofday( &now, NULL );
+        seconds = now.tv_sec + now.tv_usec * 1e-6 + thread->period;
+        deadline.tv_sec = (time_t)seconds;
+        deadline.tv_nsec = (long)( (seconds - deadline.tv_sec) * 1e9 );
+
+        if( pthread_cond_timedwait( &thread->cond, &thread->mutex, &deadline ) == ETIMEDOUT
+                && !thread->stopRequested )
+        {
+            pthread_mutex_unlock( &thread->mutex );
+            thread->function( thread->userData );
+            pthread_mutex_lock( &thread->mutex );
+        }
+    }
+    pthread_mutex_unlock( &thread->mutex );
+
+    if( thread->stoppedByFunction )
+    {
+        pthread_cond_destroy( &thread->cond );
+        pthread_mutex_destroy( &thread->mutex );
+        PaUtil_FreeMemory( thread );
+    }
+
+    return NULL;
+}
+
+PaError PaUtil_StartPeriodicThread( PaUtilPeriodicThread **thread,
+        PaUtilPeriodicFunction *function, void *userData, PaTime period )
+{
+    PaUtilPeriodicThread *self;
+    pthread_attr_t attr;
+    struct sched_param spm;
+    int created;
+
+    self = (PaUtilPeriodicThread *) PaUtil_AllocateMemory( sizeof(PaUtilPeriodicThread) );
+    if( self == NULL )
+        return paInsufficientMemory;
+
+    self->stopRequested = 0;
+    self->stoppedByFunction = 0;
+    self->function = function;
+    self->userData = userData;
+    self->period = period;
+    if( pthread_mutex_init( &self->mutex, NULL ) != 0 )
+    {
+        PaUtil_FreeMemory( self );
+        return paInsufficientMemory;
+    }
+    if( pthread_cond_init( &self->cond, NULL ) != 0 )
+    {
+        pthread_mutex_destroy( &self->mutex );
+        PaUtil_FreeMemory( self );
+        return paInsufficientMemory;
+    }
+
+    /* don't inherit the policy of a real-time caller */
+    memset( &spm, 0, sizeof(spm) );
+    created = pthread_attr_init( &attr ) == 0;
+    if( created )
+    {
+        pthread_attr_setinheritsched( &attr, PTHREAD_EXPLICIT_SCHED );
+        pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
+        pthread_attr_setschedparam( &attr, &spm );
+        created = pthread_create( &self->thread, &attr, PeriodicThreadFunc, self ) == 0;
+        pthread_attr_destroy( &attr );
+    }
+    if( !created )
+    {
+        pthread_cond_destroy( &self->cond );
+        pthread_mutex_destroy( &self->mutex );
+        PaUtil_FreeMemory( self );
+        return paInternalError;
+    }
+
+    *thread = self;
+    return paNoError;
+}
+
+void PaUtil_StopPeriodicThread( PaUtilPeriodicThread *thread )
+{
+    if( thread == NULL )
+        return;
+
+    /* joining itself would deadlock, the thread exits once the function returns */
+    if( pthread_equal( pthread_self(), thread->thread ) )
+    {
+        thread->stopRequested = 1;
+        thread->stoppedByFunction = 1;
+        pthread_detach( thread->thread );
+        return;
+    }
+
+    pthread_mutex_lock( &thread->mutex );
+    thread->stopRequested = 1;
+    pthread_cond_signal( &thread->cond );
+    pthread_mutex_unlock( &thread->mutex );
+    pthread_join( thread->thread, NULL );
+
+    pthread_cond_destroy( &thread->cond );
+    pthread_mutex_destroy( &thread->mutex );
+    PaUtil_FreeMemory( thread );
+}
+
 PaError PaUtil_InitializeThreading( PaUtilThreading *threading )
 {
     (void) paUtilErr_;
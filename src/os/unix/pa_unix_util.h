@@ -98,11 +98,8 @@ static PaError paUtilErr_;          /* Used with PA_ENSURE */
     do { \
         if( UNLIKELY( (paUtilErr_ = (expr)) != success ) ) \
         { \
-            /* PaUtil_SetLastHostErrorInfo should only be used in the main thread */ \
-            if( pthread_equal(pthread_self(), paUnixMainThread) ) \
-            { \
-                PaUtil_SetLastHostErrorInfo( paALSA, paUtilErr_, strerror( paUtilErr_ ) ); \
-            } \
+            /* the last host error is per thread */ \
+            PaUtil_SetLastHostErrorInfo( paALSA, paUtilErr_, strerror( paUtilErr_ ) ); \
             PaUtil_DebugPrint( "Expression '" #expr "' failed in '" __FILE__ "', line: " STRINGIZE( __LINE__ ) "\n" ); \
             result = paUnanticipatedHostError; \
             goto error; \
@@ -45,6 +45,7 @@
  
 #include <windows.h>
 #include <mmsystem.h> /* for timeGetTime() */
+#include <string.h> /* for memset() */
 
 #include "pa_util.h"
 
@@ -86,6 +87,80 @@ void PaUtil_FreeMemory( void *block )
 }
 
 
+/*
+   Buffer memory which is to be locked is allocated with VirtualAlloc() so that
+   unlocking it can't affect other allocations sharing its pages. A header
+   preceding each block records how to release it. Huge pages require the
+   SeLockMemoryPrivilege and are not used.
+ */
+
+typedef struct PaUtilBufferMemoryHeader
+{
+    void *base;
+    int virtualAlloced;
+}
+PaUtilBufferMemoryHeader;
+
+void *PaUtil_AllocateBufferMemory( long size, PaUtilBufferMemoryFlags flags )
+{
+    PaUtilBufferMemoryHeader header = { NULL, 0 };
+    char *result;
+
+    if( flags & paUtilLockBufferMemory )
+    {
+        /* the header occupies the first PA_BUFFER_MEMORY_ALIGNMENT bytes of the allocation */
+        SIZE_T totalSize = size + PA_BUFFER_MEMORY_ALIGNMENT;
+
+        header.base = VirtualAlloc( NULL, totalSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+        if( !header.base )
+            return NULL;
+        header.virtualAlloced = 1;
+        VirtualLock( header.base, totalSize ); /* failure leaves the block unlocked */
+
+        result = (char *)header.base + PA_BUFFER_MEMORY_ALIGNMENT;
+    }
+    else
+    {
+        header.base = GlobalAlloc( GPTR, size + PA_BUFFER_MEMORY_ALIGNMENT + sizeof (PaUtilBufferMemoryHeader) );
+        if( !header.base )
+            return NULL;
+
+        result = (char *)header.base + sizeof (PaUtilBufferMemoryHeader);
+        result += (PA_BUFFER_MEMORY_ALIGNMENT - (size_t)result % PA_BUFFER_MEMORY_ALIGNMENT) % PA_BUFFER_MEMORY_ALIGNMENT;
+    }
+
+    memcpy( result - sizeof (PaUtilBufferMemoryHeader), &header, sizeof (PaUtilBufferMemoryHeader) );
+
+    if( flags & paUtilPrefaultBufferMemory )
+        memset( result, 0, size );
+
+#if PA_TRACK_MEMORY
+    numAllocations_ += 1;
+#endif
+    return result;
+}
+
+
+void PaUtil_FreeBufferMemory( void *block )
+{
+    PaUtilBufferMemoryHeader header;
+
+    if( block == NULL )
+        return;
+
+    memcpy( &header, (char *)block - sizeof (PaUtilBufferMemoryHeader), sizeof (PaUtilBufferMemoryHeader) );
+
+    if( header.virtualAlloced )
+        VirtualFree( header.base, 0, MEM_RELEASE ); /* also unlocks */
+    else
+        GlobalFree( header.base );
+
+#if PA_TRACK_MEMORY
+    numAllocations_ -= 1;
+#endif
+}
+
+
 int PaUtil_CountCurrentlyAllocatedBlocks( void )
 {
 #if PA_TRACK_MEMORY
@@ -151,3 +226,155 @@ double PaUtil_GetTime( void )
 #endif                
     }
 }
+
+
+struct PaUtilLock
+{
+    CRITICAL_SECTION criticalSection;
+};
+
+PaError PaUtil_CreateLock( PaUtilLock **lock )
+{
+    *lock = (PaUtilLock *) PaUtil_AllocateMemory( sizeof(PaUtilLock) );
+    if( *lock == NULL )
+        return paInsufficientMemory;
+
+    InitializeCriticalSection( &(*lock)->criticalSection );
+    return paNoError;
+}
+
+void PaUtil_DestroyLock( PaUtilLock *lock )
+{
+    if( lock == NULL )
+        return;
+
+    DeleteCriticalSection( &lock->criticalSection );
+    PaUtil_FreeMemory( lock );
+}
+
+void PaUtil_AcquireLock( PaUtilLock *lock )
+{
+    EnterCriticalSection( &lock->criticalSection );
+}
+
+void PaUtil_ReleaseLock( PaUtilLock *lock )
+{
+    LeaveCriticalSection( &lock->criticalSection );
+}
+
+
+/* a critical section can't be initialized statically, the initialization
+    lock is a spin lock instead. it is only held while initializing or
+    terminating PortAudio */
+static volatile LONG initializationLock_ = 0;
+
+void PaUtil_AcquireInitializationLock( void )
+{
+    while( InterlockedCompareExchange( &initializationLock_, 1, 0 ) != 0 )
+        Sleep( 1 );
+}
+
+void PaUtil_ReleaseInitializationLock( void )
+{
+    InterlockedExchange( &initializationLock_, 0 );
+}
+
+
+/* use CreateThread for CYGWIN and Windows CE, _beginthreadex for all others */
+#if !defined(__CYGWIN__) && !defined(_WIN32_WCE)
+#include <process.h>
+#define PA_PERIODIC_THREAD_FUNC static unsigned WINAPI
+#else
+#define PA_PERIODIC_THREAD_FUNC static DWORD WINAPI
+#endif
+
+struct PaUtilPeriodicThread
+{
+    HANDLE thread;
+    DWORD threadId;
+    HANDLE stopEvent;
+    int stoppedByFunction;  /* the thread releases itself when the function returns */
+    PaUtilPeriodicFunction *function;
+    void *userData;
+    PaTime period;
+};
+
+PA_PERIODIC_THREAD_FUNC PeriodicThreadProc( void *threadArg )
+{
+    PaUtilPeriodicThread *thread = (PaUtilPeriodicThread *)threadArg;
+    DWORD periodMsec = (DWORD)( thread->period * 1000. );
+
+    while( WaitForSingleObject( thread->stopEvent, periodMsec ) == WAIT_TIMEOUT )
+        thread->function( thread->userData );
+
+    if( thread->stoppedByFunction )
+    {
+        CloseHandle( thread->thread );
+        CloseHandle( thread->stopEvent );
+        PaUtil_FreeMemory( thread );
+    }
+
+    return 0;
+}
+
+PaError PaUtil_StartPeriodicThread( PaUtilPeriodicThread **thread,
+        PaUtilPeriodicFunction *function, void *userData, PaTime period )
+{
+    PaUtilPeriodicThread *self;
+
+    self = (PaUtilPeriodicThread *) PaUtil_AllocateMemory( sizeof(PaUtilPeriodicThread) );
+    if( self == NULL )
+        return paInsufficientMemory;
+
+    self->stoppedByFunction = 0;
+    self->function = function;
+    self->userData = userData;
+    self->period = period;
+    self->stopEvent = CreateEvent( NULL, TRUE, FALSE, NULL );
+    if( self->stopEvent == NULL )
+    {
+        PaUtil_FreeMemory( self );
+        return paInsufficientMemory;
+    }
+
+#if !defined(__CYGWIN__) && !defined(_WIN32_WCE)
+    self->thread = (HANDLE)_beginthreadex( NULL, 0, PeriodicThreadProc, self, CREATE_SUSPENDED,
+            (unsigned *)&self->threadId );
+#else
+    self->thread = CreateThread( NULL, 0, PeriodicThreadProc, self, CREATE_SUSPENDED, &self->threadId );
+#endif
+    if( self->thread == NULL )
+    {
+        CloseHandle( self->stopEvent );
+        PaUtil_FreeMemory( self );
+        return paInternalError;
+    }
+
+    /* don't inherit the priority of a real-time caller */
+    SetThreadPriority( self->thread, THREAD_PRIORITY_NORMAL );
+    ResumeThread( self->thread );
+
+    *thread = self;
+    return paNoError;
+}
+
+void PaUtil_StopPeriodicThread( PaUtilPeriodicThread *thread )
+{
+    if( thread == NULL )
+        return;
+
+    /* waiting for itself would deadlock, the thread exits once the function returns */
+    if( GetCurrentThreadId() == thread->threadId )
+    {
+        thread->stoppedByFunction = 1;
+        SetEvent( thread->stopEvent );
+        return;
+    }
+
+    SetEvent( thread->stopEvent );
+    WaitForSingleObject( thread->thread, INFINITE );
+
+    CloseHandle( thread->thread );
+    CloseHandle( thread->stopEvent );
+    PaUtil_FreeMemory( thread );
+}
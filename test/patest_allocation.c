@@ -0,0 +1,232 @@
+/** @file patest_allocation.c
+	@ingroup test_src
+	@brief Unit test of allocation groups: alignment of their blocks, and reuse of freed memory.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com
+ * Copyright (c) 1999-2000 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pa_allocation.h"
+
+/* Blocks are aligned for any type, which this test takes to be 16 bytes */
+#define BLOCK_ALIGNMENT     (16)
+/* Enough small blocks to need several chunks */
+#define NUM_BLOCKS          (2000)
+#define MAX_BLOCK_SIZE      (100)
+/* Larger than a quarter of any shared chunk, so given a chunk of its own */
+#define LARGE_BLOCK_SIZE    (100000)
+#define BUFFER_SIZE         (1000)
+
+static int gNumPassed = 0;
+static int gNumFailed = 0;
+
+#define EXPECT(_exp) \
+    do \
+    { \
+        if ((_exp)) {\
+            gNumPassed++; \
+        } \
+        else { \
+            printf("ERROR - line %d: %s\n", __LINE__, #_exp ); \
+            gNumFailed++; \
+        } \
+    } while(0)
+
+static int isAligned( const void *block, unsigned long alignment )
+{
+    return (size_t)block % alignment == 0;
+}
+
+/* Fill a block with a byte derived from its index, to detect blocks overlapping */
+static void fillBlock( void *block, long size, int index )
+{
+    memset( block, index & 0xFF, size );
+}
+
+static int checkBlock( const void *block, long size, int index )
+{
+    const unsigned char *bytes = (const unsigned char *)block;
+    long i;
+
+    for( i=0; i<size; i++ )
+        if( bytes[i] != ( index & 0xFF ) )
+            return 0;
+    return 1;
+}
+
+/* Blocks of all sizes are aligned, don't overlap, and are released together */
+static void testAlignment( void )
+{
+    static void *blocks[ NUM_BLOCKS ];
+    PaUtilAllocationGroup *group = PaUtil_CreateAllocationGroup();
+    PaUtilAllocationGroupStatistics statistics;
+    void *buffer;
+    long blockBytes = 0;
+    int i, allAligned = 1, allIntact = 1;
+
+    printf("alignment\n");
+    EXPECT( group != NULL );
+    if( !group ) return;
+
+    for( i=0; i<NUM_BLOCKS; i++ )
+    {
+        long size = 1 + i % MAX_BLOCK_SIZE;
+        blocks[i] = PaUtil_GroupAllocateMemory( group, size );
+        if( !blocks[i] || !isAligned( blocks[i], BLOCK_ALIGNMENT ) )
+            allAligned = 0;
+        if( blocks[i] )
+            fillBlock( blocks[i], size, i );
+        blockBytes += size;
+    }
+    EXPECT( allAligned );
+
+    for( i=0; i<NUM_BLOCKS; i++ )
+        if( blocks[i] && !checkBlock( blocks[i], 1 + i % MAX_BLOCK_SIZE, i ) )
+            allIntact = 0;
+    EXPECT( allIntact );
+
+    /* Buffer memory is aligned to the cache line */
+    buffer = PaUtil_GroupAllocateBufferMemory( group, BUFFER_SIZE, paUtilPrefaultBufferMemory );
+    EXPECT( buffer != NULL );
+    EXPECT( isAligned( buffer, PA_BUFFER_MEMORY_ALIGNMENT ) );
+
+    PaUtil_GetAllocationGroupStatistics( group, &statistics );
+    EXPECT( statistics.blockCount == NUM_BLOCKS + 1 );
+    EXPECT( statistics.blockBytes == (unsigned long)blockBytes + BUFFER_SIZE );
+    EXPECT( statistics.totalBlockCount == NUM_BLOCKS + 1 );
+    /* Small blocks share chunks */
+    EXPECT( statistics.chunkCount > 1 && statistics.chunkCount < NUM_BLOCKS / 10 );
+    EXPECT( statistics.peakChunkBytes == statistics.chunkBytes );
+
+    /* One chunk is kept for later allocations */
+    PaUtil_FreeAllAllocations( group );
+    PaUtil_GetAllocationGroupStatistics( group, &statistics );
+    EXPECT( statistics.blockCount == 0 );
+    EXPECT( statistics.blockBytes == 0 );
+    EXPECT( statistics.chunkCount == 1 );
+    EXPECT( statistics.peakChunkBytes > statistics.chunkBytes );
+
+    PaUtil_DestroyAllocationGroup( group );
+}
+
+/* Freed memory is reused when the block was the most recent one in its chunk, or its chunk is empty */
+static void testReuse( void )
+{
+    PaUtilAllocationGroup *group = PaUtil_CreateAllocationGroup();
+    PaUtilAllocationGroupStatistics statistics;
+    void *first, *second, *third, *large;
+    unsigned long chunkCount;
+
+    printf("reuse after free\n");
+    EXPECT( group != NULL );
+    if( !group ) return;
+
+    first = PaUtil_GroupAllocateMemory( group, 24 );
+    second = PaUtil_GroupAllocateMemory( group, 40 );
+    EXPECT( first != NULL && second != NULL );
+    EXPECT( (char *)second >= (char *)first + 24 );
+    PaUtil_GetAllocationGroupStatistics( group, &statistics );
+    chunkCount = statistics.chunkCount;
+    EXPECT( chunkCount == 1 );
+
+    /* The most recent block is reused */
+    PaUtil_GroupFreeMemory( group, second );
+    third = PaUtil_GroupAllocateMemory( group, 40 );
+    EXPECT( third == second );
+
+    /* An earlier block isn't */
+    PaUtil_GroupFreeMemory( group, first );
+    second = PaUtil_GroupAllocateMemory( group, 24 );
+    EXPECT( second != first );
+    EXPECT( (char *)second >= (char *)third + 40 );
+
+    /* Once all blocks of the chunk are freed, the chunk is reused from its start */
+    PaUtil_GroupFreeMemory( group, second );
+    PaUtil_GroupFreeMemory( group, third );
+    PaUtil_GetAllocationGroupStatistics( group, &statistics );
+    EXPECT( statistics.blockCount == 0 );
+    EXPECT( statistics.chunkCount == chunkCount );
+    second = PaUtil_GroupAllocateMemory( group, 24 );
+    EXPECT( second == first );
+
+    /* A large block gets a chunk of its own, which is released with the block */
+    large = PaUtil_GroupAllocateMemory( group, LARGE_BLOCK_SIZE );
+    EXPECT( large != NULL );
+    EXPECT( isAligned( large, BLOCK_ALIGNMENT ) );
+    PaUtil_GetAllocationGroupStatistics( group, &statistics );
+    EXPECT( statistics.chunkCount == chunkCount + 1 );
+    if( large )
+    {
+        fillBlock( large, LARGE_BLOCK_SIZE, 0x5A );
+        EXPECT( checkBlock( large, LARGE_BLOCK_SIZE, 0x5A ) );
+    }
+    PaUtil_GroupFreeMemory( group, large );
+    PaUtil_GetAllocationGroupStatistics( group, &statistics );
+    EXPECT( statistics.chunkCount == chunkCount );
+    EXPECT( statistics.blockCount == 1 );
+
+    /* Small blocks still come from the shared chunk */
+    third = PaUtil_GroupAllocateMemory( group, 8 );
+    EXPECT( third != NULL && (char *)third >= (char *)second + 24 );
+    PaUtil_GetAllocationGroupStatistics( group, &statistics );
+    EXPECT( statistics.chunkCount == chunkCount );
+
+    /* Freeing NULL is harmless */
+    PaUtil_GroupFreeMemory( group, NULL );
+    PaUtil_GetAllocationGroupStatistics( group, &statistics );
+    EXPECT( statistics.blockCount == 2 );
+
+    PaUtil_DestroyAllocationGroup( group );
+}
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    printf("patest_allocation: allocation groups.\n");
+
+    testAlignment();
+    testReuse();
+
+    printf("%d tests passed, %d failed.\n", gNumPassed, gNumFailed );
+    if( gNumFailed )
+        return 1;
+    printf("Test finished.\n");
+    return 0;
+}
@@ -0,0 +1,201 @@
+/** @file patest_front_overhead.c
+	@ingroup test_src
+	@brief Measure the per call cost of the front end's blocking stream
+	functions, validated and unchecked.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com
+ * Copyright (c) 1999-2000 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+#include <stdio.h>
+#include "portaudio.h"
+
+#define SAMPLE_RATE         (44100)
+#define FRAMES_PER_BUFFER   (256)
+#define NUM_CALLS           (1000000)
+#define NUM_WRITE_FRAMES    (SAMPLE_RATE * 2)
+
+/* Pa_GetStreamTime() is used as the clock, the overhead of the one call per
+    measurement is negligible */
+
+/* the validated functions, or their unchecked variants */
+typedef struct
+{
+    PaError (*IsStreamActive)( PaStream *stream );
+    PaTime (*GetStreamTime)( PaStream *stream );
+    signed long (*GetStreamWriteAvailable)( PaStream *stream );
+    PaError (*WriteStream)( PaStream *stream, const void *buffer, unsigned long frames );
+}
+StreamFunctions;
+
+static const StreamFunctions validatedFunctions_ =
+    { Pa_IsStreamActive, Pa_GetStreamTime, Pa_GetStreamWriteAvailable, Pa_WriteStream };
+
+static const StreamFunctions uncheckedFunctions_ =
+    { Pa_IsStreamActiveUnchecked, Pa_GetStreamTimeUnchecked,
+      Pa_GetStreamWriteAvailableUnchecked, Pa_WriteStreamUnchecked };
+
+typedef struct
+{
+    double isStreamActive;
+    double getStreamTime;
+    double getStreamWriteAvailable;
+    double writeStream;
+}
+CallCosts;
+
+
+static PaError MeasureCallCosts( const StreamFunctions *functions, CallCosts *costs )
+{
+    PaStreamParameters outputParameters;
+    PaStream *stream;
+    PaError err;
+    float frame[2] = { 0.f, 0.f };
+    PaTime start, elapsed;
+    long framesWritten, writeCalls;
+    int i;
+
+    outputParameters.device = Pa_GetDefaultOutputDevice();
+    if( outputParameters.device == paNoDevice )
+        return paDeviceUnavailable;
+    outputParameters.channelCount = 2;
+    outputParameters.sampleFormat = paFloat32;
+    outputParameters.suggestedLatency = Pa_GetDeviceInfo( outputParameters.device )->defaultHighOutputLatency;
+    outputParameters.hostApiSpecificStreamInfo = NULL;
+
+    err = Pa_OpenStream( &stream, NULL, &outputParameters, SAMPLE_RATE, FRAMES_PER_BUFFER,
+            paNoFlag, NULL, NULL );
+    if( err != paNoError )
+        return err;
+
+    err = Pa_StartStream( stream );
+    if( err != paNoError )
+        goto done;
+
+    start = Pa_GetStreamTime( stream );
+    for( i=0; i < NUM_CALLS; ++i )
+        functions->IsStreamActive( stream );
+    costs->isStreamActive = (Pa_GetStreamTime( stream ) - start) / NUM_CALLS;
+
+    start = Pa_GetStreamTime( stream );
+    for( i=0; i < NUM_CALLS; ++i )
+        functions->GetStreamTime( stream );
+    costs->getStreamTime = (Pa_GetStreamTime( stream ) - start) / NUM_CALLS;
+
+    start = Pa_GetStreamTime( stream );
+    for( i=0; i < NUM_CALLS; ++i )
+        functions->GetStreamWriteAvailable( stream );
+    costs->getStreamWriteAvailable = (Pa_GetStreamTime( stream ) - start) / NUM_CALLS;
+
+    /* write one frame per call, but only as many as fit without blocking, so
+        that only the calls are measured */
+    elapsed = 0.;
+    framesWritten = 0;
+    writeCalls = 0;
+    while( framesWritten < NUM_WRITE_FRAMES )
+    {
+        long available = Pa_GetStreamWriteAvailable( stream );
+        if( available < 0 )
+        {
+            err = (PaError) available;
+            goto done;
+        }
+
+        start = Pa_GetStreamTime( stream );
+        for( i=0; i < available; ++i )
+        {
+            err = functions->WriteStream( stream, frame, 1 );
+            if( err != paNoError && err != paOutputUnderflowed )
+                goto done;
+        }
+        elapsed += Pa_GetStreamTime( stream ) - start;
+
+        framesWritten += available;
+        writeCalls += available;
+        if( available == 0 )
+            Pa_Sleep( 1 );
+    }
+    costs->writeStream = elapsed / writeCalls;
+
+    err = Pa_StopStream( stream );
+
+done:
+    Pa_CloseStream( stream );
+    return err;
+}
+
+
+static void PrintCallCost( const char *name, double validated, double unchecked )
+{
+    printf( "%-28s %10.1f %10.1f\n", name, validated * 1e9, unchecked * 1e9 );
+}
+
+
+int main(void);
+int main(void)
+{
+    CallCosts validated, unchecked;
+    PaError err;
+
+    printf( "PortAudio Test: per call cost of the front end's blocking stream functions.\n" );
+
+    err = Pa_Initialize();
+    if( err != paNoError ) goto error;
+
+    err = MeasureCallCosts( &validatedFunctions_, &validated );
+    if( err != paNoError ) goto error;
+
+    err = MeasureCallCosts( &uncheckedFunctions_, &unchecked );
+    if( err != paNoError ) goto error;
+
+    printf( "%-28s %10s %10s\n", "nanoseconds per call", "validated", "unchecked" );
+    PrintCallCost( "Pa_IsStreamActive", validated.isStreamActive, unchecked.isStreamActive );
+    PrintCallCost( "Pa_GetStreamTime", validated.getStreamTime, unchecked.getStreamTime );
+    PrintCallCost( "Pa_GetStreamWriteAvailable", validated.getStreamWriteAvailable, unchecked.getStreamWriteAvailable );
+    PrintCallCost( "Pa_WriteStream (1 frame)", validated.writeStream, unchecked.writeStream );
+
+    Pa_Terminate();
+    printf("Test finished.\n");
+    return err;
+
+error:
+    Pa_Terminate();
+    fprintf( stderr, "An error occured while using the portaudio stream\n" );
+    fprintf( stderr, "Error number: %d\n", err );
+    fprintf( stderr, "Error message: %s\n", Pa_GetErrorText( err ) );
+    return err;
+}
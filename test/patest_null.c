@@ -0,0 +1,281 @@
+/** @file patest_null.c
+	@ingroup test_src
+	@brief Run callback and blocking streams on virtual devices of the null host API,
+	with jitter and xrun injection, and a free-running device to measure throughput.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com
+ * Copyright (c) 1999-2000 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "portaudio.h"
+#include "pa_null.h"
+
+#define SAMPLE_RATE         (48000)
+#define FRAMES_PER_BUFFER   (64)
+#define NUM_SECONDS         (2)
+#define NUM_CHANNELS        (2)
+/* Audio rendered on the free-running device */
+#define NUM_RENDER_SECONDS  (600)
+#ifndef M_PI
+#define M_PI  (3.14159265)
+#endif
+
+typedef struct
+{
+    double phase;
+    unsigned long frames;
+    unsigned long xruns;
+    unsigned long maxFrames;
+}
+paTestData;
+
+/* Render a sine in full duplex, counting xruns until maxFrames have been processed */
+static int sineCallback( const void *inputBuffer, void *outputBuffer,
+                         unsigned long framesPerBuffer,
+                         const PaStreamCallbackTimeInfo* timeInfo,
+                         PaStreamCallbackFlags statusFlags,
+                         void *userData )
+{
+    paTestData *data = (paTestData*)userData;
+    float *out = (float*)outputBuffer;
+    unsigned long i;
+    int j;
+    (void) inputBuffer; (void) timeInfo;
+
+    if( statusFlags & (paInputOverflow | paOutputUnderflow) )
+        data->xruns++;
+
+    for( i=0; i<framesPerBuffer; i++ )
+    {
+        float sample = (float) (0.2 * sin( data->phase ));
+        for( j=0; j<NUM_CHANNELS; j++ )
+            *out++ = sample;
+        data->phase += 2. * M_PI * 440. / SAMPLE_RATE;
+        if( data->phase > 2. * M_PI ) data->phase -= 2. * M_PI;
+    }
+    data->frames += framesPerBuffer;
+    return data->maxFrames && data->frames >= data->maxFrames ? paComplete : paContinue;
+}
+
+/* Called from a thread of normal priority when the callback missed deadlines, reports only once */
+static void reportDeadlineMisses( PaStream *stream, const PaStreamCallbackProfile *profile, void *userData )
+{
+    PaError err;
+
+    (void) userData;
+    printf("  %lu of %lu callbacks missed their deadline so far\n", profile->deadlineMissCount,
+            profile->callbackCount );
+    err = Pa_SetStreamCallbackProfileReport( stream, NULL, NULL );
+    if( err != paNoError )
+        printf("  Stopping the report failed: %s\n", Pa_GetErrorText( err ) );
+}
+
+static PaError runCallbackStream( PaDeviceIndex device, paTestData *data, int waitForCompletion )
+{
+    PaStreamParameters inputParameters, outputParameters;
+    PaNullStreamStatistics statistics;
+    PaStreamCallbackProfile profile;
+    PaStream *stream = NULL;
+    PaTime start, elapsed;
+    double cpuLoad;
+    PaError err;
+
+    inputParameters.device = outputParameters.device = device;
+    inputParameters.channelCount = outputParameters.channelCount = NUM_CHANNELS;
+    inputParameters.sampleFormat = outputParameters.sampleFormat = paFloat32;
+    inputParameters.suggestedLatency = Pa_GetDeviceInfo( device )->defaultLowInputLatency;
+    outputParameters.suggestedLatency = Pa_GetDeviceInfo( device )->defaultLowOutputLatency;
+    inputParameters.hostApiSpecificStreamInfo = outputParameters.hostApiSpecificStreamInfo = NULL;
+
+    err = Pa_OpenStream( &stream, &inputParameters, &outputParameters, SAMPLE_RATE, FRAMES_PER_BUFFER,
+                         paClipOff | paProfileCallback, sineCallback, data );
+    if( err != paNoError ) return err;
+
+    err = Pa_SetStreamCallbackProfileReport( stream, reportDeadlineMisses, NULL );
+    if( err != paNoError ) goto done;
+
+    start = Pa_GetStreamTime( stream );
+    err = Pa_StartStream( stream );
+    if( err != paNoError ) goto done;
+
+    if( waitForCompletion )
+    {
+        while( ( err = Pa_IsStreamActive( stream ) ) == 1 )
+            Pa_Sleep( 10 );
+        if( err < 0 ) goto done;
+    }
+    else
+        Pa_Sleep( NUM_SECONDS * 1000 );
+
+    elapsed = Pa_GetStreamTime( stream ) - start;
+    cpuLoad = Pa_GetStreamCpuLoad( stream );
+    err = PaNull_GetStreamStatistics( stream, &statistics );
+    if( err != paNoError ) goto done;
+    err = Pa_GetStreamCallbackProfile( stream, &profile );
+    if( err != paNoError ) goto done;
+    err = Pa_StopStream( stream );
+    if( err != paNoError ) goto done;
+
+    printf("  %g seconds of stream time\n", elapsed );
+    printf("  %lu frames in callbacks, %lu host buffers, %lu xruns reported (%lu injected, %lu late), CPU load %g\n",
+            data->frames, statistics.hostBuffersProcessed, data->xruns, statistics.injectedXruns,
+            statistics.lateXruns, cpuLoad );
+    printf("  callbacks used %.2f%% of their budget, %lu missed their deadline",
+            profile.totalBudget > 0. ? 100. * profile.totalDuration / profile.totalBudget : 0.,
+            profile.deadlineMissCount );
+    if( profile.worstCount > 0 )
+        printf(", the worst used %.2f%% of %g seconds", 100. * profile.worst[0].duration / profile.worst[0].budget,
+                profile.worst[0].budget );
+    printf("\n");
+
+done:
+    Pa_CloseStream( stream );
+    return err;
+}
+
+static PaError runBlockingStream( PaDeviceIndex device )
+{
+    PaStreamParameters inputParameters, outputParameters;
+    PaStream *stream = NULL;
+    short buffer[FRAMES_PER_BUFFER * NUM_CHANNELS] = { 0 };
+    unsigned long frames = 0;
+    PaTime start;
+    PaError err;
+
+    inputParameters.device = outputParameters.device = device;
+    inputParameters.channelCount = outputParameters.channelCount = NUM_CHANNELS;
+    inputParameters.sampleFormat = outputParameters.sampleFormat = paInt16;
+    inputParameters.suggestedLatency = Pa_GetDeviceInfo( device )->defaultLowInputLatency;
+    outputParameters.suggestedLatency = Pa_GetDeviceInfo( device )->defaultLowOutputLatency;
+    inputParameters.hostApiSpecificStreamInfo = outputParameters.hostApiSpecificStreamInfo = NULL;
+
+    err = Pa_OpenStream( &stream, &inputParameters, &outputParameters, SAMPLE_RATE, FRAMES_PER_BUFFER,
+                         paClipOff, NULL, NULL );
+    if( err != paNoError ) return err;
+
+    err = Pa_StartStream( stream );
+    if( err != paNoError ) goto done;
+
+    start = Pa_GetStreamTime( stream );
+    while( frames < NUM_SECONDS * SAMPLE_RATE )
+    {
+        err = Pa_ReadStream( stream, buffer, FRAMES_PER_BUFFER );
+        if( err != paNoError && err != paInputOverflowed ) goto done;
+        err = Pa_WriteStream( stream, buffer, FRAMES_PER_BUFFER );
+        if( err != paNoError && err != paOutputUnderflowed ) goto done;
+        frames += FRAMES_PER_BUFFER;
+    }
+    printf("  %lu frames read and written in %g seconds\n", frames, Pa_GetStreamTime( stream ) - start );
+
+    err = Pa_StopStream( stream );
+
+done:
+    Pa_CloseStream( stream );
+    return err;
+}
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    PaNullDeviceSpec spec;
+    PaDeviceIndex paced, freeRunning;
+    PaHostApiIndex hostApi;
+    paTestData data = { 0., 0, 0, 0 };
+    PaError err;
+
+    printf("patest_null: virtual devices of the null host API.\n");
+
+    /* A device with a slightly fast clock, jittery wakeups and random xruns */
+    PaNull_InitializeDeviceSpec( &spec );
+    spec.name = "Jittery";
+    spec.hostSampleFormat = paInt16;
+    spec.framesPerHostBuffer = 256;
+    spec.clockRatio = 1.001;
+    spec.maxJitter = 0.002;
+    spec.xrunProbability = 0.01;
+    err = PaNull_AddDevice( &spec );
+    if( err != paNoError ) goto error;
+
+    PaNull_InitializeDeviceSpec( &spec );
+    spec.name = "Free-running";
+    spec.hostSampleFormat = paInt24 | paNonInterleaved;
+    spec.framesPerHostBuffer = 1024;
+    spec.flags = paNullFreeRunning;
+    err = PaNull_AddDevice( &spec );
+    if( err != paNoError ) goto error;
+
+    err = Pa_Initialize();
+    if( err != paNoError ) goto error;
+
+    hostApi = Pa_HostApiTypeIdToHostApiIndex( paInDevelopment );
+    if( hostApi < 0 ) {
+        err = hostApi;
+        goto error;
+    }
+    paced = Pa_HostApiDeviceIndexToDeviceIndex( hostApi, 0 );
+    freeRunning = Pa_HostApiDeviceIndexToDeviceIndex( hostApi, 1 );
+
+    printf("Callback stream on %s, %d seconds:\n", Pa_GetDeviceInfo( paced )->name, NUM_SECONDS );
+    err = runCallbackStream( paced, &data, 0 );
+    if( err != paNoError ) goto error;
+
+    printf("Blocking stream on %s, %d seconds:\n", Pa_GetDeviceInfo( paced )->name, NUM_SECONDS );
+    err = runBlockingStream( paced );
+    if( err != paNoError ) goto error;
+
+    printf("Callback stream on %s, %d seconds of audio:\n", Pa_GetDeviceInfo( freeRunning )->name,
+            NUM_RENDER_SECONDS );
+    data.frames = data.xruns = 0;
+    data.maxFrames = NUM_RENDER_SECONDS * SAMPLE_RATE;
+    err = runCallbackStream( freeRunning, &data, 1 );
+    if( err != paNoError ) goto error;
+
+    Pa_Terminate();
+    PaNull_ClearDevices();
+    printf("Test finished.\n");
+    return err;
+
+error:
+    Pa_Terminate();
+    fprintf( stderr, "An error occured while using the portaudio stream\n" );
+    fprintf( stderr, "Error number: %d\n", err );
+    fprintf( stderr, "Error message: %s\n", Pa_GetErrorText( err ) );
+    return err;
+}
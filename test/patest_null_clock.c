@@ -0,0 +1,197 @@
+/** @file patest_null_clock.c
+	@ingroup test_src
+	@brief Run streams on null devices with skewed clocks, and check that the rate ratio
+	estimated by Pa_GetStreamClockInfo converges to the skew.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com
+ * Copyright (c) 1999-2000 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "portaudio.h"
+#include "pa_null.h"
+
+#define SAMPLE_RATE         (48000)
+#define FRAMES_PER_BUFFER   (256)
+#define FRAMES_PER_HOST_BUFFER (512)
+/* Each wakeup of the device's thread is delayed by up to half a millisecond */
+#define MAX_JITTER          (0.0005)
+/* The estimate is checked during the last CHECK_SECONDS of RUN_SECONDS */
+#define RUN_SECONDS         (8)
+#define CHECK_SECONDS       (3)
+#define POLL_MSEC           (100)
+/* Largest relative error of the estimated rate ratio once converged */
+#define RATIO_TOLERANCE     (0.0005)
+#define NUM_RATIOS          (2)
+
+/* A device clock running 0.2% fast, then one running 0.3% slow */
+static const double clockRatios[ NUM_RATIOS ] = { 1.002, 0.997 };
+
+/* Output silence */
+static int silenceCallback( const void *inputBuffer, void *outputBuffer,
+                            unsigned long framesPerBuffer,
+                            const PaStreamCallbackTimeInfo* timeInfo,
+                            PaStreamCallbackFlags statusFlags,
+                            void *userData )
+{
+    float *out = (float*)outputBuffer;
+    unsigned long i;
+    (void) inputBuffer; (void) timeInfo; (void) statusFlags; (void) userData;
+
+    for( i=0; i<framesPerBuffer; i++ )
+        *out++ = 0.f;
+    return paContinue;
+}
+
+/* Run a stream on a device whose clock is skewed by clockRatio, and check the estimate of the skew */
+static PaError testClockRatio( double clockRatio )
+{
+    PaNullDeviceSpec spec;
+    PaStreamParameters outputParameters;
+    PaStream *stream = NULL;
+    PaStreamClockInfo clockInfo;
+    double minRatio = 2., maxRatio = 0.;
+    int i, checked = 0;
+    PaError err;
+
+    printf("Device clock ratio %g:\n", clockRatio );
+
+    PaNull_InitializeDeviceSpec( &spec );
+    spec.name = "Skewed";
+    spec.maxInputChannels = 0;
+    spec.maxOutputChannels = 1;
+    spec.defaultSampleRate = SAMPLE_RATE;
+    spec.framesPerHostBuffer = FRAMES_PER_HOST_BUFFER;
+    spec.clockRatio = clockRatio;
+    spec.maxJitter = MAX_JITTER;
+    err = PaNull_AddDevice( &spec );
+    if( err != paNoError ) goto done;
+
+    err = Pa_Initialize();
+    if( err != paNoError ) goto done;
+
+    outputParameters.device = Pa_HostApiDeviceIndexToDeviceIndex(
+            Pa_HostApiTypeIdToHostApiIndex( paInDevelopment ), 0 );
+    if( outputParameters.device < 0 )
+    {
+        err = outputParameters.device;
+        goto done;
+    }
+    outputParameters.channelCount = 1;
+    outputParameters.sampleFormat = paFloat32;
+    outputParameters.suggestedLatency = Pa_GetDeviceInfo( outputParameters.device )->defaultLowOutputLatency;
+    outputParameters.hostApiSpecificStreamInfo = NULL;
+
+    err = Pa_OpenStream( &stream, NULL, &outputParameters, SAMPLE_RATE, FRAMES_PER_BUFFER, paClipOff,
+                         silenceCallback, NULL );
+    if( err != paNoError ) goto done;
+
+    err = Pa_StartStream( stream );
+    if( err != paNoError ) goto done;
+
+    for( i=1; i<=RUN_SECONDS * 1000 / POLL_MSEC; i++ )
+    {
+        Pa_Sleep( POLL_MSEC );
+        clockInfo.structVersion = 1;
+        err = Pa_GetStreamClockInfo( stream, &clockInfo );
+        if( err != paNoError ) goto done;
+
+        if( i % ( 1000 / POLL_MSEC ) == 0 )
+        {
+            printf("  after %d seconds: %s, rate ratio %.6f\n", i * POLL_MSEC / 1000,
+                    clockInfo.isLocked ? "locked" : "not locked", clockInfo.rateRatio );
+        }
+
+        /* Once converged, every estimate must be within the tolerance */
+        if( i > ( RUN_SECONDS - CHECK_SECONDS ) * 1000 / POLL_MSEC )
+        {
+            if( !clockInfo.isLocked )
+            {
+                printf("The estimator isn't locked after %d seconds!\n", i * POLL_MSEC / 1000 );
+                err = paInternalError;
+                goto done;
+            }
+            if( clockInfo.rateRatio < minRatio ) minRatio = clockInfo.rateRatio;
+            if( clockInfo.rateRatio > maxRatio ) maxRatio = clockInfo.rateRatio;
+            checked++;
+        }
+    }
+
+    err = Pa_StopStream( stream );
+    if( err != paNoError ) goto done;
+
+    printf("  over the last %d seconds the rate ratio was between %.6f and %.6f\n", CHECK_SECONDS,
+            minRatio, maxRatio );
+    if( !checked || fabs( minRatio / clockRatio - 1. ) > RATIO_TOLERANCE ||
+            fabs( maxRatio / clockRatio - 1. ) > RATIO_TOLERANCE )
+    {
+        printf("The rate ratio differs from %g by more than %g%%!\n", clockRatio, 100. * RATIO_TOLERANCE );
+        err = paInternalError;
+    }
+
+done:
+    if( stream ) Pa_CloseStream( stream );
+    Pa_Terminate();
+    PaNull_ClearDevices();
+    return err;
+}
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    PaError err = paNoError;
+    int i;
+
+    printf("patest_null_clock: estimate the skew of the clocks of null devices with Pa_GetStreamClockInfo.\n");
+
+    for( i=0; i<NUM_RATIOS; i++ )
+    {
+        err = testClockRatio( clockRatios[i] );
+        if( err != paNoError ) goto error;
+    }
+
+    printf("Test finished.\n");
+    return err;
+
+error:
+    fprintf( stderr, "An error occured while using the portaudio stream\n" );
+    fprintf( stderr, "Error number: %d\n", err );
+    fprintf( stderr, "Error message: %s\n", Pa_GetErrorText( err ) );
+    return err;
+}
@@ -0,0 +1,258 @@
+/** @file patest_null_convert.c
+	@ingroup test_src
+	@brief Convert the sample rate of a stream on a null device which doesn't support it,
+	checking the frames written, the reported latency and the frequency of a sine.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com
+ * Copyright (c) 1999-2000 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "portaudio.h"
+#include "pa_null.h"
+
+/* The device only runs at DEVICE_RATE, the stream is converted from SAMPLE_RATE */
+#define DEVICE_RATE         (48000)
+#define SAMPLE_RATE         (44100)
+#define FRAMES_PER_BUFFER   (256)
+#define FRAMES_PER_HOST_BUFFER (1024)
+#define NUM_SECONDS         (4)
+#define FREQUENCY           (1000.)
+/* Largest relative error of the measured frequency */
+#define FREQUENCY_TOLERANCE (0.001)
+/* Frames at the device rate left out of the frequency measurement at each end of the file */
+#define EDGE_FRAMES         (8192)
+#define OUTPUT_FILE         "patest_null_convert.wav"
+/* Size of the header of the 16 bit WAV files written by the null host API */
+#define WAV_HEADER_SIZE     (44)
+#ifndef M_PI
+#define M_PI  (3.14159265)
+#endif
+
+typedef struct
+{
+    double phase;
+    unsigned long frames;
+}
+paTestData;
+
+/* Render a sine at SAMPLE_RATE until NUM_SECONDS have been written */
+static int sineCallback( const void *inputBuffer, void *outputBuffer,
+                         unsigned long framesPerBuffer,
+                         const PaStreamCallbackTimeInfo* timeInfo,
+                         PaStreamCallbackFlags statusFlags,
+                         void *userData )
+{
+    paTestData *data = (paTestData*)userData;
+    float *out = (float*)outputBuffer;
+    unsigned long i;
+    (void) inputBuffer; (void) timeInfo; (void) statusFlags;
+
+    for( i=0; i<framesPerBuffer; i++ )
+    {
+        *out++ = (float) (0.5 * sin( data->phase ));
+        data->phase += 2. * M_PI * FREQUENCY / SAMPLE_RATE;
+        if( data->phase > 2. * M_PI ) data->phase -= 2. * M_PI;
+    }
+    data->frames += framesPerBuffer;
+    return data->frames >= NUM_SECONDS * SAMPLE_RATE ? paComplete : paContinue;
+}
+
+/* Read the mono samples of a WAV file written by the null host API, return the number of frames or -1 */
+static long readWavFile( const char *fileName, short *samples, long maxFrames )
+{
+    FILE *file = fopen( fileName, "rb" );
+    unsigned char bytes[2];
+    long frames = 0;
+
+    if( !file ) return -1;
+    if( fseek( file, WAV_HEADER_SIZE, SEEK_SET ) != 0 )
+    {
+        fclose( file );
+        return -1;
+    }
+    /* WAV samples are little endian */
+    while( frames < maxFrames && fread( bytes, 1, 2, file ) == 2 )
+        samples[frames++] = (short)( bytes[0] | ( bytes[1] << 8 ) );
+    fclose( file );
+    return frames;
+}
+
+/* Measure the frequency of a sine from its rising zero crossings, interpolating between samples */
+static double measureFrequency( const short *samples, long numFrames, double sampleRate )
+{
+    double first = -1., last = -1.;
+    long crossings = 0, i;
+
+    for( i=1; i<numFrames; i++ )
+    {
+        if( samples[i-1] < 0 && samples[i] >= 0 )
+        {
+            last = i - 1 + (double)-samples[i-1] / ( samples[i] - samples[i-1] );
+            if( first < 0 ) first = last;
+            crossings++;
+        }
+    }
+    return crossings > 1 ? ( crossings - 1 ) * sampleRate / ( last - first ) : 0.;
+}
+
+/* Every frame of the file, with room for the converter's delay and a partial host buffer */
+static short samples[ 2 * NUM_SECONDS * DEVICE_RATE ];
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    PaNullDeviceSpec spec;
+    PaStreamParameters outputParameters;
+    PaStream *stream = NULL;
+    const PaStreamInfo *streamInfo;
+    paTestData data = { 0., 0 };
+    PaTime hostLatency, outputLatency;
+    long fileFrames, expectedFrames, toleranceFrames;
+    double frequency;
+    PaError err;
+
+    printf("patest_null_convert: play a %g Hz sine at %d Hz to a null device running at %d Hz.\n",
+            FREQUENCY, SAMPLE_RATE, DEVICE_RATE );
+
+    PaNull_InitializeDeviceSpec( &spec );
+    spec.name = "Converted";
+    spec.maxInputChannels = 0;
+    spec.maxOutputChannels = 1;
+    spec.defaultSampleRate = spec.minSampleRate = spec.maxSampleRate = DEVICE_RATE;
+    spec.framesPerHostBuffer = FRAMES_PER_HOST_BUFFER;
+    spec.flags = paNullFreeRunning;
+    spec.outputFile = OUTPUT_FILE;
+    err = PaNull_AddDevice( &spec );
+    if( err != paNoError ) goto error;
+
+    err = Pa_Initialize();
+    if( err != paNoError ) goto error;
+
+    outputParameters.device = Pa_HostApiDeviceIndexToDeviceIndex(
+            Pa_HostApiTypeIdToHostApiIndex( paInDevelopment ), 0 );
+    if( outputParameters.device < 0 )
+    {
+        err = outputParameters.device;
+        goto error;
+    }
+    outputParameters.channelCount = 1;
+    outputParameters.sampleFormat = paFloat32;
+    outputParameters.suggestedLatency = Pa_GetDeviceInfo( outputParameters.device )->defaultLowOutputLatency;
+    outputParameters.hostApiSpecificStreamInfo = NULL;
+    /* Without a converter, the latency of the device's host buffers */
+    hostLatency = outputParameters.suggestedLatency;
+
+    /* The device doesn't support the rate unless converting */
+    err = Pa_OpenStream( &stream, NULL, &outputParameters, SAMPLE_RATE, FRAMES_PER_BUFFER, paClipOff,
+                         sineCallback, &data );
+    if( err != paInvalidSampleRate )
+    {
+        printf("Opening a stream at %d Hz without paConvertSampleRate returned %d!\n", SAMPLE_RATE, err );
+        if( err == paNoError ) Pa_CloseStream( stream );
+        err = paInternalError;
+        goto error;
+    }
+
+    err = Pa_OpenStream( &stream, NULL, &outputParameters, SAMPLE_RATE, FRAMES_PER_BUFFER,
+                         paClipOff | paConvertSampleRate, sineCallback, &data );
+    if( err != paNoError ) goto error;
+
+    /* The stream runs at the requested rate, and its latency includes the converter's delay */
+    streamInfo = Pa_GetStreamInfo( stream );
+    outputLatency = streamInfo->outputLatency;
+    printf("Stream sample rate %g Hz, output latency %g seconds, %g seconds of which are the device's.\n",
+            streamInfo->sampleRate, outputLatency, hostLatency );
+    if( streamInfo->sampleRate != SAMPLE_RATE || outputLatency <= hostLatency || outputLatency > hostLatency + .1 )
+    {
+        printf("Unexpected stream sample rate or output latency!\n");
+        err = paInternalError;
+        goto error;
+    }
+
+    err = Pa_StartStream( stream );
+    if( err != paNoError ) goto error;
+    while( ( err = Pa_IsStreamActive( stream ) ) == 1 )
+        Pa_Sleep( 10 );
+    if( err < 0 ) goto error;
+
+    /* Closing the stream completes the output file */
+    err = Pa_CloseStream( stream );
+    stream = NULL;
+    if( err != paNoError ) goto error;
+    Pa_Terminate();
+    PaNull_ClearDevices();
+
+    /* The device writes the frames converted to its rate in whole host buffers, give or take the converter's
+       delay and the last user buffer */
+    fileFrames = readWavFile( OUTPUT_FILE, samples, sizeof (samples) / sizeof (samples[0]) );
+    expectedFrames = (long)( (double)data.frames * DEVICE_RATE / SAMPLE_RATE );
+    toleranceFrames = FRAMES_PER_HOST_BUFFER + FRAMES_PER_BUFFER * DEVICE_RATE / SAMPLE_RATE +
+        (long)ceil( ( outputLatency - hostLatency ) * DEVICE_RATE );
+    printf("%lu frames rendered at %d Hz, %s has %ld frames at %d Hz, %ld expected.\n", data.frames,
+            SAMPLE_RATE, OUTPUT_FILE, fileFrames, DEVICE_RATE, expectedFrames );
+    if( fileFrames < expectedFrames - toleranceFrames || fileFrames > expectedFrames + toleranceFrames )
+    {
+        printf("The number of frames differs from the expected one by more than %ld!\n", toleranceFrames );
+        err = paInternalError;
+        goto error;
+    }
+
+    /* Leave out the converter's ramp up and the end of the file */
+    frequency = measureFrequency( samples + EDGE_FRAMES, fileFrames - 2 * EDGE_FRAMES, DEVICE_RATE );
+    printf("The sine has a frequency of %.3f Hz at the device rate.\n", frequency );
+    if( fabs( frequency - FREQUENCY ) > FREQUENCY_TOLERANCE * FREQUENCY )
+    {
+        printf("The frequency differs from %g Hz by more than %g%%!\n", FREQUENCY, 100. * FREQUENCY_TOLERANCE );
+        err = paInternalError;
+        goto error;
+    }
+
+    printf("Test finished.\n");
+    return err;
+
+error:
+    if( stream ) Pa_CloseStream( stream );
+    Pa_Terminate();
+    PaNull_ClearDevices();
+    fprintf( stderr, "An error occured while using the portaudio stream\n" );
+    fprintf( stderr, "Error number: %d\n", err );
+    fprintf( stderr, "Error message: %s\n", Pa_GetErrorText( err ) );
+    return err;
+}
@@ -0,0 +1,390 @@
+/** @file patest_null_inplace.c
+	@ingroup test_src
+	@brief Check that the buffer processor passes user buffers in place in the host buffers
+	of a null device when their formats match, and converts them correctly when they don't.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com
+ * Copyright (c) 1999-2000 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "portaudio.h"
+#include "pa_null.h"
+
+#define SAMPLE_RATE         (48000)
+#define FRAMES_PER_HOST_BUFFER (1024)
+#define MAX_CHANNELS        (4)
+/* One second of input, with as many channels as the device */
+#define INPUT_FRAMES        (48000)
+/* Frames of the output file read for checking */
+#define MAX_OUTPUT_FRAMES   (INPUT_FRAMES + 4 * FRAMES_PER_HOST_BUFFER)
+/* Largest error of a sample, 16 bit samples are converted with truncation */
+#define TOLERANCE           (0.0001)
+#define INPUT_FILE          "patest_null_inplace_in.raw"
+#define OUTPUT_FILE         "patest_null_inplace_out.raw"
+
+typedef struct
+{
+    int channelCount;
+    PaSampleFormat sampleFormat;
+    unsigned long framesPerBuffer;
+    /* Whether the buffer processor should pass user buffers in the host buffers */
+    int inputInPlace, outputInPlace;
+    const char *description;
+}
+TestCase;
+
+/* The device's host buffers are interleaved float with MAX_CHANNELS channels */
+static const TestCase testCases[] =
+{
+    { 4, paFloat32, 256, 1, 1, "same format and channels, user buffers dividing host buffers" },
+    { 4, paFloat32, 384, 1, 1, "same format and channels, user buffers straddling host buffers" },
+    { 2, paFloat32, 256, 0, 1, "fewer channels than the input file" },
+    { 4, paInt16, 256, 0, 0, "16 bit user buffers" },
+    { 4, paFloat32 | paNonInterleaved, 256, 0, 0, "non-interleaved user buffers" }
+};
+
+#define NUM_TEST_CASES  ((int)( sizeof (testCases) / sizeof (testCases[0]) ))
+
+typedef struct
+{
+    const TestCase *testCase;
+    unsigned long frames;               /* Frames passed to the callback so far */
+    unsigned long maxFrames;            /* Output only streams complete after as many frames */
+    unsigned long mismatches;           /* Input samples which differ from the input file */
+    const void *previousInput, *previousOutput;
+    unsigned long inputMoves, outputMoves; /* Callbacks passed different buffers than the previous one */
+}
+paTestData;
+
+/* The signal of the input file, a ramp that doesn't repeat within a second, different on each channel */
+static float expectedSample( unsigned long frame, int channel )
+{
+    return (float)( (long)( ( frame * 37 + channel * 5003 ) % 16384 ) - 8192 ) / 16384.f;
+}
+
+/* The first channel of a buffer passed to the callback */
+static const void *firstChannel( const void *buffer, PaSampleFormat sampleFormat )
+{
+    return ( sampleFormat & paNonInterleaved ) ? ((const void * const *)buffer)[0] : buffer;
+}
+
+static float getSample( const void *buffer, const TestCase *testCase, unsigned long frame, int channel )
+{
+    if( testCase->sampleFormat & paNonInterleaved )
+        return ((const float * const *)buffer)[channel][frame];
+    if( testCase->sampleFormat == paInt16 )
+        return ((const short *)buffer)[frame * testCase->channelCount + channel] / 32768.f;
+    return ((const float *)buffer)[frame * testCase->channelCount + channel];
+}
+
+static void setSample( void *buffer, const TestCase *testCase, unsigned long frame, int channel, float sample )
+{
+    if( testCase->sampleFormat & paNonInterleaved )
+        ((float **)buffer)[channel][frame] = sample;
+    else if( testCase->sampleFormat == paInt16 )
+        ((short *)buffer)[frame * testCase->channelCount + channel] = (short)( sample * 32768.f );
+    else
+        ((float *)buffer)[frame * testCase->channelCount + channel] = sample;
+}
+
+/* Check the input against the input file, and pass it to the output, or play the input file's signal */
+static int testCallback( const void *inputBuffer, void *outputBuffer,
+                         unsigned long framesPerBuffer,
+                         const PaStreamCallbackTimeInfo* timeInfo,
+                         PaStreamCallbackFlags statusFlags,
+                         void *userData )
+{
+    paTestData *data = (paTestData*)userData;
+    const TestCase *testCase = data->testCase;
+    unsigned long i;
+    int j;
+    (void) timeInfo; (void) statusFlags;
+
+    if( inputBuffer )
+    {
+        const void *input = firstChannel( inputBuffer, testCase->sampleFormat );
+        if( data->previousInput && input != data->previousInput )
+            data->inputMoves++;
+        data->previousInput = input;
+    }
+    if( outputBuffer )
+    {
+        const void *output = firstChannel( outputBuffer, testCase->sampleFormat );
+        if( data->previousOutput && output != data->previousOutput )
+            data->outputMoves++;
+        data->previousOutput = output;
+    }
+
+    for( i=0; i<framesPerBuffer; i++ )
+    {
+        for( j=0; j<testCase->channelCount; j++ )
+        {
+            float sample = expectedSample( data->frames + i, j );
+            if( inputBuffer )
+            {
+                /* The input ends with silence in the last host buffer */
+                if( data->frames + i < INPUT_FRAMES &&
+                        fabs( getSample( inputBuffer, testCase, i, j ) - sample ) > TOLERANCE )
+                    data->mismatches++;
+                sample = getSample( inputBuffer, testCase, i, j );
+            }
+            if( outputBuffer )
+                setSample( outputBuffer, testCase, i, j, sample );
+        }
+    }
+    data->frames += framesPerBuffer;
+
+    /* Streams with input complete at the end of the input file */
+    return !inputBuffer && data->frames >= data->maxFrames ? paComplete : paContinue;
+}
+
+/* Write the input file, interleaved float samples in native byte order */
+static int writeInputFile( void )
+{
+    FILE *file = fopen( INPUT_FILE, "wb" );
+    unsigned long i;
+    int j;
+
+    if( !file ) return 0;
+    for( i=0; i<INPUT_FRAMES; i++ )
+    {
+        for( j=0; j<MAX_CHANNELS; j++ )
+        {
+            float sample = expectedSample( i, j );
+            if( fwrite( &sample, sizeof (sample), 1, file ) != 1 )
+            {
+                fclose( file );
+                return 0;
+            }
+        }
+    }
+    return fclose( file ) == 0;
+}
+
+static float outputSamples[ MAX_OUTPUT_FRAMES * MAX_CHANNELS ];
+
+/* Check that the output file has the input file's signal after delayFrames of silence, return the number of
+   mismatching samples */
+static unsigned long checkOutputFile( int channelCount, unsigned long delayFrames, unsigned long frames )
+{
+    FILE *file = fopen( OUTPUT_FILE, "rb" );
+    unsigned long framesRead, mismatches = 0, i;
+    int j;
+
+    if( !file ) return frames * channelCount;
+    framesRead = (unsigned long)fread( outputSamples, sizeof (float) * channelCount, MAX_OUTPUT_FRAMES, file );
+    fclose( file );
+
+    if( framesRead < frames )
+    {
+        printf("    %s has %lu frames, %lu expected\n", OUTPUT_FILE, framesRead, frames );
+        mismatches += ( frames - framesRead ) * channelCount;
+        frames = framesRead;
+    }
+    for( i=0; i<frames; i++ )
+    {
+        for( j=0; j<channelCount; j++ )
+        {
+            float sample = i < delayFrames ? 0.f : expectedSample( i - delayFrames, j );
+            if( fabs( outputSamples[ i * channelCount + j ] - sample ) > TOLERANCE )
+                mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+/* Run a callback stream on the device until it completes, and return the frames by which the buffer processor
+   delays its output */
+static PaError runStream( PaDeviceIndex device, int input, int output, paTestData *data,
+                          unsigned long *delayFrames )
+{
+    const TestCase *testCase = data->testCase;
+    PaStreamParameters parameters;
+    PaStream *stream = NULL;
+    const PaStreamInfo *streamInfo;
+    PaTime delay = 0;
+    PaError err;
+
+    parameters.device = device;
+    parameters.channelCount = testCase->channelCount;
+    parameters.sampleFormat = testCase->sampleFormat;
+    parameters.suggestedLatency = Pa_GetDeviceInfo( device )->defaultLowOutputLatency;
+    parameters.hostApiSpecificStreamInfo = NULL;
+
+    err = Pa_OpenStream( &stream, input ? &parameters : NULL, output ? &parameters : NULL, SAMPLE_RATE,
+                         testCase->framesPerBuffer, paClipOff | paDitherOff, testCallback, data );
+    if( err != paNoError ) return err;
+
+    /* The device's own latency is a host buffer of input, and defaultLowOutputLatency of output. Its files
+       aren't delayed by it, the rest of the latency is the buffer processor's. */
+    streamInfo = Pa_GetStreamInfo( stream );
+    if( input )
+        delay += streamInfo->inputLatency - (PaTime)FRAMES_PER_HOST_BUFFER / SAMPLE_RATE;
+    if( output )
+        delay += streamInfo->outputLatency - Pa_GetDeviceInfo( device )->defaultLowOutputLatency;
+    *delayFrames = (unsigned long)floor( delay * SAMPLE_RATE + .5 );
+
+    err = Pa_StartStream( stream );
+    if( err != paNoError ) goto done;
+    while( ( err = Pa_IsStreamActive( stream ) ) == 1 )
+        Pa_Sleep( 5 );
+    if( err < 0 ) goto done;
+    err = Pa_StopStream( stream );
+
+done:
+    /* Closing the stream completes the output file */
+    Pa_CloseStream( stream );
+    return err;
+}
+
+/* Run input only, output only and full duplex streams for a test case, and check their signals */
+static int runTestCase( PaDeviceIndex device, const TestCase *testCase, PaError *err )
+{
+    static const char *directions[] = { "input only", "output only", "full duplex" };
+    int direction, failed = 0;
+
+    printf("%d channels, %s, %lu frames per buffer:\n", testCase->channelCount, testCase->description,
+            testCase->framesPerBuffer );
+
+    for( direction=0; direction<3; direction++ )
+    {
+        int input = direction != 1, output = direction != 0;
+        paTestData data;
+        unsigned long delayFrames, mismatches;
+
+        memset( &data, 0, sizeof (data) );
+        data.testCase = testCase;
+        data.maxFrames = INPUT_FRAMES;
+
+        *err = runStream( device, input, output, &data, &delayFrames );
+        if( *err != paNoError ) return 0;
+
+        mismatches = data.mismatches;
+        if( output )
+            mismatches += checkOutputFile( testCase->channelCount, delayFrames, INPUT_FRAMES );
+
+        printf("  %-12s %lu frames, delayed by %lu, buffers moved %lu times in input and %lu in output, "
+                "%lu bad samples\n", directions[direction], data.frames, delayFrames, data.inputMoves,
+                data.outputMoves, mismatches );
+
+        if( mismatches )
+        {
+            printf("  Bad samples!\n");
+            failed = 1;
+        }
+        /* In place, the callback is passed successive parts of the host buffers */
+        if( ( input && ( data.inputMoves != 0 ) != testCase->inputInPlace ) ||
+                ( output && ( data.outputMoves != 0 ) != testCase->outputInPlace ) )
+        {
+            printf("  User buffers were %s!\n", ( input ? data.inputMoves : data.outputMoves ) ?
+                    "unexpectedly passed in place" : "unexpectedly not passed in place" );
+            failed = 1;
+        }
+    }
+    return !failed;
+}
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    PaNullDeviceSpec spec;
+    PaDeviceIndex device;
+    PaError err = paNoError;
+    int i, failures = 0;
+
+    printf("patest_null_inplace: process the buffers of a null device in place or through conversions.\n");
+
+    if( !writeInputFile() )
+    {
+        printf("Can't write %s!\n", INPUT_FILE );
+        return 1;
+    }
+
+    PaNull_InitializeDeviceSpec( &spec );
+    spec.name = "Raw";
+    spec.maxInputChannels = spec.maxOutputChannels = MAX_CHANNELS;
+    spec.defaultSampleRate = SAMPLE_RATE;
+    spec.hostSampleFormat = paFloat32;
+    spec.framesPerHostBuffer = FRAMES_PER_HOST_BUFFER;
+    spec.flags = paNullFreeRunning | paNullRawFiles;
+    spec.inputFile = INPUT_FILE;
+    spec.outputFile = OUTPUT_FILE;
+    err = PaNull_AddDevice( &spec );
+    if( err != paNoError ) goto error;
+
+    err = Pa_Initialize();
+    if( err != paNoError ) goto error;
+
+    device = Pa_HostApiDeviceIndexToDeviceIndex( Pa_HostApiTypeIdToHostApiIndex( paInDevelopment ), 0 );
+    if( device < 0 )
+    {
+        err = device;
+        goto error;
+    }
+
+    for( i=0; i<NUM_TEST_CASES; i++ )
+    {
+        if( !runTestCase( device, &testCases[i], &err ) )
+        {
+            if( err != paNoError ) goto error;
+            failures++;
+        }
+    }
+
+    Pa_Terminate();
+    PaNull_ClearDevices();
+
+    if( failures )
+    {
+        printf("%d of %d test cases failed.\n", failures, NUM_TEST_CASES );
+        return 1;
+    }
+    printf("Test finished.\n");
+    return err;
+
+error:
+    Pa_Terminate();
+    PaNull_ClearDevices();
+    fprintf( stderr, "An error occured while using the portaudio stream\n" );
+    fprintf( stderr, "Error number: %d\n", err );
+    fprintf( stderr, "Error message: %s\n", Pa_GetErrorText( err ) );
+    return err;
+}
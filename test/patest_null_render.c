@@ -0,0 +1,269 @@
+/** @file patest_null_render.c
+	@ingroup test_src
+	@brief Render a WAV file offline with a free-running file device of the null host API,
+	then process it into another one, measuring the throughput of the callbacks.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com
+ * Copyright (c) 1999-2000 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "portaudio.h"
+#include "pa_null.h"
+
+#define SAMPLE_RATE         (48000)
+#define FRAMES_PER_BUFFER   (256)
+#define FRAMES_PER_HOST_BUFFER (4096)
+#define NUM_CHANNELS        (2)
+/* Audio rendered, ten minutes */
+#define NUM_SECONDS         (600)
+#define RENDER_FILE         "patest_null_render.wav"
+#define PROCESS_FILE        "patest_null_process.wav"
+/* Size of the header of the 16 bit WAV files written by the null host API */
+#define WAV_HEADER_SIZE     (44)
+#ifndef M_PI
+#define M_PI  (3.14159265)
+#endif
+
+typedef struct
+{
+    double phase;
+    unsigned long frames;
+    unsigned long callbacks;
+    unsigned long maxFrames;
+}
+paTestData;
+
+/* Render a sine until maxFrames have been written */
+static int renderCallback( const void *inputBuffer, void *outputBuffer,
+                           unsigned long framesPerBuffer,
+                           const PaStreamCallbackTimeInfo* timeInfo,
+                           PaStreamCallbackFlags statusFlags,
+                           void *userData )
+{
+    paTestData *data = (paTestData*)userData;
+    float *out = (float*)outputBuffer;
+    unsigned long i;
+    int j;
+    (void) inputBuffer; (void) timeInfo; (void) statusFlags;
+
+    for( i=0; i<framesPerBuffer; i++ )
+    {
+        float sample = (float) (0.5 * sin( data->phase ));
+        for( j=0; j<NUM_CHANNELS; j++ )
+            *out++ = sample;
+        data->phase += 2. * M_PI * 440. / SAMPLE_RATE;
+        if( data->phase > 2. * M_PI ) data->phase -= 2. * M_PI;
+    }
+    data->frames += framesPerBuffer;
+    data->callbacks++;
+    return data->frames >= data->maxFrames ? paComplete : paContinue;
+}
+
+/* Attenuate the input, the stream completes at the end of the input file */
+static int processCallback( const void *inputBuffer, void *outputBuffer,
+                            unsigned long framesPerBuffer,
+                            const PaStreamCallbackTimeInfo* timeInfo,
+                            PaStreamCallbackFlags statusFlags,
+                            void *userData )
+{
+    paTestData *data = (paTestData*)userData;
+    const float *in = (const float*)inputBuffer;
+    float *out = (float*)outputBuffer;
+    unsigned long i;
+    (void) timeInfo; (void) statusFlags;
+
+    for( i=0; i<framesPerBuffer * NUM_CHANNELS; i++ )
+        *out++ = 0.5f * *in++;
+    data->frames += framesPerBuffer;
+    data->callbacks++;
+    return paContinue;
+}
+
+/* Return the number of frames in a WAV file written by the null host API, or -1 if it can't be read */
+static long countWavFrames( const char *fileName )
+{
+    FILE *file = fopen( fileName, "rb" );
+    long size = -1;
+
+    if( !file ) return -1;
+    if( fseek( file, 0, SEEK_END ) == 0 )
+        size = ftell( file );
+    fclose( file );
+    return size < WAV_HEADER_SIZE ? -1 : ( size - WAV_HEADER_SIZE ) / (long)( NUM_CHANNELS * sizeof (short) );
+}
+
+/* Run a stream on the first null device until it completes, and report its throughput */
+static PaError runStream( int numInputChannels, PaStreamCallback *callback, paTestData *data )
+{
+    PaStreamParameters inputParameters, outputParameters;
+    PaHostApiIndex hostApi;
+    PaDeviceIndex device;
+    PaStream *stream = NULL;
+    clock_t start;
+    double seconds;
+    PaError err;
+
+    hostApi = Pa_HostApiTypeIdToHostApiIndex( paInDevelopment );
+    if( hostApi < 0 ) return hostApi;
+    device = Pa_HostApiDeviceIndexToDeviceIndex( hostApi, 0 );
+
+    inputParameters.device = outputParameters.device = device;
+    inputParameters.channelCount = numInputChannels;
+    outputParameters.channelCount = NUM_CHANNELS;
+    inputParameters.sampleFormat = outputParameters.sampleFormat = paFloat32;
+    inputParameters.suggestedLatency = Pa_GetDeviceInfo( device )->defaultHighInputLatency;
+    outputParameters.suggestedLatency = Pa_GetDeviceInfo( device )->defaultHighOutputLatency;
+    inputParameters.hostApiSpecificStreamInfo = outputParameters.hostApiSpecificStreamInfo = NULL;
+
+    err = Pa_OpenStream( &stream, numInputChannels ? &inputParameters : NULL, &outputParameters, SAMPLE_RATE,
+                         FRAMES_PER_BUFFER, paClipOff, callback, data );
+    if( err != paNoError ) return err;
+
+    start = clock();
+    err = Pa_StartStream( stream );
+    if( err != paNoError ) goto done;
+
+    while( ( err = Pa_IsStreamActive( stream ) ) == 1 )
+        Pa_Sleep( 10 );
+    if( err < 0 ) goto done;
+    seconds = (double)( clock() - start ) / CLOCKS_PER_SEC;
+
+    printf("  %g seconds of audio in %g CPU seconds, %g times real time\n",
+            (double)data->frames / SAMPLE_RATE, seconds, data->frames / ( SAMPLE_RATE * seconds ) );
+    printf("  %lu callbacks of %d frames, %g callbacks per second\n", data->callbacks, FRAMES_PER_BUFFER,
+            data->callbacks / seconds );
+
+    err = Pa_StopStream( stream );
+
+done:
+    /* Closing the stream completes the output file */
+    Pa_CloseStream( stream );
+    return err;
+}
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    PaNullDeviceSpec spec;
+    paTestData data = { 0., 0, 0, 0 };
+    unsigned long renderedFrames;
+    long renderedFileFrames, processedFileFrames;
+    PaError err;
+
+    printf("patest_null_render: render %d seconds of audio to %s, then process it into %s.\n",
+            NUM_SECONDS, RENDER_FILE, PROCESS_FILE );
+
+    PaNull_InitializeDeviceSpec( &spec );
+    spec.name = "Render";
+    spec.maxInputChannels = 0;
+    spec.defaultSampleRate = SAMPLE_RATE;
+    spec.framesPerHostBuffer = FRAMES_PER_HOST_BUFFER;
+    spec.flags = paNullFreeRunning;
+    spec.outputFile = RENDER_FILE;
+    err = PaNull_AddDevice( &spec );
+    if( err != paNoError ) goto error;
+
+    err = Pa_Initialize();
+    if( err != paNoError ) goto error;
+
+    printf("Rendering:\n");
+    data.maxFrames = NUM_SECONDS * SAMPLE_RATE;
+    err = runStream( 0, renderCallback, &data );
+    if( err != paNoError ) goto error;
+    renderedFrames = data.frames;
+    Pa_Terminate();
+
+    /* The device writes whole host buffers, the rest of the last one is silence */
+    renderedFileFrames = countWavFrames( RENDER_FILE );
+    if( renderedFileFrames != (long)( ( renderedFrames + FRAMES_PER_HOST_BUFFER - 1 ) / FRAMES_PER_HOST_BUFFER *
+                FRAMES_PER_HOST_BUFFER ) )
+    {
+        printf("Rendered %lu frames, but %s has %ld!\n", renderedFrames, RENDER_FILE, renderedFileFrames );
+        err = paInternalError;
+        goto error;
+    }
+
+    /* The device's input channels and sample rate are taken from the rendered file */
+    PaNull_ClearDevices();
+    spec.name = "Process";
+    spec.inputFile = RENDER_FILE;
+    spec.outputFile = PROCESS_FILE;
+    err = PaNull_AddDevice( &spec );
+    if( err != paNoError ) goto error;
+
+    err = Pa_Initialize();
+    if( err != paNoError ) goto error;
+
+    printf("Processing:\n");
+    data.frames = data.callbacks = 0;
+    err = runStream( NUM_CHANNELS, processCallback, &data );
+    if( err != paNoError ) goto error;
+    if( data.frames < renderedFrames )
+    {
+        printf("Processed %lu frames, but %lu were rendered!\n", data.frames, renderedFrames );
+        err = paInternalError;
+        goto error;
+    }
+    Pa_Terminate();
+
+    /* The output file ends with the input file */
+    processedFileFrames = countWavFrames( PROCESS_FILE );
+    if( processedFileFrames != renderedFileFrames )
+    {
+        printf("%s has %ld frames, but %s has %ld!\n", PROCESS_FILE, processedFileFrames, RENDER_FILE,
+                renderedFileFrames );
+        err = paInternalError;
+        goto error;
+    }
+    printf("%s and %s both have %ld frames.\n", RENDER_FILE, PROCESS_FILE, processedFileFrames );
+
+    PaNull_ClearDevices();
+    printf("Test finished.\n");
+    return err;
+
+error:
+    Pa_Terminate();
+    PaNull_ClearDevices();
+    fprintf( stderr, "An error occured while using the portaudio stream\n" );
+    fprintf( stderr, "Error number: %d\n", err );
+    fprintf( stderr, "Error message: %s\n", Pa_GetErrorText( err ) );
+    return err;
+}
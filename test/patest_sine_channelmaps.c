@@ -39,7 +39,7 @@
 /** @file patest_sine_channelmaps.c
 	@ingroup test_src
 	@brief Plays sine waves using sme simple channel maps.
-          Designed for use with CoreAudio, but should made to work with other APIs
+          Designed for use with CoreAudio, also works with ALSA. Should be made to work with other APIs
 	@author Bjorn Roche <bjorn@xowave.com>
    @author Ross Bencina <rossb@audiomulch.com>
    @author Phil Burk <philburk@softsynth.com>
@@ -51,6 +51,8 @@
 
 #ifdef __APPLE__
 #include "pa_mac_core.h"
+#elif defined(PA_USE_ALSA)
+#include "pa_linux_alsa.h"
 #endif
 
 #define NUM_SECONDS   (5)
@@ -112,6 +114,9 @@ int main(void)
 #ifdef __APPLE__
     PaMacCoreStreamInfo macInfo;
     const SInt32 channelMap[4] = { -1, -1, 0, 1 };
+#elif defined(PA_USE_ALSA)
+    PaAlsaStreamInfo alsaInfo;
+    const int channelSelectors[2] = { 2, 3 };
 #endif
     int i;
 
@@ -136,6 +141,10 @@ int main(void)
 
     for( i=0; i<4; ++i )
        printf( "channel %d name: %s\n", i, PaMacCore_GetChannelName( Pa_GetDefaultOutputDevice(), i, false ) );
+#elif defined(PA_USE_ALSA)
+    PaAlsa_InitializeStreamInfo( &alsaInfo );
+    alsaInfo.flags = paAlsaUseChannelSelectors;
+    alsaInfo.channelSelectors = channelSelectors;
 #else
     printf( "Channel mapping not supported on this platform. Reverting to normal sine test.\n" );
 #endif
@@ -150,6 +159,8 @@ int main(void)
     outputParameters.suggestedLatency = Pa_GetDeviceInfo( outputParameters.device )->defaultLowOutputLatency;
 #ifdef __APPLE__
     outputParameters.hostApiSpecificStreamInfo = &macInfo;
+#elif defined(PA_USE_ALSA)
+    outputParameters.hostApiSpecificStreamInfo = &alsaInfo;
 #else
     outputParameters.hostApiSpecificStreamInfo = NULL;
 #endif
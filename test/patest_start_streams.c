@@ -0,0 +1,164 @@
+/** @file patest_start_streams.c
+	@ingroup test_src
+	@brief Start the default input and output as separate streams with
+	Pa_StartStreams() and report the start skew.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com
+ * Copyright (c) 1999-2000 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "portaudio.h"
+
+#define SAMPLE_RATE         (44100)
+#define FRAMES_PER_BUFFER   (256)
+#define NUM_SECONDS         (3)
+#ifndef M_PI
+#define M_PI  (3.14159265)
+#endif
+
+typedef struct
+{
+    double phase;
+    unsigned long inputFrames;
+}
+paTestData;
+
+static int outputCallback( const void *inputBuffer, void *outputBuffer,
+                           unsigned long framesPerBuffer,
+                           const PaStreamCallbackTimeInfo* timeInfo,
+                           PaStreamCallbackFlags statusFlags,
+                           void *userData )
+{
+    paTestData *data = (paTestData*)userData;
+    float *out = (float*)outputBuffer;
+    unsigned long i;
+    (void) inputBuffer; (void) timeInfo; (void) statusFlags;
+
+    for( i=0; i<framesPerBuffer; i++ )
+    {
+        *out++ = (float) (0.2 * sin( data->phase ));
+        data->phase += 2. * M_PI * 440. / SAMPLE_RATE;
+        if( data->phase > 2. * M_PI ) data->phase -= 2. * M_PI;
+    }
+    return paContinue;
+}
+
+static int inputCallback( const void *inputBuffer, void *outputBuffer,
+                          unsigned long framesPerBuffer,
+                          const PaStreamCallbackTimeInfo* timeInfo,
+                          PaStreamCallbackFlags statusFlags,
+                          void *userData )
+{
+    paTestData *data = (paTestData*)userData;
+    (void) inputBuffer; (void) outputBuffer; (void) timeInfo; (void) statusFlags;
+
+    data->inputFrames += framesPerBuffer;
+    return paContinue;
+}
+
+/*******************************************************************/
+int main(void);
+int main(void)
+{
+    PaStreamParameters inputParameters, outputParameters;
+    PaStream *streams[2] = { NULL, NULL };
+    paTestData data = { 0., 0 };
+    PaTime skew;
+    PaError err;
+
+    printf("patest_start_streams: start input and output together, %d seconds.\n", NUM_SECONDS );
+
+    err = Pa_Initialize();
+    if( err != paNoError ) goto error;
+
+    inputParameters.device = Pa_GetDefaultInputDevice();
+    if( inputParameters.device == paNoDevice ) {
+        fprintf(stderr,"Error: No default input device.\n");
+        goto error;
+    }
+    inputParameters.channelCount = 1;
+    inputParameters.sampleFormat = paFloat32;
+    inputParameters.suggestedLatency = Pa_GetDeviceInfo( inputParameters.device )->defaultLowInputLatency;
+    inputParameters.hostApiSpecificStreamInfo = NULL;
+
+    outputParameters.device = Pa_GetDefaultOutputDevice();
+    if( outputParameters.device == paNoDevice ) {
+        fprintf(stderr,"Error: No default output device.\n");
+        goto error;
+    }
+    outputParameters.channelCount = 1;
+    outputParameters.sampleFormat = paFloat32;
+    outputParameters.suggestedLatency = Pa_GetDeviceInfo( outputParameters.device )->defaultLowOutputLatency;
+    outputParameters.hostApiSpecificStreamInfo = NULL;
+
+    err = Pa_OpenStream( &streams[0], &inputParameters, NULL, SAMPLE_RATE, FRAMES_PER_BUFFER,
+                         paClipOff, inputCallback, &data );
+    if( err != paNoError ) goto error;
+
+    err = Pa_OpenStream( &streams[1], NULL, &outputParameters, SAMPLE_RATE, FRAMES_PER_BUFFER,
+                         paClipOff, outputCallback, &data );
+    if( err != paNoError ) goto error;
+
+    err = Pa_StartStreams( streams, 2, &skew );
+    if( err != paNoError ) goto error;
+
+    printf("Start skew = %g msec\n", skew * 1000. );
+
+    Pa_Sleep( NUM_SECONDS * 1000 );
+
+    err = Pa_StopStreams( streams, 2 );
+    if( err != paNoError ) goto error;
+
+    printf("Input frames = %lu\n", data.inputFrames );
+
+    Pa_CloseStream( streams[0] );
+    Pa_CloseStream( streams[1] );
+    Pa_Terminate();
+    printf("Test finished.\n");
+    return err;
+
+error:
+    if( streams[0] ) Pa_CloseStream( streams[0] );
+    if( streams[1] ) Pa_CloseStream( streams[1] );
+    Pa_Terminate();
+    fprintf( stderr, "An error occured while using the portaudio stream\n" );
+    fprintf( stderr, "Error number: %d\n", err );
+    fprintf( stderr, "Error message: %s\n", Pa_GetErrorText( err ) );
+    return err;
+}
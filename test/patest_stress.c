@@ -0,0 +1,433 @@
+/** @file patest_stress.c
+	@ingroup test_src
+	@brief Stress test: open hundreds of concurrent streams and start, stop, abort and
+	close them at random from several threads, to measure the scaling limits of a host API.
+
+	Reports percentiles of the time taken by each operation, the rate of callbacks
+	which missed their deadline or were notified of an xrun, the CPU time used, and
+	the blocks allocated by PortAudio which are still allocated after all streams have
+	been closed and PortAudio has been terminated.
+
+	The leak count uses PaUtil_CountCurrentlyAllocatedBlocks(), which isn't exported by
+	the shared library: link this test with the static library, built with PA_TRACK_MEMORY
+	defined for the count to be meaningful. The test uses POSIX threads.
+
+	Usage: patest_stress [-d device] [-n streams] [-t threads] [-s seconds] [-i msec] [-b frames]
+
+	By default the streams are opened on the default output device of the null host API,
+	if it is built, otherwise on the default output device.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com
+ * Copyright (c) 1999-2000 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "portaudio.h"
+#include "pa_util.h"
+
+#define SAMPLE_RATE         (44100)
+#define NUM_CHANNELS        (2)
+#define NUM_STREAMS         (200)
+#define NUM_THREADS         (8)
+#define NUM_SECONDS         (10)
+/* Mean time between the operations of each thread */
+#define OPERATION_MSEC      (20)
+#define FRAMES_PER_BUFFER   (256)
+/* Operation times kept per thread and operation */
+#define MAX_SAMPLES         (100000)
+
+typedef enum
+{
+    OP_OPEN,
+    OP_START,
+    OP_STOP,
+    OP_ABORT,
+    OP_CLOSE,
+    NUM_OPS
+}
+Operation;
+
+static const char *operationNames[NUM_OPS] = { "open", "start", "stop", "abort", "close" };
+
+typedef struct
+{
+    pthread_mutex_t mutex;      /* Held by the thread operating on the stream */
+    PaStream *stream;
+    int active;
+    /* Written by the callback */
+    volatile unsigned long callbacks;
+    volatile unsigned long xruns;
+    volatile unsigned long lateCallbacks;
+}
+StreamSlot;
+
+typedef struct
+{
+    int index;
+    pthread_t thread;
+    unsigned int seed;
+    PaTime *samples[NUM_OPS];
+    int numSamples[NUM_OPS];
+    unsigned long failures[NUM_OPS];
+    PaError lastError;
+}
+Worker;
+
+static PaStreamParameters outputParameters;
+static unsigned long framesPerBuffer = FRAMES_PER_BUFFER;
+static StreamSlot *slots;
+static int numStreams = NUM_STREAMS;
+static int operationMsec = OPERATION_MSEC;
+static volatile int stopWorkers;
+
+/* Output silence, counting the callbacks which are notified of xruns, or called after
+   their output should have been played */
+static int stressCallback( const void *inputBuffer, void *outputBuffer,
+                           unsigned long frames,
+                           const PaStreamCallbackTimeInfo* timeInfo,
+                           PaStreamCallbackFlags statusFlags,
+                           void *userData )
+{
+    StreamSlot *slot = (StreamSlot*)userData;
+    (void) inputBuffer;
+
+    memset( outputBuffer, 0, frames * NUM_CHANNELS * sizeof(float) );
+
+    slot->callbacks++;
+    if( statusFlags & (paOutputUnderflow | paOutputOverflow) )
+        slot->xruns++;
+    else if( timeInfo->outputBufferDacTime > 0. && timeInfo->currentTime > timeInfo->outputBufferDacTime )
+        slot->lateCallbacks++;
+    return paContinue;
+}
+
+static PaError doOperation( Worker *worker, StreamSlot *slot, Operation op )
+{
+    PaTime start = PaUtil_GetTime();
+    PaError err;
+
+    switch( op )
+    {
+    case OP_OPEN:
+        err = Pa_OpenStream( &slot->stream, NULL, &outputParameters, SAMPLE_RATE, framesPerBuffer,
+                             paClipOff, stressCallback, slot );
+        if( err != paNoError ) slot->stream = NULL;
+        break;
+    case OP_START:
+        err = Pa_StartStream( slot->stream );
+        break;
+    case OP_STOP:
+        err = Pa_StopStream( slot->stream );
+        break;
+    case OP_ABORT:
+        err = Pa_AbortStream( slot->stream );
+        break;
+    default:
+        err = Pa_CloseStream( slot->stream );
+        slot->stream = NULL;
+        break;
+    }
+
+    if( err != paNoError )
+    {
+        worker->failures[op]++;
+        worker->lastError = err;
+        return err;
+    }
+    if( worker->numSamples[op] < MAX_SAMPLES )
+        worker->samples[op][ worker->numSamples[op]++ ] = PaUtil_GetTime() - start;
+    slot->active = ( op == OP_START );
+    return err;
+}
+
+/* Operate on random streams until stopWorkers is set: open closed streams, start or
+   close stopped ones, and stop or abort active ones */
+static void *workerThread( void *userData )
+{
+    Worker *worker = (Worker*)userData;
+    StreamSlot *slot;
+    int r;
+
+    while( !stopWorkers )
+    {
+        slot = &slots[ rand_r( &worker->seed ) % numStreams ];
+        if( pthread_mutex_trylock( &slot->mutex ) != 0 )
+            continue;
+
+        r = rand_r( &worker->seed ) % 10;
+        if( !slot->stream )
+            doOperation( worker, slot, OP_OPEN );
+        else if( !slot->active )
+            doOperation( worker, slot, r < 9 ? OP_START : OP_CLOSE );
+        else
+            doOperation( worker, slot, r < 5 ? OP_STOP : OP_ABORT );
+
+        pthread_mutex_unlock( &slot->mutex );
+
+        if( operationMsec > 0 )
+            Pa_Sleep( rand_r( &worker->seed ) % (2 * operationMsec + 1) );
+    }
+    return NULL;
+}
+
+static int compareTimes( const void *a, const void *b )
+{
+    PaTime x = *(const PaTime*)a, y = *(const PaTime*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void printPercentiles( Operation op, Worker *workers, int numThreads, PaTime *buffer )
+{
+    int i, count = 0;
+    unsigned long failures = 0;
+
+    for( i=0; i<numThreads; i++ )
+    {
+        memcpy( buffer + count, workers[i].samples[op], workers[i].numSamples[op] * sizeof(PaTime) );
+        count += workers[i].numSamples[op];
+        failures += workers[i].failures[op];
+    }
+    if( count == 0 )
+    {
+        printf("  %-6s %8d calls, %lu failed\n", operationNames[op], count, failures );
+        return;
+    }
+    qsort( buffer, count, sizeof(PaTime), compareTimes );
+    printf("  %-6s %8d calls, %lu failed, msec p50 %8.3f p90 %8.3f p99 %8.3f max %8.3f\n",
+            operationNames[op], count, failures, buffer[count / 2] * 1000., buffer[count * 9 / 10] * 1000.,
+            buffer[count * 99 / 100] * 1000., buffer[count - 1] * 1000. );
+}
+
+static double cpuSeconds( void )
+{
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+            ( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec ) * 1e-6;
+}
+
+static void usage( void )
+{
+    fprintf( stderr, "usage: patest_stress [-d device] [-n streams] [-t threads] [-s seconds] [-i msec] [-b frames]\n" );
+    fprintf( stderr, "  -d  output device index, default: null host API or default output device\n" );
+    fprintf( stderr, "  -n  number of streams, default %d\n", NUM_STREAMS );
+    fprintf( stderr, "  -t  number of threads operating on the streams, default %d\n", NUM_THREADS );
+    fprintf( stderr, "  -s  duration in seconds, default %d\n", NUM_SECONDS );
+    fprintf( stderr, "  -i  mean time between the operations of each thread in msec, default %d\n", OPERATION_MSEC );
+    fprintf( stderr, "  -b  frames per buffer, default %d\n", FRAMES_PER_BUFFER );
+}
+
+/*******************************************************************/
+int main( int argc, char **argv );
+int main( int argc, char **argv )
+{
+    PaDeviceIndex device = paNoDevice;
+    PaHostApiIndex nullHostApi;
+    int numThreads = NUM_THREADS, numRunning, numSeconds = NUM_SECONDS;
+    int blocksBefore, blocksClosed, blocksAfter;
+    Worker *workers = NULL;
+    PaTime *times = NULL;
+    PaTime start, elapsed;
+    double cpuStart, cpu;
+    unsigned long callbacks = 0, xruns = 0, lateCallbacks = 0;
+    int initialized = 0, i, op;
+    PaError err = paNoError;
+
+    for( i=1; i<argc; i++ )
+    {
+        if( argv[i][0] != '-' || i + 1 >= argc )
+        {
+            usage();
+            return 1;
+        }
+        switch( argv[i][1] )
+        {
+        case 'd': device = atoi( argv[++i] ); break;
+        case 'n': numStreams = atoi( argv[++i] ); break;
+        case 't': numThreads = atoi( argv[++i] ); break;
+        case 's': numSeconds = atoi( argv[++i] ); break;
+        case 'i': operationMsec = atoi( argv[++i] ); break;
+        case 'b': framesPerBuffer = atol( argv[++i] ); break;
+        default: usage(); return 1;
+        }
+    }
+    if( numStreams < 1 || numThreads < 1 )
+    {
+        usage();
+        return 1;
+    }
+
+    printf("patest_stress: %d streams, %d threads, %d seconds.\n", numStreams, numThreads, numSeconds );
+
+    blocksBefore = PaUtil_CountCurrentlyAllocatedBlocks();
+    err = Pa_Initialize();
+    if( err != paNoError ) goto error;
+    initialized = 1;
+
+    if( device == paNoDevice )
+    {
+        nullHostApi = Pa_HostApiTypeIdToHostApiIndex( paInDevelopment );
+        device = nullHostApi >= 0 ? Pa_GetHostApiInfo( nullHostApi )->defaultOutputDevice
+                                  : Pa_GetDefaultOutputDevice();
+    }
+    if( device < 0 || device >= Pa_GetDeviceCount() )
+    {
+        err = paInvalidDevice;
+        goto error;
+    }
+    printf("Device: %s (%s)\n", Pa_GetDeviceInfo( device )->name,
+            Pa_GetHostApiInfo( Pa_GetDeviceInfo( device )->hostApi )->name );
+
+    outputParameters.device = device;
+    outputParameters.channelCount = NUM_CHANNELS;
+    outputParameters.sampleFormat = paFloat32;
+    outputParameters.suggestedLatency = Pa_GetDeviceInfo( device )->defaultLowOutputLatency;
+    outputParameters.hostApiSpecificStreamInfo = NULL;
+
+    slots = (StreamSlot*)calloc( numStreams, sizeof(StreamSlot) );
+    workers = (Worker*)calloc( numThreads, sizeof(Worker) );
+    times = (PaTime*)malloc( numThreads * MAX_SAMPLES * sizeof(PaTime) );
+    if( !slots || !workers || !times )
+    {
+        err = paInsufficientMemory;
+        goto error;
+    }
+    for( i=0; i<numStreams; i++ )
+        pthread_mutex_init( &slots[i].mutex, NULL );
+    for( i=0; i<numThreads; i++ )
+    {
+        workers[i].index = i;
+        workers[i].seed = 1234 + i;
+        for( op=0; op<NUM_OPS; op++ )
+        {
+            workers[i].samples[op] = (PaTime*)malloc( MAX_SAMPLES * sizeof(PaTime) );
+            if( !workers[i].samples[op] )
+            {
+                err = paInsufficientMemory;
+                goto error;
+            }
+        }
+    }
+
+    /* Open and start all streams, spread over the threads' accounts, then operate on them at random */
+    start = PaUtil_GetTime();
+    cpuStart = cpuSeconds();
+    for( i=0; i<numStreams; i++ )
+    {
+        Worker *worker = &workers[ i % numThreads ];
+        if( doOperation( worker, &slots[i], OP_OPEN ) == paNoError )
+            doOperation( worker, &slots[i], OP_START );
+    }
+    printf("Opened and started %d streams in %g seconds.\n", numStreams, PaUtil_GetTime() - start );
+
+    stopWorkers = 0;
+    for( numRunning=0; numRunning<numThreads; numRunning++ )
+    {
+        if( pthread_create( &workers[numRunning].thread, NULL, workerThread, &workers[numRunning] ) != 0 )
+            break;
+    }
+    Pa_Sleep( numSeconds * 1000 );
+    stopWorkers = 1;
+    for( i=0; i<numRunning; i++ )
+        pthread_join( workers[i].thread, NULL );
+
+    for( i=0; i<numStreams; i++ )
+    {
+        if( slots[i].stream )
+            doOperation( &workers[0], &slots[i], OP_CLOSE );
+        callbacks += slots[i].callbacks;
+        xruns += slots[i].xruns;
+        lateCallbacks += slots[i].lateCallbacks;
+    }
+    elapsed = PaUtil_GetTime() - start;
+    cpu = cpuSeconds() - cpuStart;
+    blocksClosed = PaUtil_CountCurrentlyAllocatedBlocks();
+
+    printf("Operation times:\n");
+    for( op=0; op<NUM_OPS; op++ )
+        printPercentiles( (Operation)op, workers, numThreads, times );
+    for( i=0; i<numThreads; i++ )
+    {
+        if( workers[i].lastError != paNoError )
+            printf("  last error of thread %d: %s\n", i, Pa_GetErrorText( workers[i].lastError ) );
+    }
+    printf("Callbacks: %lu, missed: %lu with xruns (%.3f%%), %lu late (%.3f%%)\n", callbacks,
+            xruns, callbacks ? 100. * xruns / callbacks : 0., lateCallbacks,
+            callbacks ? 100. * lateCallbacks / callbacks : 0. );
+    printf("CPU: %g seconds in %g seconds, %.1f%% of a core\n", cpu, elapsed, 100. * cpu / elapsed );
+
+    /* The open stream tables are only freed by Pa_Terminate() */
+    Pa_Terminate();
+    initialized = 0;
+    blocksAfter = PaUtil_CountCurrentlyAllocatedBlocks();
+    printf("Allocated blocks: %d after closing all streams, %d leaked after termination\n",
+            blocksClosed, blocksAfter - blocksBefore );
+
+    err = blocksAfter != blocksBefore ? paInternalError : paNoError;
+
+error:
+    if( initialized )
+        Pa_Terminate();
+    if( workers )
+    {
+        for( i=0; i<numThreads; i++ )
+            for( op=0; op<NUM_OPS; op++ )
+                free( workers[i].samples[op] );
+    }
+    if( slots )
+    {
+        for( i=0; i<numStreams; i++ )
+            pthread_mutex_destroy( &slots[i].mutex );
+    }
+    free( workers );
+    free( times );
+    free( slots );
+    if( err != paNoError )
+    {
+        fprintf( stderr, "An error occured while using the portaudio stream\n" );
+        fprintf( stderr, "Error number: %d\n", err );
+        fprintf( stderr, "Error message: %s\n", Pa_GetErrorText( err ) );
+    }
+    else
+        printf("Test finished.\n");
+    return err;
+}